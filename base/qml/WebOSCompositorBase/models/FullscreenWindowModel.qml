@@ -19,10 +19,6 @@ import WebOSCoreCompositor 1.0
 
 WindowModel {
     surfaceSource: compositor.surfaceModel
-    acceptFunction: "filter"
-
-    function filter(surfaceItem) {
-        return surfaceItem.fullscreen &&
-               surfaceItem.displayAffinity == compositorWindow.displayId;
-    }
+    fullscreenOnly: true
+    displayId: compositorWindow.displayId
 }
@@ -20,10 +20,5 @@ import WebOSCoreCompositor 1.0
 WindowModel {
     surfaceSource: compositor.surfaceModel
     windowType: "_WEBOS_WINDOW_TYPE_SYSTEM_UI"
-    acceptFunction: "filter"
-
-    function filter(surfaceItem) {
-        return surfaceItem.type === windowType &&
-               surfaceItem.displayAffinity == compositorWindow.displayId;
-    }
+    displayId: compositorWindow.displayId
 }
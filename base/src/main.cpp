@@ -117,19 +117,15 @@ static gboolean deferredDeleter(gpointer data)
     return true;
 }
 
-int main(int argc, char *argv[])
+// Everything up to the event loop, profiled as one span
+static WebOSCoreCompositor *boot(Profiler &profiler)
 {
-    Profiler profiler;
-#ifdef CURSOR_THEME
-    qputenv("QT_QPA_EGLFS_CURSOR", EGLFS_CURSOR_DESCRIPTION);
-#endif
-    qInstallMessageHandler(WebOSCoreCompositor::logger);
+    Profiler::Span bootSpan("boot");
 
-    // We want the main compositor window to be able to be transparent
-    QQuickWindow::setDefaultAlphaBuffer(true);
-
-    QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts, true);
-    QGuiApplication app(argc, argv);
+    {
+        Profiler::Span span("config");
+        WebOSCompositorConfig::instance();
+    }
 
     WebOSCompositorWindow *compositorWindow = NULL;
     WebOSCoreCompositor *compositor = NULL;
@@ -139,6 +135,7 @@ int main(int argc, char *argv[])
     QString compositorPluginName = WebOSCompositorConfig::instance()->compositorPlugin();
     bool usePlugin = false;
     if (!compositorPluginName.isEmpty()) {
+        Profiler::Span span("plugin-load", compositorPluginName);
         compositorPluginLoader = new WebOSCompositorPluginLoader(compositorPluginName);
         compositorWindow = compositorPluginLoader->compositorWindow(WebOSCompositorConfig::instance()->primaryScreen(), WebOSCompositorConfig::instance()->geometryString());
         compositor = compositorPluginLoader->compositor();
@@ -175,14 +172,28 @@ int main(int argc, char *argv[])
        where extended compositor installs filters. */
     compositorWindow->installEventFilter(new EventFilter(compositor));
 
-    compositor->create();
-    compositor->registerWindow(compositorWindow, WebOSCompositorConfig::instance()->primaryScreen());
-    compositor->registerTypes();
+    {
+        Profiler::Span span("create");
+        compositor->create();
+    }
+
+    {
+        Profiler::Span span("registerWindow", WebOSCompositorConfig::instance()->primaryScreen());
+        compositor->registerWindow(compositorWindow, WebOSCompositorConfig::instance()->primaryScreen());
+    }
+
+    {
+        Profiler::Span span("registerTypes");
+        compositor->registerTypes();
+    }
 
     // Register resource files if exist (the first takes precedence)
-    QResource::registerResource(WEBOS_INSTALL_QML "/WebOSCompositorExtended/WebOSCompositorExtended.rcc");
-    QResource::registerResource(WEBOS_INSTALL_QML "/WebOSCompositor/WebOSCompositor.rcc");
-    QResource::registerResource(WEBOS_INSTALL_QML "/WebOSCompositorBase/WebOSCompositorBase.rcc");
+    {
+        Profiler::Span span("registerResource");
+        QResource::registerResource(WEBOS_INSTALL_QML "/WebOSCompositorExtended/WebOSCompositorExtended.rcc");
+        QResource::registerResource(WEBOS_INSTALL_QML "/WebOSCompositor/WebOSCompositor.rcc");
+        QResource::registerResource(WEBOS_INSTALL_QML "/WebOSCompositorBase/WebOSCompositorBase.rcc");
+    }
 
     compositorWindow->setCompositor(compositor);
     compositorWindow->setCompositorMain(WebOSCompositorConfig::instance()->source(), WebOSCompositorConfig::instance()->importPath());
@@ -198,11 +209,13 @@ int main(int argc, char *argv[])
         displays = actualDisplays;
     }
     if (displays > 1) {
+        Profiler::Span span("extraWindows");
         qInfo() << "Initializing extra windows, expected" << displays - 1;
         QList<WebOSCompositorWindow *> extraWindows = WebOSCompositorWindow::initializeExtraWindows(compositor, displays - 1, usePlugin ? compositorPluginLoader : nullptr);
         for (int i = 0; i < extraWindows.size(); i++) {
             WebOSCompositorWindow *extraWindow = extraWindows.at(i);
             windowCount++;
+            profiler.addWindow(extraWindow);
             extraWindow->showWindow();
             qInfo() << "Initialized an extra window" << extraWindow;
         }
@@ -212,7 +225,10 @@ int main(int argc, char *argv[])
     }
 
     // Optional post initialization after the compositor and compositor windows get initialized
-    compositor->postInit();
+    {
+        Profiler::Span span("postInit");
+        compositor->postInit();
+    }
 
 #ifdef UPSTART_SIGNALING
     if (compositor->autoStart())
@@ -232,6 +248,25 @@ int main(int argc, char *argv[])
 
     g_timeout_add(10000, (GSourceFunc)deferredDeleter, NULL);
 
+    return compositor;
+}
+
+int main(int argc, char *argv[])
+{
+    Profiler profiler;
+#ifdef CURSOR_THEME
+    qputenv("QT_QPA_EGLFS_CURSOR", EGLFS_CURSOR_DESCRIPTION);
+#endif
+    qInstallMessageHandler(WebOSCoreCompositor::logger);
+
+    // We want the main compositor window to be able to be transparent
+    QQuickWindow::setDefaultAlphaBuffer(true);
+
+    QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts, true);
+    QGuiApplication app(argc, argv);
+
+    WebOSCoreCompositor *compositor = boot(profiler);
+
     emit compositor->eventLoopReady();
 
     return app.exec();
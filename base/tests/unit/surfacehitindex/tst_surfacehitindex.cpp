@@ -0,0 +1,333 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <QGuiApplication>
+#include <QQuickItem>
+#include <QtTest>
+
+#include <private/qquickitem_p.h>
+
+#include "surfacehitindex.h"
+#include "weboscorecompositor.h"
+#include "webossurfaceitem.h"
+
+static const QSizeF SCENE_SIZE(1920, 1080);
+static const int COLUMNS = 10;
+static const qreal TILE_WIDTH = SCENE_SIZE.width() / COLUMNS;
+static const qreal TILE_HEIGHT = SCENE_SIZE.height() / COLUMNS;
+
+// The recursive paint order walk the index replaces, as a baseline
+static WebOSSurfaceItem *paintOrderItemAt(QQuickItem *base, const QPointF &scenePoint)
+{
+    if (!base->isVisible() || !base->isEnabled())
+        return nullptr;
+
+    const QList<QQuickItem *> children = QQuickItemPrivate::get(base)->paintOrderChildItems();
+    for (int i = children.count() - 1; i >= 0; --i) {
+        if (WebOSSurfaceItem *item = paintOrderItemAt(children.at(i), scenePoint))
+            return item;
+    }
+
+    WebOSSurfaceItem *item = qobject_cast<WebOSSurfaceItem *>(base);
+    if (item && item->QQuickItem::contains(item->mapFromScene(scenePoint)))
+        return item;
+    return nullptr;
+}
+
+class TestSurfaceHitIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+    void matchesPaintOrder();
+    void moveWithoutRebuild();
+    void ancestorMove();
+    void stacking();
+    void disabledSubtree();
+    void hiddenSubtree();
+    void destroyedItem();
+    void sceneResize();
+
+    void benchItemAt_data();
+    void benchItemAt();
+    void benchItemAtAfterMove_data();
+    void benchItemAtAfterMove();
+    void benchPaintOrderWalk_data();
+    void benchPaintOrderWalk();
+
+private:
+    void createScene(int count);
+    QPointF centerOf(QQuickItem *item) const;
+    void verifyPaintOrder();
+
+    WebOSCoreCompositor *m_compositor = nullptr;
+    QQuickItem *m_root = nullptr;
+    SurfaceHitIndex *m_index = nullptr;
+    QList<QQuickItem *> m_rows;
+    QList<WebOSSurfaceItem *> m_items;
+};
+
+void TestSurfaceHitIndex::initTestCase()
+{
+    m_compositor = new WebOSCoreCompositor(WebOSCoreCompositor::NoExtensions);
+}
+
+void TestSurfaceHitIndex::cleanupTestCase()
+{
+    delete m_compositor;
+    m_compositor = nullptr;
+}
+
+void TestSurfaceHitIndex::init()
+{
+    m_root = new QQuickItem;
+    m_root->setSize(SCENE_SIZE);
+    m_index = new SurfaceHitIndex(m_root);
+    m_index->setSceneSize(SCENE_SIZE);
+}
+
+void TestSurfaceHitIndex::cleanup()
+{
+    // Surface items are not QObject children of their containers
+    qDeleteAll(m_items);
+    delete m_index;
+    m_index = nullptr;
+    delete m_root;
+    m_root = nullptr;
+    m_rows.clear();
+    m_items.clear();
+}
+
+/* Surfaces in rows of COLUMNS tiles, each row in its own container as
+   with the layers of the compositor. Beyond COLUMNS rows the tiles start
+   over from the top and overlap the earlier ones, stacked above them. */
+void TestSurfaceHitIndex::createScene(int count)
+{
+    for (int i = 0; i < count; ++i) {
+        const int row = i / COLUMNS;
+        if (row == m_rows.size()) {
+            QQuickItem *container = new QQuickItem(m_root);
+            container->setY((row % COLUMNS) * TILE_HEIGHT);
+            container->setSize(QSizeF(SCENE_SIZE.width(), TILE_HEIGHT));
+            container->setZ(row);
+            m_rows.append(container);
+        }
+
+        WebOSSurfaceItem *item = new WebOSSurfaceItem(m_compositor, nullptr);
+        item->setParentItem(m_rows.at(row));
+        item->setX((i % COLUMNS) * TILE_WIDTH);
+        item->setSize(QSizeF(TILE_WIDTH, TILE_HEIGHT));
+        m_items.append(item);
+        m_index->addItem(item);
+    }
+}
+
+QPointF TestSurfaceHitIndex::centerOf(QQuickItem *item) const
+{
+    return item->mapToScene(QPointF(item->width() / 2, item->height() / 2));
+}
+
+void TestSurfaceHitIndex::verifyPaintOrder()
+{
+    for (qreal y = TILE_HEIGHT / 4; y < SCENE_SIZE.height(); y += TILE_HEIGHT / 2) {
+        for (qreal x = TILE_WIDTH / 4; x < SCENE_SIZE.width(); x += TILE_WIDTH / 2) {
+            const QPointF point(x, y);
+            QCOMPARE(m_index->itemAt(point), paintOrderItemAt(m_root, point));
+        }
+    }
+}
+
+void TestSurfaceHitIndex::matchesPaintOrder()
+{
+    createScene(150);
+    verifyPaintOrder();
+    QCOMPARE(m_index->itemAt(QPointF(-10, -10)), nullptr);
+    QCOMPARE(m_index->itemAt(centerOf(m_items.last())), m_items.last());
+}
+
+void TestSurfaceHitIndex::moveWithoutRebuild()
+{
+    createScene(20);
+    m_index->itemAt(QPointF());
+    const int rebuilds = m_index->rebuildCount();
+
+    WebOSSurfaceItem *item = m_items.at(3);
+    const QPointF oldCenter = centerOf(item);
+    item->setX(item->x() + 5 * TILE_WIDTH);
+    item->setY(item->y() + 5 * TILE_HEIGHT);
+
+    QCOMPARE(m_index->itemAt(centerOf(item)), item);
+    QCOMPARE(m_index->itemAt(oldCenter), nullptr);
+    QCOMPARE(m_index->rebuildCount(), rebuilds);
+    verifyPaintOrder();
+}
+
+void TestSurfaceHitIndex::ancestorMove()
+{
+    createScene(20);
+    m_index->itemAt(QPointF());
+    const int rebuilds = m_index->rebuildCount();
+
+    m_rows.at(0)->setY(4 * TILE_HEIGHT);
+
+    QCOMPARE(m_index->itemAt(centerOf(m_items.at(0))), m_items.at(0));
+    QCOMPARE(m_index->rebuildCount(), rebuilds);
+    verifyPaintOrder();
+}
+
+void TestSurfaceHitIndex::stacking()
+{
+    createScene(2 * COLUMNS);
+
+    // Move the second row over the first, then stack it below
+    m_rows.at(1)->setY(0);
+    QCOMPARE(m_index->itemAt(centerOf(m_items.at(0))), m_items.at(COLUMNS));
+
+    m_rows.at(1)->setZ(-1);
+    QCOMPARE(m_index->itemAt(centerOf(m_items.at(0))), m_items.at(0));
+
+    // Among siblings
+    m_items.at(1)->setX(m_items.at(0)->x());
+    QCOMPARE(m_index->itemAt(centerOf(m_items.at(0))), m_items.at(1));
+    m_items.at(0)->setZ(1);
+    QCOMPARE(m_index->itemAt(centerOf(m_items.at(0))), m_items.at(0));
+    verifyPaintOrder();
+}
+
+// Enabling a subtree again brings its surfaces back
+void TestSurfaceHitIndex::disabledSubtree()
+{
+    createScene(2 * COLUMNS);
+    const QPointF point = centerOf(m_items.at(2));
+
+    m_rows.at(0)->setEnabled(false);
+    QCOMPARE(m_index->itemAt(point), nullptr);
+    verifyPaintOrder();
+
+    m_rows.at(0)->setEnabled(true);
+    QCOMPARE(m_index->itemAt(point), m_items.at(2));
+    verifyPaintOrder();
+}
+
+void TestSurfaceHitIndex::hiddenSubtree()
+{
+    createScene(2 * COLUMNS);
+    const QPointF point = centerOf(m_items.at(2));
+
+    m_rows.at(0)->setVisible(false);
+    QCOMPARE(m_index->itemAt(point), nullptr);
+
+    m_rows.at(0)->setVisible(true);
+    QCOMPARE(m_index->itemAt(point), m_items.at(2));
+    verifyPaintOrder();
+}
+
+void TestSurfaceHitIndex::destroyedItem()
+{
+    createScene(COLUMNS);
+    const QPointF point = centerOf(m_items.at(4));
+    m_index->itemAt(point);
+
+    delete m_items.takeAt(4);
+    QCOMPARE(m_index->itemAt(point), nullptr);
+    verifyPaintOrder();
+
+    // A container going away takes its surfaces out of the scene
+    delete m_rows.takeFirst();
+    QCOMPARE(m_index->itemAt(QPointF(TILE_WIDTH / 2, TILE_HEIGHT / 2)), nullptr);
+}
+
+void TestSurfaceHitIndex::sceneResize()
+{
+    createScene(COLUMNS);
+
+    m_index->setSceneSize(SCENE_SIZE / 2);
+    QCOMPARE(m_index->itemAt(centerOf(m_items.last())), m_items.last());
+    m_index->setSceneSize(SCENE_SIZE);
+    verifyPaintOrder();
+}
+
+void TestSurfaceHitIndex::benchItemAt_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("10") << 10;
+    QTest::newRow("50") << 50;
+    QTest::newRow("200") << 200;
+}
+
+// Repeated lookups on an unchanged scene, as with hover and tablet moves
+void TestSurfaceHitIndex::benchItemAt()
+{
+    QFETCH(int, count);
+    createScene(count);
+    const QPointF point = centerOf(m_items.first());
+
+    QBENCHMARK {
+        m_index->itemAt(point);
+    }
+}
+
+void TestSurfaceHitIndex::benchItemAtAfterMove_data()
+{
+    benchItemAt_data();
+}
+
+// A surface moving under the pointer, as with TouchHighlight
+void TestSurfaceHitIndex::benchItemAtAfterMove()
+{
+    QFETCH(int, count);
+    createScene(count);
+    WebOSSurfaceItem *item = m_items.first();
+    qreal dx = 1;
+
+    QBENCHMARK {
+        item->setX(item->x() + dx);
+        dx = -dx;
+        m_index->itemAt(centerOf(item));
+    }
+}
+
+void TestSurfaceHitIndex::benchPaintOrderWalk_data()
+{
+    benchItemAt_data();
+}
+
+void TestSurfaceHitIndex::benchPaintOrderWalk()
+{
+    QFETCH(int, count);
+    createScene(count);
+    const QPointF point = centerOf(m_items.first());
+
+    QBENCHMARK {
+        paintOrderItemAt(m_root, point);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+    TestSurfaceHitIndex test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_surfacehitindex.moc"
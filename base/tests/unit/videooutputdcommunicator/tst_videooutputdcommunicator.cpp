@@ -0,0 +1,239 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <QCoreApplication>
+#include <QtTest>
+
+#include "videooutputd_communicator.h"
+
+// Keeps what was sent as text, in order
+class RecordingTransport : public VideoOutputdTransport
+{
+public:
+    void send(const VideoOutputdBatch &batch) override
+    {
+        batches++;
+        foreach (const VideoOutputdBatch::Request &r, batch.requests) {
+            switch (r.type) {
+            case VideoOutputdBatch::Request::DisplayWindow:
+                log << QStringLiteral("%1 window=%2").arg(batch.contextId).arg(r.destinationRect.x());
+                break;
+            case VideoOutputdBatch::Request::CropRegion:
+                log << QStringLiteral("%1 crop=%2").arg(batch.contextId).arg(r.destinationRect.x());
+                break;
+            case VideoOutputdBatch::Request::Property:
+                log << QStringLiteral("%1 %2=%3").arg(batch.contextId, r.name, r.value);
+                break;
+            case VideoOutputdBatch::Request::Compositing:
+                log << QStringLiteral("%1 %2=%3").arg(batch.contextId, r.name).arg(r.intValue);
+                break;
+            }
+        }
+    }
+
+    QStringList log;
+    int batches = 0;
+};
+
+class TestVideoOutputdCommunicator : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void batchingOffByDefault();
+    void immediate();
+    void batchedOnNextPass();
+    void globalOrder();
+    void coalesceGeometry();
+    void keepDependentRequests();
+
+    void benchFrame_data();
+    void benchFrame();
+
+private:
+    void setDisplayWindow(const QString &contextId, int x);
+    void processQueuedFlush();
+
+    VideoOutputdCommunicator *m_communicator = nullptr;
+    RecordingTransport *m_transport = nullptr;
+};
+
+void TestVideoOutputdCommunicator::initTestCase()
+{
+    qunsetenv("WEBOS_VIDEOOUTPUTD_BATCH");
+}
+
+void TestVideoOutputdCommunicator::init()
+{
+    m_communicator = VideoOutputdCommunicator::instance();
+    m_transport = new RecordingTransport;
+    m_communicator->setTransport(m_transport);
+}
+
+void TestVideoOutputdCommunicator::cleanup()
+{
+    // Takes the transport with it
+    VideoOutputdCommunicator::resetInstance();
+    m_communicator = nullptr;
+    m_transport = nullptr;
+}
+
+void TestVideoOutputdCommunicator::setDisplayWindow(const QString &contextId, int x)
+{
+    m_communicator->setDisplayWindow(QRect(0, 0, 1920, 1080), QRect(x, 0, 640, 360), QRect(0, 0, 1920, 1080), contextId);
+}
+
+// The queued flush, as the event loop would run it
+void TestVideoOutputdCommunicator::processQueuedFlush()
+{
+    QCoreApplication::sendPostedEvents(m_communicator, QEvent::MetaCall);
+}
+
+void TestVideoOutputdCommunicator::batchingOffByDefault()
+{
+    QVERIFY(!m_communicator->batching());
+}
+
+void TestVideoOutputdCommunicator::immediate()
+{
+    m_communicator->setProperty("mute", "on", "A");
+    setDisplayWindow("A", 10);
+    setDisplayWindow("A", 20);
+    QCOMPARE(m_transport->log, (QStringList{"A mute=on", "A window=10", "A window=20"}));
+    QCOMPARE(m_transport->batches, 3);
+}
+
+void TestVideoOutputdCommunicator::batchedOnNextPass()
+{
+    m_communicator->setBatching(true);
+    setDisplayWindow("A", 10);
+    m_communicator->setVideoCompositing("zorder", 1, "A");
+    QVERIFY(m_transport->log.isEmpty());
+
+    processQueuedFlush();
+    QCOMPARE(m_transport->log, (QStringList{"A window=10", "A zorder=1"}));
+    QCOMPARE(m_transport->batches, 1);
+}
+
+// Moving the mute owner, as WebOSExported::registerMuteOwner does
+void TestVideoOutputdCommunicator::globalOrder()
+{
+    m_communicator->setBatching(true);
+    m_communicator->setProperty("registerMute", "on", "A");
+    m_communicator->setProperty("mute", "off", "A");
+    m_communicator->setProperty("registerMute", "off", "A");
+    m_communicator->setProperty("registerMute", "on", "B");
+    m_communicator->setProperty("mute", "on", "B");
+    processQueuedFlush();
+
+    QCOMPARE(m_transport->log, (QStringList{"A registerMute=on", "A mute=off", "A registerMute=off",
+                                            "B registerMute=on", "B mute=on"}));
+    QCOMPARE(m_transport->batches, 2);
+}
+
+// Two videos moving in the same frame send their final geometry only
+void TestVideoOutputdCommunicator::coalesceGeometry()
+{
+    m_communicator->setBatching(true);
+    for (int x = 1; x <= 3; ++x) {
+        setDisplayWindow("A", x);
+        setDisplayWindow("B", 10 * x);
+    }
+    m_communicator->setCropRegion(QRect(), QRect(), QRect(4, 0, 1, 1), QRect(), "A");
+    processQueuedFlush();
+
+    QCOMPARE(m_transport->log, (QStringList{"B window=30", "A crop=4"}));
+}
+
+// A request only replaces a pending one it may overtake
+void TestVideoOutputdCommunicator::keepDependentRequests()
+{
+    m_communicator->setBatching(true);
+    m_communicator->setProperty("mute", "on", "A");
+    m_communicator->setProperty("registerMute", "on", "B");
+    m_communicator->setProperty("mute", "off", "A");
+    setDisplayWindow("A", 1);
+    m_communicator->setVideoCompositing("zorder", 2, "B");
+    setDisplayWindow("A", 2);
+    m_communicator->setProperty("mute", "on", "A");
+    processQueuedFlush();
+
+    QCOMPARE(m_transport->log, (QStringList{"A mute=on", "B registerMute=on", "A mute=off", "A window=1",
+                                            "B zorder=2", "A window=2", "A mute=on"}));
+}
+
+void TestVideoOutputdCommunicator::benchFrame_data()
+{
+    QTest::addColumn<bool>("batching");
+    QTest::addColumn<int>("contexts");
+    QTest::addColumn<int>("updates");
+
+    for (bool batching : {false, true}) {
+        for (int contexts : {1, 4}) {
+            for (int updates : {1, 8}) {
+                const QByteArray name = QByteArray(batching ? "batched" : "immediate") + " "
+                    + QByteArray::number(contexts) + "x" + QByteArray::number(updates);
+                QTest::newRow(name.constData()) << batching << contexts << updates;
+            }
+        }
+    }
+}
+
+/* One frame of video geometry updates for a number of contexts, each
+   moved several times in the frame, sent to the loopback transport.
+   The queueing latency is what batching adds until the request is sent. */
+void TestVideoOutputdCommunicator::benchFrame()
+{
+    QFETCH(bool, batching);
+    QFETCH(int, contexts);
+    QFETCH(int, updates);
+
+    VideoOutputdLoopbackTransport *loopback = new VideoOutputdLoopbackTransport;
+    m_communicator->setTransport(loopback);
+    m_communicator->setBatching(batching);
+
+    QStringList contextIds;
+    for (int i = 0; i < contexts; ++i)
+        contextIds << QStringLiteral("context%1").arg(i);
+
+    int x = 0;
+    QBENCHMARK {
+        for (int u = 0; u < updates; ++u) {
+            x = (x + 1) % 1920;
+            foreach (const QString &contextId, contextIds)
+                setDisplayWindow(contextId, x);
+        }
+        processQueuedFlush();
+    }
+
+    QVERIFY(loopback->batchCount() > 0);
+    QCOMPARE(loopback->states().value(contextIds.last()).destinationRect.x(), x);
+    qInfo() << loopback->requestCount() / loopback->batchCount() << "requests per batch, queueing latency avg"
+            << loopback->averageLatencyNs() / 1000.0 << "us max" << loopback->maxLatencyNs() / 1000.0 << "us";
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    TestVideoOutputdCommunicator test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_videooutputdcommunicator.moc"
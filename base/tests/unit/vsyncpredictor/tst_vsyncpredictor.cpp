@@ -0,0 +1,170 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <QCoreApplication>
+#include <QtTest>
+
+#include "vsyncpredictor.h"
+
+static const qint64 PERIOD_60HZ = 1000000000 / 60;
+static const qint64 PERIOD_59_94HZ = Q_INT64_C(1000000000) * 1001 / 60000;
+static const qint64 PERIOD_50HZ = 1000000000 / 50;
+// Somewhere well into CLOCK_MONOTONIC
+static const qint64 START = Q_INT64_C(1000000000000);
+
+// Deviations of the reported flip times, up to half a millisecond
+static const qint64 JITTER[] = { 300000, -450000, 120000, -200000, 480000, -60000, -350000, 250000 };
+
+class TestVsyncPredictor : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void nominalUntilLocked();
+    void jitteredTimestamps();
+    void missedVsyncs();
+    void periodReEstimation();
+    void timingJump();
+    void sequenceRestart();
+};
+
+void TestVsyncPredictor::nominalUntilLocked()
+{
+    VsyncPredictor predictor(PERIOD_60HZ);
+    QVERIFY(!predictor.isValid());
+    QCOMPARE(predictor.period(), PERIOD_60HZ);
+
+    // A display a bit off the nominal rate
+    const qint64 actual = PERIOD_60HZ + 100000;
+    for (quint32 seq = 1; seq <= 3; seq++) {
+        predictor.addFlip(seq, START + seq * actual);
+        QVERIFY(predictor.isValid());
+        QVERIFY(!predictor.isLocked());
+        QCOMPARE(predictor.period(), PERIOD_60HZ);
+        QCOMPARE(predictor.lastFlip(), START + seq * actual);
+    }
+
+    predictor.addFlip(4, START + 4 * actual);
+    QVERIFY(predictor.isLocked());
+    QVERIFY(qAbs(predictor.period() - actual) <= 1);
+}
+
+void TestVsyncPredictor::jitteredTimestamps()
+{
+    VsyncPredictor predictor(PERIOD_60HZ);
+    const int count = 64;
+    for (int i = 0; i < count; i++)
+        predictor.addFlip(i + 1, START + i * PERIOD_60HZ + JITTER[i % 8]);
+
+    // The fit follows the actual vsyncs rather than the last sample
+    QVERIFY(predictor.isLocked());
+    QVERIFY(qAbs(predictor.period() - PERIOD_60HZ) < 100000);
+    const qint64 last = START + (count - 1) * PERIOD_60HZ;
+    QVERIFY(qAbs(predictor.lastFlip() - last) < 500000);
+
+    const qint64 next = predictor.nextFlipAfter(last + PERIOD_60HZ / 4);
+    QVERIFY(qAbs(next - (last + PERIOD_60HZ)) < 500000);
+    QCOMPARE(predictor.nextFlipAfter(last - 10 * PERIOD_60HZ), predictor.lastFlip());
+}
+
+void TestVsyncPredictor::missedVsyncs()
+{
+    VsyncPredictor predictor(PERIOD_60HZ);
+    quint32 seq = 1;
+    for (int i = 0; i < 32; i++) {
+        predictor.addFlip(seq, START + seq * PERIOD_60HZ);
+        // Every other frame misses one to three vsyncs
+        seq += (i % 2) ? 1 + (i % 3) + 1 : 1;
+        QCOMPARE(predictor.isLocked(), i >= 3);
+    }
+
+    QVERIFY(qAbs(predictor.period() - PERIOD_60HZ) <= 1);
+    const qint64 last = predictor.lastFlip();
+    QVERIFY(qAbs(predictor.nextFlipAfter(last + 3 * PERIOD_60HZ + 1000) - (last + 4 * PERIOD_60HZ)) <= 4);
+}
+
+void TestVsyncPredictor::periodReEstimation()
+{
+    VsyncPredictor predictor(PERIOD_60HZ);
+    quint32 seq = 1;
+    qint64 time = START;
+    for (int i = 0; i < 16; i++, seq++) {
+        time += PERIOD_60HZ;
+        predictor.addFlip(seq, time);
+    }
+    QVERIFY(qAbs(predictor.period() - PERIOD_60HZ) <= 1);
+
+    // A slightly slower rate does not look like a jump, the fit moves
+    // over to it until the old flips are out of the window
+    for (int i = 0; i < 16; i++, seq++) {
+        time += PERIOD_59_94HZ;
+        predictor.addFlip(seq, time);
+        QVERIFY(predictor.isLocked());
+    }
+    QVERIFY(qAbs(predictor.period() - PERIOD_59_94HZ) <= 1);
+    QVERIFY(qAbs(predictor.lastFlip() - time) <= 16);
+
+    // A new nominal rate starts over
+    predictor.setNominalPeriod(PERIOD_50HZ);
+    QVERIFY(!predictor.isValid());
+    QCOMPARE(predictor.period(), PERIOD_50HZ);
+}
+
+// A flip far from the prediction, as after a mode set, drops the history
+void TestVsyncPredictor::timingJump()
+{
+    VsyncPredictor predictor(PERIOD_60HZ);
+    quint32 seq = 1;
+    for (; seq <= 8; seq++)
+        predictor.addFlip(seq, START + seq * PERIOD_60HZ);
+    QVERIFY(predictor.isLocked());
+
+    const qint64 jumped = START + seq * PERIOD_60HZ + PERIOD_60HZ * 3 / 4;
+    predictor.addFlip(seq, jumped);
+    QVERIFY(predictor.isValid());
+    QVERIFY(!predictor.isLocked());
+    QCOMPARE(predictor.period(), PERIOD_60HZ);
+    QCOMPARE(predictor.lastFlip(), jumped);
+}
+
+void TestVsyncPredictor::sequenceRestart()
+{
+    VsyncPredictor predictor(PERIOD_60HZ);
+    for (quint32 seq = 1; seq <= 8; seq++)
+        predictor.addFlip(seq, START + seq * PERIOD_60HZ);
+    QVERIFY(predictor.isLocked());
+
+    // The same sequence again, as from a restarted counter
+    predictor.addFlip(8, START + 9 * PERIOD_60HZ);
+    QVERIFY(!predictor.isLocked());
+
+    // A timestamp going backwards
+    for (quint32 seq = 9; seq <= 16; seq++)
+        predictor.addFlip(seq, START + (seq + 1) * PERIOD_60HZ);
+    QVERIFY(predictor.isLocked());
+    predictor.addFlip(17, START);
+    QVERIFY(!predictor.isLocked());
+    QCOMPARE(predictor.lastFlip(), START);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    TestVsyncPredictor test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_vsyncpredictor.moc"
@@ -0,0 +1,169 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QtTest>
+
+#include "weboscompositorlogging.h"
+
+Q_LOGGING_CATEGORY(lsmTest, "lsm.test", QtInfoMsg)
+
+static int s_messages = 0;
+
+// Counts instead of printing, so that benchmarks measure the call sites
+// and not the terminal.
+static void countingHandler(QtMsgType, const QMessageLogContext &, const QString &)
+{
+    s_messages++;
+}
+
+static int s_evaluated = 0;
+
+static int expensiveArgument()
+{
+    s_evaluated++;
+    return s_evaluated;
+}
+
+class TestWebOSCompositorLogging : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+
+    void debugDisabledByDefault();
+    void limiterBurst();
+    void limiterReportsSuppressed();
+    void limitedSkipsArguments();
+
+    void benchDisabledDebug();
+    void benchEnabledInfo();
+    void benchLimitedSuppressed();
+    void benchTryAcquire();
+
+private:
+    QtMessageHandler m_previousHandler = nullptr;
+};
+
+void TestWebOSCompositorLogging::initTestCase()
+{
+    m_previousHandler = qInstallMessageHandler(countingHandler);
+}
+
+void TestWebOSCompositorLogging::cleanupTestCase()
+{
+    qInstallMessageHandler(m_previousHandler);
+}
+
+void TestWebOSCompositorLogging::init()
+{
+    s_messages = 0;
+    s_evaluated = 0;
+}
+
+void TestWebOSCompositorLogging::debugDisabledByDefault()
+{
+    QVERIFY(!lsmInput().isDebugEnabled());
+    QVERIFY(!lsmScheduler().isDebugEnabled());
+    QVERIFY(lsmInput().isInfoEnabled());
+
+    qCDebug(lsmInput) << expensiveArgument();
+    QCOMPARE(s_evaluated, 0);
+    QCOMPARE(s_messages, 0);
+}
+
+void TestWebOSCompositorLogging::limiterBurst()
+{
+    LogRateLimiter limiter(1, 5);
+    LogRateLimiter::Suppressed suppressed;
+
+    for (int i = 0; i < 5; i++)
+        QVERIFY(limiter.tryAcquire(&suppressed));
+    QVERIFY(!limiter.tryAcquire(&suppressed));
+    QVERIFY(!limiter.tryAcquire(&suppressed));
+}
+
+void TestWebOSCompositorLogging::limiterReportsSuppressed()
+{
+    LogRateLimiter limiter(100, 1);
+    LogRateLimiter::Suppressed suppressed;
+
+    QVERIFY(limiter.tryAcquire(&suppressed));
+    QCOMPARE(suppressed.count, 0u);
+    QVERIFY(!limiter.tryAcquire(&suppressed));
+    QVERIFY(!limiter.tryAcquire(&suppressed));
+
+    QThread::msleep(20);
+    QVERIFY(limiter.tryAcquire(&suppressed));
+    QCOMPARE(suppressed.count, 2u);
+}
+
+void TestWebOSCompositorLogging::limitedSkipsArguments()
+{
+    // A single call site, so the limiter is shared by all iterations
+    for (int i = 0; i < 100; i++)
+        qCInfoLimited(lsmTest, 1, 3) << expensiveArgument();
+
+    QCOMPARE(s_messages, 3);
+    QCOMPARE(s_evaluated, 3);
+}
+
+void TestWebOSCompositorLogging::benchDisabledDebug()
+{
+    QBENCHMARK {
+        qCDebug(lsmInput) << expensiveArgument() << QStringLiteral("disabled");
+    }
+    QCOMPARE(s_evaluated, 0);
+}
+
+void TestWebOSCompositorLogging::benchEnabledInfo()
+{
+    QBENCHMARK {
+        qCInfo(lsmTest) << expensiveArgument() << QStringLiteral("enabled");
+    }
+    QVERIFY(s_messages > 0);
+}
+
+void TestWebOSCompositorLogging::benchLimitedSuppressed()
+{
+    // Almost every iteration is dropped before its arguments are built
+    QBENCHMARK {
+        qCInfoLimited(lsmTest, 1, 1) << expensiveArgument() << QStringLiteral("limited");
+    }
+    QCOMPARE(s_evaluated, s_messages);
+}
+
+void TestWebOSCompositorLogging::benchTryAcquire()
+{
+    LogRateLimiter limiter(1000000, 1000);
+    LogRateLimiter::Suppressed suppressed;
+    QBENCHMARK {
+        limiter.tryAcquire(&suppressed);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    TestWebOSCompositorLogging test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_weboscompositorlogging.moc"
@@ -0,0 +1,376 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <QGuiApplication>
+#include <QLoggingCategory>
+#include <QPointer>
+#include <QSet>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <wayland-server.h>
+
+#include "weboscorecompositor.h"
+#include "webosforeign.h"
+#include "webossurfaceitem.h"
+
+// Surface items shared by the exports, as several videos in one app
+static const int SURFACE_ITEMS = 64;
+
+class TestImported : public WebOSImported
+{
+public:
+    TestImported(WebOSExported *exported, struct wl_client *client, uint32_t id,
+                 WebOSForeign::WebOSExportedType exportedType)
+        : WebOSImported(exported, client, id, exportedType)
+    {
+    }
+
+    void attachPunchThrough(const QString &contextId) { webos_imported_attach_punchthrough_with_context(resource(), contextId); }
+    void detachPunchThrough() { webos_imported_detach_punchthrough(resource()); }
+};
+
+class TestForeign : public WebOSForeign
+{
+public:
+    explicit TestForeign(WebOSCoreCompositor *compositor)
+        : WebOSForeign(compositor)
+    {
+    }
+
+    // What webos_foreign_export_element does once it has the surface item
+    WebOSExported *exportElement(struct wl_client *client, uint32_t id, WebOSSurfaceItem *surfaceItem)
+    {
+        WebOSExported *exported = createExported(client, id, surfaceItem, VideoObject);
+        registerExported(exported);
+        return exported;
+    }
+
+    TestImported *importElement(Resource *resource, uint32_t id, const QString &windowId)
+    {
+        m_lastImported = nullptr;
+        webos_foreign_import_element(resource, id, windowId, VideoObject);
+        return m_lastImported;
+    }
+
+protected:
+    WebOSImported *createImported(WebOSExported *exported, struct wl_client *client,
+                                  uint32_t id, WebOSExportedType exportedType) override
+    {
+        m_lastImported = new TestImported(exported, client, id, exportedType);
+        return m_lastImported;
+    }
+
+private:
+    TestImported *m_lastImported = nullptr;
+};
+
+class TestWebOSForeign : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+    void lookups();
+    void contextReattach();
+    void windowIdReassign();
+    void stress_data();
+    void stress();
+
+    void benchExportImport_data();
+    void benchExportImport();
+
+private:
+    struct Pair {
+        QPointer<WebOSExported> exported;
+        TestImported *imported = nullptr;
+        QString windowId;
+        quint32 handle = 0;
+        QString contextId;
+    };
+
+    Pair createPair(const QString &contextId = QString());
+    void destroyPair(const Pair &pair);
+    void verifyPair(const Pair &pair);
+    void verifyGone(const Pair &pair);
+    void drain();
+
+    WebOSCoreCompositor *m_compositor = nullptr;
+    TestForeign *m_foreign = nullptr;
+    QList<WebOSSurfaceItem *> m_surfaceItems;
+    // Live pairs left to destroy in cleanup
+    QList<Pair> m_pairs;
+
+    // Server side of a client nobody listens to
+    struct wl_client *m_client = nullptr;
+    int m_clientFd = -1;
+    TestForeign::Resource *m_foreignResource = nullptr;
+    uint32_t m_nextId = 0;
+    int m_created = 0;
+};
+
+void TestWebOSForeign::initTestCase()
+{
+    // Every export and import logs several lines
+    QLoggingCategory::setFilterRules(QStringLiteral("lsm.foreign.info=false"));
+
+    m_compositor = new WebOSCoreCompositor(WebOSCoreCompositor::NoExtensions, "tst-webosforeign");
+    m_compositor->create();
+    m_foreign = new TestForeign(m_compositor);
+
+    for (int i = 0; i < SURFACE_ITEMS; ++i)
+        m_surfaceItems.append(new WebOSSurfaceItem(m_compositor, nullptr));
+}
+
+void TestWebOSForeign::cleanupTestCase()
+{
+    qDeleteAll(m_surfaceItems);
+    m_surfaceItems.clear();
+    delete m_foreign;
+    m_foreign = nullptr;
+    delete m_compositor;
+    m_compositor = nullptr;
+}
+
+void TestWebOSForeign::init()
+{
+    int fds[2];
+    QCOMPARE(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds), 0);
+    m_client = wl_client_create(m_compositor->display(), fds[0]);
+    QVERIFY(m_client);
+    m_clientFd = fds[1];
+    fcntl(m_clientFd, F_SETFL, fcntl(m_clientFd, F_GETFL) | O_NONBLOCK);
+
+    // Object id 1 is the display of the client
+    m_nextId = 2;
+    m_created = 0;
+    m_foreignResource = m_foreign->add(m_client, m_nextId++, WEBOSFOREIGN_VERSION);
+}
+
+void TestWebOSForeign::cleanup()
+{
+    // Exports take their imports with them, then the client goes
+    for (const Pair &pair : qAsConst(m_pairs))
+        destroyPair(pair);
+    m_pairs.clear();
+
+    wl_client_destroy(m_client);
+    m_client = nullptr;
+    m_foreignResource = nullptr;
+    close(m_clientFd);
+    m_clientFd = -1;
+}
+
+TestWebOSForeign::Pair TestWebOSForeign::createPair(const QString &contextId)
+{
+    Pair pair;
+    pair.exported = m_foreign->exportElement(m_client, m_nextId++,
+                                             m_surfaceItems.at(m_created++ % SURFACE_ITEMS));
+    pair.windowId = pair.exported->windowId();
+    pair.handle = pair.exported->handle();
+    pair.imported = m_foreign->importElement(m_foreignResource, m_nextId++, pair.windowId);
+    if (!contextId.isNull() && pair.imported)
+        pair.imported->attachPunchThrough(contextId);
+    pair.contextId = contextId;
+    return pair;
+}
+
+// As the client destroying its exported object
+void TestWebOSForeign::destroyPair(const Pair &pair)
+{
+    if (pair.exported)
+        wl_resource_destroy(pair.exported->resource()->handle);
+}
+
+void TestWebOSForeign::verifyPair(const Pair &pair)
+{
+    QVERIFY(pair.exported);
+    QVERIFY(pair.imported);
+    QCOMPARE(m_foreign->exportedByWindowId(pair.windowId), pair.exported.data());
+    QCOMPARE(m_foreign->exportedByHandle(pair.handle), pair.exported.data());
+    if (!pair.contextId.isNull())
+        QCOMPARE(m_foreign->exportedByContextId(pair.contextId), pair.exported.data());
+}
+
+void TestWebOSForeign::verifyGone(const Pair &pair)
+{
+    QVERIFY(!pair.exported);
+    QCOMPARE(m_foreign->exportedByWindowId(pair.windowId), nullptr);
+    QCOMPARE(m_foreign->exportedByHandle(pair.handle), nullptr);
+    if (!pair.contextId.isNull())
+        QCOMPARE(m_foreign->exportedByContextId(pair.contextId), nullptr);
+}
+
+// Events to the client pile up in its socket otherwise
+void TestWebOSForeign::drain()
+{
+    wl_client_flush(m_client);
+    char buffer[4096];
+    while (read(m_clientFd, buffer, sizeof(buffer)) > 0) {
+    }
+}
+
+void TestWebOSForeign::lookups()
+{
+    for (int i = 0; i < 4; ++i)
+        m_pairs.append(createPair(QStringLiteral("context%1").arg(i)));
+    drain();
+
+    QSet<quint32> handles;
+    for (const Pair &pair : qAsConst(m_pairs)) {
+        verifyPair(pair);
+        QCOMPARE(pair.windowId, QStringLiteral("_Window_Id_%1").arg(pair.handle));
+        handles.insert(pair.handle);
+    }
+    QCOMPARE(handles.size(), m_pairs.size());
+    QCOMPARE(m_foreign->exportedByWindowId(QStringLiteral("_Window_Id_0")), nullptr);
+
+    const Pair gone = m_pairs.takeAt(1);
+    destroyPair(gone);
+    verifyGone(gone);
+    for (const Pair &pair : qAsConst(m_pairs))
+        verifyPair(pair);
+}
+
+// The context index follows attach and detach of the punch through
+void TestWebOSForeign::contextReattach()
+{
+    Pair pair = createPair(QStringLiteral("MAIN"));
+    m_pairs.append(pair);
+    verifyPair(pair);
+
+    pair.imported->detachPunchThrough();
+    QCOMPARE(m_foreign->exportedByContextId(QStringLiteral("MAIN")), nullptr);
+
+    pair.imported->attachPunchThrough(QStringLiteral("SUB"));
+    QCOMPARE(m_foreign->exportedByContextId(QStringLiteral("SUB")), pair.exported.data());
+    QCOMPARE(m_foreign->exportedByContextId(QStringLiteral("MAIN")), nullptr);
+    drain();
+}
+
+void TestWebOSForeign::windowIdReassign()
+{
+    Pair pair = createPair();
+    m_pairs.append(pair);
+
+    pair.exported->assignWindowId(QStringLiteral("_Window_Id_reassigned"));
+    QCOMPARE(m_foreign->exportedByWindowId(pair.windowId), nullptr);
+    QCOMPARE(m_foreign->exportedByWindowId(QStringLiteral("_Window_Id_reassigned")), pair.exported.data());
+    QCOMPARE(m_foreign->exportedByHandle(pair.handle), pair.exported.data());
+    drain();
+
+    destroyPair(pair);
+    m_pairs.removeLast();
+    QCOMPARE(m_foreign->exportedByWindowId(QStringLiteral("_Window_Id_reassigned")), nullptr);
+}
+
+void TestWebOSForeign::stress_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("1000") << 1000;
+    QTest::newRow("5000") << 5000;
+}
+
+/* Thousands of export/import pairs come and go over several rounds,
+   torn down out of creation order, with the lookups checked in between. */
+void TestWebOSForeign::stress()
+{
+    QFETCH(int, count);
+    QList<Pair> gone;
+
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < count; ++i) {
+            // Half of them with a punch through, as videos on a sink
+            const QString contextId = i % 2 ? QStringLiteral("context%1_%2").arg(round).arg(i) : QString();
+            m_pairs.append(createPair(contextId));
+            if (i % 64 == 0)
+                drain();
+        }
+        drain();
+
+        for (const Pair &pair : qAsConst(m_pairs))
+            verifyPair(pair);
+
+        // Every other one, from the back
+        for (int i = m_pairs.size() - 1; i >= 0; i -= 2) {
+            const Pair pair = m_pairs.takeAt(i);
+            destroyPair(pair);
+            gone.append(pair);
+        }
+        drain();
+
+        for (const Pair &pair : qAsConst(m_pairs))
+            verifyPair(pair);
+        for (const Pair &pair : qAsConst(gone))
+            verifyGone(pair);
+    }
+
+    // Handles of live exports are unique and not those of destroyed ones
+    QSet<quint32> handles;
+    for (const Pair &pair : qAsConst(m_pairs))
+        handles.insert(pair.handle);
+    QCOMPARE(handles.size(), m_pairs.size());
+    for (const Pair &pair : qAsConst(gone))
+        QVERIFY(!handles.contains(pair.handle));
+}
+
+void TestWebOSForeign::benchExportImport_data()
+{
+    QTest::addColumn<int>("live");
+    QTest::newRow("10") << 10;
+    QTest::newRow("1000") << 1000;
+    QTest::newRow("5000") << 5000;
+}
+
+// One pair created, looked up and destroyed among a number of live ones
+void TestWebOSForeign::benchExportImport()
+{
+    QFETCH(int, live);
+    for (int i = 0; i < live; ++i)
+        m_pairs.append(createPair(QStringLiteral("context%1").arg(i)));
+    drain();
+
+    QBENCHMARK {
+        const Pair pair = createPair(QStringLiteral("bench"));
+        m_foreign->exportedByContextId(QStringLiteral("bench"));
+        destroyPair(pair);
+        drain();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    // The compositor needs a place for its socket
+    QTemporaryDir runtimeDir;
+    if (!qEnvironmentVariableIsSet("XDG_RUNTIME_DIR"))
+        qputenv("XDG_RUNTIME_DIR", runtimeDir.path().toLocal8Bit());
+
+    QGuiApplication app(argc, argv);
+    TestWebOSForeign test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_webosforeign.moc"
@@ -0,0 +1,210 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <QGuiApplication>
+#include <QKeyEvent>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "weboscorecompositor.h"
+#include "webosinputdevice.h"
+
+static const int MAX_SEATS = 32;
+
+// The device id travels in the modifier bits outside Qt::KeyboardModifierMask
+static QKeyEvent *createKeyEvent(int deviceId)
+{
+    return new QKeyEvent(QEvent::KeyPress, Qt::Key_A,
+                         Qt::KeyboardModifiers(static_cast<Qt::KeyboardModifier>(deviceId)));
+}
+
+class TestWebOSInputDevice : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void cleanup();
+
+    void seatForDeviceId();
+    void defaultSeatForDeviceZero();
+    void deviceIdChange();
+    void seatRemoval();
+
+    void benchSeatFor_data();
+    void benchSeatFor();
+    void benchScanIsOwner_data();
+    void benchScanIsOwner();
+
+private:
+    void createSeats(int count);
+
+    WebOSCoreCompositor *m_compositor = nullptr;
+    QList<WebOSInputDevice *> m_seats;
+    QList<QKeyEvent *> m_events;
+};
+
+void TestWebOSInputDevice::initTestCase()
+{
+#ifndef MULTIINPUT_SUPPORT
+    QSKIP("Built without multi input support");
+#endif
+    m_compositor = new WebOSCoreCompositor(WebOSCoreCompositor::NoExtensions, "tst-webosinputdevice");
+    m_compositor->create();
+    QVERIFY(m_compositor->defaultSeat());
+}
+
+void TestWebOSInputDevice::cleanupTestCase()
+{
+    delete m_compositor;
+    m_compositor = nullptr;
+}
+
+void TestWebOSInputDevice::cleanup()
+{
+    qDeleteAll(m_seats);
+    m_seats.clear();
+    qDeleteAll(m_events);
+    m_events.clear();
+}
+
+// Seats get device ids 1..count, the way queryInputDevice assigns them
+void TestWebOSInputDevice::createSeats(int count)
+{
+    for (int id = 1; id <= count; id++) {
+        QKeyEvent *event = createKeyEvent(id);
+        WebOSInputDevice *seat = new WebOSInputDevice(m_compositor);
+        seat->setDeviceId(event);
+        m_seats.append(seat);
+        m_events.append(event);
+    }
+}
+
+void TestWebOSInputDevice::seatForDeviceId()
+{
+    createSeats(MAX_SEATS);
+
+    for (int i = 0; i < MAX_SEATS; i++) {
+        QCOMPARE(m_seats[i]->id(), i + 1);
+        QCOMPARE(m_compositor->seatForDeviceId(i + 1), m_seats[i]);
+        QCOMPARE(m_compositor->seatFor(m_events[i]), m_seats[i]);
+        QVERIFY(m_compositor->isRegisteredSeat(m_seats[i]));
+    }
+    QVERIFY(!m_compositor->isRegisteredSeat(m_compositor->defaultSeat()));
+}
+
+void TestWebOSInputDevice::defaultSeatForDeviceZero()
+{
+    createSeats(4);
+
+    QScopedPointer<QKeyEvent> event(createKeyEvent(0));
+    QCOMPARE(m_compositor->seatFor(event.data()), m_compositor->defaultSeat());
+}
+
+void TestWebOSInputDevice::deviceIdChange()
+{
+    createSeats(2);
+
+    QScopedPointer<QKeyEvent> event(createKeyEvent(7));
+    m_seats[0]->setDeviceId(event.data());
+
+    QCOMPARE(m_compositor->seatForDeviceId(7), m_seats[0]);
+    QCOMPARE(m_compositor->seatForDeviceId(1), nullptr);
+    QCOMPARE(m_compositor->seatFor(event.data()), m_seats[0]);
+    QCOMPARE(m_compositor->seatFor(m_events[1]), m_seats[1]);
+
+    // A seat taking over an id in use does not steal it from the first one
+    m_seats[1]->setDeviceId(event.data());
+    QCOMPARE(m_compositor->seatForDeviceId(7), m_seats[0]);
+    QCOMPARE(m_compositor->seatForDeviceId(2), nullptr);
+
+    // Until the first one goes away
+    delete m_seats.takeFirst();
+    QCOMPARE(m_compositor->seatForDeviceId(7), m_seats[0]);
+}
+
+void TestWebOSInputDevice::seatRemoval()
+{
+    createSeats(3);
+
+    WebOSInputDevice *removed = m_seats.takeAt(1);
+    delete removed;
+
+    QCOMPARE(m_compositor->seatForDeviceId(2), nullptr);
+    QVERIFY(!m_compositor->isRegisteredSeat(removed));
+    QCOMPARE(m_compositor->seatForDeviceId(1), m_seats[0]);
+    QCOMPARE(m_compositor->seatForDeviceId(3), m_seats[1]);
+}
+
+void TestWebOSInputDevice::benchSeatFor_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("1") << 1;
+    QTest::newRow("8") << 8;
+    QTest::newRow("32") << MAX_SEATS;
+}
+
+// Synthetic events spread over all seats, as from many remote controls
+void TestWebOSInputDevice::benchSeatFor()
+{
+    QFETCH(int, count);
+    createSeats(count);
+
+    QBENCHMARK {
+        for (QKeyEvent *event : qAsConst(m_events))
+            m_compositor->seatFor(event);
+    }
+}
+
+void TestWebOSInputDevice::benchScanIsOwner_data()
+{
+    benchSeatFor_data();
+}
+
+// The linear isOwner() scan seatFor used to do, as a baseline
+void TestWebOSInputDevice::benchScanIsOwner()
+{
+    QFETCH(int, count);
+    createSeats(count);
+    const QList<QWaylandSeat *> seats = m_compositor->inputDevices();
+
+    QBENCHMARK {
+        for (QKeyEvent *event : qAsConst(m_events)) {
+            for (int i = 1; i < seats.size(); i++) {
+                if (seats.at(i)->isOwner(event))
+                    break;
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    // The compositor needs a place for its socket
+    QTemporaryDir runtimeDir;
+    if (!qEnvironmentVariableIsSet("XDG_RUNTIME_DIR"))
+        qputenv("XDG_RUNTIME_DIR", runtimeDir.path().toLocal8Bit());
+
+    QGuiApplication app(argc, argv);
+    TestWebOSInputDevice test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_webosinputdevice.moc"
@@ -0,0 +1,293 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <QGuiApplication>
+#include <QTemporaryDir>
+#include <QWaylandClient>
+#include <QWaylandSurface>
+#include <QtTest>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <wayland-server.h>
+
+#include "weboscorecompositor.h"
+#include "webosinputdevice.h"
+#include "weboskeyboard.h"
+
+static const int SEATS = 2;
+// XKB keycode of the left shift key
+static const uint KEY_LEFTSHIFT_XKB = 50;
+
+struct TestGrabber : public KeyboardGrabber
+{
+    void focused(QWaylandSurface *) override {}
+    void key(uint32_t, uint32_t, uint32_t, uint32_t) override {}
+    void modifiers(uint32_t, uint32_t mods_depressed, uint32_t, uint32_t, uint32_t) override
+    {
+        count++;
+        depressed = mods_depressed;
+    }
+    void updateModifiers() override {}
+
+    int count = 0;
+    uint32_t depressed = 0;
+};
+
+class TestWebOSKeyboard : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+    void syncOnSerialChange();
+    void syncOnFocusChange();
+    void syncAfterGrab();
+
+private:
+    WebOSKeyboard *keyboard(int seat) const;
+    bool setShift(bool pressed);
+    void syncAll();
+    void readEvents();
+    int takeModifiers(int seat, uint32_t *depressed = nullptr);
+
+    WebOSCoreCompositor *m_compositor = nullptr;
+    QList<WebOSInputDevice *> m_seats;
+    QList<QWaylandSurface *> m_surfaces;
+
+    // Server side of a client whose events are read back raw
+    struct wl_client *m_client = nullptr;
+    int m_clientFd = -1;
+    QByteArray m_received;
+    uint32_t m_keyboardIds[SEATS];
+    // Modifiers events per seat since the last takeModifiers()
+    QList<uint32_t> m_modifiers[SEATS];
+};
+
+void TestWebOSKeyboard::initTestCase()
+{
+    m_compositor = new WebOSCoreCompositor(WebOSCoreCompositor::NoExtensions, "tst-weboskeyboard");
+    m_compositor->create();
+}
+
+void TestWebOSKeyboard::cleanupTestCase()
+{
+    delete m_compositor;
+    m_compositor = nullptr;
+}
+
+void TestWebOSKeyboard::init()
+{
+    int fds[2];
+    QCOMPARE(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds), 0);
+    m_client = wl_client_create(m_compositor->display(), fds[0]);
+    QVERIFY(m_client);
+    m_clientFd = fds[1];
+    fcntl(m_clientFd, F_SETFL, fcntl(m_clientFd, F_GETFL) | O_NONBLOCK);
+
+    // Object id 1 is the display of the client
+    uint32_t id = 2;
+    QWaylandClient *client = QWaylandClient::fromWlClient(m_compositor, m_client);
+    for (int i = 0; i < SEATS; i++) {
+        WebOSInputDevice *seat = new WebOSInputDevice(m_compositor, QWaylandSeat::Keyboard);
+        m_seats.append(seat);
+        QVERIFY(keyboard(i));
+        m_keyboardIds[i] = id;
+        keyboard(i)->addClient(client, id++, 4);
+        m_surfaces.append(new QWaylandSurface(m_compositor, client, id++, 4));
+    }
+
+    // Each seat focuses a surface of its own
+    for (int i = 0; i < SEATS; i++)
+        keyboard(i)->setFocus(m_surfaces.at(i));
+    takeModifiers(0);
+    takeModifiers(1);
+}
+
+void TestWebOSKeyboard::cleanup()
+{
+    // The state is shared with the keyboards of other tests
+    if (!m_seats.isEmpty())
+        setShift(false);
+
+    // Surfaces go with the client
+    wl_client_destroy(m_client);
+    m_client = nullptr;
+    m_surfaces.clear();
+    close(m_clientFd);
+    m_clientFd = -1;
+    m_received.clear();
+
+    qDeleteAll(m_seats);
+    m_seats.clear();
+}
+
+WebOSKeyboard *TestWebOSKeyboard::keyboard(int seat) const
+{
+    return qobject_cast<WebOSKeyboard *>(m_seats.at(seat)->keyboard());
+}
+
+// Updates the shared state the way WebOSCoreCompositor does for a key event
+bool TestWebOSKeyboard::setShift(bool pressed)
+{
+    return keyboard(0)->updateSharedModifierState(KEY_LEFTSHIFT_XKB,
+        pressed ? WL_KEYBOARD_KEY_STATE_PRESSED : WL_KEYBOARD_KEY_STATE_RELEASED, false);
+}
+
+void TestWebOSKeyboard::syncAll()
+{
+    for (int i = 0; i < SEATS; i++)
+        keyboard(i)->syncModifiers();
+}
+
+// Collects the modifiers events each keyboard resource got
+void TestWebOSKeyboard::readEvents()
+{
+    wl_client_flush(m_client);
+    char buffer[4096];
+    ssize_t size;
+    while ((size = read(m_clientFd, buffer, sizeof(buffer))) > 0)
+        m_received.append(buffer, size);
+
+    // Each message starts with the object id and its size and opcode
+    while (m_received.size() >= 8) {
+        const uint32_t *words = reinterpret_cast<const uint32_t *>(m_received.constData());
+        const int messageSize = words[1] >> 16;
+        if (messageSize < 8 || m_received.size() < messageSize)
+            break;
+
+        const uint32_t opcode = words[1] & 0xffff;
+        for (int i = 0; i < SEATS; i++) {
+            // Arguments are the serial, then the depressed modifiers
+            if (words[0] == m_keyboardIds[i] && opcode == WL_KEYBOARD_MODIFIERS)
+                m_modifiers[i].append(words[3]);
+        }
+        m_received.remove(0, messageSize);
+    }
+}
+
+// Returns the number of modifiers events since the last call and the last value
+int TestWebOSKeyboard::takeModifiers(int seat, uint32_t *depressed)
+{
+    readEvents();
+    const QList<uint32_t> modifiers = m_modifiers[seat];
+    m_modifiers[seat].clear();
+    if (depressed && !modifiers.isEmpty())
+        *depressed = modifiers.last();
+    return modifiers.size();
+}
+
+void TestWebOSKeyboard::syncOnSerialChange()
+{
+    if (!setShift(true))
+        QSKIP("No keymap to update the modifier state with");
+    const uint32_t shift = keyboard(0)->modifierState().depressed;
+    QVERIFY(shift != 0);
+
+    // Every seat has a client that has not seen the change
+    syncAll();
+    for (int i = 0; i < SEATS; i++) {
+        uint32_t depressed = 0;
+        QCOMPARE(takeModifiers(i, &depressed), 1);
+        QCOMPARE(depressed, shift);
+    }
+
+    // Nothing new to tell
+    syncAll();
+    for (int i = 0; i < SEATS; i++)
+        QCOMPARE(takeModifiers(i), 0);
+
+    QVERIFY(setShift(false));
+    syncAll();
+    for (int i = 0; i < SEATS; i++) {
+        uint32_t depressed = shift;
+        QCOMPARE(takeModifiers(i, &depressed), 1);
+        QCOMPARE(depressed, 0u);
+    }
+}
+
+void TestWebOSKeyboard::syncOnFocusChange()
+{
+    if (!setShift(true))
+        QSKIP("No keymap to update the modifier state with");
+    const uint32_t shift = keyboard(0)->modifierState().depressed;
+    syncAll();
+    takeModifiers(0);
+    takeModifiers(1);
+
+    // Only the seat whose focus moved tells its client again
+    keyboard(1)->setFocus(m_surfaces.at(0));
+    uint32_t depressed = 0;
+    QVERIFY(takeModifiers(1, &depressed) > 0);
+    QCOMPARE(depressed, shift);
+    QCOMPARE(takeModifiers(0), 0);
+
+    syncAll();
+    QCOMPARE(takeModifiers(0), 0);
+    QCOMPARE(takeModifiers(1), 0);
+}
+
+void TestWebOSKeyboard::syncAfterGrab()
+{
+    TestGrabber grabber;
+    keyboard(0)->startGrab(&grabber);
+
+    if (!setShift(true)) {
+        keyboard(0)->endGrab();
+        QSKIP("No keymap to update the modifier state with");
+    }
+    const uint32_t shift = keyboard(0)->modifierState().depressed;
+
+    // The grabber gets the change instead of the client
+    syncAll();
+    QCOMPARE(grabber.count, 1);
+    QCOMPARE(grabber.depressed, shift);
+    QCOMPARE(takeModifiers(0), 0);
+    QCOMPARE(takeModifiers(1), 1);
+
+    // The client catches up once, however the grab ends
+    keyboard(0)->endGrab();
+    uint32_t depressed = 0;
+    QCOMPARE(takeModifiers(0, &depressed), 1);
+    QCOMPARE(depressed, shift);
+    QCOMPARE(grabber.count, 1);
+
+    syncAll();
+    QCOMPARE(takeModifiers(0), 0);
+    QCOMPARE(takeModifiers(1), 0);
+}
+
+int main(int argc, char *argv[])
+{
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    // The compositor needs a place for its socket
+    QTemporaryDir runtimeDir;
+    if (!qEnvironmentVariableIsSet("XDG_RUNTIME_DIR"))
+        qputenv("XDG_RUNTIME_DIR", runtimeDir.path().toLocal8Bit());
+
+    QGuiApplication app(argc, argv);
+    TestWebOSKeyboard test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_weboskeyboard.moc"
@@ -0,0 +1,175 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <QCoreApplication>
+#include <QJSEngine>
+#include <QtTest>
+
+#include "weboskeyfilter.h"
+
+class TestWebOSKeyFilter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void registrationOrder();
+    void stateNegation();
+    void modifierMask();
+    void resetDuringEvaluation();
+
+private:
+    void addPolicy(const QString &policy, const QString &name);
+    QStringList takeLog();
+
+    QJSEngine *m_engine = nullptr;
+    WebOSKeyFilter *m_filter = nullptr;
+};
+
+void TestWebOSKeyFilter::init()
+{
+    m_engine = new QJSEngine;
+    m_filter = new WebOSKeyFilter;
+    QJSEngine::setObjectOwnership(m_filter, QJSEngine::CppOwnership);
+    m_engine->globalObject().setProperty(QStringLiteral("filter"), m_engine->newQObject(m_filter));
+    m_engine->evaluate(QStringLiteral("var log = [];"));
+
+    // Reached only if no policy decided
+    m_filter->addKeyFilter(m_engine->evaluate(QStringLiteral("(function() { log.push('filters'); return 2; })")),
+                           QStringLiteral("filters"));
+}
+
+void TestWebOSKeyFilter::cleanup()
+{
+    delete m_filter;
+    m_filter = nullptr;
+    delete m_engine;
+    m_engine = nullptr;
+}
+
+void TestWebOSKeyFilter::addPolicy(const QString &policy, const QString &name)
+{
+    QJSValue value = m_engine->evaluate(QLatin1Char('(') + policy + QLatin1Char(')'));
+    QVERIFY2(!value.isError(), qPrintable(value.toString()));
+    m_filter->addKeyPolicy(value, name);
+}
+
+QStringList TestWebOSKeyFilter::takeLog()
+{
+    const QStringList log = m_engine->globalObject().property(QStringLiteral("log")).toVariant().toStringList();
+    m_engine->evaluate(QStringLiteral("log = [];"));
+    return log;
+}
+
+/* Actions and handler results are WebOSKeyPolicy::Result values:
+   0 NotAccepted, 1 Accepted, 2 NextPolicy. */
+
+// Key-specific and any-key policies apply in the order they were added
+void TestWebOSKeyFilter::registrationOrder()
+{
+    addPolicy(QStringLiteral("{ handler: function() { log.push('A'); return 2; } }"), QStringLiteral("A"));
+    addPolicy(QStringLiteral("{ key: 10, handler: function() { log.push('B'); return 2; } }"), QStringLiteral("B"));
+    addPolicy(QStringLiteral("{ handler: function() { log.push('C'); return 2; } }"), QStringLiteral("C"));
+    addPolicy(QStringLiteral("{ keys: [10, 11], handler: function() { log.push('D'); return 2; } }"), QStringLiteral("D"));
+
+    QVERIFY(!m_filter->handleKeyEvent(10, true, false));
+    QCOMPARE(takeLog(), QStringList({"A", "B", "C", "D", "filters"}));
+    QVERIFY(!m_filter->handleKeyEvent(11, true, false));
+    QCOMPARE(takeLog(), QStringList({"A", "C", "D", "filters"}));
+    QVERIFY(!m_filter->handleKeyEvent(12, true, false));
+    QCOMPARE(takeLog(), QStringList({"A", "C", "filters"}));
+
+    // The first policy to decide wins, whether for a key or any key
+    addPolicy(QStringLiteral("{ key: 10, action: 1 }"), QStringLiteral("accept 10"));
+    addPolicy(QStringLiteral("{ action: 0 }"), QStringLiteral("reject any"));
+
+    QVERIFY(m_filter->handleKeyEvent(10, true, false));
+    QCOMPARE(takeLog(), QStringList({"A", "B", "C", "D"}));
+    QVERIFY(!m_filter->handleKeyEvent(12, true, false));
+    QCOMPARE(takeLog(), QStringList({"A", "C"}));
+}
+
+void TestWebOSKeyFilter::stateNegation()
+{
+    addPolicy(QStringLiteral("{ key: 1, state: 'menu', action: 1 }"), QStringLiteral("in menu"));
+    addPolicy(QStringLiteral("{ key: 2, state: '!menu', action: 1 }"), QStringLiteral("not in menu"));
+
+    QVERIFY(!m_filter->handleKeyEvent(1, true, false));
+    QCOMPARE(takeLog(), QStringList({"filters"}));
+    QVERIFY(m_filter->handleKeyEvent(2, true, false));
+    QCOMPARE(takeLog(), QStringList());
+
+    m_filter->setPolicyState(QStringLiteral("menu"), true);
+    QVERIFY(m_filter->handleKeyEvent(1, true, false));
+    QCOMPARE(takeLog(), QStringList());
+    QVERIFY(!m_filter->handleKeyEvent(2, true, false));
+    QCOMPARE(takeLog(), QStringList({"filters"}));
+
+    m_filter->setPolicyState(QStringLiteral("menu"), false);
+    QVERIFY(!m_filter->handleKeyEvent(1, true, false));
+    QVERIFY(m_filter->handleKeyEvent(2, true, false));
+}
+
+void TestWebOSKeyFilter::modifierMask()
+{
+    addPolicy(QStringLiteral("{ key: 1, modifiers: 0x1, modifierMask: 0x3, action: 1 }"), QStringLiteral("masked"));
+    // The mask defaults to the modifiers themselves
+    addPolicy(QStringLiteral("{ key: 2, modifiers: 0x2, action: 1 }"), QStringLiteral("unmasked"));
+    // Modifiers outside the mask are ignored
+    addPolicy(QStringLiteral("{ key: 3, modifiers: 0x5, modifierMask: 0x1, action: 1 }"), QStringLiteral("outside"));
+
+    QVERIFY(m_filter->handleKeyEvent(1, true, false, 0x1));
+    QVERIFY(m_filter->handleKeyEvent(1, true, false, 0x5));
+    QVERIFY(!m_filter->handleKeyEvent(1, true, false, 0x3));
+    QVERIFY(!m_filter->handleKeyEvent(1, true, false, 0x0));
+
+    QVERIFY(m_filter->handleKeyEvent(2, true, false, 0x2));
+    QVERIFY(m_filter->handleKeyEvent(2, true, false, 0x3));
+    QVERIFY(!m_filter->handleKeyEvent(2, true, false, 0x1));
+
+    QVERIFY(m_filter->handleKeyEvent(3, true, false, 0x1));
+    QVERIFY(!m_filter->handleKeyEvent(3, true, false, 0x4));
+}
+
+// A handler replacing the table stops the evaluation of the old one
+void TestWebOSKeyFilter::resetDuringEvaluation()
+{
+    addPolicy(QStringLiteral("{ handler: function() {"
+                             "    log.push('A');"
+                             "    filter.resetKeyPolicies();"
+                             "    filter.addKeyPolicy({ action: 1 }, 'late');"
+                             "    return 2; } }"), QStringLiteral("A"));
+    addPolicy(QStringLiteral("{ key: 5, handler: function() { log.push('B'); return 1; } }"), QStringLiteral("B"));
+    addPolicy(QStringLiteral("{ handler: function() { log.push('C'); return 1; } }"), QStringLiteral("C"));
+
+    QVERIFY(!m_filter->handleKeyEvent(5, true, false));
+    QCOMPARE(takeLog(), QStringList({"A", "filters"}));
+
+    // The new table applies from the next key on
+    QVERIFY(m_filter->handleKeyEvent(5, true, false));
+    QCOMPARE(takeLog(), QStringList());
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    TestWebOSKeyFilter test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_weboskeyfilter.moc"
@@ -0,0 +1,333 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <QGuiApplication>
+#include <QRandomGenerator>
+#include <QtTest>
+
+#include <algorithm>
+
+#include "weboscorecompositor.h"
+#include "webossurfacegroup.h"
+#include "webossurfaceitem.h"
+
+// Gives access to the ordering without wayland layers and resources
+class TestGroup : public WebOSSurfaceGroup
+{
+public:
+    using WebOSSurfaceGroup::addZOrderedSurfaceLayoutInfoList;
+    using WebOSSurfaceGroup::takeLayoutInfoFor;
+    using WebOSSurfaceGroup::attachedClientSurfaceItems;
+    using WebOSSurfaceGroup::insertKeyOrderedItem;
+    using WebOSSurfaceGroup::removeKeyOrderedItem;
+
+    void attach(WebOSSurfaceItem *item)
+    {
+        addZOrderedSurfaceLayoutInfoList(item, QSharedPointer<QObject>(new QObject));
+    }
+};
+
+class TestWebOSSurfaceGroup : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+    void zOrderNavigation();
+    void zOrderFollowsZ();
+    void equalZKeepsAttachOrder();
+    void detach();
+    void keyOrderNavigation();
+    void keyOrderTieBreak();
+    void keyOrderRebuild();
+
+    void benchZChange_data();
+    void benchZChange();
+    void benchNextKeyOrdered_data();
+    void benchNextKeyOrdered();
+
+private:
+    WebOSSurfaceItem *createItem(qreal z = 0);
+    QList<WebOSSurfaceItem *> zOrder() const;
+    QList<WebOSSurfaceItem *> keyOrder(const QList<WebOSSurfaceItem *> &keyed) const;
+
+    WebOSCoreCompositor *m_compositor = nullptr;
+    TestGroup *m_group = nullptr;
+    WebOSSurfaceItem *m_root = nullptr;
+    QList<WebOSSurfaceItem *> m_items;
+};
+
+void TestWebOSSurfaceGroup::initTestCase()
+{
+    m_compositor = new WebOSCoreCompositor(WebOSCoreCompositor::NoExtensions);
+}
+
+void TestWebOSSurfaceGroup::cleanupTestCase()
+{
+    delete m_compositor;
+    m_compositor = nullptr;
+}
+
+void TestWebOSSurfaceGroup::init()
+{
+    m_group = new TestGroup;
+    m_root = createItem();
+    m_group->setRootItem(m_root);
+}
+
+void TestWebOSSurfaceGroup::cleanup()
+{
+    // The group goes first, it detaches the items
+    delete m_group;
+    m_group = nullptr;
+    qDeleteAll(m_items);
+    m_items.clear();
+    m_root = nullptr;
+}
+
+WebOSSurfaceItem *TestWebOSSurfaceGroup::createItem(qreal z)
+{
+    WebOSSurfaceItem *item = new WebOSSurfaceItem(m_compositor, nullptr);
+    item->setZ(z);
+    m_items.append(item);
+    return item;
+}
+
+// Bottommost first, walking down from the top as key navigation does
+QList<WebOSSurfaceItem *> TestWebOSSurfaceGroup::zOrder() const
+{
+    QList<WebOSSurfaceItem *> order = m_group->attachedClientSurfaceItems();
+    if (order.isEmpty())
+        return order;
+    QList<WebOSSurfaceItem *> walked;
+    for (WebOSSurfaceItem *item = order.first(); item; item = m_group->nextZOrderedSurfaceGroupItem(item))
+        walked.prepend(item);
+    return walked;
+}
+
+/* Bottommost first. An item not in key order counts as the topmost one,
+   so the walk starts below the top. That is the one of the keyed items
+   the walk does not reach. */
+QList<WebOSSurfaceItem *> TestWebOSSurfaceGroup::keyOrder(const QList<WebOSSurfaceItem *> &keyed) const
+{
+    QList<WebOSSurfaceItem *> walked;
+    for (WebOSSurfaceItem *item = m_group->nextKeyOrderedSurfaceGroupItem(nullptr); item;
+         item = m_group->nextKeyOrderedSurfaceGroupItem(item))
+        walked.prepend(item);
+    for (WebOSSurfaceItem *item : keyed) {
+        if (!walked.contains(item)) {
+            walked.append(item);
+            break;
+        }
+    }
+    return walked;
+}
+
+void TestWebOSSurfaceGroup::zOrderNavigation()
+{
+    WebOSSurfaceItem *a = createItem(1);
+    WebOSSurfaceItem *b = createItem(3);
+    WebOSSurfaceItem *c = createItem(2);
+    m_group->attach(a);
+    m_group->attach(b);
+    m_group->attach(c);
+
+    QCOMPARE(m_group->attachedClientSurfaceItems(), (QList<WebOSSurfaceItem *>{b, c, a}));
+    QCOMPARE(m_group->nextZOrderedSurfaceGroupItem(b), c);
+    QCOMPARE(m_group->nextZOrderedSurfaceGroupItem(c), a);
+    QCOMPARE(m_group->nextZOrderedSurfaceGroupItem(a), m_root);
+    QCOMPARE(m_group->nextZOrderedSurfaceGroupItem(m_root), nullptr);
+    QCOMPARE(m_group->nextZOrderedSurfaceGroupItem(createItem()), nullptr);
+}
+
+// Random z changes against a stable sort by z of the attach order
+void TestWebOSSurfaceGroup::zOrderFollowsZ()
+{
+    QList<WebOSSurfaceItem *> attached{m_root};
+    for (int i = 0; i < 50; ++i) {
+        WebOSSurfaceItem *item = createItem(QRandomGenerator::global()->bounded(10) + 1);
+        m_group->attach(item);
+        attached.append(item);
+    }
+
+    for (int round = 0; round < 200; ++round) {
+        WebOSSurfaceItem *item = attached.at(QRandomGenerator::global()->bounded(1, attached.size()));
+        item->setZ(QRandomGenerator::global()->bounded(10) + 1);
+
+        QList<WebOSSurfaceItem *> expected = attached;
+        std::stable_sort(expected.begin(), expected.end(),
+                         [](const WebOSSurfaceItem *a, const WebOSSurfaceItem *b) { return a->z() < b->z(); });
+        QCOMPARE(zOrder(), expected);
+    }
+}
+
+void TestWebOSSurfaceGroup::equalZKeepsAttachOrder()
+{
+    WebOSSurfaceItem *a = createItem(1);
+    WebOSSurfaceItem *b = createItem(1);
+    WebOSSurfaceItem *c = createItem(5);
+    m_group->attach(a);
+    m_group->attach(b);
+    m_group->attach(c);
+
+    // Whether it comes from above or below
+    c->setZ(1);
+    QCOMPARE(zOrder(), (QList<WebOSSurfaceItem *>{m_root, a, b, c}));
+    a->setZ(0.5);
+    a->setZ(1);
+    QCOMPARE(zOrder(), (QList<WebOSSurfaceItem *>{m_root, a, b, c}));
+}
+
+void TestWebOSSurfaceGroup::detach()
+{
+    WebOSSurfaceItem *a = createItem(1);
+    WebOSSurfaceItem *b = createItem(2);
+    m_group->attach(a);
+    m_group->attach(b);
+
+    QVERIFY(m_group->takeLayoutInfoFor(a));
+    QCOMPARE(zOrder(), (QList<WebOSSurfaceItem *>{m_root, b}));
+    QCOMPARE(m_group->nextZOrderedSurfaceGroupItem(a), nullptr);
+
+    // No longer followed
+    a->setZ(3);
+    QCOMPARE(zOrder(), (QList<WebOSSurfaceItem *>{m_root, b}));
+}
+
+void TestWebOSSurfaceGroup::keyOrderNavigation()
+{
+    WebOSSurfaceItem *a = createItem(1);
+    WebOSSurfaceItem *b = createItem(2);
+    WebOSSurfaceItem *c = createItem(3);
+    m_group->attach(a);
+    m_group->attach(b);
+    m_group->attach(c);
+    m_group->insertKeyOrderedItem(a, 3);
+    m_group->insertKeyOrderedItem(b, 1);
+    m_group->insertKeyOrderedItem(c, 2);
+
+    QCOMPARE(keyOrder({m_root, a, b, c}), (QList<WebOSSurfaceItem *>{m_root, b, c, a}));
+    QCOMPARE(m_group->nextKeyOrderedSurfaceGroupItem(a), c);
+    QCOMPARE(m_group->nextKeyOrderedSurfaceGroupItem(m_root), nullptr);
+
+    // Not in key order counts as the topmost one
+    QCOMPARE(m_group->nextKeyOrderedSurfaceGroupItem(createItem()), c);
+
+    m_group->removeKeyOrderedItem(c);
+    QCOMPARE(keyOrder({m_root, a, b}), (QList<WebOSSurfaceItem *>{m_root, b, a}));
+    m_group->insertKeyOrderedItem(b, 4);
+    QCOMPARE(keyOrder({m_root, a, b}), (QList<WebOSSurfaceItem *>{m_root, a, b}));
+}
+
+// Equal key indices keep the attach order, whatever the insertion order
+void TestWebOSSurfaceGroup::keyOrderTieBreak()
+{
+    WebOSSurfaceItem *a = createItem(3);
+    WebOSSurfaceItem *b = createItem(2);
+    WebOSSurfaceItem *c = createItem(1);
+    m_group->attach(a);
+    m_group->attach(b);
+    m_group->attach(c);
+
+    m_group->insertKeyOrderedItem(c, 1);
+    m_group->insertKeyOrderedItem(b, 1);
+    m_group->insertKeyOrderedItem(a, 1);
+    QCOMPARE(keyOrder({m_root, a, b, c}), (QList<WebOSSurfaceItem *>{m_root, a, b, c}));
+
+    m_group->insertKeyOrderedItem(a, 1);
+    QCOMPARE(keyOrder({m_root, a, b, c}), (QList<WebOSSurfaceItem *>{m_root, a, b, c}));
+}
+
+// Without layers a rebuild keeps just the root, and inserting again in
+// any order gives the same order as before
+void TestWebOSSurfaceGroup::keyOrderRebuild()
+{
+    QList<WebOSSurfaceItem *> items{m_root};
+    for (int i = 0; i < 6; ++i) {
+        WebOSSurfaceItem *item = createItem(i + 1);
+        m_group->attach(item);
+        m_group->insertKeyOrderedItem(item, 1 + i % 2);
+        items.append(item);
+    }
+    const QList<WebOSSurfaceItem *> before = keyOrder(items);
+    QCOMPARE(before.size(), items.size());
+
+    m_group->makeKeyOrderedItems();
+    QCOMPARE(keyOrder({m_root}), (QList<WebOSSurfaceItem *>{m_root}));
+
+    for (int i = items.size() - 1; i >= 1; --i)
+        m_group->insertKeyOrderedItem(items.at(i), 1 + (i - 1) % 2);
+    QCOMPARE(keyOrder(items), before);
+}
+
+void TestWebOSSurfaceGroup::benchZChange_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("10") << 10;
+    QTest::newRow("100") << 100;
+    QTest::newRow("1000") << 1000;
+}
+
+// One item going back and forth across the whole group
+void TestWebOSSurfaceGroup::benchZChange()
+{
+    QFETCH(int, count);
+    for (int i = 0; i < count; ++i)
+        m_group->attach(createItem(i + 1));
+    WebOSSurfaceItem *item = m_items.at(count / 2);
+    qreal z = 0.5;
+
+    QBENCHMARK {
+        item->setZ(z);
+        z = count + 1.5 - z;
+    }
+}
+
+void TestWebOSSurfaceGroup::benchNextKeyOrdered_data()
+{
+    benchZChange_data();
+}
+
+void TestWebOSSurfaceGroup::benchNextKeyOrdered()
+{
+    QFETCH(int, count);
+    for (int i = 0; i < count; ++i) {
+        WebOSSurfaceItem *item = createItem(i + 1);
+        m_group->attach(item);
+        m_group->insertKeyOrderedItem(item, i + 1);
+    }
+    WebOSSurfaceItem *item = m_items.at(count / 2);
+
+    QBENCHMARK {
+        m_group->nextKeyOrderedSurfaceGroupItem(item);
+        m_group->nextZOrderedSurfaceGroupItem(item);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+    TestWebOSSurfaceGroup test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_webossurfacegroup.moc"
@@ -0,0 +1,408 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <QGuiApplication>
+#include <QRandomGenerator>
+#include <QSignalSpy>
+#include <QSortFilterProxyModel>
+#include <QtTest>
+
+#include "weboscorecompositor.h"
+#include "webossurfaceitem.h"
+#include "webossurfacemodel.h"
+
+static const QString CARD = QStringLiteral("_WEBOS_WINDOW_TYPE_CARD");
+static const QString OVERLAY = QStringLiteral("_WEBOS_WINDOW_TYPE_OVERLAY");
+
+class TestWebOSSurfaceModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void rowIndex();
+    void appIdLookup();
+    void lastRecentItem();
+
+    void directDataChanged();
+    void coalescedRanges();
+    void coalescedRowShift();
+    void coalescedTransientOrder();
+    void coalescedTransientProxy_data();
+    void coalescedTransientProxy();
+
+    void benchInsertRecent_data();
+    void benchInsertRecent();
+    void benchLookup_data();
+    void benchLookup();
+
+private:
+    WebOSSurfaceItem *createItem(const QString &appId, const QString &type = CARD);
+    void verifyRows(const WebOSSurfaceModel &model, const QList<WebOSSurfaceItem *> &expected);
+    void fill(WebOSSurfaceModel &model, int count);
+    WebOSSurfaceModel *createModel(bool coalesce);
+    void flush(WebOSSurfaceModel *model);
+
+    WebOSCoreCompositor *m_compositor = nullptr;
+};
+
+typedef QPair<int, int> RowRange;
+
+static QList<RowRange> rangesOf(const QSignalSpy &spy)
+{
+    QList<RowRange> ranges;
+    for (const QList<QVariant> &args : spy)
+        ranges << RowRange(args.at(0).value<QModelIndex>().row(), args.at(1).value<QModelIndex>().row());
+    return ranges;
+}
+
+// Accepts a transient only if its display affinity matches the one of
+// its parent, so its acceptance depends on another row
+class TransientProxyModel : public QSortFilterProxyModel
+{
+public:
+    WebOSSurfaceItem *parentItem = nullptr;
+    WebOSSurfaceItem *transientItem = nullptr;
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override
+    {
+        QModelIndex index = sourceModel()->index(sourceRow, 0, sourceParent);
+        WebOSSurfaceItem *item = sourceModel()->data(index).value<WebOSSurfaceItem *>();
+        if (item == transientItem)
+            return parentItem->displayAffinity() == transientItem->displayAffinity();
+        return true;
+    }
+};
+
+void TestWebOSSurfaceModel::initTestCase()
+{
+    qRegisterMetaType<QVector<int>>();
+    m_compositor = new WebOSCoreCompositor(WebOSCoreCompositor::NoExtensions);
+}
+
+void TestWebOSSurfaceModel::cleanupTestCase()
+{
+    delete m_compositor;
+    m_compositor = nullptr;
+}
+
+WebOSSurfaceItem *TestWebOSSurfaceModel::createItem(const QString &appId, const QString &type)
+{
+    WebOSSurfaceItem *item = new WebOSSurfaceItem(m_compositor, nullptr);
+    item->setAppId(appId, false);
+    item->setType(type, false);
+    return item;
+}
+
+void TestWebOSSurfaceModel::verifyRows(const WebOSSurfaceModel &model, const QList<WebOSSurfaceItem *> &expected)
+{
+    QCOMPARE(model.rowCount(), expected.size());
+    for (int row = 0; row < expected.size(); ++row)
+        QCOMPARE(model.indexFromItem(expected.at(row)).row(), row);
+}
+
+void TestWebOSSurfaceModel::fill(WebOSSurfaceModel &model, int count)
+{
+    for (int i = 0; i < count; ++i)
+        model.appendRow(createItem(QString("app%1").arg(i)));
+}
+
+WebOSSurfaceModel *TestWebOSSurfaceModel::createModel(bool coalesce)
+{
+    // The mode is read when the model is created
+    if (coalesce)
+        qputenv("WEBOS_SURFACE_MODEL_COALESCE_CHANGES", "1");
+    else
+        qunsetenv("WEBOS_SURFACE_MODEL_COALESCE_CHANGES");
+    WebOSSurfaceModel *model = new WebOSSurfaceModel;
+    qunsetenv("WEBOS_SURFACE_MODEL_COALESCE_CHANGES");
+    return model;
+}
+
+void TestWebOSSurfaceModel::flush(WebOSSurfaceModel *model)
+{
+    QCoreApplication::sendPostedEvents(model, QEvent::MetaCall);
+}
+
+// Rows must match a plain list through inserts and removals at any row
+void TestWebOSSurfaceModel::rowIndex()
+{
+    WebOSSurfaceModel model;
+    QList<WebOSSurfaceItem *> expected;
+    QRandomGenerator random(1234);
+
+    for (int i = 0; i < 500; ++i) {
+        const int op = random.bounded(3);
+        if (op == 0 || expected.isEmpty()) {
+            WebOSSurfaceItem *item = createItem(QString("app%1").arg(i));
+            const int row = random.bounded(expected.size() + 1);
+            model.insertRow(row, item);
+            expected.insert(row, item);
+        } else if (op == 1) {
+            WebOSSurfaceItem *item = createItem(QString("app%1").arg(i));
+            model.appendRow(item);
+            expected.append(item);
+        } else {
+            const int row = random.bounded(expected.size());
+            WebOSSurfaceItem *item = model.takeRow(row);
+            QCOMPARE(item, expected.takeAt(row));
+            QVERIFY(!model.indexFromItem(item).isValid());
+            delete item;
+        }
+        verifyRows(model, expected);
+    }
+}
+
+void TestWebOSSurfaceModel::appIdLookup()
+{
+    WebOSSurfaceModel model;
+    WebOSSurfaceItem *a = createItem("A");
+    WebOSSurfaceItem *b = createItem("B");
+    WebOSSurfaceItem *c = createItem("A");
+    model.appendRows(QList<WebOSSurfaceItem *>() << a << b << c);
+    QCOMPARE(model.surfaceItemForAppId("A"), a);
+    QCOMPARE(model.surfaceItemForAppId("B"), b);
+    QVERIFY(!model.surfaceItemForAppId("C"));
+
+    // The first in row order wins, as with a linear scan
+    WebOSSurfaceItem *d = createItem("A");
+    model.insertRow(0, d);
+    QCOMPARE(model.surfaceItemForAppId("A"), d);
+
+    // Items are re-bucketed when the appId changes
+    b->setAppId("A", false);
+    a->setAppId("Z", false);
+    delete model.takeRow(0);
+    QCOMPARE(model.surfaceItemForAppId("A"), b);
+    QCOMPARE(model.surfaceItemForAppId("Z"), a);
+    QVERIFY(!model.surfaceItemForAppId("B"));
+}
+
+void TestWebOSSurfaceModel::lastRecentItem()
+{
+    WebOSSurfaceModel model;
+    QVERIFY(!model.getLastRecentItem());
+
+    WebOSSurfaceItem *overlay = createItem("overlay", OVERLAY);
+    WebOSSurfaceItem *card = createItem("card", CARD);
+    WebOSSurfaceItem *plain = createItem("plain", QString());
+    model.appendRows(QList<WebOSSurfaceItem *>() << overlay << card << plain);
+    QCOMPARE(model.getLastRecentItem(), card);
+
+    WebOSSurfaceItem *recent = createItem("recent", QString());
+    model.insertRow(0, recent);
+    QCOMPARE(model.getLastRecentItem(), recent);
+
+    // Changing the type takes it out of the candidates
+    recent->setType(OVERLAY, false);
+    QCOMPARE(model.getLastRecentItem(), card);
+}
+
+// By default every change goes out at once, for the changed row only
+void TestWebOSSurfaceModel::directDataChanged()
+{
+    QScopedPointer<WebOSSurfaceModel> model(createModel(false));
+    fill(*model, 5);
+    QSignalSpy spy(model.data(), &QAbstractItemModel::dataChanged);
+
+    model->surfaceItemForIndex(1)->setDisplayAffinity(1);
+    QCOMPARE(rangesOf(spy), QList<RowRange>() << RowRange(1, 1));
+
+    model->surfaceItemForIndex(3)->setDisplayAffinity(1);
+    model->surfaceItemForIndex(0)->setDisplayAffinity(1);
+    QCOMPARE(rangesOf(spy), QList<RowRange>() << RowRange(1, 1) << RowRange(3, 3) << RowRange(0, 0));
+}
+
+// Changes of one event loop pass go out together, one signal per
+// contiguous run of rows, in row order and with the surfaceItem role
+void TestWebOSSurfaceModel::coalescedRanges()
+{
+    QScopedPointer<WebOSSurfaceModel> model(createModel(true));
+    fill(*model, 6);
+    QSignalSpy spy(model.data(), &QAbstractItemModel::dataChanged);
+
+    model->surfaceItemForIndex(4)->setDisplayAffinity(1);
+    model->surfaceItemForIndex(1)->setDisplayAffinity(1);
+    model->surfaceItemForIndex(2)->setDisplayAffinity(1);
+    model->surfaceItemForIndex(4)->setDisplayAffinity(2);
+    QCOMPARE(spy.count(), 0);
+
+    flush(model.data());
+    QCOMPARE(rangesOf(spy), QList<RowRange>() << RowRange(1, 2) << RowRange(4, 4));
+    for (const QList<QVariant> &args : spy)
+        QCOMPARE(args.at(2).value<QVector<int>>(), QVector<int>() << 0);
+
+    // Nothing is left over for the next pass
+    spy.clear();
+    flush(model.data());
+    QCOMPARE(spy.count(), 0);
+}
+
+// Rows are resolved at flush time, after the rows have moved
+void TestWebOSSurfaceModel::coalescedRowShift()
+{
+    QScopedPointer<WebOSSurfaceModel> model(createModel(true));
+    fill(*model, 4);
+    QSignalSpy spy(model.data(), &QAbstractItemModel::dataChanged);
+
+    WebOSSurfaceItem *changed = model->surfaceItemForIndex(2);
+    WebOSSurfaceItem *removed = model->surfaceItemForIndex(3);
+    changed->setDisplayAffinity(1);
+    removed->setDisplayAffinity(1);
+
+    model->insertRow(0, createItem("recent"));
+    delete model->takeRow(model->indexFromItem(removed).row());
+
+    flush(model.data());
+    QCOMPARE(rangesOf(spy), QList<RowRange>() << RowRange(3, 3));
+}
+
+// A transient changed before its parent is still reported after it, as
+// the transient comes after the parent in the model
+void TestWebOSSurfaceModel::coalescedTransientOrder()
+{
+    QScopedPointer<WebOSSurfaceModel> model(createModel(true));
+    fill(*model, 2);
+    WebOSSurfaceItem *parentItem = createItem("parent");
+    WebOSSurfaceItem *transientItem = createItem("transient");
+    model->appendRow(parentItem);
+    model->appendRow(createItem("other"));
+    model->appendRow(transientItem);
+    QSignalSpy spy(model.data(), &QAbstractItemModel::dataChanged);
+
+    transientItem->setDisplayAffinity(1);
+    parentItem->setDisplayAffinity(1);
+    flush(model.data());
+
+    QCOMPARE(rangesOf(spy), QList<RowRange>() << RowRange(2, 2) << RowRange(4, 4));
+}
+
+// A proxy whose filter of a transient depends on its parent must end up
+// the same with coalescing as without, once the batch is flushed
+void TestWebOSSurfaceModel::coalescedTransientProxy_data()
+{
+    QTest::addColumn<bool>("coalesce");
+    QTest::newRow("direct") << false;
+    QTest::newRow("coalesced") << true;
+}
+
+void TestWebOSSurfaceModel::coalescedTransientProxy()
+{
+    QFETCH(bool, coalesce);
+
+    QScopedPointer<WebOSSurfaceModel> model(createModel(coalesce));
+    WebOSSurfaceItem *parentItem = createItem("parent");
+    WebOSSurfaceItem *transientItem = createItem("transient");
+    model->appendRows(QList<WebOSSurfaceItem *>() << parentItem << createItem("other") << transientItem);
+
+    TransientProxyModel proxy;
+    proxy.parentItem = parentItem;
+    proxy.transientItem = transientItem;
+    proxy.setSourceModel(model.data());
+    QCOMPARE(proxy.rowCount(), 3);
+
+    // Hidden as the transient moves away from its parent
+    transientItem->setDisplayAffinity(1);
+    flush(model.data());
+    QCOMPARE(proxy.rowCount(), 2);
+
+    // Shown again as both move to the same display in one pass
+    parentItem->setDisplayAffinity(2);
+    transientItem->setDisplayAffinity(2);
+    flush(model.data());
+    QCOMPARE(proxy.rowCount(), 3);
+
+    // Both move on, the parent first
+    parentItem->setDisplayAffinity(3);
+    transientItem->setDisplayAffinity(3);
+    flush(model.data());
+    QCOMPARE(proxy.rowCount(), 3);
+    QCOMPARE(proxy.mapToSource(proxy.index(2, 0)).row(), 2);
+
+    if (!coalesce)
+        return;
+
+    // The transient first. Without coalescing, the transient would be
+    // filtered against the old parent and stay hidden. The batch goes
+    // out in row order, so the parent is updated first.
+    transientItem->setDisplayAffinity(4);
+    parentItem->setDisplayAffinity(4);
+    flush(model.data());
+    QCOMPARE(proxy.rowCount(), 3);
+}
+
+void TestWebOSSurfaceModel::benchInsertRecent_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("50") << 50;
+    QTest::newRow("500") << 500;
+    QTest::newRow("2000") << 2000;
+}
+
+// A recent item comes in at the front and goes away again. The cost
+// should not grow with the number of items.
+void TestWebOSSurfaceModel::benchInsertRecent()
+{
+    QFETCH(int, count);
+
+    WebOSSurfaceModel model;
+    fill(model, count);
+    WebOSSurfaceItem *recent = createItem("recent");
+    WebOSSurfaceItem *last = model.surfaceItemForIndex(count - 1);
+
+    QBENCHMARK {
+        model.insertRow(0, recent);
+        model.indexFromItem(last);
+        model.takeRow(0);
+    }
+
+    delete recent;
+}
+
+void TestWebOSSurfaceModel::benchLookup_data()
+{
+    benchInsertRecent_data();
+}
+
+void TestWebOSSurfaceModel::benchLookup()
+{
+    QFETCH(int, count);
+
+    WebOSSurfaceModel model;
+    fill(model, count);
+    WebOSSurfaceItem *last = model.surfaceItemForIndex(count - 1);
+    const QString lastAppId = last->appId();
+
+    QBENCHMARK {
+        model.indexFromItem(last);
+        model.surfaceItemForAppId(lastAppId);
+        model.getLastRecentItem();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+    TestWebOSSurfaceModel test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_webossurfacemodel.moc"
@@ -0,0 +1,170 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <QGuiApplication>
+#include <QtTest>
+
+#include "weboscorecompositor.h"
+#include "webosgroupedwindowmodel.h"
+#include "webossurfaceitem.h"
+#include "webossurfacemodel.h"
+
+class TestWebOSWindowModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+    void groupedZOrder();
+    void groupedZOrderWhileLocked();
+    void unlockSorts();
+
+private:
+    WebOSSurfaceItem *createItem(qreal z);
+    QList<WebOSSurfaceItem *> rows(WebOSWindowModel &model);
+    void changeZ(WebOSSurfaceItem *item, qreal z);
+    void flush(QObject *model);
+
+    WebOSCoreCompositor *m_compositor = nullptr;
+    WebOSSurfaceModel *m_source = nullptr;
+};
+
+void TestWebOSWindowModel::initTestCase()
+{
+    m_compositor = new WebOSCoreCompositor(WebOSCoreCompositor::NoExtensions);
+}
+
+void TestWebOSWindowModel::cleanupTestCase()
+{
+    delete m_compositor;
+    m_compositor = nullptr;
+}
+
+void TestWebOSWindowModel::init()
+{
+    m_source = new WebOSSurfaceModel;
+}
+
+void TestWebOSWindowModel::cleanup()
+{
+    // The source deletes its items
+    delete m_source;
+    m_source = nullptr;
+}
+
+WebOSSurfaceItem *TestWebOSWindowModel::createItem(qreal z)
+{
+    WebOSSurfaceItem *item = new WebOSSurfaceItem(m_compositor, nullptr);
+    item->setZ(z);
+    m_source->appendRow(item);
+    return item;
+}
+
+QList<WebOSSurfaceItem *> TestWebOSWindowModel::rows(WebOSWindowModel &model)
+{
+    QList<WebOSSurfaceItem *> items;
+    for (int row = 0; row < model.count(); ++row)
+        items.append(model.get(row).value<WebOSSurfaceItem *>());
+    return items;
+}
+
+// As a surface group layer does when its z index is set
+void TestWebOSWindowModel::changeZ(WebOSSurfaceItem *item, qreal z)
+{
+    item->setZ(z);
+    emit item->zOrderChanged(int(z));
+}
+
+// z-order changes are applied in a queued call
+void TestWebOSWindowModel::flush(QObject *model)
+{
+    QCoreApplication::sendPostedEvents(model, QEvent::MetaCall);
+}
+
+void TestWebOSWindowModel::groupedZOrder()
+{
+    WebOSSurfaceItem *a = createItem(1);
+    WebOSSurfaceItem *b = createItem(2);
+    WebOSSurfaceItem *c = createItem(3);
+
+    WebOSGroupedWindowModel model;
+    model.setSortKeys({WebOSWindowModel::SortByZ});
+    model.setSurfaceSource(m_source);
+    QCOMPARE(rows(model), (QList<WebOSSurfaceItem *>{a, b, c}));
+
+    changeZ(a, 4);
+    flush(&model);
+    QCOMPARE(rows(model), (QList<WebOSSurfaceItem *>{b, c, a}));
+}
+
+// Changes while locked are not dropped but applied on unlock
+void TestWebOSWindowModel::groupedZOrderWhileLocked()
+{
+    WebOSSurfaceItem *a = createItem(1);
+    WebOSSurfaceItem *b = createItem(2);
+    WebOSSurfaceItem *c = createItem(3);
+
+    WebOSGroupedWindowModel model;
+    model.setSortKeys({WebOSWindowModel::SortByZ});
+    model.setSurfaceSource(m_source);
+
+    model.setLocked(true);
+    changeZ(c, 0);
+    flush(&model);
+    QCOMPARE(rows(model), (QList<WebOSSurfaceItem *>{a, b, c}));
+
+    model.setLocked(false);
+    QCOMPARE(rows(model), (QList<WebOSSurfaceItem *>{c, a, b}));
+
+    // And tracking goes on as before
+    changeZ(a, 5);
+    flush(&model);
+    QCOMPARE(rows(model), (QList<WebOSSurfaceItem *>{c, b, a}));
+}
+
+void TestWebOSWindowModel::unlockSorts()
+{
+    WebOSSurfaceItem *a = createItem(1);
+    WebOSSurfaceItem *b = createItem(2);
+
+    WebOSWindowModel model;
+    model.setSortKeys({WebOSWindowModel::SortByZ});
+    model.setSurfaceSource(m_source);
+
+    model.setLocked(true);
+    a->setZ(3);
+    m_source->notifyItemChanged(a);
+    flush(m_source);
+    QCOMPARE(rows(model), (QList<WebOSSurfaceItem *>{a, b}));
+
+    model.setLocked(false);
+    QCOMPARE(rows(model), (QList<WebOSSurfaceItem *>{b, a}));
+}
+
+int main(int argc, char *argv[])
+{
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+    TestWebOSWindowModel test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_weboswindowmodel.moc"
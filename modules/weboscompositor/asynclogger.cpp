@@ -0,0 +1,260 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "asynclogger.h"
+
+#include <QByteArray>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+// Idle interval of the drainer
+static const int DRAIN_INTERVAL_MS = 20;
+// Bounds for flushing before abort and on exit
+static const int FATAL_FLUSH_TIMEOUT_MS = 200;
+static const int SHUTDOWN_FLUSH_TIMEOUT_MS = 500;
+// A message longer than this many records is truncated
+static const int MAX_CHUNKS = 16;
+
+static AsyncLogger *s_instance = nullptr;
+
+namespace {
+struct ThreadRing {
+    std::shared_ptr<void> ring;
+    std::atomic<bool> *retired = nullptr;
+    ~ThreadRing();
+};
+
+thread_local ThreadRing t_ring;
+// Trivially destructible, so still valid after t_ring is gone
+thread_local bool t_ringDestroyed = false;
+thread_local bool t_isDrainer = false;
+}
+
+static void shutdownAtExit()
+{
+    if (s_instance)
+        s_instance->shutdown();
+}
+
+AsyncLogger *AsyncLogger::create(Sink sink)
+{
+    if (qgetenv("WEBOS_COMPOSITOR_ASYNC_LOG").toInt() != 1)
+        return nullptr;
+    if (!s_instance) {
+        s_instance = new AsyncLogger(sink);
+        std::atexit(shutdownAtExit);
+    }
+    return s_instance;
+}
+
+AsyncLogger::AsyncLogger(Sink sink)
+    : m_sink(sink)
+{
+    m_thread = std::thread(&AsyncLogger::run, this);
+}
+
+AsyncLogger::LogRing *AsyncLogger::threadRing()
+{
+    if (Q_UNLIKELY(t_ringDestroyed))
+        return nullptr;
+
+    if (Q_UNLIKELY(!t_ring.ring)) {
+        std::shared_ptr<LogRing> ring = std::make_shared<LogRing>();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_rings.push_back(ring);
+        }
+        t_ring.ring = ring;
+        t_ring.retired = &ring->retired;
+    }
+    return static_cast<LogRing *>(t_ring.ring.get());
+}
+
+ThreadRing::~ThreadRing()
+{
+    // The drainer writes what is left and then releases the ring
+    t_ringDestroyed = true;
+    if (retired)
+        retired->store(true, std::memory_order_release);
+}
+
+bool AsyncLogger::log(QtMsgType type, const char *function, const QString &message)
+{
+    if (m_stopped.load(std::memory_order_acquire) || t_isDrainer)
+        return false;
+
+    if (type == QtFatalMsg) {
+        // Get the preceding messages out before the caller aborts
+        flush(FATAL_FLUSH_TIMEOUT_MS);
+        return false;
+    }
+
+    LogRing *ring = threadRing();
+    if (!ring)
+        return false;
+
+    const int length = qMin(message.size(), MAX_CHUNKS * LogRecord::MaxChars);
+    const quint32 chunks = qMax(1, (length + LogRecord::MaxChars - 1) / LogRecord::MaxChars);
+
+    const quint32 head = ring->head.load(std::memory_order_relaxed);
+    const quint32 tail = ring->tail.load(std::memory_order_acquire);
+    if (LogRing::Capacity - (head - tail) < chunks) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    const quint64 seq = m_sequence.fetch_add(1, std::memory_order_relaxed);
+    const QChar *src = message.constData();
+    int remaining = length;
+    for (quint32 i = 0; i < chunks; ++i) {
+        LogRecord &r = ring->records[(head + i) % LogRing::Capacity];
+        r.seq = seq;
+        r.function = function;
+        r.type = type;
+        r.chunk = i;
+        r.chunks = chunks;
+        r.length = qMin(remaining, LogRecord::MaxChars);
+        memcpy(r.text, src, r.length * sizeof(QChar));
+        src += r.length;
+        remaining -= r.length;
+    }
+    ring->head.store(head + chunks, std::memory_order_release);
+
+    // Don't wait for the idle interval if the ring is filling up.
+    // The notification can be missed, which only delays draining.
+    if (head + chunks - tail > LogRing::Capacity / 2 &&
+        !m_drainRequested.exchange(true, std::memory_order_relaxed))
+        m_wakeup.notify_one();
+
+    return true;
+}
+
+bool AsyncLogger::flush(int timeoutMs)
+{
+    if (t_isDrainer)
+        return false;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_thread.joinable())
+        return false;
+
+    // A pass that already started may have missed the latest records
+    const quint64 target = m_passesStarted + 1;
+    m_drainRequested.store(true, std::memory_order_relaxed);
+    m_wakeup.notify_one();
+    return m_passFinished.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                                   [this, target] { return m_passesFinished >= target; });
+}
+
+void AsyncLogger::shutdown()
+{
+    if (m_stopped.exchange(true))
+        return;
+
+    bool flushed = flush(SHUTDOWN_FLUSH_TIMEOUT_MS);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wakeup.notify_one();
+
+    // The sink may be stuck, so don't wait for it forever
+    if (flushed)
+        m_thread.join();
+    else
+        m_thread.detach();
+}
+
+void AsyncLogger::run()
+{
+    t_isDrainer = true;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wakeup.wait_for(lock, std::chrono::milliseconds(DRAIN_INTERVAL_MS), [this] {
+            return m_stopping || m_drainRequested.load(std::memory_order_relaxed);
+        });
+        const bool stopping = m_stopping;
+        m_drainRequested.store(false, std::memory_order_relaxed);
+        ++m_passesStarted;
+        std::vector<std::shared_ptr<LogRing>> rings = m_rings;
+        lock.unlock();
+
+        drain(rings);
+
+        lock.lock();
+        // Release the rings of finished threads once they are empty
+        m_rings.erase(std::remove_if(m_rings.begin(), m_rings.end(),
+                                     [](const std::shared_ptr<LogRing> &ring) {
+                                         return ring->retired.load(std::memory_order_acquire) &&
+                                             ring->head.load(std::memory_order_acquire) ==
+                                                 ring->tail.load(std::memory_order_relaxed);
+                                     }),
+                      m_rings.end());
+        ++m_passesFinished;
+        m_passFinished.notify_all();
+
+        if (stopping)
+            break;
+    }
+}
+
+void AsyncLogger::drain(const std::vector<std::shared_ptr<LogRing>> &rings)
+{
+    struct Entry {
+        quint64 seq;
+        QtMsgType type;
+        const char *function;
+        QString text;
+    };
+    std::vector<Entry> entries;
+    quint64 dropped = 0;
+
+    for (const std::shared_ptr<LogRing> &ring : rings) {
+        quint32 tail = ring->tail.load(std::memory_order_relaxed);
+        const quint32 head = ring->head.load(std::memory_order_acquire);
+        while (tail != head) {
+            const LogRecord &r = ring->records[tail % LogRing::Capacity];
+            if (r.chunk == 0) {
+                Entry entry = { r.seq, r.type, r.function, QString() };
+                entry.text.reserve(r.chunks * LogRecord::MaxChars);
+                entries.push_back(entry);
+            }
+            entries.back().text.append(r.text, r.length);
+            ++tail;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+        dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+    }
+
+    // Interleave messages of different threads in the order they were logged
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry &a, const Entry &b) { return a.seq < b.seq; });
+    for (const Entry &entry : entries) {
+        QByteArray text = entry.text.toUtf8();
+        m_sink(entry.type, entry.function, text.constData());
+    }
+
+    if (dropped > 0) {
+        m_droppedTotal.fetch_add(dropped, std::memory_order_relaxed);
+        QByteArray text = QByteArray::number(dropped) + " messages dropped as the log buffer was full, "
+                          + QByteArray::number(droppedCount()) + " in total";
+        m_sink(QtWarningMsg, "AsyncLogger", text.constData());
+    }
+}
@@ -0,0 +1,95 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef ASYNCLOGGER_H
+#define ASYNCLOGGER_H
+
+#include <QtGlobal>
+#include <QString>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Moves log output off the calling thread.
+   Each thread copies its messages into fixed-size records of its own
+   single-producer ring, and a drainer thread formats them and passes
+   them to the sink in sequence order. When a ring is full the message
+   is dropped and counted; the drainer reports the count. */
+class AsyncLogger
+{
+public:
+    typedef void (*Sink)(QtMsgType type, const char *function, const char *message);
+
+    // Returns nullptr unless enabled by WEBOS_COMPOSITOR_ASYNC_LOG=1
+    static AsyncLogger *create(Sink sink);
+
+    // Returns false if the caller has to write the message by itself,
+    // which is the case for fatal messages (after a bounded flush),
+    // for the drainer thread and after shutdown.
+    bool log(QtMsgType type, const char *function, const QString &message);
+
+    // Waits up to timeoutMs until everything logged so far has been written
+    bool flush(int timeoutMs);
+    void shutdown();
+
+    quint64 droppedCount() const { return m_droppedTotal.load(std::memory_order_relaxed); }
+
+private:
+    struct LogRecord {
+        static const int MaxChars = 240;
+        quint64 seq;
+        const char *function;
+        QtMsgType type;
+        quint16 chunk;
+        quint16 chunks;
+        quint16 length;
+        QChar text[MaxChars];
+    };
+
+    struct LogRing {
+        static const quint32 Capacity = 128;
+        LogRecord records[Capacity];
+        std::atomic<quint32> head{0};
+        std::atomic<quint32> tail{0};
+        std::atomic<quint32> dropped{0};
+        std::atomic<bool> retired{false};
+    };
+
+    explicit AsyncLogger(Sink sink);
+    LogRing *threadRing();
+    void run();
+    void drain(const std::vector<std::shared_ptr<LogRing>> &rings);
+
+    Sink m_sink;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::condition_variable m_passFinished;
+    std::vector<std::shared_ptr<LogRing>> m_rings;
+    std::atomic<bool> m_drainRequested{false};
+    std::atomic<bool> m_stopped{false};
+    bool m_stopping = false;
+    quint64 m_passesStarted = 0;
+    quint64 m_passesFinished = 0;
+    std::atomic<quint64> m_sequence{0};
+    std::atomic<quint64> m_droppedTotal{0};
+};
+
+#endif // ASYNCLOGGER_H
@@ -0,0 +1,84 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "contentratedetector.h"
+
+// Commits needed within the tolerance to regard a source as steady
+static constexpr int STEADY_COMMITS = 8;
+// Deviation allowed from the smoothed interval, in percent
+static constexpr int INTERVAL_TOLERANCE = 15;
+// A source not committing for this many intervals is regarded as idle
+static constexpr int IDLE_INTERVALS = 3;
+// Intervals longer than this are not content cadence (1 fps)
+static constexpr qint64 MAX_INTERVAL = 1000000000;
+
+static const qreal s_commonRates[] = { 23.976, 24, 25, 29.97, 30, 48, 50, 59.94, 60 };
+
+void ContentRateDetector::addCommit(const void *source, qint64 timestamp)
+{
+    Source &s = m_sources[source];
+
+    if (s.lastCommit > 0) {
+        qint64 interval = timestamp - s.lastCommit;
+        if (interval <= 0 || interval > MAX_INTERVAL) {
+            s.interval = 0;
+            s.steadyCommits = 0;
+        } else if (s.interval == 0) {
+            s.interval = interval;
+        } else if (qAbs(interval - s.interval) * 100 <= s.interval * INTERVAL_TOLERANCE) {
+            s.interval += (interval - s.interval) / 8;
+            if (s.steadyCommits < STEADY_COMMITS)
+                s.steadyCommits++;
+        } else {
+            s.interval = interval;
+            s.steadyCommits = 0;
+        }
+    }
+
+    s.lastCommit = timestamp;
+}
+
+void ContentRateDetector::remove(const void *source)
+{
+    m_sources.remove(source);
+}
+
+qreal ContentRateDetector::snapRate(qreal rate)
+{
+    for (qreal common : s_commonRates) {
+        if (qAbs(rate - common) <= common * 0.01)
+            return common;
+    }
+    return rate;
+}
+
+qreal ContentRateDetector::dominantRate(qint64 now) const
+{
+    qint64 shortest = 0;
+
+    for (auto it = m_sources.cbegin(); it != m_sources.cend(); ++it) {
+        const Source &s = it.value();
+        if (s.interval == 0 || now - s.lastCommit > s.interval * IDLE_INTERVALS)
+            continue;
+        // Any active source without steady cadence decides nothing
+        if (s.steadyCommits < STEADY_COMMITS)
+            return 0;
+        if (shortest == 0 || s.interval < shortest)
+            shortest = s.interval;
+    }
+
+    return shortest > 0 ? snapRate(1000000000.0 / shortest) : 0;
+}
@@ -0,0 +1,50 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CONTENTRATEDETECTOR_H
+#define CONTENTRATEDETECTOR_H
+
+#include <WebOSCoreCompositor/weboscompositorexport.h>
+
+#include <QHash>
+
+/* Estimates the commit cadence of each content source (surface) from
+   commit timestamps and tells the dominant content rate, which is the
+   highest rate among the sources committing steadily.
+   Timestamps are in nanoseconds of CLOCK_MONOTONIC. */
+class WEBOS_COMPOSITOR_EXPORT ContentRateDetector
+{
+public:
+    void addCommit(const void *source, qint64 timestamp);
+    void remove(const void *source);
+    void clear() { m_sources.clear(); }
+
+    // Rate in Hz snapped to common video rates, 0 if nothing is steady
+    qreal dominantRate(qint64 now) const;
+
+private:
+    struct Source {
+        qint64 lastCommit = 0;
+        qint64 interval = 0; // smoothed
+        int steadyCommits = 0;
+    };
+
+    static qreal snapRate(qreal rate);
+
+    QHash<const void *, Source> m_sources;
+};
+
+#endif // CONTENTRATEDETECTOR_H
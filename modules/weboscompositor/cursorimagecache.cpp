@@ -0,0 +1,85 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "cursorimagecache.h"
+
+#include <QCoreApplication>
+#include <QHash>
+#include <QImage>
+#include <QPixmap>
+#include <QtWaylandCompositor/qwaylandbufferref.h>
+
+// Enough for the frames of an animated cursor or two
+static const int MAX_CURSORS = 32;
+
+CursorImageCache *CursorImageCache::instance()
+{
+    static CursorImageCache s_instance;
+    return &s_instance;
+}
+
+CursorImageCache::CursorImageCache()
+    : m_cursors(MAX_CURSORS)
+{
+    // The cursors must go while the platform integration is still alive
+    qAddPostRoutine(CursorImageCache::cleanup);
+}
+
+void CursorImageCache::cleanup()
+{
+    instance()->m_cursors.clear();
+}
+
+bool CursorImageCache::cursorFor(const QWaylandBufferRef &buffer, int hotSpotX, int hotSpotY, QCursor *cursor)
+{
+    // For shm buffers this refers to the client memory, nothing is copied yet
+    const QImage image = buffer.image();
+    if (image.isNull())
+        return false;
+
+    if (hotSpotX < 0 || hotSpotX > image.width() || hotSpotY < 0 || hotSpotY > image.height())
+        return false;
+
+    Key key;
+    key.buffer = buffer.wl_buffer();
+    key.contentHash = qHashBits(image.constBits(), image.sizeInBytes());
+    key.size = image.size();
+    key.hotSpotX = hotSpotX;
+    key.hotSpotY = hotSpotY;
+
+    if (QCursor *cached = m_cursors.object(key)) {
+        *cursor = *cached;
+        return true;
+    }
+
+    QCursor *c = new QCursor(QPixmap::fromImage(image.copy()), hotSpotX, hotSpotY);
+    *cursor = *c;
+    m_cursors.insert(key, c);
+    return true;
+}
+
+bool operator==(const CursorImageCache::Key &a, const CursorImageCache::Key &b)
+{
+    return a.buffer == b.buffer && a.contentHash == b.contentHash && a.size == b.size &&
+        a.hotSpotX == b.hotSpotX && a.hotSpotY == b.hotSpotY;
+}
+
+uint qHash(const CursorImageCache::Key &key, uint seed)
+{
+    return qHash(key.buffer, seed) ^ key.contentHash ^
+        qHash((key.size.width() << 16) ^ key.size.height(), seed) ^
+        qHash((key.hotSpotX << 16) ^ key.hotSpotY, seed);
+}
@@ -0,0 +1,56 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef CURSORIMAGECACHE_H
+#define CURSORIMAGECACHE_H
+
+#include <QCache>
+#include <QCursor>
+#include <QSize>
+
+class QWaylandBufferRef;
+
+/* Cursors made from client cursor buffers, shared by all surface items.
+   A live cursor usually cycles through a few buffers, so each frame is
+   converted to a QCursor once. Entries are keyed by the buffer, its
+   contents and the hotspot, as a client may redraw a buffer it reuses. */
+class CursorImageCache
+{
+public:
+    static CursorImageCache *instance();
+
+    // Returns false if the buffer has no image or the hotspot is outside
+    bool cursorFor(const QWaylandBufferRef &buffer, int hotSpotX, int hotSpotY, QCursor *cursor);
+
+    struct Key {
+        const void *buffer;
+        uint contentHash;
+        QSize size;
+        int hotSpotX;
+        int hotSpotY;
+    };
+
+private:
+    CursorImageCache();
+    static void cleanup();
+
+    QCache<Key, QCursor> m_cursors;
+};
+
+bool operator==(const CursorImageCache::Key &a, const CursorImageCache::Key &b);
+uint qHash(const CursorImageCache::Key &key, uint seed = 0);
+
+#endif // CURSORIMAGECACHE_H
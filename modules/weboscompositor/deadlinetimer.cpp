@@ -0,0 +1,106 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <QDebug>
+#include <QSocketNotifier>
+
+#include "deadlinetimer.h"
+
+DeadlineTimer::DeadlineTimer(QObject *parent)
+    : QObject(parent)
+{
+    m_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (m_fd >= 0) {
+        m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+        connect(m_notifier, &QSocketNotifier::activated, this, &DeadlineTimer::onExpired);
+    } else {
+        qWarning() << "Can't create timerfd, falling back to QTimer";
+        m_fallbackTimer.setTimerType(Qt::PreciseTimer);
+        m_fallbackTimer.setSingleShot(true);
+        connect(&m_fallbackTimer, &QTimer::timeout, this, &DeadlineTimer::onExpired);
+    }
+}
+
+DeadlineTimer::~DeadlineTimer()
+{
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+qint64 DeadlineTimer::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (qint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void DeadlineTimer::start(qint64 deadlineNs)
+{
+    // Zero disarms timerfd, so use the earliest valid time instead
+    m_deadline = qMax<qint64>(deadlineNs, 1);
+    m_active = true;
+
+    if (m_fd >= 0) {
+        struct itimerspec spec = {};
+        spec.it_value.tv_sec = m_deadline / 1000000000;
+        spec.it_value.tv_nsec = m_deadline % 1000000000;
+        if (timerfd_settime(m_fd, TFD_TIMER_ABSTIME, &spec, nullptr) != 0)
+            qWarning() << "timerfd_settime failed for deadline" << m_deadline;
+    } else {
+        // Round up not to fire before the deadline
+        qint64 remaining = qMax<qint64>(m_deadline - now(), 0);
+        m_fallbackTimer.start((int) ((remaining + 999999) / 1000000));
+    }
+}
+
+void DeadlineTimer::stop()
+{
+    m_active = false;
+
+    if (m_fd >= 0) {
+        struct itimerspec spec = {};
+        timerfd_settime(m_fd, 0, &spec, nullptr);
+    } else {
+        m_fallbackTimer.stop();
+    }
+}
+
+qint64 DeadlineTimer::remainingTimeNs() const
+{
+    if (!m_active)
+        return -1;
+    return qMax<qint64>(m_deadline - now(), 0);
+}
+
+void DeadlineTimer::onExpired()
+{
+    if (m_fd >= 0) {
+        quint64 expirations = 0;
+        // Drain the expiration count, it may be stale after stop()
+        if (::read(m_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+            return;
+    }
+
+    if (!m_active)
+        return;
+
+    m_active = false;
+    emit timeout();
+}
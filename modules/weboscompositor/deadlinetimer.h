@@ -0,0 +1,64 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef DEADLINETIMER_H
+#define DEADLINETIMER_H
+
+#include <WebOSCoreCompositor/weboscompositorexport.h>
+
+#include <QObject>
+#include <QTimer>
+
+class QSocketNotifier;
+
+/* Single shot timer firing at an absolute CLOCK_MONOTONIC deadline
+   in nanoseconds. Unlike QTimer it is not quantized to milliseconds.
+   Falls back to QTimer if timerfd is not available. */
+class WEBOS_COMPOSITOR_EXPORT DeadlineTimer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DeadlineTimer(QObject *parent = nullptr);
+    ~DeadlineTimer();
+
+    void start(qint64 deadlineNs);
+    void startAfter(qint64 intervalNs) { start(now() + intervalNs); }
+    void stop();
+
+    bool isActive() const { return m_active; }
+    qint64 deadline() const { return m_deadline; }
+    // -1 if not active, 0 if expired but not delivered yet
+    qint64 remainingTimeNs() const;
+
+    static qint64 now();
+
+signals:
+    void timeout();
+
+private slots:
+    void onExpired();
+
+private:
+    int m_fd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+    QTimer m_fallbackTimer;
+
+    bool m_active = false;
+    qint64 m_deadline = 0;
+};
+
+#endif // DEADLINETIMER_H
@@ -71,6 +71,11 @@ QPointF DebugTouchPoint::normalizedPos() const
     return d->normalizedPos;
 }
 
+void DebugTouchPoint::setTouchId(int id)
+{
+    d->id = id;
+}
+
 void DebugTouchPoint::setPos(const QPointF &pos)
 {
     d->pos = pos;
@@ -134,26 +139,46 @@ DebugTouchEvent::DebugTouchEvent(QObject *parent)
 {
 }
 
+// The copy refers to the points but doesn't own them
 DebugTouchEvent::DebugTouchEvent(const DebugTouchEvent &other)
 {
     this->m_touchPoints = other._touchPoints();
+    this->m_count = m_touchPoints.size();
 }
 
+// Points are children of the event that owns them
 DebugTouchEvent::~DebugTouchEvent()
 {
-    qDeleteAll(m_touchPoints.begin(), m_touchPoints.end());
+}
+
+DebugTouchEvent::ListIndex DebugTouchEvent::touchPointCount(QQmlListProperty<DebugTouchPoint> *list)
+{
+    return static_cast<DebugTouchEvent *>(list->object)->m_count;
+}
+
+DebugTouchPoint *DebugTouchEvent::touchPointAt(QQmlListProperty<DebugTouchPoint> *list, ListIndex index)
+{
+    DebugTouchEvent *event = static_cast<DebugTouchEvent *>(list->object);
+    return index >= 0 && index < event->m_count ? event->m_touchPoints.at(index) : nullptr;
 }
 
 QQmlListProperty<DebugTouchPoint> DebugTouchEvent::touchPoints()
 {
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-    return QQmlListProperty<DebugTouchPoint>(this, &m_touchPoints);
-#else
-    return QQmlListProperty<DebugTouchPoint>(this, m_touchPoints);
-#endif
+    return QQmlListProperty<DebugTouchPoint>(this, nullptr, &DebugTouchEvent::touchPointCount, &DebugTouchEvent::touchPointAt);
 }
 
 void DebugTouchEvent::appendDebugTouchPoint(DebugTouchPoint *point)
 {
-    m_touchPoints.append(point);
+    point->setParent(this);
+    m_touchPoints.insert(m_count++, point);
+}
+
+DebugTouchPoint *DebugTouchEvent::nextDebugTouchPoint(int id)
+{
+    if (m_count == m_touchPoints.size())
+        m_touchPoints.append(new DebugTouchPoint(this));
+
+    DebugTouchPoint *point = m_touchPoints.at(m_count++);
+    point->setTouchId(id);
+    return point;
 }
@@ -68,6 +68,7 @@ public:
     TouchPointState state() const;
 
     // internal
+    void setTouchId(int id);
     void setPos(const QPointF &normalizedPos);
     void setNormalizedPos(const QPointF &normalizedPos);
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
@@ -94,13 +95,26 @@ public:
     ~DebugTouchEvent() override;
 
     QQmlListProperty<DebugTouchPoint> touchPoints();
-    QList<DebugTouchPoint *> _touchPoints() const { return m_touchPoints; }
+    QList<DebugTouchPoint *> _touchPoints() const { return m_touchPoints.mid(0, m_count); }
 
     // internal
     void appendDebugTouchPoint(DebugTouchPoint *point);
+    // Points are pooled and reused by the next event after clear()
+    void clear() { m_count = 0; }
+    DebugTouchPoint *nextDebugTouchPoint(int id);
 
 private:
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    typedef qsizetype ListIndex;
+#else
+    typedef int ListIndex;
+#endif
+    static ListIndex touchPointCount(QQmlListProperty<DebugTouchPoint> *list);
+    static DebugTouchPoint *touchPointAt(QQmlListProperty<DebugTouchPoint> *list, ListIndex index);
+
+    // The first m_count entries are the points of the current event
     QList<DebugTouchPoint *> m_touchPoints;
+    int m_count = 0;
 };
 Q_DECLARE_METATYPE(DebugTouchEvent)
 
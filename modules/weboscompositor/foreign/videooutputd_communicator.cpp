@@ -20,9 +20,39 @@
 
 VideoOutputdCommunicator* VideoOutputdCommunicator::m_instance = nullptr;
 
+// Whether b can be sent before a, which holds only for the geometry of
+// different contexts. Anything else may depend on the order, e.g. moving
+// the mute owner from one context to another.
+static bool commutes(const QString &aContextId, const VideoOutputdBatch::Request &a,
+                     const QString &bContextId, const VideoOutputdBatch::Request &b)
+{
+    return aContextId != bContextId &&
+        a.type <= VideoOutputdBatch::Request::CropRegion &&
+        b.type <= VideoOutputdBatch::Request::CropRegion;
+}
+
+// The display window and crop region set the same thing
+static bool sameTarget(const VideoOutputdBatch::Request &a, const VideoOutputdBatch::Request &b)
+{
+    switch (a.type) {
+    case VideoOutputdBatch::Request::DisplayWindow:
+    case VideoOutputdBatch::Request::CropRegion:
+        return b.type <= VideoOutputdBatch::Request::CropRegion;
+    default:
+        return a.type == b.type && a.name == b.name;
+    }
+}
+
 VideoOutputdCommunicator::VideoOutputdCommunicator(QObject *parent)
     : QObject(parent)
+    , m_transport(new VideoOutputdSignalTransport(this))
 {
+    m_batching = qgetenv("WEBOS_VIDEOOUTPUTD_BATCH").toInt() == 1;
+}
+
+VideoOutputdCommunicator::~VideoOutputdCommunicator()
+{
+    flush();
 }
 
 VideoOutputdCommunicator* VideoOutputdCommunicator::instance()
@@ -41,22 +71,120 @@ void VideoOutputdCommunicator::resetInstance()
     m_instance = nullptr;
 }
 
+void VideoOutputdCommunicator::setTransport(VideoOutputdTransport *transport)
+{
+    // Pending requests were made for the old one
+    flush();
+    if (transport)
+        m_transport.reset(transport);
+    else
+        m_transport.reset(new VideoOutputdSignalTransport(this));
+}
+
+void VideoOutputdCommunicator::setBatching(bool batching)
+{
+    if (m_batching != batching) {
+        flush();
+        m_batching = batching;
+    }
+}
+
+void VideoOutputdCommunicator::queue(const QString &contextId, const VideoOutputdBatch::Request &request)
+{
+    const qint64 queuedNs = VideoOutputdTransport::now();
+
+    if (!m_batching) {
+        VideoOutputdBatch batch;
+        batch.contextId = contextId;
+        batch.queuedNs = queuedNs;
+        batch.requests.append(request);
+        m_transport->send(batch);
+        return;
+    }
+
+    /* A later request replaces a pending one with the same target, but
+       only if it may move ahead of everything queued after that one.
+       Otherwise both are sent. */
+    for (int i = m_pending.size() - 1; i >= 0; --i) {
+        const PendingRequest &pending = m_pending.at(i);
+        if (pending.contextId == contextId && sameTarget(pending.request, request)) {
+            m_pending.remove(i);
+            break;
+        }
+        if (!commutes(pending.contextId, pending.request, contextId, request))
+            break;
+    }
+    m_pending.append({contextId, request, queuedNs});
+
+    // Geometry is updated while synchronizing a frame, so a queued flush
+    // goes out once per frame with the final values of it
+    if (!m_flushQueued) {
+        m_flushQueued = true;
+        QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+    }
+}
+
+void VideoOutputdCommunicator::flush()
+{
+    m_flushQueued = false;
+    if (m_pending.isEmpty())
+        return;
+
+    // The transport may cause new requests, which go to the next flush
+    QVector<PendingRequest> pending;
+    pending.swap(m_pending);
+
+    // Runs of the same context become one batch each
+    VideoOutputdBatch batch;
+    for (const PendingRequest &p : qAsConst(pending)) {
+        if (!batch.requests.isEmpty() && batch.contextId != p.contextId) {
+            m_transport->send(batch);
+            batch.requests.clear();
+        }
+        if (batch.requests.isEmpty()) {
+            batch.contextId = p.contextId;
+            batch.queuedNs = p.queuedNs;
+        }
+        batch.requests.append(p.request);
+    }
+    m_transport->send(batch);
+}
+
 void VideoOutputdCommunicator::setDisplayWindow(QRect sourceRectangle, QRect destinationRectangle, QRect appOutput, QString contextId)
 {
-    emit setVideoDisplayWindowRequested(sourceRectangle, destinationRectangle, appOutput, contextId);
+    VideoOutputdBatch::Request request;
+    request.type = VideoOutputdBatch::Request::DisplayWindow;
+    request.sourceRect = sourceRectangle;
+    request.destinationRect = destinationRectangle;
+    request.appOutput = appOutput;
+    queue(contextId, request);
 }
 
 void VideoOutputdCommunicator::setCropRegion(QRect originalRectangle, QRect sourceRectangle, QRect destinationRectangle, QRect appOutput, QString contextId)
 {
-    emit setVideoCropRegionRequested(originalRectangle, sourceRectangle, destinationRectangle, appOutput, contextId);
+    VideoOutputdBatch::Request request;
+    request.type = VideoOutputdBatch::Request::CropRegion;
+    request.originalRect = originalRectangle;
+    request.sourceRect = sourceRectangle;
+    request.destinationRect = destinationRectangle;
+    request.appOutput = appOutput;
+    queue(contextId, request);
 }
 
 void VideoOutputdCommunicator::setProperty(QString name, QString value, QString contextId)
 {
-    emit setVideoPropertyRequested(name, value, contextId);
+    VideoOutputdBatch::Request request;
+    request.type = VideoOutputdBatch::Request::Property;
+    request.name = name;
+    request.value = value;
+    queue(contextId, request);
 }
 
 void VideoOutputdCommunicator::setVideoCompositing(QString name, int value, QString contextId)
 {
-    emit setVideoCompositingRequested(name, value, contextId);
+    VideoOutputdBatch::Request request;
+    request.type = VideoOutputdBatch::Request::Compositing;
+    request.name = name;
+    request.intValue = value;
+    queue(contextId, request);
 }
@@ -19,9 +19,13 @@
 
 #include <QObject>
 #include <QRect>
+#include <QScopedPointer>
 #include <QString>
+#include <QVector>
 #include <WebOSCoreCompositor/weboscompositorexport.h>
 
+#include "videooutputd_transport.h"
+
 class WEBOS_COMPOSITOR_EXPORT VideoOutputdCommunicator : public QObject
 {
     Q_OBJECT
@@ -35,6 +39,18 @@ public:
     void setProperty(QString name, QString value, QString contextId);
     void setVideoCompositing(QString name, int value, QString contextId);
 
+    // Takes the ownership. Passing nullptr restores the signal transport.
+    void setTransport(VideoOutputdTransport *transport);
+    VideoOutputdTransport *transport() const { return m_transport.data(); }
+
+    /* Off by default, as the signal transport goes through QML anyway.
+       Worth it with a transport that calls videooutputd directly. */
+    void setBatching(bool batching);
+    bool batching() const { return m_batching; }
+
+    // Sends what is pending right away instead of on the next event loop pass
+    Q_INVOKABLE void flush();
+
 signals:
     void setVideoDisplayWindowRequested(const QRect sourceRectangle, const QRect destinationRectangle, QRect appOutput, const QString contextId);
     void setVideoCropRegionRequested(const QRect originalRectangle, const QRect sourceRectangle, const QRect destinationRectangle, QRect appOutput, const QString contextId);
@@ -43,9 +59,25 @@ signals:
 
 protected:
     VideoOutputdCommunicator(QObject *parent = Q_NULLPTR);
+    ~VideoOutputdCommunicator();
 
 private:
+    void queue(const QString &contextId, const VideoOutputdBatch::Request &request);
+
     static VideoOutputdCommunicator* m_instance;
+
+    struct PendingRequest {
+        QString contextId;
+        VideoOutputdBatch::Request request;
+        qint64 queuedNs;
+    };
+
+    QScopedPointer<VideoOutputdTransport> m_transport;
+    // WEBOS_VIDEOOUTPUTD_BATCH=1 queues requests until the next event loop pass
+    bool m_batching = false;
+    bool m_flushQueued = false;
+    // All contexts in one queue, so requests go out in the order they were made
+    QVector<PendingRequest> m_pending;
 };
 
 #endif  //#ifndef VIDEOOUTPUTD_COMMUNICATOR_H
@@ -0,0 +1,86 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "videooutputd_transport.h"
+#include "videooutputd_communicator.h"
+
+#include <time.h>
+
+qint64 VideoOutputdTransport::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+VideoOutputdSignalTransport::VideoOutputdSignalTransport(VideoOutputdCommunicator *communicator)
+    : m_communicator(communicator)
+{
+}
+
+void VideoOutputdSignalTransport::send(const VideoOutputdBatch &batch)
+{
+    foreach (const VideoOutputdBatch::Request &r, batch.requests) {
+        switch (r.type) {
+        case VideoOutputdBatch::Request::DisplayWindow:
+            emit m_communicator->setVideoDisplayWindowRequested(r.sourceRect, r.destinationRect, r.appOutput, batch.contextId);
+            break;
+        case VideoOutputdBatch::Request::CropRegion:
+            emit m_communicator->setVideoCropRegionRequested(r.originalRect, r.sourceRect, r.destinationRect, r.appOutput, batch.contextId);
+            break;
+        case VideoOutputdBatch::Request::Property:
+            emit m_communicator->setVideoPropertyRequested(r.name, r.value, batch.contextId);
+            break;
+        case VideoOutputdBatch::Request::Compositing:
+            emit m_communicator->setVideoCompositingRequested(r.name, r.intValue, batch.contextId);
+            break;
+        }
+    }
+}
+
+void VideoOutputdLoopbackTransport::send(const VideoOutputdBatch &batch)
+{
+    const qint64 sentNs = now();
+
+    ContextState &state = m_states[batch.contextId];
+    foreach (const VideoOutputdBatch::Request &r, batch.requests) {
+        switch (r.type) {
+        case VideoOutputdBatch::Request::DisplayWindow:
+        case VideoOutputdBatch::Request::CropRegion:
+            state.sourceRect = r.sourceRect;
+            state.destinationRect = r.destinationRect;
+            break;
+        case VideoOutputdBatch::Request::Property:
+            state.properties.insert(r.name, r.value);
+            break;
+        case VideoOutputdBatch::Request::Compositing:
+            state.compositing.insert(r.name, r.intValue);
+            break;
+        }
+    }
+
+    const qint64 latencyNs = sentNs - batch.queuedNs;
+    m_latencySumNs += latencyNs;
+    m_latencyMaxNs = qMax(m_latencyMaxNs, latencyNs);
+    m_requests += batch.requests.size();
+    m_batches++;
+}
+
+void VideoOutputdLoopbackTransport::resetStats()
+{
+    m_batches = m_requests = 0;
+    m_latencySumNs = m_latencyMaxNs = 0;
+}
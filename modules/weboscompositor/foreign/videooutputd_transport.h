@@ -0,0 +1,109 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef VIDEOOUTPUTD_TRANSPORT_H
+#define VIDEOOUTPUTD_TRANSPORT_H
+
+#include <QHash>
+#include <QRect>
+#include <QString>
+#include <QVector>
+#include <WebOSCoreCompositor/weboscompositorexport.h>
+
+class VideoOutputdCommunicator;
+
+/* Consecutive requests for one video context, in request order. */
+struct WEBOS_COMPOSITOR_EXPORT VideoOutputdBatch
+{
+    struct Request {
+        enum Type {
+            DisplayWindow,
+            CropRegion,
+            Property,
+            Compositing
+        };
+        Type type;
+        QRect originalRect;
+        QRect sourceRect;
+        QRect destinationRect;
+        QRect appOutput;
+        QString name;
+        QString value;
+        int intValue = 0;
+    };
+
+    QString contextId;
+    QVector<Request> requests;
+    // When the first request of the batch was made, see VideoOutputdTransport::now
+    qint64 queuedNs = 0;
+};
+
+/* Delivers batches to videooutputd. Install one with
+   VideoOutputdCommunicator::setTransport. */
+class WEBOS_COMPOSITOR_EXPORT VideoOutputdTransport
+{
+public:
+    virtual ~VideoOutputdTransport() {}
+    virtual void send(const VideoOutputdBatch &batch) = 0;
+
+    // Monotonic clock for queuedNs
+    static qint64 now();
+};
+
+/* Replays batches as the signals of VideoOutputdCommunicator, which the
+   QML side turns into luna calls. This is the default. */
+class WEBOS_COMPOSITOR_EXPORT VideoOutputdSignalTransport : public VideoOutputdTransport
+{
+public:
+    explicit VideoOutputdSignalTransport(VideoOutputdCommunicator *communicator);
+    void send(const VideoOutputdBatch &batch) override;
+
+private:
+    VideoOutputdCommunicator *m_communicator;
+};
+
+/* Stand-in for videooutputd in tests and benchmarks, installed with
+   setTransport only. It applies batches to a local state per context
+   and counts them along with their queueing latency. Nothing reaches
+   the service. */
+class WEBOS_COMPOSITOR_EXPORT VideoOutputdLoopbackTransport : public VideoOutputdTransport
+{
+public:
+    void send(const VideoOutputdBatch &batch) override;
+
+    struct ContextState {
+        QRect sourceRect;
+        QRect destinationRect;
+        QHash<QString, QString> properties;
+        QHash<QString, int> compositing;
+    };
+    const QHash<QString, ContextState> &states() const { return m_states; }
+
+    int batchCount() const { return m_batches; }
+    int requestCount() const { return m_requests; }
+    qint64 averageLatencyNs() const { return m_batches ? m_latencySumNs / m_batches : 0; }
+    qint64 maxLatencyNs() const { return m_latencyMaxNs; }
+    void resetStats();
+
+private:
+    QHash<QString, ContextState> m_states;
+    int m_batches = 0;
+    int m_requests = 0;
+    qint64 m_latencySumNs = 0;
+    qint64 m_latencyMaxNs = 0;
+};
+
+#endif  //#ifndef VIDEOOUTPUTD_TRANSPORT_H
@@ -18,6 +18,7 @@
 #include <QDebug>
 
 #include "videowindow_informer.h"
+#include "weboscompositorlogging.h"
 
 VideoWindowInformer* VideoWindowInformer::m_instance = nullptr;
 
@@ -44,12 +45,12 @@ void VideoWindowInformer::resetInstance()
 
 void VideoWindowInformer::insertVideoWindowList(const QString contextId, const QRect destinationRectangle, const QString windowId, const QString appId, const QRect appWindow, const QString appRotation)
 {
-    qDebug() << "insertVideoWindowList() with contextId : " << contextId << " , destinationRectangle : " << destinationRectangle << " , windowId : " << windowId << "  ,  appId " << appId << " , appWindow : " << appWindow << " , appRotation : " << appRotation;
+    qCDebug(lsmForeign) << "insertVideoWindowList() with contextId : " << contextId << " , destinationRectangle : " << destinationRectangle << " , windowId : " << windowId << "  ,  appId " << appId << " , appWindow : " << appWindow << " , appRotation : " << appRotation;
     emit insertVideoWindowInfo(contextId, destinationRectangle, windowId, appId, appWindow, appRotation);
 }
 
 void VideoWindowInformer::removeVideoWindowList(const QString contextId)
 {
-    qDebug() << "removeVideoWindowList() with contextId : " << contextId;
+    qCDebug(lsmForeign) << "removeVideoWindowList() with contextId : " << contextId;
     emit removeVideoWindowInfo(contextId);
 }
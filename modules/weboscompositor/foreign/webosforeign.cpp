@@ -21,6 +21,7 @@
 #include "webosforeign.h"
 #include "videowindow_informer.h"
 #include "securecoding.h"
+#include "weboscompositorlogging.h"
 
 #include <QDebug>
 #include <QGuiApplication>
@@ -34,21 +35,19 @@
 
 #include <qpa/qplatformnativeinterface.h>
 
-static QString generateWindowId()
+// Send video plane updates when the graphics frame is swapped rather
+// than ahead of rendering it, so both land on the same vsync
+static bool syncVideoToFrame()
 {
-    static quint32 window_count = 0;
-    if(window_count == UINT_MAX) {
-        qDebug() << "Cannot generate Id for window greater than " << UINT_MAX;
-        window_count = 0;
-    }
-    return QString("_Window_Id_%1").arg(++window_count);
+    static const bool s_syncVideoToFrame = qgetenv("WEBOS_EXPORTED_SYNC_VIDEO_TO_FRAME").toInt() == 1;
+    return s_syncVideoToFrame;
 }
 
 class MirrorItemHandler {
 
 public:
     MirrorItemHandler() {}
-    ~MirrorItemHandler() { clearHandler(); qInfo() << "MirrorItemHandler destroyed" << this; }
+    ~MirrorItemHandler() { clearHandler(); qCInfo(lsmForeign) << "MirrorItemHandler destroyed" << this; }
 
     static inline qreal getParentRatio(QQuickItem *dItem, QQuickItem *nItem, bool isWidth = true) {
         if (dItem && dItem->parentItem() && nItem && nItem->parentItem()) {
@@ -63,7 +62,7 @@ public:
 
     virtual void initialize(QQuickItem *item, QQuickItem *exportedItem, QQuickItem *source, QQuickItem *parent)
     {
-        qInfo() << "mirror" << item <<"exported" << exportedItem << "source" << source << "parent" << parent;
+        qCInfo(lsmForeign) << "mirror" << item <<"exported" << exportedItem << "source" << source << "parent" << parent;
 
         // Set parent first, otherwise export item suddenly appears at first.
         item->setParentItem(parent);
@@ -103,7 +102,7 @@ public:
         QWaylandQuickItem *wlItem = qobject_cast<QWaylandQuickItem *>(item);
         if (wlItem) {
             m_surfaceConn = QObject::connect(wlItem, &QWaylandQuickItem::surfaceChanged, [wlItem]() {
-                qInfo() << wlItem << "is destroyed by changing surface";
+                qCInfo(lsmForeign) << wlItem << "is destroyed by changing surface";
                 if (wlItem && !wlItem->surface())
                     delete wlItem;
             });
@@ -143,7 +142,7 @@ public:
     {
     }
 
-    ~ImportedMirrorItem() { qInfo() << "ImportedMirrorItem destroyed" << this; }
+    ~ImportedMirrorItem() { qCInfo(lsmForeign) << "ImportedMirrorItem destroyed" << this; }
 
     void initialize(QQuickItem *item, QQuickItem *exportedItem, QQuickItem *source, QQuickItem *parent) override
     {
@@ -226,8 +225,31 @@ void WebOSForeign::webos_foreign_export_element(Resource *resource,
         createExported(resource->client(), id, surfaceItem,
                        static_cast<WebOSForeign::WebOSExportedType>(exported_type));
 
-    pWebOSExported->assignWindowId(generateWindowId());
-    m_exportedList.append(pWebOSExported);
+    registerExported(pWebOSExported);
+}
+
+void WebOSForeign::registerExported(WebOSExported *exported)
+{
+    // After a wrap-around, skip 0 and handles still in use
+    do {
+        if (m_lastHandle == UINT_MAX)
+            qCDebug(lsmForeign) << "Cannot generate Id for window greater than " << UINT_MAX;
+        ++m_lastHandle;
+    } while (m_lastHandle == 0 || m_exportedByHandle.contains(m_lastHandle));
+
+    exported->m_handle = m_lastHandle;
+    m_exportedByHandle.insert(m_lastHandle, exported);
+    exported->assignWindowId(QString("_Window_Id_%1").arg(m_lastHandle));
+}
+
+void WebOSForeign::unregisterExported(WebOSExported *exported)
+{
+    if (exported->m_handle)
+        m_exportedByHandle.remove(exported->m_handle);
+    if (!exported->m_windowId.isNull() && m_exportedByWindowId.value(exported->m_windowId) == exported)
+        m_exportedByWindowId.remove(exported->m_windowId);
+    if (!exported->m_contextId.isNull() && m_exportedByContextId.value(exported->m_contextId) == exported)
+        m_exportedByContextId.remove(exported->m_contextId);
 }
 
 void WebOSForeign::webos_foreign_import_element(Resource *resource,
@@ -235,21 +257,20 @@ void WebOSForeign::webos_foreign_import_element(Resource *resource,
                                                 const QString &window_id,
                                                 uint32_t exported_type)
 {
-    qInfo() << "webos_foreign_import_element with " << window_id;
-    foreach(WebOSExported* exported, m_exportedList) {
-        if (exported->m_windowId == window_id) {
-            WebOSImported *imported =
-                createImported(exported, resource->client(), id,
-                               static_cast<WebOSForeign::WebOSExportedType>(exported_type));
-            exported->m_importList.append(imported);
-            return;
-        }
+    qCInfo(lsmForeign) << "webos_foreign_import_element with " << window_id;
+    WebOSExported *exported = m_exportedByWindowId.value(window_id);
+    if (exported) {
+        WebOSImported *imported =
+            createImported(exported, resource->client(), id,
+                           static_cast<WebOSForeign::WebOSExportedType>(exported_type));
+        exported->m_importList.append(imported);
+        return;
     }
     wl_resource_post_error(resource->handle,
                            WL_DISPLAY_ERROR_INVALID_OBJECT,
                            "No matching WebOSExported.");
     wl_resource_destroy(resource->handle);
-    qWarning() << "No matching WebOSExported with "
+    qCWarning(lsmForeign) << "No matching WebOSExported with "
                << window_id;
 }
 
@@ -287,7 +308,7 @@ WebOSExported::WebOSExported(
     , m_defaultRatio(1.0)
     , m_fullscreenByApp(false)
 {
-    qInfo() << this << "is created";
+    qCInfo(lsmForeign) << this << "is created";
 
     m_exportedItem->setClip(true);
     m_exportedItem->setZ(-1);
@@ -295,16 +316,17 @@ WebOSExported::WebOSExported(
     m_surfaceItem->appendExported(this);
     updateCompositorWindow(m_surfaceItem->window());
 
-    qInfo() <<"Window status of surface item (" << m_surfaceItem << ") for exporter : " << m_surfaceItem->state();
+    qCInfo(lsmForeign) <<"Window status of surface item (" << m_surfaceItem << ") for exporter : " << m_surfaceItem->state();
 
     m_isSurfaceItemFullscreen = (m_surfaceItem->state() == Qt::WindowFullScreen) ? true : false;
 
     connect(m_exportedItem, &QQuickItem::visibleChanged, this, &WebOSExported::updateVisible);
     connect(m_surfaceItem, &WebOSSurfaceItem::stateChanged, this, &WebOSExported::updateWindowState);
-    connect(m_surfaceItem, &QWaylandQuickItem::xChanged, this, &WebOSExported::calculateAll);
-    connect(m_surfaceItem, &QWaylandQuickItem::yChanged, this, &WebOSExported::calculateAll);
-    connect(m_surfaceItem, &QWaylandQuickItem::widthChanged, this, &WebOSExported::calculateAll);
-    connect(m_surfaceItem, &QWaylandQuickItem::heightChanged, this, &WebOSExported::calculateAll);
+    // Recalculated once per frame however many of these change
+    connect(m_surfaceItem, &QWaylandQuickItem::xChanged, this, &WebOSExported::scheduleCalculateAll);
+    connect(m_surfaceItem, &QWaylandQuickItem::yChanged, this, &WebOSExported::scheduleCalculateAll);
+    connect(m_surfaceItem, &QWaylandQuickItem::widthChanged, this, &WebOSExported::scheduleCalculateAll);
+    connect(m_surfaceItem, &QWaylandQuickItem::heightChanged, this, &WebOSExported::scheduleCalculateAll);
     // 2022.05.04. fix transient issue.
     //connect(m_surfaceItem, &QWaylandQuickItem::scaleChanged, this, &WebOSExported::calculateAll);
     connect(m_surfaceItem, &QWaylandQuickItem::surfaceDestroyed, this, &WebOSExported::onSurfaceDestroyed);
@@ -343,7 +365,7 @@ WebOSExported::WebOSExported(
 
 WebOSExported::~WebOSExported()
 {
-    qInfo() << "WebOSExported destructor is called on " << this;
+    qCInfo(lsmForeign) << "WebOSExported destructor is called on " << this;
 
     if (m_surfaceItem) {
         m_surfaceItem->setFullscreenVideo("default");
@@ -366,7 +388,7 @@ WebOSExported::~WebOSExported()
         m_muteRegisteredContextId = QString();
     }
 
-    m_foreign->m_exportedList.removeAll(this);
+    m_foreign->unregisterExported(this);
 
     // Usually it is deleted by QObjectPrivate::deleteChildren with its parent surfaceItem.
     if (m_exportedItem)
@@ -376,18 +398,18 @@ WebOSExported::~WebOSExported()
 void WebOSExported::updateOrientation()
 {
     if (!m_surfaceItem) {
-        qWarning() << "surfaceItem for " << m_windowId << " is null";
+        qCWarning(lsmForeign) << "surfaceItem for " << m_windowId << " is null";
         return;
     }
 
     if (m_isRotationChanging == false) {
-        qInfo() << "start to change rotation for WebOSExported (" << m_windowId << ")";
+        qCInfo(lsmForeign) << "start to change rotation for WebOSExported (" << m_windowId << ")";
         m_isRotationChanging = true;
         setVideoDisplayWindow();
     }
 
     Qt::ScreenOrientation orientationInfo = m_surfaceItem->orientationInfo();
-    qInfo() << "surface item= " << m_surfaceItem << " orientation changed : " << orientationInfo <<  " on " << m_windowId;
+    qCInfo(lsmForeign) << "surface item= " << m_surfaceItem << " orientation changed : " << orientationInfo <<  " on " << m_windowId;
 
     if (orientationInfo == Qt::PortraitOrientation)
         m_appRotation = "Deg90";
@@ -404,13 +426,13 @@ void WebOSExported::updateOrientation()
 void WebOSExported::onSurfaceItemMapped(WebOSSurfaceItem *mappedItem)
 {
     if (!mappedItem) {
-        qWarning() << "mappedItem is null";
+        qCWarning(lsmForeign) << "mappedItem is null";
         return;
     }
 
-    qDebug() << "mappedItem : " << mappedItem << " on " << m_windowId;
+    qCDebug(lsmForeign) << "mappedItem : " << mappedItem << " on " << m_windowId;
     if (m_surfaceItem == mappedItem) {
-        qInfo() << "Surface item of exported is mapped on " << m_windowId;
+        qCInfo(lsmForeign) << "Surface item of exported is mapped on " << m_windowId;
         updateDisplayPosition(true);
     }
 }
@@ -418,7 +440,7 @@ void WebOSExported::onSurfaceItemMapped(WebOSSurfaceItem *mappedItem)
 void WebOSExported::updateDisplayPosition(bool forceUpdate)
 {
     if (m_compositorWindow == nullptr || !m_surfaceItem || m_surfaceItem->surface() == nullptr) {
-        qDebug() << "SurfaceItem  for " << m_windowId << " is already destroyed";
+        qCDebug(lsmForeign) << "SurfaceItem  for " << m_windowId << " is already destroyed";
         return;
     }
 
@@ -426,24 +448,24 @@ void WebOSExported::updateDisplayPosition(bool forceUpdate)
 
     if (m_fullscreenByApp)
         globalPosition = QPoint(0,0);
-    qDebug() << "globalPosition : " << globalPosition  << ", previous position : " << m_surfaceGlobalPosition << ", forceUpdate : " << forceUpdate << " on " << m_windowId << ", m_fullscreenByApp : " << m_fullscreenByApp;
+    qCDebug(lsmForeign) << "globalPosition : " << globalPosition  << ", previous position : " << m_surfaceGlobalPosition << ", forceUpdate : " << forceUpdate << " on " << m_windowId << ", m_fullscreenByApp : " << m_fullscreenByApp;
 
     if (globalPosition != m_surfaceGlobalPosition || forceUpdate) {
-        qInfo() << "globalPosition : " << globalPosition  << ", previous position : " << m_surfaceGlobalPosition << ", forceUpdate : " << forceUpdate << " on " << m_windowId << ", m_fullscreenByApp : " << m_fullscreenByApp;
+        qCInfo(lsmForeign) << "globalPosition : " << globalPosition  << ", previous position : " << m_surfaceGlobalPosition << ", forceUpdate : " << forceUpdate << " on " << m_windowId << ", m_fullscreenByApp : " << m_fullscreenByApp;
         calculateVideoDispRatio();
     }
 }
 
 void WebOSExported::calculateVideoDispRatio()
 {
-    qInfo() << "WebOSExported::calculateVideoDispRatio is called on " << m_windowId;
+    qCInfo(lsmForeign) << "WebOSExported::calculateVideoDispRatio is called on " << m_windowId;
     if (!m_surfaceItem || !m_compositorWindow) {
-        qWarning() << "WebOSSurfaceItem for" << m_windowId << "neither exists nor belongs to a window";
+        qCWarning(lsmForeign) << "WebOSSurfaceItem for" << m_windowId << "neither exists nor belongs to a window";
         return;
     }
 
     if (m_compositorWindow->outputGeometryPending()) {
-        qWarning() << "OutputGeometry is being changed, should wait a bit more";
+        qCWarning(lsmForeign) << "OutputGeometry is being changed, should wait a bit more";
         return;
     }
 
@@ -462,9 +484,9 @@ void WebOSExported::calculateVideoDispRatio()
             m_videoDispRatio = m_videoDispRatio * m_fullscreenVideoRatio;
 
 #if QT_VERSION >= QT_VERSION_CHECK(6,0,0)
-        qInfo() << "Output size:" << outputGeometry.size() << "surface size:" << m_surfaceItem->surface()->bufferSize()  <<  ", app rotation : " << m_appRotation << "m_videoDisplayRect: " << m_videoDisplayRect <<  " on " << "m_videoDispRatio:" << m_videoDispRatio << ", m_surfaceGlobalPosition: " << m_surfaceGlobalPosition << "m_fullscreenByApp : " << m_fullscreenByApp << " fullscreenVideoMode: " << m_surfaceItem->fullscreenVideoMode();
+        qCInfo(lsmForeign) << "Output size:" << outputGeometry.size() << "surface size:" << m_surfaceItem->surface()->bufferSize()  <<  ", app rotation : " << m_appRotation << "m_videoDisplayRect: " << m_videoDisplayRect <<  " on " << "m_videoDispRatio:" << m_videoDispRatio << ", m_surfaceGlobalPosition: " << m_surfaceGlobalPosition << "m_fullscreenByApp : " << m_fullscreenByApp << " fullscreenVideoMode: " << m_surfaceItem->fullscreenVideoMode();
 #else
-        qInfo() << "Output size:" << outputGeometry.size() << "surface size:" << m_surfaceItem->surface()->size()  <<  ", app rotation :        " << m_appRotation << "m_videoDisplayRect: " << m_videoDisplayRect <<  " on " << "m_videoDispRatio:" << m_videoDispRatio << ", m_surfaceGlobalPosition: " << m_surfaceGlobalPosition << "m_fullscreenByApp : " << m_fullscreenByApp << " fullscreenVideoMode: " << m_surfaceItem->fullscreenVideoMode();;
+        qCInfo(lsmForeign) << "Output size:" << outputGeometry.size() << "surface size:" << m_surfaceItem->surface()->size()  <<  ", app rotation :        " << m_appRotation << "m_videoDisplayRect: " << m_videoDisplayRect <<  " on " << "m_videoDispRatio:" << m_videoDispRatio << ", m_surfaceGlobalPosition: " << m_surfaceGlobalPosition << "m_fullscreenByApp : " << m_fullscreenByApp << " fullscreenVideoMode: " << m_surfaceItem->fullscreenVideoMode();;
 #endif
 
         /* m_requestedRegion.isValid(0,0,0x0) -> A valid rectangle has a left() <= right() and top() <= bottom().
@@ -472,24 +494,24 @@ void WebOSExported::calculateVideoDispRatio()
         So the condition changed from m_requestedRegion.isValid(() to m_requestedRegion.size().isValid()*/
         if (m_requestedRegion.size().isValid()) {
             setVideoDisplayRect();
-            qInfo() << "Calculated video display output region:" << m_videoDisplayRect;
+            qCInfoLimited(lsmForeign, 10, 20) << "Calculated video display output region:" << m_videoDisplayRect;
             setVideoDisplayWindow();
         } else {
-           qWarning() << "Requested video region is not valid";
+           qCWarning(lsmForeign) << "Requested video region is not valid";
         }
     }
 }
 
 void WebOSExported::calculateExportedItemRatio()
 {
-    qInfo() << "WebOSExported::calculateExportedItemRatio is called on" << m_windowId;
+    qCInfo(lsmForeign) << "WebOSExported::calculateExportedItemRatio is called on" << m_windowId;
     if (!m_surfaceItem || !m_compositorWindow) {
-        qWarning() << "WebOSSurfaceItem for" << m_windowId << "neither exists nor belongs to a window";
+        qCWarning(lsmForeign) << "WebOSSurfaceItem for" << m_windowId << "neither exists nor belongs to a window";
         return;
     }
 
     if (m_compositorWindow->outputGeometryPending()) {
-        qWarning() << "OutputGeometry is being changed, should wait a bit more";
+        qCWarning(lsmForeign) << "OutputGeometry is being changed, should wait a bit more";
         return;
     }
 
@@ -511,9 +533,9 @@ void WebOSExported::calculateExportedItemRatio()
         else if (m_fullscreenVideoMode != FullscreenVideoMode::Default)
             m_exportedWindowRatio = m_exportedWindowRatio * m_fullscreenVideoRatio;
 #if QT_VERSION >= QT_VERSION_CHECK(6,0,0)
-        qInfo() << "surface size: " << m_surfaceItem->surface()->bufferSize() << "item size:" << m_surfaceItem->size() << "m_exportedWindowRatio:" << m_exportedWindowRatio << ", m_fullscreenByApp: " << m_fullscreenByApp << ", m_fullscreenVideoMode: " << m_fullscreenVideoMode;
+        qCInfo(lsmForeign) << "surface size: " << m_surfaceItem->surface()->bufferSize() << "item size:" << m_surfaceItem->size() << "m_exportedWindowRatio:" << m_exportedWindowRatio << ", m_fullscreenByApp: " << m_fullscreenByApp << ", m_fullscreenVideoMode: " << m_fullscreenVideoMode;
 #else
-        qInfo() << "surface size: " << m_surfaceItem->surface()->size() << "item size:" << m_surfaceItem->size() << "m_exportedWindowRatio:" << m_exportedWindowRatio << ", m_fullscreenByApp: " << m_fullscreenByApp << ", m_fullscreenVideoMode: " << m_fullscreenVideoMode;
+        qCInfo(lsmForeign) << "surface size: " << m_surfaceItem->surface()->size() << "item size:" << m_surfaceItem->size() << "m_exportedWindowRatio:" << m_exportedWindowRatio << ", m_fullscreenByApp: " << m_fullscreenByApp << ", m_fullscreenVideoMode: " << m_fullscreenVideoMode;
 #endif
         if (m_requestedRegion.isValid()) {
             if (m_fullscreenByApp) {
@@ -554,19 +576,87 @@ void WebOSExported::calculateExportedItemRatio()
 
 void WebOSExported::calculateAll()
 {
+    m_geometryDirty = false;
     updateDisplayPosition(true);
     calculateExportedItemRatio();
 }
 
+void WebOSExported::scheduleCalculateAll()
+{
+    if (!m_compositorWindow) {
+        calculateAll();
+        return;
+    }
+
+    if (!m_geometryDirty) {
+        m_geometryDirty = true;
+        // Geometry changes of items normally request a frame already
+        m_compositorWindow->update();
+    }
+}
+
+void WebOSExported::flushPendingGeometry()
+{
+    if (m_geometryDirty)
+        calculateAll();
+}
+
+void WebOSExported::flushPendingVideoRequest()
+{
+    if (m_hasPendingVideoRequest) {
+        m_hasPendingVideoRequest = false;
+        sendVideoDisplayRequest(m_pendingVideoRequest);
+    }
+}
+
+bool WebOSExported::VideoDisplayRequest::operator==(const VideoDisplayRequest &other) const
+{
+    return crop == other.crop && inputRect == other.inputRect && sourceRect == other.sourceRect &&
+        displayRect == other.displayRect && appOutput == other.appOutput && contextId == other.contextId;
+}
+
+void WebOSExported::submitVideoDisplayRequest(const VideoDisplayRequest &request)
+{
+    // Compare with what videooutputd will have got by the time this is sent
+    if (m_hasPendingVideoRequest ? request == m_pendingVideoRequest
+                                 : (m_hasLastVideoRequest && request == m_lastVideoRequest)) {
+        qCDebug(lsmForeign) << "Same video display request as before, skipped for" << m_contextId;
+        return;
+    }
+
+    if (syncVideoToFrame() && m_compositorWindow) {
+        m_pendingVideoRequest = request;
+        m_hasPendingVideoRequest = true;
+        m_compositorWindow->update();
+        return;
+    }
+
+    sendVideoDisplayRequest(request);
+}
+
+void WebOSExported::sendVideoDisplayRequest(const VideoDisplayRequest &request)
+{
+    m_lastVideoRequest = request;
+    m_hasLastVideoRequest = true;
+
+    if (request.crop) {
+        qCInfo(lsmForeign) << "Call setCropRegion with original input rect : " << request.inputRect << " , source rect: " << request.sourceRect << " , video display rect : " << request.displayRect << ", appOutput : " << request.appOutput << " , m_contextId : " << request.contextId;
+        VideoOutputdCommunicator::instance()->setCropRegion(request.inputRect, request.sourceRect, request.displayRect, request.appOutput, request.contextId);
+    } else {
+        qCInfo(lsmForeign) << " Call setDisplayWindow with video display rect : " << request.displayRect << ", appOutput : " << request.appOutput << " , contextid : " << request.contextId;
+        VideoOutputdCommunicator::instance()->setDisplayWindow(request.sourceRect, request.displayRect, request.appOutput, request.contextId);
+    }
+}
+
 void WebOSExported::updateWindowState()
 {
     if (!m_surfaceItem) {
-        qWarning() << "WebOSSurfaceItem for " << m_windowId << " is already destroyed";
+        qCWarning(lsmForeign) << "WebOSSurfaceItem for " << m_windowId << " is already destroyed";
         return;
     }
     WebOSSurfaceItem *item = qobject_cast<WebOSSurfaceItem*>(m_surfaceItem);
     bool m_isSurfaceItemFullscreen = item->state() == Qt::WindowFullScreen;
-    qInfo() << "update window state : " << item->state() << "for WebOSExported ( " << m_windowId << " ) ";
+    qCInfo(lsmForeign) << "update window state : " << item->state() << "for WebOSExported ( " << m_windowId << " ) ";
     if (m_isSurfaceItemFullscreen) {
         calculateVideoDispRatio();
         calculateExportedItemRatio();
@@ -579,16 +669,16 @@ void WebOSExported::updateWindowState()
 void WebOSExported::updateWindowType()
 {
     if (!m_surfaceItem) {
-        qWarning() << "QWaylandQuickItem for " << m_windowId << " is already destroyed";
+        qCWarning(lsmForeign) << "QWaylandQuickItem for " << m_windowId << " is already destroyed";
         return;
     }
 
     m_surfaceItemWindowType = m_surfaceItem->type();
 
     if(m_contextId.isNull())
-        qInfo() << "update window type : " << m_surfaceItem->type() << "for WebOSExported ( " << this << " ) ";
+        qCInfo(lsmForeign) << "update window type : " << m_surfaceItem->type() << "for WebOSExported ( " << this << " ) ";
     else
-        qInfo() << "update window type : " << m_surfaceItem->type() << "for WebOSExported ( " << m_windowId << " ) ";
+        qCInfo(lsmForeign) << "update window type : " << m_surfaceItem->type() << "for WebOSExported ( " << m_windowId << " ) ";
 
     calculateExportedItemRatio();
     calculateVideoDispRatio();
@@ -597,13 +687,13 @@ void WebOSExported::updateWindowType()
 void WebOSExported::updateCoverState()
 {
     if (!m_surfaceItem) {
-        qWarning() << "WebOSSurfaceItem for " << m_windowId << "is already destroyed";
+        qCWarning(lsmForeign) << "WebOSSurfaceItem for " << m_windowId << "is already destroyed";
         return;
     }
 
     if (m_coverState != m_surfaceItem->coverState()) {
         m_coverState = m_surfaceItem->coverState();
-        qInfo() << "cover state is changed = " << m_coverState << " for WebOSExported (" << m_windowId << ")";
+        qCInfo(lsmForeign) << "cover state is changed = " << m_coverState << " for WebOSExported (" << m_windowId << ")";
         calculateVideoDispRatio();
     }
 }
@@ -611,23 +701,23 @@ void WebOSExported::updateCoverState()
 void WebOSExported::updateActiveRegion()
 {
     if (!m_surfaceItem) {
-        qWarning() << "WebOSSurfaceItem for " << m_windowId << "is already destroyed";
+        qCWarning(lsmForeign) << "WebOSSurfaceItem for " << m_windowId << "is already destroyed";
         return;
     }
 
     QRect activeRegion = m_surfaceItem->activeRegion();
 
     if (m_activeRegion != activeRegion) {
-        qInfo() << "active region is changed = " << activeRegion << " for WebOSExported (" << m_windowId << ")";
+        qCInfo(lsmForeign) << "active region is changed = " << activeRegion << " for WebOSExported (" << m_windowId << ")";
         m_activeRegion = activeRegion;
         updateDestinationRegion();
 
         setDestinationRect();
         setVideoDisplayRect();
 
-        qInfo() << "exported requested destination region : " << m_requestedRegion << " on " << m_windowId;
-        qInfo() << "exported item region : " << m_destinationRect << ", video display region : " << m_videoDisplayRect;
-        qInfo() << "exported item ratio : " << m_exportedWindowRatio << ", video display ratio :  " << m_videoDispRatio;
+        qCInfoLimited(lsmForeign, 10, 20) << "exported requested destination region : " << m_requestedRegion << " on " << m_windowId;
+        qCInfoLimited(lsmForeign, 10, 20) << "exported item region : " << m_destinationRect << ", video display region : " << m_videoDisplayRect;
+        qCInfoLimited(lsmForeign, 10, 20) << "exported item ratio : " << m_exportedWindowRatio << ", video display ratio :  " << m_videoDispRatio;
 
         setVideoDisplayWindow();
         updateExportedItemSize();
@@ -637,12 +727,12 @@ void WebOSExported::updateActiveRegion()
 void WebOSExported::updatePipSub()
 {
     if (!m_surfaceItem) {
-        qWarning() << "WebOSSurfaceItem for " << m_windowId << "is already destroyed";
+        qCWarning(lsmForeign) << "WebOSSurfaceItem for " << m_windowId << "is already destroyed";
         return;
     }
 
     m_pipSub = m_surfaceItem->pipSub();
-    qInfo() << "pipSub is changed = " << m_pipSub << " for WebOSExported (" << m_windowId << ")";
+    qCInfo(lsmForeign) << "pipSub is changed = " << m_pipSub << " for WebOSExported (" << m_windowId << ")";
     if (m_exportedType == WebOSForeign::TransparentObject) {
         if (m_pipSub) {
             setPunchThrough(true);
@@ -655,15 +745,15 @@ void WebOSExported::updatePipSub()
 void WebOSExported::updateVisible()
 {
     if (!m_exportedItem) {
-        qWarning() << "QWaylandQuickItem for " << m_windowId << " is  already destroyed ";
+        qCWarning(lsmForeign) << "QWaylandQuickItem for " << m_windowId << " is  already destroyed ";
         return;
     }
     if (!m_contextId.isNull()) {
         if (m_exportedItem->isVisible()) {
-            qInfo() << "exported item's visible is changed to true on " << m_windowId;
+            qCInfo(lsmForeign) << "exported item's visible is changed to true on " << m_windowId;
             updateVideoWindowList(m_contextId, m_videoDisplayRect, false);
         } else {
-            qInfo() << "exported item's visible is changed to false on" << m_windowId;
+            qCInfo(lsmForeign) << "exported item's visible is changed to false on" << m_windowId;
             updateVideoWindowList(m_contextId, QRect(0, 0, 0, 0), true);
         }
     }
@@ -671,7 +761,7 @@ void WebOSExported::updateVisible()
 
 void WebOSExported::onSurfaceDestroyed()
 {
-    qInfo() << "Surface item for (" << m_windowId << ") is destroyed";
+    qCInfo(lsmForeign) << "Surface item for (" << m_windowId << ") is destroyed";
 
     m_surfaceItem = nullptr;
     updateCompositorWindow(nullptr);
@@ -696,7 +786,7 @@ void WebOSExported::updateVideoWindowList(QString contextId, QRect videoDisplayR
     if (needRemove || !m_exportedItem) {
         VideoWindowInformer::instance()->removeVideoWindowList(contextId);
     } else {
-        qInfo() << "updateVideoWindowList m_exportedItem: " << m_exportedItem;
+        qCInfo(lsmForeign) << "updateVideoWindowList m_exportedItem: " << m_exportedItem;
         if(!m_contextId.isNull() && m_exportedItem->isVisible() && m_surfaceItem) {
             QString appId = m_surfaceItem ? m_surfaceItem->appId() : "";
             qreal scaleFactor = m_surfaceItem->scale();
@@ -722,9 +812,9 @@ void WebOSExported::updateVideoWindowList(QString contextId, QRect videoDisplayR
 void WebOSExported::updateExportedItemSize()
 {
     if (!m_exportedItem)
-        qWarning() << "WebOSSurfaceItem for " << m_windowId << " is  already destroyed ";
+        qCWarning(lsmForeign) << "WebOSSurfaceItem for " << m_windowId << " is  already destroyed ";
 
-    qInfo() << m_exportedItem << "fits to" << m_destinationRect;
+    qCInfo(lsmForeign) << m_exportedItem << "fits to" << m_destinationRect;
     // This is the same as the function calculateExportedItemRatio before the wide screen is applied.
     // There is no problem with the value of m_destinationRect being correct before entering the updateExportedItemSize function.
     // So, I think restoring it like this increases the stability of the code.
@@ -733,9 +823,9 @@ void WebOSExported::updateExportedItemSize()
     m_exportedItem->setWidth(m_destinationRect.width());
     m_exportedItem->setHeight(m_destinationRect.height());
 
-    qInfo() << "updateExportedItemSize m_exportedItem " << m_exportedItem;
+    qCInfo(lsmForeign) << "updateExportedItemSize m_exportedItem " << m_exportedItem;
     if (m_punchThroughItem) {
-        qInfo()<< "punch through item size changed:  " << m_exportedItem->width() << "on " << m_windowId;
+        qCInfo(lsmForeign)<< "punch through item size changed:  " << m_exportedItem->width() << "on " << m_windowId;
         m_punchThroughItem->setWidth(m_exportedItem->width());
         m_punchThroughItem->setHeight(m_exportedItem->height());
     } else {
@@ -750,49 +840,50 @@ void WebOSExported::setVideoDisplayWindow()
 {
     QRect videoDisplayRect;
     if (!m_surfaceItem) {
-        qDebug() << "SurfaceItem  for " << m_windowId << " is already destroyed";
+        qCDebug(lsmForeign) << "SurfaceItem  for " << m_windowId << " is already destroyed";
         return;
     }
 
     if (!m_surfaceItem->isMapped()) {
-        qInfo() << "item " << m_surfaceItem << " is not mapped yet on " << m_windowId;
+        qCInfo(lsmForeign) << "item " << m_surfaceItem << " is not mapped yet on " << m_windowId;
         return;
     } else {
-        qInfo() << "window type : " << m_surfaceItemWindowType << ", window id : " << m_windowId;
+        qCInfo(lsmForeign) << "window type : " << m_surfaceItemWindowType << ", window id : " << m_windowId;
     }
 
     if (m_foreign->m_compositor->window() && !m_contextId.isNull()) {
         if (m_coverState == WebOSSurfaceItem::CoverStateChanging) {
-            qInfo() << "cover video state is changing. Do not call setDisplayWindow.";
+            qCInfo(lsmForeign) << "cover video state is changing. Do not call setDisplayWindow.";
             return;
         }
 
         if (m_coverState == WebOSSurfaceItem::CoverStateHidden || m_isRotationChanging) {
-            qInfo() << "cover video state (" << m_coverState << ") or rotation changing (" << m_isRotationChanging << "). set video display rect = (0, 0, 0, 0)";
+            qCInfo(lsmForeign) << "cover video state (" << m_coverState << ") or rotation changing (" << m_isRotationChanging << "). set video display rect = (0, 0, 0, 0)";
             videoDisplayRect = QRect(0, 0, 0, 0);
         } else if (m_surfaceItem->state() == Qt::WindowMinimized) {
-            qInfo() << "SurfaceItem is minimized. set video display rect = (0, 0, 0, 0)";
+            qCInfo(lsmForeign) << "SurfaceItem is minimized. set video display rect = (0, 0, 0, 0)";
         } else {
-            qDebug() << "Not cover state. Keep video display rect";
+            qCDebug(lsmForeign) << "Not cover state. Keep video display rect";
             videoDisplayRect = m_videoDisplayRect;
         }
         if (m_directVideoScalingMode) {
-            qDebug() << "Direct video scaling mode is enabled. Do not call setDisplayWindow.";
+            qCDebug(lsmForeign) << "Direct video scaling mode is enabled. Do not call setDisplayWindow.";
         } else {
             QRect appOutput = getAppWindow();
             setVideoPlaying(true);
             updateWideVideo();
-            if (m_originalInputRect.isValid()) {
-                qInfo() << "Call setCropRegion with original input rect : " << m_originalInputRect << " , source rect: " << m_sourceRect << " , video display rect : " << videoDisplayRect << ", appOutput : " << appOutput << " , m_contextId : " << m_contextId;
-                VideoOutputdCommunicator::instance()->setCropRegion(m_originalInputRect, m_sourceRect, videoDisplayRect, appOutput, m_contextId);
-            } else {
-                qInfo() << " Call setDisplayWindow with video display rect : " << videoDisplayRect << ", appOutput : " << appOutput << " , contextid : " << m_contextId;
-                VideoOutputdCommunicator::instance()->setDisplayWindow(m_sourceRect, videoDisplayRect, appOutput, m_contextId);
-            }
+            VideoDisplayRequest request;
+            request.crop = m_originalInputRect.isValid();
+            request.inputRect = m_originalInputRect;
+            request.sourceRect = m_sourceRect;
+            request.displayRect = videoDisplayRect;
+            request.appOutput = appOutput;
+            request.contextId = m_contextId;
+            submitVideoDisplayRequest(request);
         }
         updateVideoWindowList(m_contextId, videoDisplayRect, false);
     } else {
-        qInfo() << "Do not call setDisplayWindow. Punch through is not working";
+        qCInfo(lsmForeign) << "Do not call setDisplayWindow. Punch through is not working";
     }
 
     if (!m_contextId.isNull())
@@ -809,7 +900,7 @@ void WebOSExported::updateDestinationRegion()
 
                     if (m_originalRequestedRegion.isValid()) {
                         double scale = qMin((double)(m_activeRegion.width()) / (double)(m_originalRequestedRegion.width()), (double)(m_activeRegion.height()) / (double)(m_originalRequestedRegion.height()));
-                        qInfo() << "Requested region is out of bounds of active region. scale = " << scale;
+                        qCInfo(lsmForeign) << "Requested region is out of bounds of active region. scale = " << scale;
 
                         int x = double2int(m_activeRegion.x() + (m_activeRegion.width() - m_originalRequestedRegion.width()*scale)*0.5);
                         int y = double2int(m_activeRegion.y() + (m_activeRegion.height() - m_originalRequestedRegion.height()*scale)*0.5);
@@ -826,8 +917,8 @@ void WebOSExported::updateDestinationRegion()
 
             double ratio = qMin((double) m_requestedRegion.width() / m_sourceRect.width(), (double) m_requestedRegion.height() / m_sourceRect.height());
 
-            qInfo() << "Requested region is out of bounds of surface. original requested region : " << m_originalRequestedRegion << ", surface size : " << m_surfaceItem->surface()->bufferSize();
-            qInfo() << "Requested region by source rect ratio : " << ratio;
+            qCInfo(lsmForeign) << "Requested region is out of bounds of surface. original requested region : " << m_originalRequestedRegion << ", surface size : " << m_surfaceItem->surface()->bufferSize();
+            qCInfo(lsmForeign) << "Requested region by source rect ratio : " << ratio;
 
             if (m_originalRequestedRegion.x() < 0) {
                 m_sourceRect.setX((0 - m_originalRequestedRegion.x()) / ratio);
@@ -845,7 +936,7 @@ void WebOSExported::updateDestinationRegion()
                 m_sourceRect.setHeight(m_sourceRect.height() - (m_originalRequestedRegion.bottom() - m_surfaceItem->surface()->bufferSize().height()) / ratio);
                 m_requestedRegion.setHeight(m_surfaceItem->surface()->bufferSize().height() - m_requestedRegion.y());
             }
-            qInfo() << "Changed requested region : " << m_requestedRegion << ", source rect : " << m_sourceRect;
+            qCInfo(lsmForeign) << "Changed requested region : " << m_requestedRegion << ", source rect : " << m_sourceRect;
         }
 #else
         if (m_originalRequestedRegion.x() < 0 || m_originalRequestedRegion.y() < 0 ||
@@ -854,8 +945,8 @@ void WebOSExported::updateDestinationRegion()
 
             double ratio = qMin((double) m_requestedRegion.width() / m_sourceRect.width(), (double) m_requestedRegion.height() / m_sourceRect.height());
 
-            qInfo() << "Requested region is out of bounds of surface. original requested region : " << m_originalRequestedRegion << ", surface size : " << m_surfaceItem->surface()->size();
-            qInfo() << "Requested region by source rect ratio : " << ratio;
+            qCInfo(lsmForeign) << "Requested region is out of bounds of surface. original requested region : " << m_originalRequestedRegion << ", surface size : " << m_surfaceItem->surface()->size();
+            qCInfo(lsmForeign) << "Requested region by source rect ratio : " << ratio;
 
             if (m_originalRequestedRegion.x() < 0) {
                 m_sourceRect.setX(double2int((0 - m_originalRequestedRegion.x()) / ratio));
@@ -873,7 +964,7 @@ void WebOSExported::updateDestinationRegion()
                 m_sourceRect.setHeight(double2int(m_sourceRect.height() - (m_originalRequestedRegion.bottom() - m_surfaceItem->surface()->size().height()) / ratio));
                 m_requestedRegion.setHeight(m_surfaceItem->surface()->size().height() - m_requestedRegion.y());
             }
-            qInfo() << "Changed requested region : " << m_requestedRegion << ", source rect : " << m_sourceRect;
+            qCInfo(lsmForeign) << "Changed requested region : " << m_requestedRegion << ", source rect : " << m_sourceRect;
         }
 #endif
     }
@@ -918,8 +1009,8 @@ void WebOSExported::setVideoDisplayRect() {
             h_r = (int)bottom - y_r;
         }
 
-        qInfo() << "global x:" << m_surfaceGlobalPosition.x() << ", round x:" << x << ", int(round x):" << int(x);
-        qInfo() << "global y:" << m_surfaceGlobalPosition.y() << ", round y:" << y << ", int(round y):" << int(y);
+        qCInfoLimited(lsmForeign, 10, 20) << "global x:" << m_surfaceGlobalPosition.x() << ", round x:" << x << ", int(round x):" << int(x);
+        qCInfoLimited(lsmForeign, 10, 20) << "global y:" << m_surfaceGlobalPosition.y() << ", round y:" << y << ", int(round y):" << int(y);
 
         m_videoDisplayRect = QRect(x_r, y_r, w_r, h_r);
     } else if (m_fullscreenByApp) {
@@ -944,8 +1035,8 @@ void WebOSExported::setVideoDisplayRect() {
         double w_p = w - int(w);
         double h_p = h - int(h);
 
-        qInfo() << "global x:" << m_surfaceGlobalPosition.x() << ", round x:" << x << ", int(round x):" << int(x);
-        qInfo() << "global y:" << m_surfaceGlobalPosition.y() << ", round y:" << y << ", int(round y):" << int(y);
+        qCInfoLimited(lsmForeign, 10, 20) << "global x:" << m_surfaceGlobalPosition.x() << ", round x:" << x << ", int(round x):" << int(x);
+        qCInfoLimited(lsmForeign, 10, 20) << "global y:" << m_surfaceGlobalPosition.y() << ", round y:" << y << ", int(round y):" << int(y);
 
         /* TVWBS_24-53699 : If different aspect ration video playing in PIP then small transparent line is displayed in one of the corner of video.
          * Suspecting this is due to surfaceItem follows QRectF and other display rect in foreign class follows QRect.
@@ -989,12 +1080,12 @@ void WebOSExported::setVideoDisplayRect() {
         if (appOutput.isValid() &&
             m_videoDisplayRect.topLeft() == appOutput.topLeft() &&
             m_videoDisplayRect.size() != appOutput.size()) {
-            qInfo() << "align center videoDisplayRect(" << m_videoDisplayRect << ") -> appOutput(" << appOutput << ") on " << m_windowId;
+            qCInfo(lsmForeign) << "align center videoDisplayRect(" << m_videoDisplayRect << ") -> appOutput(" << appOutput << ") on " << m_windowId;
             m_videoDisplayRect.moveLeft(m_videoDisplayRect.x() + round((appOutput.width() - m_videoDisplayRect.width()) / 2));
             m_videoDisplayRect.moveTop(m_videoDisplayRect.y() + round((appOutput.height() - m_videoDisplayRect.height()) / 2));
         }
     }
-    qInfo() << "m_videoDisplayRect: " << m_videoDisplayRect << ", m_videoDispRatio: " << m_videoDispRatio << ", m_fullscreenByApp: " << m_fullscreenByApp << ", m_fullscreenVideoMode: " << m_fullscreenVideoMode;
+    qCInfo(lsmForeign) << "m_videoDisplayRect: " << m_videoDisplayRect << ", m_videoDispRatio: " << m_videoDispRatio << ", m_fullscreenByApp: " << m_fullscreenByApp << ", m_fullscreenVideoMode: " << m_fullscreenVideoMode;
 }
 
 QRect WebOSExported::getAppWindow() {
@@ -1048,10 +1139,10 @@ void WebOSExported::setDestinationRegion(struct::wl_resource *destination_region
         setDestinationRect();
         setVideoDisplayRect();
 
-        qInfo() << "exported original requested destination region : " << m_originalRequestedRegion << " on " << m_windowId;
-        qInfo() << "exported requested destination region : " << m_requestedRegion << " on " << m_windowId;
-        qInfo() << "exported item region : " << m_destinationRect << ", video display region : " << m_videoDisplayRect;
-        qInfo() << "exported item ratio : " << m_exportedWindowRatio << ", video display ratio :  " << m_videoDispRatio;
+        qCInfo(lsmForeign) << "exported original requested destination region : " << m_originalRequestedRegion << " on " << m_windowId;
+        qCInfoLimited(lsmForeign, 10, 20) << "exported requested destination region : " << m_requestedRegion << " on " << m_windowId;
+        qCInfoLimited(lsmForeign, 10, 20) << "exported item region : " << m_destinationRect << ", video display region : " << m_videoDisplayRect;
+        qCInfoLimited(lsmForeign, 10, 20) << "exported item ratio : " << m_exportedWindowRatio << ", video display ratio :  " << m_videoDispRatio;
 
         setVideoDisplayWindow();
         updateExportedItemSize();
@@ -1061,10 +1152,22 @@ void WebOSExported::setDestinationRegion(struct::wl_resource *destination_region
 void WebOSExported::updateCompositorWindow(QQuickWindow *window)
 {
     if (window != m_compositorWindow) {
-        if (m_compositorWindow)
+        if (m_compositorWindow) {
             disconnect(m_compositorWindow, &WebOSCompositorWindow::outputGeometryChanged, this, &WebOSExported::calculateAll);
+            disconnect(m_compositorWindow, &QQuickWindow::beforeSynchronizing, this, &WebOSExported::flushPendingGeometry);
+            disconnect(m_compositorWindow, &QQuickWindow::frameSwapped, this, &WebOSExported::flushPendingVideoRequest);
+        }
+        // Anything left for the old window goes out now
+        flushPendingVideoRequest();
         m_compositorWindow = static_cast<WebOSCompositorWindow *>(window);
-        connect(m_compositorWindow, &WebOSCompositorWindow::outputGeometryChanged, this, &WebOSExported::calculateAll);
+        if (m_compositorWindow) {
+            connect(m_compositorWindow, &WebOSCompositorWindow::outputGeometryChanged, this, &WebOSExported::calculateAll);
+            // Emitted on the render thread, so this runs on the GUI thread
+            // once the frame has been synchronized
+            connect(m_compositorWindow, &QQuickWindow::beforeSynchronizing, this, &WebOSExported::flushPendingGeometry, Qt::QueuedConnection);
+            if (syncVideoToFrame())
+                connect(m_compositorWindow, &QQuickWindow::frameSwapped, this, &WebOSExported::flushPendingVideoRequest, Qt::QueuedConnection);
+        }
 
         calculateAll();
     }
@@ -1072,11 +1175,11 @@ void WebOSExported::updateCompositorWindow(QQuickWindow *window)
 
 void WebOSExported::setFullscreenVideoMode(QString fullscreenVideoMode)
 {
-    qInfo() << "Requested fullscreenVideoMode: " << fullscreenVideoMode << ", uiScaleMode: " << m_surfaceItem->uiScaleMode();
+    qCInfo(lsmForeign) << "Requested fullscreenVideoMode: " << fullscreenVideoMode << ", uiScaleMode: " << m_surfaceItem->uiScaleMode();
 
     // It is assumed that setting fullscreenVideoMode by the app has higher priority.
     if (m_fullscreenByApp) {
-        qWarning() << "The state is in fullscreenVideoMode by app. Prevent fullscreenVideoMode from being updated by user";
+        qCWarning(lsmForeign) << "The state is in fullscreenVideoMode by app. Prevent fullscreenVideoMode from being updated by user";
         return;
     }
 
@@ -1121,7 +1224,7 @@ void WebOSExported::webos_exported_set_exported_window(
         }
     }
 
-    qInfo() << "exported_window source rect : " << m_sourceRect << "on " << m_windowId;
+    qCInfo(lsmForeign) << "exported_window source rect : " << m_sourceRect << "on " << m_windowId;
 
     m_isRotationChanging = false;
     setDestinationRegion(destination_region);
@@ -1161,14 +1264,14 @@ void WebOSExported::webos_exported_set_crop_region(
         }
     }
 
-    qInfo() << "crop_region original rect : " << m_originalInputRect << "on " << m_windowId;
-    qInfo() << "crop_region source rect : " << m_sourceRect << "on " << m_windowId;
+    qCInfo(lsmForeign) << "crop_region original rect : " << m_originalInputRect << "on " << m_windowId;
+    qCInfo(lsmForeign) << "crop_region source rect : " << m_sourceRect << "on " << m_windowId;
 
     m_isRotationChanging = false;
     setDestinationRegion(destination_region);
 
     if (m_fullscreenByApp) {
-        qInfo() << "The fullscreenmode is enabled by the app.";
+        qCInfo(lsmForeign) << "The fullscreenmode is enabled by the app.";
         calculateAll();
     }
 }
@@ -1178,17 +1281,17 @@ void WebOSExported::webos_exported_set_property(
         const QString &name,
         const QString &value)
 {
-    qInfo() << "set_property name : " << name << " value : " << value << "on" << m_windowId << ", m_exportedItem: " << m_exportedItem;
+    qCInfo(lsmForeign) << "set_property name : " << name << " value : " << value << "on" << m_windowId << ", m_exportedItem: " << m_exportedItem;
 
     // Set exportedItems' z_index from z_index value
     if (name == "z_index") {
         bool result;
         int z_index = value.toInt(&result, 10);
         if (result) {
-            qInfo() << "set exportedItem's z_index to " << z_index;
+            qCInfo(lsmForeign) << "set exportedItem's z_index to " << z_index;
             m_exportedItem->setZ(z_index);
         } else {
-            qInfo() << "Failed to convert value to integer";
+            qCInfo(lsmForeign) << "Failed to convert value to integer";
         }
         return;
     }
@@ -1200,23 +1303,25 @@ void WebOSExported::webos_exported_set_property(
 
         if (!m_contextId.isNull()) {
             if (result) {
-                qInfo() << "set video z_order to " << z_order << " on " << m_contextId;
+                qCInfo(lsmForeign) << "set video z_order to " << z_order << " on " << m_contextId;
                 VideoOutputdCommunicator::instance()->setVideoCompositing("zorder", z_order, m_contextId);
             } else {
-                qInfo() << "Failed to convert value to integer";
+                qCInfo(lsmForeign) << "Failed to convert value to integer";
             }
         } else {
-            qInfo() << "Do not set video z_order. contextId is null";
+            qCInfo(lsmForeign) << "Do not set video z_order. contextId is null";
         }
 
         return;
     }
 
     if (name == "directVideoScalingMode") {
-        if (value == "on")
-            m_directVideoScalingMode = true;
-        else
-            m_directVideoScalingMode = false;
+        bool mode = (value == "on");
+        if (m_directVideoScalingMode != mode) {
+            m_directVideoScalingMode = mode;
+            // The last request was sent for the other scaling mode
+            m_hasLastVideoRequest = false;
+        }
         return;
     }
 
@@ -1250,7 +1355,7 @@ void WebOSExported::webos_exported_set_property(
             return;
         }
     } else {
-        qInfo() << "Do not call setProperty as there is no window for this WebOSExported" << this;
+        qCInfo(lsmForeign) << "Do not call setProperty as there is no window for this WebOSExported" << this;
     }
 
     if (value.isNull())
@@ -1284,10 +1389,23 @@ void WebOSExported::setPunchThrough(bool needPunch)
     }
 }
 
+void WebOSExported::setContextId(const QString &contextId)
+{
+    if (!m_contextId.isNull() && m_foreign->m_exportedByContextId.value(m_contextId) == this)
+        m_foreign->m_exportedByContextId.remove(m_contextId);
+    m_contextId = contextId;
+    if (!m_contextId.isNull())
+        m_foreign->m_exportedByContextId.insert(m_contextId, this);
+}
+
 void WebOSExported::assignWindowId(QString windowId)
 {
+    if (!m_windowId.isNull() && m_foreign->m_exportedByWindowId.value(m_windowId) == this)
+        m_foreign->m_exportedByWindowId.remove(m_windowId);
     m_windowId = windowId;
-    qInfo() << m_windowId << "is assigned for " << this;
+    if (!m_windowId.isNull())
+        m_foreign->m_exportedByWindowId.insert(m_windowId, this);
+    qCInfo(lsmForeign) << m_windowId << "is assigned for " << this;
     send_window_id_assigned(m_windowId, m_exportedType);
 }
 
@@ -1299,7 +1417,7 @@ WebOSSurfaceItem *WebOSExported::getImportedItem()
         return nullptr;
 
     if (childDisplayItem->childItems().size() > 1)
-        qWarning() << "more than one imported item for WebOSExported" << m_surfaceItem;
+        qCWarning(lsmForeign) << "more than one imported item for WebOSExported" << m_surfaceItem;
 
     // Imported surface item
     return static_cast<WebOSSurfaceItem *>(childDisplayItem->childItems().first());
@@ -1324,7 +1442,7 @@ bool WebOSExported::hasSecuredContent()
 void WebOSExported::setParentOf(QQuickItem *item, QQuickItem *childDisplayItem)
 {
     if (!m_surfaceItem || !m_exportedItem) {
-        qWarning() << "unexpected null reference" << m_surfaceItem << m_exportedItem;
+        qCWarning(lsmForeign) << "unexpected null reference" << m_surfaceItem << m_exportedItem;
         return;
     }
 
@@ -1337,20 +1455,20 @@ void WebOSExported::setParentOf(QQuickItem *item, QQuickItem *childDisplayItem)
 
 void WebOSExported::registerMuteOwner(const QString& contextId)
 {
-    qDebug() << "WebOSExported::registerMuteOwner() m_muteRegisteredContextId : " << m_muteRegisteredContextId <<  "contextId: " << contextId;
+    qCDebug(lsmForeign) << "WebOSExported::registerMuteOwner() m_muteRegisteredContextId : " << m_muteRegisteredContextId <<  "contextId: " << contextId;
 
     if (!m_muteRegisteredContextId.isNull()) {
         if (m_muteRegisteredContextId == contextId) {
-            qDebug() << "ContextId is same. Do not unregister mute owner";
+            qCDebug(lsmForeign) << "ContextId is same. Do not unregister mute owner";
         } else {
-            qDebug() << "ContextId is different from the previous one";
+            qCDebug(lsmForeign) << "ContextId is different from the previous one";
             VideoOutputdCommunicator::instance()->setProperty("mute", "off", m_muteRegisteredContextId);
             VideoOutputdCommunicator::instance()->setProperty("registerMute", "off", m_muteRegisteredContextId);
             VideoOutputdCommunicator::instance()->setProperty("registerMute", "on", contextId);
             m_muteRegisteredContextId = contextId;
         }
     } else {
-        qDebug() << "m_muteRegisteredContextId is null";
+        qCDebug(lsmForeign) << "m_muteRegisteredContextId is null";
         QMap<QString, QString>::const_iterator it = (m_properties).find("registerMute");
         if (it!= (m_properties).end()) {
             VideoOutputdCommunicator::instance()->setProperty(it.key(), it.value(), contextId);
@@ -1378,7 +1496,7 @@ void WebOSExported::unregisterMuteOwner()
 
 void WebOSExported::webos_exported_destroy(Resource *r)
 {
-    qInfo() << "webos_exported_destroy is called on " << this;
+    qCInfo(lsmForeign) << "webos_exported_destroy is called on " << this;
     if (r)
         wl_resource_destroy(r->handle);
 }
@@ -1396,7 +1514,7 @@ void WebOSExported::startImportedMirroring(WebOSSurfaceItem *parent)
 
     QQuickItem *source = getImportedItem();
 
-    qInfo() << "startImportedMirroring for source" << source;
+    qCInfo(lsmForeign) << "startImportedMirroring for source" << source;
 
     // Nothing imported to the exported item
     if (!source)
@@ -1415,7 +1533,7 @@ void WebOSExported::startImportedMirroring(WebOSSurfaceItem *parent)
         mirror->setDirectUpdateOnPlane(parent->directUpdateOnPlane());
         connect(parent, &WebOSSurfaceItem::directUpdateOnPlaneChanged, mirror, &WebOSSurfaceItem::updateDirectUpdateOnPlane);
 
-        qInfo() << "source" << si << "mirror" << mirror;
+        qCInfo(lsmForeign) << "source" << si << "mirror" << mirror;
     }
 }
 
@@ -1443,19 +1561,19 @@ WebOSImported::WebOSImported(WebOSExported* exported, struct wl_client* client,
     , m_importedType(exportedType)
 {
     if (exported) {
-        qInfo() << this << "is created. Video window id is : " << m_exported->m_windowId;
+        qCInfo(lsmForeign) << this << "is created. Video window id is : " << m_exported->m_windowId;
         connect(exported, &WebOSExported::geometryChanged,
                 this, &WebOSImported::updateGeometry);
         send_destination_region_changed(exported->m_destinationRect.width(),
                                         exported->m_destinationRect.height());
     } else {
-        qWarning() << this << "is created with a null video window";
+        qCWarning(lsmForeign) << this << "is created with a null video window";
     }
 }
 
 WebOSImported::~WebOSImported()
 {
-    qInfo() << "WebOSImported destructor is called on " << this << ", call detach()";
+    qCInfo(lsmForeign) << "WebOSImported destructor is called on " << this << ", call detach()";
     if (!m_exported)
         return;
     else
@@ -1482,10 +1600,10 @@ void WebOSImported::setSurfaceItemSize()
             qreal surfaceItemY = (m_exported->m_destinationRect.height() - (m_exported->m_sourceRect.height() * ratio)) / 2;
             qreal surfaceItemWidth = m_exported->m_sourceRect.width() * ratio;
             qreal surfaceItemHeight = m_exported->m_sourceRect.height() * ratio;
-            qInfo() << "setSurfaceItemSize m_exportedItem: " << m_exported->m_exportedItem;
-            qInfo() << "Fit surface item's source : " << m_exported->m_sourceRect << this;
-            qInfo() << "Fit surface item's destination : " << m_exported->m_destinationRect << this;
-            qInfo() << "Fit surface item's coord : "
+            qCInfo(lsmForeign) << "setSurfaceItemSize m_exportedItem: " << m_exported->m_exportedItem;
+            qCInfo(lsmForeign) << "Fit surface item's source : " << m_exported->m_sourceRect << this;
+            qCInfo(lsmForeign) << "Fit surface item's destination : " << m_exported->m_destinationRect << this;
+            qCInfo(lsmForeign) << "Fit surface item's coord : "
                             << surfaceItemX << ","
                             << surfaceItemY << ","
                             << surfaceItemWidth << "x"
@@ -1508,11 +1626,11 @@ void WebOSImported::setSurfaceItemSize()
             qreal cropSurfaceItemWidth = m_exported->m_originalInputRect.width() * widthRatio;
             qreal cropSurfaceItemHeight = m_exported->m_originalInputRect.height() * heightRatio;
 
-            qInfo() << "setSurfaceItemSize m_exportedItem: " << m_exported->m_exportedItem;
-            qInfo() << "Crop surface item's destination : "
+            qCInfo(lsmForeign) << "setSurfaceItemSize m_exportedItem: " << m_exported->m_exportedItem;
+            qCInfo(lsmForeign) << "Crop surface item's destination : "
                             << m_exported->m_destinationRect.width() << "x"
                             << m_exported->m_destinationRect.height() << this;
-            qInfo() << "Crop surface item's coord : "
+            qCInfo(lsmForeign) << "Crop surface item's coord : "
                             << cropSurfaceItemX << ","
                             << cropSurfaceItemY << ","
                             << cropSurfaceItemWidth << "x"
@@ -1526,9 +1644,9 @@ void WebOSImported::setSurfaceItemSize()
             m_childSurfaceItem->setX(cropSurfaceItemX);
             m_childSurfaceItem->setY(cropSurfaceItemY);
         } else { // stretch
-            qInfo() << "setSurfaceItemSize m_exportedItem: " << m_exported->m_exportedItem;
-            qInfo() << "set surface item's width : " << m_exported->m_exportedItem->width() << this;
-            qInfo() << "set surface item's height : " << m_exported->m_exportedItem->height() << this;
+            qCInfo(lsmForeign) << "setSurfaceItemSize m_exportedItem: " << m_exported->m_exportedItem;
+            qCInfo(lsmForeign) << "set surface item's width : " << m_exported->m_exportedItem->width() << this;
+            qCInfo(lsmForeign) << "set surface item's height : " << m_exported->m_exportedItem->height() << this;
 
             m_childDisplayItem->setWidth(m_exported->m_exportedItem->width());
             m_childDisplayItem->setHeight(m_exported->m_exportedItem->height());
@@ -1555,7 +1673,7 @@ void WebOSImported::updateGeometry()
 
     if (m_exported && m_exported->m_exportedItem) {
         m_exported->updateWideVideo();
-        qInfo() << "updateGeometry m_exportedItem: " << m_exported->m_exportedItem;
+        qCInfo(lsmForeign) << "updateGeometry m_exportedItem: " << m_exported->m_exportedItem;
         send_destination_region_changed(double2uint(m_exported->m_exportedItem->width()),
                                     double2uint(m_exported->m_exportedItem->height()));
     }
@@ -1563,17 +1681,17 @@ void WebOSImported::updateGeometry()
 
 void WebOSImported::detach()
 {
-    qWarning() << "detach is called on  : " << this;
+    qCWarning(lsmForeign) << "detach is called on  : " << this;
     if (m_exported) {
         // exported for punch through is destroyed
         if (m_punchThroughAttached) {
-            qInfo() << "request to detach punchthrough";
+            qCInfo(lsmForeign) << "request to detach punchthrough";
             webos_imported_detach_punchthrough(nullptr);
         }
 
        // exported for texture surface is destroyed
         if (m_childSurfaceItem) {
-            qInfo() << "request to detach surface";
+            qCInfo(lsmForeign) << "request to detach surface";
             webos_imported_detach_surface(nullptr, m_childSurfaceItem->surface()->resource());
         }
     }
@@ -1581,7 +1699,7 @@ void WebOSImported::detach()
 
 void WebOSImported::updateExported(WebOSExported * exported)
 {
-    qInfo() << "WebOSImported::updateExported is called " << this;
+    qCInfo(lsmForeign) << "WebOSImported::updateExported is called " << this;
 
     if (m_exported == exported)
         return;
@@ -1594,7 +1712,7 @@ void WebOSImported::updateExported(WebOSExported * exported)
 
 void WebOSImported::webos_imported_attach_punchthrough(Resource* r)
 {
-    qInfo() << "attach_punchthrough is called, invoke attach_punchthrough_with_context with MAIN context for backward compatibility";
+    qCInfo(lsmForeign) << "attach_punchthrough is called, invoke attach_punchthrough_with_context with MAIN context for backward compatibility";
     webos_imported_attach_punchthrough_with_context(r, QString("MAIN"));
 }
 
@@ -1602,14 +1720,14 @@ void WebOSImported::webos_imported_attach_punchthrough_with_context(Resource* r,
 {
     Q_UNUSED(r);
 
-    qInfo() << "attach_punchthrough_with_context is called with contextId " << contextId << " on " << this;
+    qCInfo(lsmForeign) << "attach_punchthrough_with_context is called with contextId " << contextId << " on " << this;
 
     if (!m_exported || !(m_exported->m_exportedItem) || contextId.isNull()) {
-        qWarning() << " Fail to attach punch through (m_exported : " << m_exported << " contextId : " << contextId << ")";
+        qCWarning(lsmForeign) << " Fail to attach punch through (m_exported : " << m_exported << " contextId : " << contextId << ")";
         return;
     }
     if (!(m_exported->m_contextId.isNull()))
-        qWarning() << "m_exported has m_contextId " << m_exported->m_contextId;
+        qCWarning(lsmForeign) << "m_exported has m_contextId " << m_exported->m_contextId;
 
     m_exported->registerMuteOwner(contextId);
 
@@ -1617,7 +1735,7 @@ void WebOSImported::webos_imported_attach_punchthrough_with_context(Resource* r,
     if (!(m_exported->m_properties).isEmpty()) {
         QMap<QString, QString>::const_iterator i = m_exported->m_properties.constBegin();
         while (i != m_exported->m_properties.constEnd()) {
-            qInfo() << "m_properties key : " << i.key() << " value :  " << i.value();
+            qCInfo(lsmForeign) << "m_properties key : " << i.key() << " value :  " << i.value();
             if (i.key() == "mute" && i.value() == "windowBasedOn")
                 VideoOutputdCommunicator::instance()->setProperty(i.key(), "on", contextId);
             else
@@ -1627,14 +1745,16 @@ void WebOSImported::webos_imported_attach_punchthrough_with_context(Resource* r,
     }
 
     m_contextId = contextId;
-    m_exported->m_contextId = contextId;
+    m_exported->setContextId(contextId);
     m_punchThroughAttached = true;
+    // A newly attached sink needs the display window even if unchanged
+    m_exported->m_hasLastVideoRequest = false;
 
     if (m_exported->m_requestedRegion.isValid())
         m_exported->setVideoDisplayWindow();
 
     m_exported->updateDisplayPosition(true);
-    qInfo() << "webos_imported_attach_punchthrough m_exportedItem: " << m_exported->m_exportedItem;
+    qCInfo(lsmForeign) << "webos_imported_attach_punchthrough m_exportedItem: " << m_exported->m_exportedItem;
     //m_exported->setPunchThrough(true);
     send_punchthrough_attached(contextId);
 }
@@ -1643,16 +1763,16 @@ void WebOSImported::webos_imported_set_punchthrough(Resource* r, const QString&
 {
     Q_UNUSED(r);
 
-    qInfo() << "set_punchthrough is called with contextId " << contextId << " on " << this;
+    qCInfo(lsmForeign) << "set_punchthrough is called with contextId " << contextId << " on " << this;
 
     if (!m_exported || !(m_exported->m_exportedItem) || contextId.isNull()) {
-        qWarning() << " Fail to set punch through (m_exported : " << m_exported << " contextId : " << contextId << ")";
+        qCWarning(lsmForeign) << " Fail to set punch through (m_exported : " << m_exported << " contextId : " << contextId << ")";
         return;
     }
     if (!(m_exported->m_contextId.isNull()))
-        qWarning() << "m_exported has m_contextId " << m_exported->m_contextId;
+        qCWarning(lsmForeign) << "m_exported has m_contextId " << m_exported->m_contextId;
 
-    qInfo() << "webos_imported_set_punchthrough m_exportedItem: " << m_exported->m_exportedItem;
+    qCInfo(lsmForeign) << "webos_imported_set_punchthrough m_exportedItem: " << m_exported->m_exportedItem;
     m_exported->setPunchThrough(true);
 }
 
@@ -1660,26 +1780,27 @@ void WebOSImported::webos_imported_detach_punchthrough(Resource* r)
 {
     Q_UNUSED(r);
 
-    qInfo() << "detach_punchthrough is called on " << this;
+    qCInfo(lsmForeign) << "detach_punchthrough is called on " << this;
 
     if (!m_exported || m_exported->m_contextId.isNull()) {
-        qWarning() << "m_exported or m_contextId is null";
+        qCWarning(lsmForeign) << "m_exported or m_contextId is null";
         return;
     }
 
     m_exported->setVideoPlaying(false);
     m_exported->setWideVideo(false);
+    m_exported->m_hasLastVideoRequest = false;
 
     if (m_contextId == m_exported->m_contextId) {
-        qInfo() << "webos_imported_detach_punchthrough m_exportedItem: " << m_exported->m_exportedItem;
+        qCInfo(lsmForeign) << "webos_imported_detach_punchthrough m_exportedItem: " << m_exported->m_exportedItem;
         m_exported->setPunchThrough(false);
         m_exported->unregisterMuteOwner();
         send_punchthrough_detached(m_exported->m_contextId);
         m_exported->updateVideoWindowList(m_exported->m_contextId, QRect(0, 0, 0, 0), true);
-        m_exported->m_contextId = QString();
+        m_exported->setContextId(QString());
         m_punchThroughAttached = false;
     } else {
-        qInfo() << "detach_punchthrough is called for contextId " << m_contextId;
+        qCInfo(lsmForeign) << "detach_punchthrough is called for contextId " << m_contextId;
         send_punchthrough_detached(m_contextId);
         m_exported->updateVideoWindowList(m_contextId, QRect(0, 0, 0, 0), true);
         m_punchThroughAttached = false;
@@ -1688,7 +1809,7 @@ void WebOSImported::webos_imported_detach_punchthrough(Resource* r)
 
 void WebOSImported::webos_imported_destroy(Resource* r)
 {
-    qInfo() << "webos_imported_destroy is called on " << this;
+    qCInfo(lsmForeign) << "webos_imported_destroy is called on " << this;
     if (r)
         wl_resource_destroy(r->handle);
 }
@@ -1701,7 +1822,7 @@ void WebOSImported::webos_imported_destroy_resource(Resource* r)
 
 void WebOSImported::destroyChildDisplay()
 {
-    qInfo() << "destroyChildDisplay is called on " << this;
+    qCInfo(lsmForeign) << "destroyChildDisplay is called on " << this;
     if (m_childDisplayItem) {
         delete m_childDisplayItem;
         m_childDisplayItem = nullptr;
@@ -1710,7 +1831,7 @@ void WebOSImported::destroyChildDisplay()
 
 void WebOSImported::childSurfaceDestroyed()
 {
-    qInfo() << "childSurfaceDestroyed is called on " << this;
+    qCInfo(lsmForeign) << "childSurfaceDestroyed is called on " << this;
     if (m_childSurfaceItem)
         m_childSurfaceItem = nullptr;
     destroyChildDisplay();
@@ -1722,11 +1843,11 @@ void WebOSImported::webos_imported_attach_surface(
 {
 
     if (!m_exported || !(m_exported->m_exportedItem) || !surface) {
-        qWarning() << "Exported (" << m_exported << " ) is already destroyed or surface (" << surface << ") is null";
+        qCWarning(lsmForeign) << "Exported (" << m_exported << " ) is already destroyed or surface (" << surface << ") is null";
         return;
     }
     auto qwlSurface = QWaylandSurface::fromResource(surface);
-    qInfo() << "webos_imported_attach_surface m_exportedItem: " << m_exported->m_exportedItem;
+    qCInfo(lsmForeign) << "webos_imported_attach_surface m_exportedItem: " << m_exported->m_exportedItem;
     m_childSurfaceItem = WebOSSurfaceItem::getSurfaceItemFromSurface(qwlSurface);
     if (!m_childSurfaceItem)
         return;
@@ -1754,15 +1875,16 @@ void WebOSImported::webos_imported_detach_surface(
         Resource * resource,
         struct ::  wl_resource *surface)
 {
-    qInfo() <<"detach_surface is called : " << surface << " on " << this;
+    qCInfo(lsmForeign) <<"detach_surface is called : " << surface << " on " << this;
 
     if (!m_childSurfaceItem || m_childSurfaceItem->surface()->resource() != surface) {
-        qWarning() << "surface is not the attached surface";
+        qCWarning(lsmForeign) << "surface is not the attached surface";
         return;
     }
 
     m_exported->setVideoPlaying(false);
     m_exported->setWideVideo(false);
+    m_exported->m_hasLastVideoRequest = false;
 
     if (m_importedType == WebOSForeign::WebOSExportedType::VideoObject)
         VideoOutputdCommunicator::instance()->setProperty("videoTexture", "off", NULL);
@@ -1780,7 +1902,7 @@ void WebOSImported::webos_imported_set_z_index(
 {
     if (m_z_index != z_index) {
         m_z_index = z_index;
-        qInfo() << "z_index of WebOSImported (" << this << " ) is changed to " << z_index;
+        qCInfo(lsmForeign) << "z_index of WebOSImported (" << this << " ) is changed to " << z_index;
     }
 }
 
@@ -1790,7 +1912,7 @@ void WebOSImported::webos_imported_set_surface_alignment(
 {
     if (m_textureAlign != (WebOSImported::surface_alignment)surface_alignment) {
         m_textureAlign = (WebOSImported::surface_alignment)surface_alignment;
-        qInfo() << "m_textureAlign of WebOSImported (" << this << " ) is changed to " << surface_alignment;
+        qCInfo(lsmForeign) << "m_textureAlign of WebOSImported (" << this << " ) is changed to " << surface_alignment;
         setSurfaceItemSize();
     }
 }
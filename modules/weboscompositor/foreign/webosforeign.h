@@ -17,6 +17,7 @@
 #ifndef WEBOSFOREIGN_H
 #define WEBOSFOREIGN_H
 
+#include <QHash>
 #include <QObject>
 #include <QQuickItem>
 #include <QtWaylandCompositor/private/qwayland-server-wayland.h>
@@ -53,6 +54,10 @@ public:
     WebOSForeign(WebOSCoreCompositor* compositor);
     void registeredWindow();
 
+    WebOSExported *exportedByWindowId(const QString &windowId) const { return m_exportedByWindowId.value(windowId); }
+    WebOSExported *exportedByHandle(quint32 handle) const { return m_exportedByHandle.value(handle); }
+    WebOSExported *exportedByContextId(const QString &contextId) const { return m_exportedByContextId.value(contextId); }
+
 protected:
     virtual WebOSExported* createExported(struct wl_client* client,
                                           uint32_t id, WebOSSurfaceItem* surfaceItem,
@@ -70,8 +75,15 @@ protected:
                                               const QString &window_id,
                                               uint32_t exported_type) override;
 
+    void registerExported(WebOSExported *exported);
+    void unregisterExported(WebOSExported *exported);
+
     WebOSCoreCompositor* m_compositor = nullptr;
-    QList<WebOSExported*> m_exportedList;
+    // Handle of the last export, the window id is derived from it
+    quint32 m_lastHandle = 0;
+    QHash<quint32, WebOSExported*> m_exportedByHandle;
+    QHash<QString, WebOSExported*> m_exportedByWindowId;
+    QHash<QString, WebOSExported*> m_exportedByContextId;
 
     friend class WebOSExported;
     friend class WebOSImported;
@@ -101,6 +113,9 @@ public:
     void setDestinationRegion(struct::wl_resource *destination_region);
     void setPunchThrough(bool needPunch);
     void assignWindowId(QString windowId);
+    quint32 handle() const { return m_handle; }
+    QString windowId() const { return m_windowId; }
+    QString contextId() const { return m_contextId; }
     void setParentOf(QQuickItem *surfaceItem, QQuickItem *childDisplay);
     void updateWindowType();
     void updateCoverState();
@@ -151,6 +166,9 @@ private slots:
     void updateVisible();
     void updateWindowState();
     void calculateAll();
+    void scheduleCalculateAll();
+    void flushPendingGeometry();
+    void flushPendingVideoRequest();
     void onSurfaceDestroyed();
     void updateCompositorWindow(QQuickWindow *window);
 
@@ -160,6 +178,7 @@ protected:
     void calculateExportedItemRatio();
     void updateExportedItemSize();
     WebOSSurfaceItem *getImportedItem();
+    void setContextId(const QString &contextId);
 
     WebOSForeign* m_foreign = nullptr;
     WebOSCompositorWindow* m_compositorWindow = nullptr;
@@ -174,6 +193,7 @@ protected:
     QRect m_originalRequestedRegion;
     QRect m_requestedRegion;
     QRect m_videoDisplayRect;
+    quint32 m_handle = 0;
     QString m_windowId;
     QString m_contextId;
     QString m_muteRegisteredContextId;
@@ -196,6 +216,25 @@ protected:
     QPoint m_surfaceGlobalPosition = QPoint(0,0);
     bool m_fullscreenByApp = false;
 
+    // Last setDisplayWindow or setCropRegion request, to drop duplicates
+    struct VideoDisplayRequest {
+        bool crop = false;
+        QRect inputRect;
+        QRect sourceRect;
+        QRect displayRect;
+        QRect appOutput;
+        QString contextId;
+        bool operator==(const VideoDisplayRequest &other) const;
+    };
+    void submitVideoDisplayRequest(const VideoDisplayRequest &request);
+    void sendVideoDisplayRequest(const VideoDisplayRequest &request);
+
+    bool m_geometryDirty = false;
+    bool m_hasLastVideoRequest = false;
+    VideoDisplayRequest m_lastVideoRequest;
+    bool m_hasPendingVideoRequest = false;
+    VideoDisplayRequest m_pendingVideoRequest;
+
     friend class WebOSForeign;
     friend class WebOSImported;
 };
@@ -1,4 +1,4 @@
- # Copyright (c) 2018-2020 LG Electronics, Inc.
+ # Copyright (c) 2018-2024 LG Electronics, Inc.
 #
 # Licensed under the Apache License, Version 2.0 (the "License");
 # you may not use this file except in compliance with the License.
@@ -22,12 +22,14 @@ WAYLANDSERVERSOURCES += $$[QT_INSTALL_DATA]/wayland-webos/webos-foreign.xml
 SOURCES += \
     $$PWD/webosforeign.cpp \
     $$PWD/videooutputd_communicator.cpp \
+    $$PWD/videooutputd_transport.cpp \
     $$PWD/videowindow_informer.cpp
 
 HEADERS += \
     $$PWD/webosforeign.h \
     $$PWD/punchthroughelement.h \
     $$PWD/videooutputd_communicator.h \
+    $$PWD/videooutputd_transport.h \
     $$PWD/videowindow_informer.h
 
 INCLUDEPATH += $$PWD/../
@@ -0,0 +1,173 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <QDebug>
+
+#include "frametimingstats.h"
+
+FrameTimingStats::FrameTimingStats()
+{
+    reset();
+}
+
+void FrameTimingStats::reset()
+{
+    m_head.store(0, std::memory_order_relaxed);
+    m_frames.store(0, std::memory_order_relaxed);
+    m_missed.store(0, std::memory_order_relaxed);
+    for (int m = 0; m < MetricCount; m++) {
+        m_max[m].store(0, std::memory_order_relaxed);
+        for (int i = 0; i < BUCKETS; i++)
+            m_buckets[m][i].store(0, std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+int FrameTimingStats::bucketIndex(quint32 value)
+{
+    if (value < SUB_BUCKETS)
+        return value;
+
+    // Position of the highest bit decides the range,
+    // the next SUB_BUCKET_BITS bits decide the sub-bucket in it.
+    int msb = 31 - __builtin_clz(value);
+    int shift = msb - SUB_BUCKET_BITS;
+    int sub = (value >> shift) & (SUB_BUCKETS - 1);
+    return (shift + 1) * SUB_BUCKETS + sub;
+}
+
+quint32 FrameTimingStats::bucketValue(int index)
+{
+    if (index < SUB_BUCKETS)
+        return index;
+
+    int shift = index / SUB_BUCKETS - 1;
+    int sub = index % SUB_BUCKETS;
+    // Upper bound of the bucket
+    return (((quint32) (SUB_BUCKETS + sub + 1)) << shift) - 1;
+}
+
+void FrameTimingStats::addFrame(const quint32 (&time)[MetricCount], bool missed)
+{
+    quint32 seq = m_frames.load(std::memory_order_relaxed) + 1;
+    quint32 head = m_head.load(std::memory_order_relaxed);
+
+    FrameRecord &record = m_ring[head % RING_SIZE];
+    record.sequence = seq;
+    record.missed = missed;
+    for (int m = 0; m < MetricCount; m++) {
+        record.time[m] = time[m];
+        m_buckets[m][bucketIndex(time[m])].fetch_add(1, std::memory_order_relaxed);
+        if (time[m] > m_max[m].load(std::memory_order_relaxed))
+            m_max[m].store(time[m], std::memory_order_relaxed);
+    }
+
+    if (missed)
+        m_missed.fetch_add(1, std::memory_order_relaxed);
+
+    m_head.store(head + 1, std::memory_order_release);
+    m_frames.store(seq, std::memory_order_release);
+}
+
+quint32 FrameTimingStats::percentile(Metric metric, double percent) const
+{
+    quint64 total = 0;
+    quint32 counts[BUCKETS];
+    for (int i = 0; i < BUCKETS; i++) {
+        counts[i] = m_buckets[metric][i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    if (total == 0)
+        return 0;
+
+    quint64 target = qMax<quint64>(1, (quint64) (total * percent / 100.0 + 0.5));
+    quint64 count = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        count += counts[i];
+        if (count >= target)
+            return qMin(bucketValue(i), maximum(metric));
+    }
+
+    return maximum(metric);
+}
+
+QList<FrameTimingStats::FrameRecord> FrameTimingStats::recentFrames() const
+{
+    QList<FrameRecord> records;
+    quint32 head = m_head.load(std::memory_order_acquire);
+    quint32 count = qMin<quint32>(head, RING_SIZE);
+
+    for (quint32 i = head - count; i != head; i++) {
+        FrameRecord record = m_ring[i % RING_SIZE];
+        // Overwritten by the writer while copying
+        if (m_head.load(std::memory_order_acquire) - i > RING_SIZE)
+            continue;
+        records << record;
+    }
+
+    return records;
+}
+
+const char *FrameTimingStats::metricName(Metric metric)
+{
+    switch (metric) {
+    case DamageToFrameCallback:
+        return "damageToFrameCallback";
+    case UpdateRequestToSwap:
+        return "updateRequestToSwap";
+    case SwapToPageFlip:
+        return "swapToPageFlip";
+    default:
+        return "unknown";
+    }
+}
+
+QVariantMap FrameTimingStats::toVariantMap() const
+{
+    QVariantMap map;
+    map[QStringLiteral("frames")] = frames();
+    map[QStringLiteral("missedFrames")] = missedFrames();
+
+    for (int m = 0; m < MetricCount; m++) {
+        Metric metric = static_cast<Metric>(m);
+        QVariantMap values;
+        values[QStringLiteral("p50")] = percentile(metric, 50);
+        values[QStringLiteral("p95")] = percentile(metric, 95);
+        values[QStringLiteral("p99")] = percentile(metric, 99);
+        values[QStringLiteral("max")] = maximum(metric);
+        map[QLatin1String(metricName(metric))] = values;
+    }
+
+    return map;
+}
+
+void FrameTimingStats::dump(const QString &name) const
+{
+    qInfo() << "=== FrameTimingStats BEGIN" << name << "===";
+    qInfo() << "frames:" << frames() << "missed:" << missedFrames();
+    for (int m = 0; m < MetricCount; m++) {
+        Metric metric = static_cast<Metric>(m);
+        qInfo() << metricName(metric) << "p50:" << percentile(metric, 50) << "p95:" << percentile(metric, 95)
+                << "p99:" << percentile(metric, 99) << "max:" << maximum(metric) << "us";
+    }
+
+    const QList<FrameRecord> records = recentFrames();
+    for (const FrameRecord &r : records)
+        qInfo() << "frame" << r.sequence << r.time[DamageToFrameCallback] << r.time[UpdateRequestToSwap]
+                << r.time[SwapToPageFlip] << "us" << (r.missed ? "missed" : "");
+    qInfo() << "=== FrameTimingStats END" << name << "===";
+}
@@ -0,0 +1,84 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef FRAMETIMINGSTATS_H
+#define FRAMETIMINGSTATS_H
+
+#include <WebOSCoreCompositor/weboscompositorexport.h>
+
+#include <QVariantMap>
+
+#include <atomic>
+
+/* Keeps per-frame timing records of a window in a fixed ring and
+   aggregates them into log-linear histograms for percentiles.
+   Records are written by one thread and can be read by any other
+   without locking. All times are in microseconds. */
+class WEBOS_COMPOSITOR_EXPORT FrameTimingStats
+{
+public:
+    enum Metric {
+        DamageToFrameCallback = 0,
+        UpdateRequestToSwap,
+        SwapToPageFlip,
+        MetricCount
+    };
+
+    struct FrameRecord {
+        quint32 sequence = 0;
+        quint32 time[MetricCount] = {};
+        bool missed = false;
+    };
+
+    FrameTimingStats();
+
+    void addFrame(const quint32 (&time)[MetricCount], bool missed);
+    void reset();
+
+    quint32 frames() const { return m_frames.load(std::memory_order_acquire); }
+    quint32 missedFrames() const { return m_missed.load(std::memory_order_acquire); }
+    quint32 percentile(Metric metric, double percent) const;
+    quint32 maximum(Metric metric) const { return m_max[metric].load(std::memory_order_relaxed); }
+
+    // Up to RING_SIZE of the most recent records, oldest first
+    QList<FrameRecord> recentFrames() const;
+
+    QVariantMap toVariantMap() const;
+    void dump(const QString &name) const;
+
+    static const char *metricName(Metric metric);
+
+    static constexpr int RING_SIZE = 256;
+
+private:
+    static int bucketIndex(quint32 value);
+    static quint32 bucketValue(int index);
+
+    // 16 linear sub-buckets for each power of two, ~6% precision
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int BUCKETS = (32 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    FrameRecord m_ring[RING_SIZE];
+    std::atomic<quint32> m_head;
+
+    std::atomic<quint32> m_frames;
+    std::atomic<quint32> m_missed;
+    std::atomic<quint32> m_max[MetricCount];
+    std::atomic<quint32> m_buckets[MetricCount][BUCKETS];
+};
+
+#endif // FRAMETIMINGSTATS_H
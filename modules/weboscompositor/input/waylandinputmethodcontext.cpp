@@ -231,14 +231,9 @@ void WaylandInputMethodContext::updateModifiers()
     Q_ASSERT(m_keyboard);
     if (m_grabResource) {
 #if QT_CONFIG(xkbcommon)
-        auto xkb_state = m_keyboard->xkbState();
-        auto modsDepressed = xkb_state_serialize_mods(xkb_state, (xkb_state_component)XKB_STATE_MODS_DEPRESSED);
-        auto modsLatched   = xkb_state_serialize_mods(xkb_state, (xkb_state_component)XKB_STATE_MODS_LATCHED);
-        auto modsLocked    = xkb_state_serialize_mods(xkb_state, (xkb_state_component)XKB_STATE_MODS_LOCKED);
-        auto group         = xkb_state_serialize_group(xkb_state, (xkb_state_component)XKB_STATE_EFFECTIVE);
-
-        xkb_state_update_mask(xkb_state, modsDepressed, modsLatched, modsLocked, 0, 0, group);
-        modifiers(m_inputMethod->compositor()->nextSerial(), modsDepressed, modsLatched, modsLocked, group);
+        // Keyboards share one modifier state, see WebOSModifierState
+        const WebOSModifierState &mods = static_cast<WebOSKeyboard *>(m_keyboardPublic)->modifierState();
+        modifiers(m_inputMethod->compositor()->nextSerial(), mods.depressed, mods.latched, mods.locked, mods.group);
 #endif
     }
 }
@@ -14,17 +14,77 @@
 //
 // SPDX-License-Identifier: Apache-2.0
 
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QScreen>
+#include <QSharedPointer>
+
+#include <time.h>
+
 #include "weboscompositorwindow.h"
 #include "weboscorecompositor.h"
 #include "webossurfaceitem.h"
 
 #include "profiler.h"
 
+// A phase is reported as a regression if it is slower than the baseline
+// by both of these
+static const qint64 REGRESSION_MIN_US = 5000;
+static const int REGRESSION_PERCENT = 10;
+
+Profiler *Profiler::s_instance = nullptr;
+
+Profiler::Span::Span(const char *name, const QString &detail)
+    : m_open(Profiler::instance())
+{
+    if (m_open)
+        Profiler::instance()->beginSpan(name, detail);
+}
+
+Profiler::Span::~Span()
+{
+    if (m_open && Profiler::instance())
+        Profiler::instance()->endSpan();
+}
+
 Profiler::Profiler()
+    : m_startNs(now())
+{
+    if (!s_instance)
+        s_instance = this;
+    m_traceQmlCompile = qgetenv("WEBOS_COMPOSITOR_BOOT_TRACE_QML_COMPILE").toInt() == 1;
+    loadBaseline();
+}
+
+Profiler::~Profiler()
+{
+    if (s_instance == this)
+        s_instance = nullptr;
+}
+
+Profiler *Profiler::instance()
 {
-    m_lsmReady.start();
-    m_eventLoopReady.start();
-    m_firstAppMapped.start();
+    return s_instance;
+}
+
+qint64 Profiler::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+QString Profiler::key(const Event &event)
+{
+    QString key = QString::fromLatin1(event.name);
+    if (!event.detail.isEmpty())
+        key += QLatin1Char('/') + event.detail;
+    return key;
 }
 
 void Profiler::init(WebOSCoreCompositor *compositor, WebOSCompositorWindow *window)
@@ -33,23 +93,189 @@ void Profiler::init(WebOSCoreCompositor *compositor, WebOSCompositorWindow *wind
     QObject::connect(compositor, &WebOSCoreCompositor::eventLoopReady, this, &Profiler::handleEventloopReady,
         Qt::QueuedConnection);
     QObject::connect(compositor, &WebOSCoreCompositor::surfaceMapped, this, &Profiler::handleFirstAppMapped);
+
+    if (window)
+        addWindow(window);
+}
+
+void Profiler::addWindow(WebOSCompositorWindow *window)
+{
+    const QString output = window->screen() ? window->screen()->name() : QString();
+
+    // frameSwapped comes from the render thread, so take the time there
+    // and record it on the main thread. The connection goes with the slot,
+    // also if the window never swaps.
+    QSharedPointer<QMetaObject::Connection> connection(new QMetaObject::Connection);
+    *connection = QObject::connect(window, &QQuickWindow::frameSwapped, this, [this, output, connection] () {
+        if (!QObject::disconnect(*connection))
+            return;
+        const qint64 swappedNs = now();
+        QMetaObject::invokeMethod(this, [this, output, swappedNs] () {
+            recordFirstFrame(output, swappedNs);
+        }, Qt::QueuedConnection);
+    }, Qt::DirectConnection);
+}
+
+void Profiler::beginSpan(const char *name, const QString &detail)
+{
+    Event event = { name, detail, now(), -1, false };
+    m_openSpans.append(m_events.size());
+    m_events.append(event);
+}
+
+void Profiler::endSpan()
+{
+    if (m_openSpans.isEmpty()) {
+        qWarning() << "Profiler: no span to end";
+        return;
+    }
+
+    Event &event = m_events[m_openSpans.takeLast()];
+    event.durationNs = now() - event.startNs;
+    compareWithBaseline(event);
+}
+
+void Profiler::mark(const char *name, const QString &detail)
+{
+    Event event = { name, detail, now(), -1, true };
+    m_events.append(event);
+    compareWithBaseline(event);
+}
+
+void Profiler::recordFirstFrame(const QString &output, qint64 swappedNs)
+{
+    qInfo() << "first-frame-swapped takes" << (swappedNs - m_startNs) / 1000000 << "ms on" << output;
+
+    // Spans the whole boot up to the swap, so it compares as a duration
+    Event event = { "first-frame-swapped", output, m_startNs, swappedNs - m_startNs, false };
+    m_events.append(event);
+    compareWithBaseline(event);
+
+    if (m_eventLoopReady)
+        writeTrace();
+}
+
+void Profiler::loadBaseline()
+{
+    const QString path = QString::fromLocal8Bit(qgetenv("WEBOS_COMPOSITOR_BOOT_BASELINE"));
+    if (path.isEmpty())
+        return;
+
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly)) {
+        qWarning() << "Profiler: could not read the baseline" << path << file.errorString();
+        return;
+    }
+
+    const QJsonArray events = QJsonDocument::fromJson(file.readAll()).object().value(QStringLiteral("traceEvents")).toArray();
+    for (const QJsonValue &value : events) {
+        const QJsonObject event = value.toObject();
+        const QJsonObject args = event.value(QStringLiteral("args")).toObject();
+        QString key = event.value(QStringLiteral("name")).toString();
+        const QString detail = args.value(QStringLiteral("detail")).toString();
+        if (!detail.isEmpty())
+            key += QLatin1Char('/') + detail;
+
+        if (event.value(QStringLiteral("ph")).toString() == QLatin1String("X"))
+            m_baseline.insert(key, event.value(QStringLiteral("dur")).toVariant().toLongLong());
+        else if (event.value(QStringLiteral("ph")).toString() == QLatin1String("i"))
+            m_baseline.insert(key, args.value(QStringLiteral("sinceStart")).toVariant().toLongLong());
+    }
+    qInfo() << "Profiler: comparing with the baseline" << path << "of" << m_baseline.size() << "phases";
+}
+
+void Profiler::compareWithBaseline(const Event &event)
+{
+    if (m_baseline.isEmpty())
+        return;
+
+    const QString phase = key(event);
+    QHash<QString, qint64>::const_iterator it = m_baseline.constFind(phase);
+    if (it == m_baseline.constEnd())
+        return;
+
+    const qint64 us = (event.isMark ? event.startNs - m_startNs : event.durationNs) / 1000;
+    const qint64 deltaUs = us - it.value();
+    if (deltaUs > REGRESSION_MIN_US && deltaUs * 100 > it.value() * REGRESSION_PERCENT)
+        qWarning() << "Boot phase" << phase << "takes" << us / 1000.0 << "ms, baseline" << it.value() / 1000.0 << "ms";
+    else
+        qInfo() << "Boot phase" << phase << "takes" << us / 1000.0 << "ms, baseline" << it.value() / 1000.0 << "ms";
+}
+
+bool Profiler::writeTrace()
+{
+    const QByteArray runtimeDir = qgetenv("XDG_RUNTIME_DIR");
+    if (runtimeDir.isEmpty()) {
+        qWarning() << "Profiler: XDG_RUNTIME_DIR is not set, no boot trace is written";
+        return false;
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray traceEvents;
+    for (const Event &event : m_events) {
+        // Still open, there is nothing to compare it with
+        if (!event.isMark && event.durationNs < 0)
+            continue;
+
+        QJsonObject args;
+        if (!event.detail.isEmpty())
+            args.insert(QStringLiteral("detail"), event.detail);
+
+        QJsonObject object;
+        object.insert(QStringLiteral("name"), QString::fromLatin1(event.name));
+        object.insert(QStringLiteral("cat"), QStringLiteral("boot"));
+        object.insert(QStringLiteral("pid"), pid);
+        object.insert(QStringLiteral("tid"), pid);
+        object.insert(QStringLiteral("ts"), event.startNs / 1000);
+        if (event.isMark) {
+            object.insert(QStringLiteral("ph"), QStringLiteral("i"));
+            object.insert(QStringLiteral("s"), QStringLiteral("p"));
+            args.insert(QStringLiteral("sinceStart"), (event.startNs - m_startNs) / 1000);
+        } else {
+            object.insert(QStringLiteral("ph"), QStringLiteral("X"));
+            object.insert(QStringLiteral("dur"), event.durationNs / 1000);
+        }
+        object.insert(QStringLiteral("args"), args);
+        traceEvents.append(object);
+    }
+
+    QJsonObject root;
+    root.insert(QStringLiteral("traceEvents"), traceEvents);
+    root.insert(QStringLiteral("displayTimeUnit"), QStringLiteral("ms"));
+
+    QSaveFile file(QString("%1/surface-manager.boottrace.json").arg(runtimeDir.constData()));
+    if (!file.open(QFile::WriteOnly) || file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) < 0 || !file.commit()) {
+        qWarning() << "Profiler: could not write the boot trace:" << file.errorString();
+        return false;
+    }
+    return true;
 }
 
 void Profiler::handleLSMReady()
 {
-    qInfo() << "lsm-ready takes" << m_lsmReady.elapsed() << "ms";
+    qInfo() << "lsm-ready takes" << (now() - m_startNs) / 1000000 << "ms";
+    mark("lsm-ready");
 }
 
 void Profiler::handleEventloopReady()
 {
-    qInfo() << "event-loop-ready takes" << m_eventLoopReady.elapsed() << "ms";
+    qInfo() << "event-loop-ready takes" << (now() - m_startNs) / 1000000 << "ms";
+    mark("event-loop-ready");
+
+    // Later phases rewrite the trace as they complete
+    m_eventLoopReady = true;
+    writeTrace();
 }
 
 void Profiler::handleFirstAppMapped(WebOSSurfaceItem *item)
 {
     WebOSCoreCompositor *compositor = qobject_cast<WebOSCoreCompositor *>(sender());
 
-    qInfo() << "first-app-mapped takes" << m_firstAppMapped.elapsed() << "ms appId =" << item->appId() << "pid =" << item->processId();
+    qInfo() << "first-app-mapped takes" << (now() - m_startNs) / 1000000 << "ms appId =" << item->appId() << "pid =" << item->processId();
+    mark("first-app-mapped");
 
     QObject::disconnect(compositor, &WebOSCoreCompositor::surfaceMapped, this, &Profiler::handleFirstAppMapped);
+
+    if (m_eventLoopReady)
+        writeTrace();
 }
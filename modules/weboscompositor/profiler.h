@@ -18,7 +18,9 @@
 #define PROFILER_H
 
 #include <QObject>
-#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QVector>
 
 #include "weboscompositorexport.h"
 
@@ -26,12 +28,45 @@ class WebOSCoreCompositor;
 class WebOSCompositorWindow;
 class WebOSSurfaceItem;
 
+/* Boot timeline of the surface manager.
+   Phases are recorded as nested spans on the main thread, with
+   CLOCK_MONOTONIC timestamps, and written as a Chrome trace to
+   $XDG_RUNTIME_DIR/surface-manager.boottrace.json. If
+   WEBOS_COMPOSITOR_BOOT_BASELINE names such a trace from an earlier
+   boot, every phase is compared against it as it completes.
+
+   WEBOS_COMPOSITOR_BOOT_TRACE_QML_COMPILE=1 additionally splits the
+   loading of the main QML into compile and instantiation. This compiles
+   it once more ahead of setSource, so it is off by default. */
 class WEBOS_COMPOSITOR_EXPORT Profiler : public QObject
 {
     Q_OBJECT
 public:
+    // Span for the enclosing scope, a no-op without a Profiler
+    class Span {
+    public:
+        explicit Span(const char *name, const QString &detail = QString());
+        ~Span();
+    private:
+        Q_DISABLE_COPY(Span)
+        bool m_open;
+    };
+
     Profiler();
+    ~Profiler();
+    static Profiler *instance();
+
     void init(WebOSCoreCompositor *compositor, WebOSCompositorWindow *window);
+    // Records when the window swaps its first frame
+    void addWindow(WebOSCompositorWindow *window);
+
+    void beginSpan(const char *name, const QString &detail = QString());
+    void endSpan();
+    void mark(const char *name, const QString &detail = QString());
+
+    bool traceQmlCompile() const { return m_traceQmlCompile; }
+
+    bool writeTrace();
 
 public slots:
     void handleLSMReady();
@@ -39,9 +74,31 @@ public slots:
     void handleFirstAppMapped(WebOSSurfaceItem *item);
 
 private:
-    QElapsedTimer m_lsmReady;
-    QElapsedTimer m_eventLoopReady;
-    QElapsedTimer m_firstAppMapped;
+    struct Event {
+        const char *name;
+        QString detail;
+        qint64 startNs;
+        // -1 while open, and for marks
+        qint64 durationNs;
+        bool isMark;
+    };
+
+    static qint64 now();
+    static QString key(const Event &event);
+    void loadBaseline();
+    void compareWithBaseline(const Event &event);
+    void recordFirstFrame(const QString &output, qint64 swappedNs);
+
+    static Profiler *s_instance;
+
+    qint64 m_startNs;
+    QVector<Event> m_events;
+    // Indices of the open spans in m_events, innermost last
+    QVector<int> m_openSpans;
+    // Microseconds per phase of the baseline
+    QHash<QString, qint64> m_baseline;
+    bool m_eventLoopReady = false;
+    bool m_traceQmlCompile = false;
 };
 
 #endif
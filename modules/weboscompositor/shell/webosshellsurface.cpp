@@ -1,4 +1,4 @@
-// Copyright (c) 2013-2021 LG Electronics, Inc.
+// Copyright (c) 2013-2024 LG Electronics, Inc.
 //
 // Licensed under the Apache License, Version 2.0 (the "License");
 // you may not use this file except in compliance with the License.
@@ -16,6 +16,7 @@
 
 #include "webosshellsurface.h"
 #include "weboscorecompositor.h"
+#include "weboscompositorlogging.h"
 
 #include <QDebug>
 #include <QWaylandCompositor>
@@ -70,7 +71,7 @@ void WebOSShell::get_shell_surface(struct wl_client *client, struct wl_resource
     WebOSShell* that = static_cast<WebOSShell *>(shell_resource->data);
     QWaylandSurface* surface = QWaylandSurface::fromResource(owner);
     if (surface == nullptr) {
-        qWarning()  << "[QWaylandSurface] Invalid pointer, "
+        qCWarning(lsmShell)  << "[QWaylandSurface] Invalid pointer, "
                     << "client :" << (client ? client : nullptr)
                     << "shell_resource :" << (shell_resource ? shell_resource : nullptr)
                     << "id :" << id
@@ -80,7 +81,7 @@ void WebOSShell::get_shell_surface(struct wl_client *client, struct wl_resource
 
     WebOSSurfaceItem* item = WebOSSurfaceItem::getSurfaceItemFromSurface(surface);
     if (item == nullptr) {
-        qWarning()  << "[WebOSSurfaceItem] Invalid pointer, "
+        qCWarning(lsmShell)  << "[WebOSSurfaceItem] Invalid pointer, "
                     << "surface :" << surface
                     << "client :" << (client ? client : nullptr)
                     << "shell_resource :" << (shell_resource ? shell_resource : nullptr)
@@ -89,7 +90,7 @@ void WebOSShell::get_shell_surface(struct wl_client *client, struct wl_resource
         return;
     }
 
-    qDebug() << surface << item;
+    qCDebug(lsmShell) << surface << item;
 
     new WebOSShellSurface(client, id, item, owner, that->getVersion(client));
 }
@@ -107,12 +108,12 @@ void WebOSShell::registerSurfaceChange(QWaylandSurface* prev, QWaylandSurface* c
     Q_UNUSED(current);
 
     if (prev == nullptr || current == nullptr) {
-      qWarning()  << "[QWaylandSurface] Invalid pointer, "
+      qCWarning(lsmShell)  << "[QWaylandSurface] Invalid pointer, "
                   << "prev :" << (prev ? prev : nullptr)
                   << "current :" << (current ? current : nullptr);
     }
 
-    qDebug()  << "prev :" << (prev ? prev : nullptr)
+    qCDebug(lsmShell)  << "prev :" << (prev ? prev : nullptr)
               << "current :" << (current ? current : nullptr);
 
     m_previousFullscreenSurface = prev;
@@ -142,9 +143,9 @@ WebOSShellSurface::WebOSShellSurface(struct wl_client* client, uint32_t id, WebO
         m_shellSurface->destroy = WebOSShellSurface::destroyShellSurface;
 
         surface->setShellSurface(this);
-        qDebug() << this << "for wl_surface@" << m_owner->object.id << "m_shellSurface:" << m_shellSurface;
+        qCDebug(lsmShell) << this << "for wl_surface@" << m_owner->object.id << "m_shellSurface:" << m_shellSurface;
     } else {
-        qWarning()  << "[wl_resource] Invalid pointer, "
+        qCWarning(lsmShell)  << "[wl_resource] Invalid pointer, "
                     << "client :" << (client ? client : nullptr)
                     << "id :" << id
                     << "surface :" << (surface ? surface : nullptr)
@@ -156,28 +157,28 @@ WebOSShellSurface::~WebOSShellSurface()
 {
     m_surface->resetShellSurface(this);
     if (m_shellSurface != nullptr) {
-        qDebug() << this << "m_shellSurface:" << m_shellSurface;
+        qCDebug(lsmShell) << this << "m_shellSurface:" << m_shellSurface;
         wl_resource_destroy(m_shellSurface);
     } else {
-        qWarning() << "[wl_resource] Invalid pointer";
+        qCWarning(lsmShell) << "[wl_resource] Invalid pointer";
     }
 }
 
 void WebOSShellSurface::destroyShellSurface(struct wl_resource* resource)
 {
     if (resource == nullptr) {
-        qWarning()  << "[wl_resource] Invalid pointer";
+        qCWarning(lsmShell)  << "[wl_resource] Invalid pointer";
         return;
     }
 
     WebOSShellSurface* that = static_cast<WebOSShellSurface *>(resource->data);
     if (that == nullptr) {
-        qWarning()  << "[WebOSShellSurface] Invalid pointer, "
+        qCWarning(lsmShell)  << "[WebOSShellSurface] Invalid pointer, "
                     << "resource :" << resource;
         return;
     }
 
-    qDebug() << that << "for resource" << resource << "m_shellSurface:" << that->m_shellSurface;
+    qCDebug(lsmShell) << that << "for resource" << resource << "m_shellSurface:" << that->m_shellSurface;
     that->m_shellSurface = NULL;
 }
 
@@ -206,7 +207,7 @@ static Qt::WindowState qtWindowStateFromWaylandState(uint32_t state)
 void WebOSShellSurface::prepareState(Qt::WindowState state)
 {
     if (m_shellSurface && m_state != state) {
-        qDebug() << m_surface << "m_preparedState" << m_preparedState << "->" << state;
+        qCDebug(lsmShell) << m_surface << "m_preparedState" << m_preparedState << "->" << state;
         m_preparedState = state;
         wl_webos_shell_surface_send_state_about_to_change(m_shellSurface, waylandStateFromQtWindowState(state));
     }
@@ -215,7 +216,7 @@ void WebOSShellSurface::prepareState(Qt::WindowState state)
 void WebOSShellSurface::setState(Qt::WindowState state)
 {
     if (m_shellSurface && (m_state != state || m_preparedState != Qt::WindowNoState)) {
-        qDebug() << m_surface << "m_state" << m_state << "->" << state;
+        qCDebug(lsmShell) << m_surface << "m_state" << m_state << "->" << state;
         m_state = state;
         m_preparedState = Qt::WindowNoState;
         wl_webos_shell_surface_send_state_changed(m_shellSurface, waylandStateFromQtWindowState(state));
@@ -226,7 +227,7 @@ void WebOSShellSurface::set_location_hint(struct wl_client *client, struct wl_re
 {
     Q_UNUSED(client);
     if (resource == nullptr) {
-        qWarning()  << "[wl_resource] Invalid pointer, "
+        qCWarning(lsmShell)  << "[wl_resource] Invalid pointer, "
                     << "client :" << (client ? client : nullptr)
                     << "hint :" << hint;
         return;
@@ -235,7 +236,7 @@ void WebOSShellSurface::set_location_hint(struct wl_client *client, struct wl_re
     WebOSSurfaceItem::LocationHints newHint = (WebOSSurfaceItem::LocationHints)hint;
     WebOSShellSurface* that = static_cast<WebOSShellSurface*>(resource->data);
     if (that == nullptr) {
-        qWarning()  << "[WebOSShellSurface] Invalid pointer, "
+        qCWarning(lsmShell)  << "[WebOSShellSurface] Invalid pointer, "
                     << "client :" << (client ? client : nullptr)
                     << "resource :" << resource
                     << "hint :" << hint;
@@ -244,7 +245,7 @@ void WebOSShellSurface::set_location_hint(struct wl_client *client, struct wl_re
 
     if (that->m_locationHint != newHint) {
         that->m_locationHint = newHint;
-        qDebug() << "changed" << that->m_locationHint;
+        qCDebug(lsmShell) << "changed" << that->m_locationHint;
         emit that->locationHintChanged();
     }
 }
@@ -253,7 +254,7 @@ void WebOSShellSurface::set_key_mask(struct wl_client *client, struct wl_resourc
 {
     Q_UNUSED(client);
     if (resource == nullptr) {
-        qWarning()  << "[wl_resource] Invalid pointer, "
+        qCWarning(lsmShell)  << "[wl_resource] Invalid pointer, "
                     << "client :" << (client ? client : nullptr)
                     << "webos_key :" << webos_key;
         return;
@@ -262,7 +263,7 @@ void WebOSShellSurface::set_key_mask(struct wl_client *client, struct wl_resourc
     WebOSSurfaceItem::KeyMasks newKeyMasks = (WebOSSurfaceItem::KeyMasks)webos_key;
     WebOSShellSurface* that = static_cast<WebOSShellSurface*>(resource->data);
     if (that == nullptr) {
-        qWarning()  << "[WebOSShellSurface] Invalid pointer, "
+        qCWarning(lsmShell)  << "[WebOSShellSurface] Invalid pointer, "
                     << "client :" << (client ? client : nullptr)
                     << "resource :" << resource
                     << "webos_key :" << webos_key;
@@ -270,7 +271,7 @@ void WebOSShellSurface::set_key_mask(struct wl_client *client, struct wl_resourc
     }
 
     if (that->m_keyMask != newKeyMasks) {
-        qInfo() << "key mask changed. newKeyMasks = " << newKeyMasks << ", client : " << (client ? client : nullptr);
+        qCInfo(lsmShell) << "key mask changed. newKeyMasks = " << newKeyMasks << ", client : " << (client ? client : nullptr);
         that->m_keyMask = newKeyMasks;
         emit that->keyMaskChanged();
     }
@@ -280,7 +281,7 @@ void WebOSShellSurface::set_state(struct wl_client *client, struct wl_resource *
 {
     Q_UNUSED(client);
     if (resource == nullptr) {
-        qWarning()  << "[wl_resource] Invalid pointer, "
+        qCWarning(lsmShell)  << "[wl_resource] Invalid pointer, "
                     << "client :" << (client ? client : nullptr)
                     << "state :" << state;
         return;
@@ -289,7 +290,7 @@ void WebOSShellSurface::set_state(struct wl_client *client, struct wl_resource *
     Qt::WindowState newState = qtWindowStateFromWaylandState(state);
     WebOSShellSurface* that = static_cast<WebOSShellSurface*>(resource->data);
     if (that == nullptr) {
-        qWarning()  << "[WebOSShellSurface] Invalid pointer, "
+        qCWarning(lsmShell)  << "[WebOSShellSurface] Invalid pointer, "
                     << "client :" << (client ? client : nullptr)
                     << "resource :" << resource
                     << "state :" << state;
@@ -297,12 +298,12 @@ void WebOSShellSurface::set_state(struct wl_client *client, struct wl_resource *
     }
 
     if (!that->m_surface->isMapped()) {
-        qWarning() << "Ignored for unmapped surface" << that->m_surface << that << that->m_state << newState;
+        qCWarning(lsmShell) << "Ignored for unmapped surface" << that->m_surface << that << that->m_state << newState;
         return;
     }
 
     if (that->m_state != newState) {
-        qInfo() << "state change requested:" << that->m_state << "->" << newState
+        qCInfo(lsmShell) << "state change requested:" << that->m_state << "->" << newState
                      << that->m_surface << that->m_surface->appId();
         emit that->stateChangeRequested(newState);
     }
@@ -311,7 +312,7 @@ void WebOSShellSurface::set_state(struct wl_client *client, struct wl_resource *
 void WebOSShellSurface::close()
 {
     if (m_shellSurface) {
-        qDebug() << "m_shellSurface:" << m_shellSurface;
+        qCDebug(lsmShell) << "m_shellSurface:" << m_shellSurface;
         wl_webos_shell_surface_send_close(m_shellSurface);
     }
 }
@@ -347,7 +348,7 @@ void WebOSShellSurface::set_property(struct wl_client *client, struct wl_resourc
 {
     Q_UNUSED(client);
     if (resource == nullptr || name == nullptr || value == nullptr) {
-        qWarning()  << "[wl_resource] Invalid pointer, "
+        qCWarning(lsmShell)  << "[wl_resource] Invalid pointer, "
                     << "client :" << (client ? client : nullptr)
                     << "name :" << (name ? name : nullptr)
                     << "value :" << (value ? value : nullptr);
@@ -356,7 +357,7 @@ void WebOSShellSurface::set_property(struct wl_client *client, struct wl_resourc
 
     WebOSShellSurface* that = static_cast<WebOSShellSurface*>(resource->data);
     if (that == nullptr) {
-        qWarning()  << "[WebOSShellSurface] Invalid pointer, "
+        qCWarning(lsmShell)  << "[WebOSShellSurface] Invalid pointer, "
                     << "client :" << (client ? client : nullptr)
                     << "resource :" << resource
                     << "name :" << name
@@ -364,13 +365,14 @@ void WebOSShellSurface::set_property(struct wl_client *client, struct wl_resourc
         return;
     }
 
-    QString key = QString::fromLatin1(name);
-    QVariant newValue = QVariant(QString::fromUtf8(value));
+    const QString key = QString::fromLatin1(name);
+    const QVariant newValue = QVariant(QString::fromUtf8(value));
 
-    bool emitChange = that->property(key) != newValue;
-    qDebug() << "set property (" << QString::fromLatin1(name) << "," << QVariant(QString::fromUtf8(value)) << ")"
+    QVariantMap::const_iterator it = that->m_properties.constFind(key);
+    bool emitChange = it == that->m_properties.constEnd() ? !newValue.isNull() : it.value() != newValue;
+    qCDebug(lsmShell) << "set property (" << key << "," << newValue << ")"
                  << that->m_surface << that->m_surface->appId();
-    that->setProperty(QString::fromLatin1(name), QVariant(QString::fromUtf8(value)));
+    that->setProperty(key, newValue);
     if (emitChange)
         that->emitSurfaceConvenienceSignal(key);
 }
@@ -379,17 +381,15 @@ void WebOSShellSurface::emitSurfaceConvenienceSignal(const QString& key)
 {
     const QMetaObject* mo = m_surface->metaObject();
     if (mo == nullptr) {
-        qWarning()  << "[QMetaObject] Invalid pointer, "
+        qCWarning(lsmShell)  << "[QMetaObject] Invalid pointer, "
                     << "key :" << key;
         return;
     }
 
-    int propertyIndex = mo->indexOfProperty(key.toLatin1().data());
-    QMetaProperty property = mo->property(propertyIndex);
-    if (property.isValid() && property.hasNotifySignal()) {
-        QMetaMethod signal = property.notifySignal();
-        qDebug() << "emit" << signal.name();
-        signal.invoke(m_surface);
+    const WebOSSurfaceItem::WindowPropertyInfo *info = WebOSSurfaceItem::windowPropertyInfo(mo, key);
+    if (info && info->notifySignal.isValid()) {
+        qCDebug(lsmShell) << "emit" << info->notifySignal.name();
+        info->notifySignal.invoke(m_surface);
     }
 }
 
@@ -408,7 +408,7 @@ void WebOSShellSurface::exposed(const QRegion& region)
             addValue(r.width(), &rects);
             addValue(r.height(), &rects);
         } else {
-            qWarning() << "Skipping expose rect" << r;
+            qCWarning(lsmShell) << "Skipping expose rect" << r;
         }
     }
 
@@ -468,7 +468,7 @@ void WebOSShellSurface::set_addon(struct wl_client *client, struct wl_resource *
             that->setAddonStatus(WebOSSurfaceItem::AddonStatusDenied);
             return;
         }
-        qDebug() << "addon changed" << that->m_addon << "to" << newAddon;
+        qCDebug(lsmShell) << "addon changed" << that->m_addon << "to" << newAddon;
         that->m_addon = newAddon;
         emit that->addonChanged();
     }
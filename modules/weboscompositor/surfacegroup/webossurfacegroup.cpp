@@ -1,4 +1,4 @@
-// Copyright (c) 2014-2021 LG Electronics, Inc.
+// Copyright (c) 2014-2024 LG Electronics, Inc.
 //
 // Licensed under the Apache License, Version 2.0 (the "License");
 // you may not use this file except in compliance with the License.
@@ -25,7 +25,7 @@
 #include <QDebug>
 #include <QQmlPropertyMap>
 #include <QQmlEngine>
-#include <algorithm>
+#include <iterator>
 
 WebOSSurfaceGroup::WebOSSurfaceGroup()
     : QtWaylandServer::wl_webos_surface_group()
@@ -35,6 +35,7 @@ WebOSSurfaceGroup::WebOSSurfaceGroup()
     , m_keyboardFocusedSurface(0)
     , m_groupCompositor(0)
     , time(0)
+    , m_sequence(0)
     , m_useKeyIndex(false)
 {
 }
@@ -44,8 +45,7 @@ WebOSSurfaceGroup::~WebOSSurfaceGroup()
     qInfo("deleting group '%s'", qPrintable(m_name));
     removeAttachedItemsFromGroup();
     m_layers.clear();
-    m_zOrderedSurfaceLayoutInfoList.clear();
-    m_keyOrderedItems.clear();
+    clearOrderedItems();
 }
 
 void WebOSSurfaceGroup::webos_surface_group_bind_resource(Resource *resource)
@@ -66,8 +66,7 @@ void WebOSSurfaceGroup::webos_surface_group_destroy_resource(Resource *resource)
         if (m_root) {
             m_root->setSurfaceGroup(NULL);
             //m_root->disconnect(this);
-            m_zOrderedSurfaceLayoutInfoList.clear();
-            m_keyOrderedItems.clear();
+            clearOrderedItems();
         }
 
         m_owner = NULL;
@@ -188,7 +187,8 @@ void WebOSSurfaceGroup::webos_surface_group_attach(Resource *resource, struct ::
             addZOrderedSurfaceLayoutInfoList(item, l->layoutInfo());
             l->attach(item);
             item->setSurfaceGroup(this);
-            makeKeyOrderedItems();
+            if (l->keyIndex())
+                insertKeyOrderedItem(item, l->keyIndex());
         }
     } else {
         qWarning("Layer '%s' does not exist in group '%s'", qPrintable(layer_name), qPrintable(m_name));
@@ -271,7 +271,8 @@ void WebOSSurfaceGroup::removeFromGroup(WebOSSurfaceItem* item)
     // This will trigger the re-evaluation of the windowmodel
     item->setSurfaceGroup(NULL);
 
-    makeKeyOrderedItems();
+    if (item != m_root)
+        removeKeyOrderedItem(item);
 
     if (m_keyboardFocusedSurface == item) {
         if (m_root) {
@@ -326,8 +327,9 @@ void WebOSSurfaceGroup::removeSurfaceItem()
 void WebOSSurfaceGroup::removeLayer(const QString& name)
 {
     qInfo("Removing layer '%s' for group '%s'", qPrintable(name), qPrintable(m_name));
-    m_layers.take(name);
-    makeKeyOrderedItems();
+    WebOSSurfaceGroupLayer* l = m_layers.take(name);
+    if (l && l->attachedSurface() && l->attachedSurface() != m_root)
+        removeKeyOrderedItem(l->attachedSurface());
 }
 
 void WebOSSurfaceGroup::removeAttachedItemsFromGroup()
@@ -391,93 +393,76 @@ void WebOSSurfaceGroup::setRootItem(WebOSSurfaceItem* item)
 {
     qInfo() << "surface group(" << m_name << ") set root:" << item;
     if (m_root != item) {
+        if (m_root)
+            removeKeyOrderedItem(m_root);
         m_root = item;
         if (m_root) {
             QSharedPointer<QObject> li = QSharedPointer<QObject>(new QObject);
             addZOrderedSurfaceLayoutInfoList(m_root, li);
-            makeKeyOrderedItems();
+            insertKeyOrderedItem(m_root, 0);
         } else {
-            m_zOrderedSurfaceLayoutInfoList.clear();
-            m_keyOrderedItems.clear();
+            clearOrderedItems();
         }
     }
 }
 
-bool zOrderedLessThan(const QPair<WebOSSurfaceItem *, QSharedPointer<QObject> > pair1, const QPair<WebOSSurfaceItem *, QSharedPointer<QObject> > pair2)
+void WebOSSurfaceGroup::clearOrderedItems()
 {
-    return pair1.first->z() <  pair2.first->z();
+    m_zOrderedItems.clear();
+    m_zOrderInfo.clear();
+    m_keyOrderedItems.clear();
+    m_keyOrderedPositions.clear();
 }
 
 WebOSSurfaceItem* WebOSSurfaceGroup::nextZOrderedSurfaceGroupItem(WebOSSurfaceItem* currentItem)
 {
-    WebOSSurfaceItem* returnItem = NULL;
     if (currentItem) {
-        if (!m_zOrderedSurfaceLayoutInfoList.isEmpty()) {
-            for (int i = (m_zOrderedSurfaceLayoutInfoList.size() - 1) ; i >= 0 ; --i) {
-                if (m_zOrderedSurfaceLayoutInfoList[i].first == currentItem) {
-                    if (i > 0) {
-                        returnItem = qobject_cast<WebOSSurfaceItem *>(m_zOrderedSurfaceLayoutInfoList[i - 1].first);
-                        break;
-                    }
-                }
-            }
-        }
+        auto it = m_zOrderInfo.constFind(currentItem);
+        if (it != m_zOrderInfo.constEnd() && it->position != m_zOrderedItems.begin())
+            return std::prev(it->position)->second;
     }
-    return returnItem;
+    return NULL;
 }
 
 void WebOSSurfaceGroup::addZOrderedSurfaceLayoutInfoList(WebOSSurfaceItem* item, QSharedPointer<QObject> layoutInfo)
 {
     if (item && layoutInfo) {
+        auto it = m_zOrderInfo.find(item);
+        if (it != m_zOrderInfo.end()) {
+            it->layoutInfo = layoutInfo;
+            repositionZOrdered(item);
+            return;
+        }
 
-        m_zOrderedSurfaceLayoutInfoList.append(qMakePair(item, layoutInfo));
+        // After the items with the same z, as appending and sorting did
+        const quint64 sequence = m_sequence++;
+        const ZOrderMap::iterator position = m_zOrderedItems.emplace(std::make_pair(item->z(), sequence), item).first;
+        m_zOrderInfo.insert(item, ZOrderInfo{sequence, position, layoutInfo});
 
-        sortZOrderedSurfaceLayoutInfoList();
-        connect(item, SIGNAL(zChanged()), this, SLOT(sortZOrderedSurfaceLayoutInfoList()));
+        connect(item, SIGNAL(zChanged()), this, SLOT(handleItemZChanged()));
     }
 }
 
 void WebOSSurfaceGroup::removeZOrderedSurfaceLayoutInfoList(WebOSSurfaceItem* item)
 {
-    if (item && !m_zOrderedSurfaceLayoutInfoList.isEmpty()) {
-        for (int i = (m_zOrderedSurfaceLayoutInfoList.size() - 1) ; i >= 0 ; --i) {
-            if (m_zOrderedSurfaceLayoutInfoList[i].first == item) {
-                m_zOrderedSurfaceLayoutInfoList.removeAll(m_zOrderedSurfaceLayoutInfoList[i]);
-                disconnect(item, SIGNAL(zChanged()), this, SLOT(sortZOrderedSurfaceLayoutInfoList()));
-                sortZOrderedSurfaceLayoutInfoList();
-                break;
-            }
-        }
-    }
+    takeLayoutInfoFor(item);
 }
 
 QSharedPointer<QObject> WebOSSurfaceGroup::layoutInfoFor(WebOSSurfaceItem* item) const
 {
-    QSharedPointer<QObject> returnvalue;
-    if (item && !m_zOrderedSurfaceLayoutInfoList.isEmpty()) {
-        for (int i = (m_zOrderedSurfaceLayoutInfoList.size() - 1) ; i >= 0 ; --i) {
-            if (m_zOrderedSurfaceLayoutInfoList[i].first == item) {
-                returnvalue = m_zOrderedSurfaceLayoutInfoList[i].second;
-                break;
-            }
-        }
-    }
-    return returnvalue;
+    auto it = m_zOrderInfo.constFind(item);
+    return it != m_zOrderInfo.constEnd() ? it->layoutInfo : QSharedPointer<QObject>();
 }
 
 QSharedPointer<QObject> WebOSSurfaceGroup::takeLayoutInfoFor(WebOSSurfaceItem* item)
 {
     QSharedPointer<QObject> returnvalue;
-    if (item && !m_zOrderedSurfaceLayoutInfoList.isEmpty()) {
-        for (int i = (m_zOrderedSurfaceLayoutInfoList.size() - 1) ; i >= 0 ; --i) {
-            if (m_zOrderedSurfaceLayoutInfoList[i].first == item) {
-                returnvalue = m_zOrderedSurfaceLayoutInfoList[i].second;
-                m_zOrderedSurfaceLayoutInfoList.removeAll(m_zOrderedSurfaceLayoutInfoList[i]);
-                disconnect(item, SIGNAL(zChanged()), this, SLOT(sortZOrderedSurfaceLayoutInfoList()));
-                sortZOrderedSurfaceLayoutInfoList();
-                break;
-            }
-        }
+    auto it = m_zOrderInfo.find(item);
+    if (item && it != m_zOrderInfo.end()) {
+        returnvalue = it->layoutInfo;
+        m_zOrderedItems.erase(it->position);
+        m_zOrderInfo.erase(it);
+        disconnect(item, SIGNAL(zChanged()), this, SLOT(handleItemZChanged()));
     }
     return returnvalue;
 }
@@ -485,73 +470,95 @@ QSharedPointer<QObject> WebOSSurfaceGroup::takeLayoutInfoFor(WebOSSurfaceItem* i
 QList<WebOSSurfaceItem*> WebOSSurfaceGroup::attachedClientSurfaceItems()
 {
     QList<WebOSSurfaceItem*> returnvalue;
-    if (!m_zOrderedSurfaceLayoutInfoList.isEmpty()) {
-        for (int i = (m_zOrderedSurfaceLayoutInfoList.size() - 1) ; i >= 0 ; --i) {
-            if (m_zOrderedSurfaceLayoutInfoList[i].first != m_root) {
-                returnvalue.append(m_zOrderedSurfaceLayoutInfoList[i].first);
-            }
-        }
+    for (auto it = m_zOrderedItems.crbegin(); it != m_zOrderedItems.crend(); ++it) {
+        if (it->second != m_root)
+            returnvalue.append(it->second);
     }
     return returnvalue;
 }
 
+// Re-keys the item by its new z, O(log n) in the size of the group
+void WebOSSurfaceGroup::repositionZOrdered(WebOSSurfaceItem* item)
+{
+    auto it = m_zOrderInfo.find(item);
+    if (it == m_zOrderInfo.end())
+        return;
+
+    const qreal z = item->z();
+    if (it->position->first.first == z)
+        return;
+
+    m_zOrderedItems.erase(it->position);
+    it->position = m_zOrderedItems.emplace(std::make_pair(z, it->sequence), item).first;
+}
+
+void WebOSSurfaceGroup::handleItemZChanged()
+{
+    WebOSSurfaceItem* item = qobject_cast<WebOSSurfaceItem *>(sender());
+    if (item)
+        repositionZOrdered(item);
+}
+
 void WebOSSurfaceGroup::sortZOrderedSurfaceLayoutInfoList()
 {
-    if (!m_zOrderedSurfaceLayoutInfoList.isEmpty())
-        std::sort(m_zOrderedSurfaceLayoutInfoList.begin(), m_zOrderedSurfaceLayoutInfoList.end(), zOrderedLessThan);
+    const QList<WebOSSurfaceItem *> items = m_zOrderInfo.keys();
+    for (WebOSSurfaceItem *item : items)
+        repositionZOrdered(item);
 }
 
 bool WebOSSurfaceGroup::allowLayerKeyOrder() const
 {
-    if (m_allowAnonymous || !m_useKeyIndex || m_keyOrderedItems.isEmpty())
+    if (m_allowAnonymous || !m_useKeyIndex || m_keyOrderedItems.empty())
         return false;
     return true;
 }
 
-bool keyOrderedLessThan(const QPair<WebOSSurfaceItem *, int> pair1, const QPair<WebOSSurfaceItem *, int> pair2)
-{
-    return pair1.second <  pair2.second;
-}
-
+// Goes through insertKeyOrderedItem as attaching does, so that the
+// order does not depend on which of the two built it
 void WebOSSurfaceGroup::makeKeyOrderedItems()
 {
     m_keyOrderedItems.clear();
+    m_keyOrderedPositions.clear();
 
-    m_keyOrderedItems.append(qMakePair(m_root, 0));
+    if (m_root)
+        insertKeyOrderedItem(m_root, 0);
     foreach (WebOSSurfaceGroupLayer* l, m_layers.values()) {
-        if (l->keyIndex() && l->attachedSurface())
-            m_keyOrderedItems.append(qMakePair(l->attachedSurface(), l->keyIndex()));
-    }
-    if (!m_keyOrderedItems.isEmpty()) {
-        std::sort(m_keyOrderedItems.begin(), m_keyOrderedItems.end(), keyOrderedLessThan);
+        if (l->keyIndex() && l->attachedSurface() && l->attachedSurface() != m_root)
+            insertKeyOrderedItem(l->attachedSurface(), l->keyIndex());
     }
 }
 
+void WebOSSurfaceGroup::insertKeyOrderedItem(WebOSSurfaceItem* item, int keyIndex)
+{
+    removeKeyOrderedItem(item);
+
+    auto info = m_zOrderInfo.constFind(item);
+    const quint64 sequence = info != m_zOrderInfo.constEnd() ? info->sequence : m_sequence++;
+    m_keyOrderedPositions.insert(item, m_keyOrderedItems.emplace(std::make_pair(keyIndex, sequence), item).first);
+}
+
+void WebOSSurfaceGroup::removeKeyOrderedItem(WebOSSurfaceItem* item)
+{
+    auto it = m_keyOrderedPositions.find(item);
+    if (it == m_keyOrderedPositions.end())
+        return;
+
+    m_keyOrderedItems.erase(it.value());
+    m_keyOrderedPositions.erase(it);
+}
+
 WebOSSurfaceItem* WebOSSurfaceGroup::nextKeyOrderedSurfaceGroupItem(WebOSSurfaceItem* currentItem)
 {
-    WebOSSurfaceItem* returnItem = NULL;
-    int currentItemIndex = m_keyOrderedItems.size() - 1;
+    if (m_keyOrderedItems.empty())
+        return NULL;
 
-    if (currentItem) {
-        if (!m_keyOrderedItems.isEmpty()) {
-            for (int i = (m_keyOrderedItems.size() - 1) ; i >= 0 ; --i) {
-                if (m_keyOrderedItems[i].first == currentItem) {
-                    currentItemIndex = i;
-                    break;
-                }
-            }
-        }
-    }
+    // An item not in key order counts as the topmost one
+    auto it = m_keyOrderedPositions.constFind(currentItem);
+    KeyOrderMap::iterator position = it != m_keyOrderedPositions.constEnd() ? it.value() : std::prev(m_keyOrderedItems.end());
 
-    if (currentItemIndex > 0) {
-        for (int i = currentItemIndex ; i >= 0 ; --i) {
-            if (i > 0 && m_keyOrderedItems[i - 1].first) {
-                returnItem = qobject_cast<WebOSSurfaceItem *>(m_keyOrderedItems[i - 1].first);
-                break;
-            }
-        }
-    }
-    return returnItem;
+    if (position != m_keyOrderedItems.begin())
+        return std::prev(position)->second;
+    return NULL;
 }
 
 WebOSSurfaceItem* WebOSSurfaceGroup::findKeyFocusedItem()
@@ -563,8 +570,8 @@ WebOSSurfaceItem* WebOSSurfaceGroup::findKeyFocusedItem()
         topIndex = m_keyOrderedItems.size() -1;
         qInfo() << "topIndex: " << topIndex << " in m_keyOrderedItems: " << m_keyOrderedItems.size();
         if (topIndex >= 0)
-            for (int i = topIndex; i >=0; i--) {
-                WebOSSurfaceItem* item = qobject_cast<WebOSSurfaceItem *>(m_keyOrderedItems[i].first);
+            for (auto it = m_keyOrderedItems.crbegin(); it != m_keyOrderedItems.crend(); ++it) {
+                WebOSSurfaceItem* item = qobject_cast<WebOSSurfaceItem *>(it->second);
                 if (item && item->isMapped()) {
                     returnItem = item;
                     break;
@@ -573,12 +580,12 @@ WebOSSurfaceItem* WebOSSurfaceGroup::findKeyFocusedItem()
                 }
             }
     } else {
-        if (!m_zOrderedSurfaceLayoutInfoList.isEmpty()) {
-            topIndex = m_zOrderedSurfaceLayoutInfoList.size() - 1;
-            qInfo() << "topIndex: " << topIndex << " in m_zOrderedSurfaceLayoutInfoList: " << m_zOrderedSurfaceLayoutInfoList.size();
+        if (!m_zOrderedItems.empty()) {
+            topIndex = m_zOrderedItems.size() - 1;
+            qInfo() << "topIndex: " << topIndex << " in m_zOrderedItems: " << m_zOrderedItems.size();
             if (topIndex >= 0)
-                for (int i = topIndex; i >=0; i--) {
-                    WebOSSurfaceItem* item = qobject_cast<WebOSSurfaceItem *>(m_zOrderedSurfaceLayoutInfoList[i].first);
+                for (auto it = m_zOrderedItems.crbegin(); it != m_zOrderedItems.crend(); ++it) {
+                    WebOSSurfaceItem* item = it->second;
                     if (item && item->isMapped()) {
                         returnItem = item;
                         break;
@@ -1,4 +1,4 @@
-// Copyright (c) 2014-2022 LG Electronics, Inc.
+// Copyright (c) 2014-2024 LG Electronics, Inc.
 //
 // Licensed under the Apache License, Version 2.0 (the "License");
 // you may not use this file except in compliance with the License.
@@ -25,6 +25,9 @@
 #include <QList>
 #include <QSharedPointer>
 #include <QMap>
+#include <QHash>
+
+#include <map>
 
 #define WEBOSSURFACEGROUP_VERSION 1
 
@@ -108,8 +111,12 @@ protected:
     QSharedPointer<QObject> takeLayoutInfoFor(WebOSSurfaceItem* item);
     QList<WebOSSurfaceItem*> attachedClientSurfaceItems();
 
+    void insertKeyOrderedItem(WebOSSurfaceItem* item, int keyIndex);
+    void removeKeyOrderedItem(WebOSSurfaceItem* item);
+
 protected slots:
     void sortZOrderedSurfaceLayoutInfoList();
+    void handleItemZChanged();
 
 private:
     // methods
@@ -119,6 +126,9 @@ private:
     void closeInvalidSurface(WebOSSurfaceItem* item);
     void removeAttachedItemsFromGroup();
 
+    void repositionZOrdered(WebOSSurfaceItem* item);
+    void clearOrderedItems();
+
 private slots:
     void removeSurfaceItem();
     void removeLayer(const QString& name);
@@ -136,8 +146,23 @@ private:
     QMap<QString, WebOSSurfaceGroupLayer*> m_layers;
     int time;
 
-    QList< QPair<WebOSSurfaceItem *, QSharedPointer<QObject> > > m_zOrderedSurfaceLayoutInfoList;
-    QList<QPair<WebOSSurfaceItem *, int>> m_keyOrderedItems;
+    // Both orders break ties by the sequence number an item gets when it
+    // joins the group, so equal z or key index keep the attach order.
+    typedef std::map<std::pair<qreal, quint64>, WebOSSurfaceItem *> ZOrderMap;
+    typedef std::map<std::pair<int, quint64>, WebOSSurfaceItem *> KeyOrderMap;
+
+    struct ZOrderInfo {
+        quint64 sequence;
+        ZOrderMap::iterator position;
+        QSharedPointer<QObject> layoutInfo;
+    };
+    // Items in ascending z, re-keyed as z of an item changes
+    ZOrderMap m_zOrderedItems;
+    QHash<WebOSSurfaceItem *, ZOrderInfo> m_zOrderInfo;
+    // Items in ascending key index
+    KeyOrderMap m_keyOrderedItems;
+    QHash<WebOSSurfaceItem *, KeyOrderMap::iterator> m_keyOrderedPositions;
+    quint64 m_sequence;
     bool m_useKeyIndex;
 };
 #endif
@@ -0,0 +1,309 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "surfacehitindex.h"
+#include "webossurfaceitem.h"
+
+#include <QtMath>
+
+#include <private/qquickitem_p.h>
+
+#include <algorithm>
+
+// Side of a grid cell in scene pixels
+static const qreal CELL_SIZE = 128.0;
+
+SurfaceHitIndex::SurfaceHitIndex(QQuickItem *root, QObject *parent)
+    : QObject(parent)
+    , m_root(root)
+{
+}
+
+void SurfaceHitIndex::setSceneSize(const QSizeF &sceneSize)
+{
+    if (m_sceneSize != sceneSize) {
+        m_sceneSize = sceneSize;
+        m_allGeometryDirty = true;
+    }
+}
+
+void SurfaceHitIndex::addItem(WebOSSurfaceItem *item)
+{
+    if (!item || m_items.contains(item))
+        return;
+
+    m_items.insert(item);
+    watch(item);
+    // Leaving the window of the root means leaving the index
+    m_watched[item].append(connect(item, &QQuickItem::windowChanged, this, [this, item]() {
+        if (item->window() != m_root->window())
+            removeItem(item);
+    }));
+    markOrderDirty();
+}
+
+void SurfaceHitIndex::removeItem(WebOSSurfaceItem *item)
+{
+    if (!m_items.remove(item))
+        return;
+
+    m_geometryDirty.remove(item);
+    unwatch(item);
+    markOrderDirty();
+}
+
+void SurfaceHitIndex::invalidate()
+{
+    markOrderDirty();
+}
+
+void SurfaceHitIndex::watch(QQuickItem *item)
+{
+    if (m_watched.contains(item))
+        return;
+
+    QVector<QMetaObject::Connection> &connections = m_watched[item];
+    auto geometry = [this, item]() { markGeometryDirty(item); };
+    auto order = [this]() { markOrderDirty(); };
+
+    connections << connect(item, &QQuickItem::xChanged, this, geometry)
+                << connect(item, &QQuickItem::yChanged, this, geometry)
+                << connect(item, &QQuickItem::widthChanged, this, geometry)
+                << connect(item, &QQuickItem::heightChanged, this, geometry)
+                << connect(item, &QQuickItem::scaleChanged, this, geometry)
+                << connect(item, &QQuickItem::rotationChanged, this, geometry)
+                << connect(item, &QQuickItem::transformOriginChanged, this, geometry)
+                << connect(item, &QQuickItem::zChanged, this, order)
+                << connect(item, &QQuickItem::parentChanged, this, order)
+                // Both are also emitted for the descendants whose effective state changed
+                << connect(item, &QQuickItem::visibleChanged, this, order)
+                << connect(item, &QQuickItem::enabledChanged, this, order);
+
+    // The item is not to be dereferenced any more
+    connections << connect(item, &QObject::destroyed, this, [this, item]() {
+        m_watched.remove(item);
+        m_ancestors.remove(item);
+        m_items.remove(static_cast<WebOSSurfaceItem *>(item));
+        m_geometryDirty.remove(static_cast<WebOSSurfaceItem *>(item));
+        markOrderDirty();
+    });
+}
+
+void SurfaceHitIndex::unwatch(QQuickItem *item)
+{
+    const QVector<QMetaObject::Connection> connections = m_watched.take(item);
+    for (const QMetaObject::Connection &connection : connections)
+        disconnect(connection);
+}
+
+// A surface only moves itself, an ancestor moves every surface below it
+void SurfaceHitIndex::markGeometryDirty(QQuickItem *item)
+{
+    WebOSSurfaceItem *surfaceItem = qobject_cast<WebOSSurfaceItem *>(item);
+    if (surfaceItem && m_items.contains(surfaceItem) && !m_ancestors.contains(item))
+        m_geometryDirty.insert(surfaceItem);
+    else
+        m_allGeometryDirty = true;
+}
+
+void SurfaceHitIndex::update()
+{
+    if (m_orderDirty) {
+        rebuild();
+    } else if (m_allGeometryDirty) {
+        rebucketAll();
+    } else {
+        for (WebOSSurfaceItem *item : qAsConst(m_geometryDirty)) {
+            const int index = m_entryIndex.value(item, -1);
+            if (index < 0)
+                continue;
+            unbucket(index);
+            m_entries[index].sceneRect = item->mapRectToScene(item->boundingRect());
+            bucket(index);
+        }
+    }
+
+    m_orderDirty = false;
+    m_allGeometryDirty = false;
+    m_geometryDirty.clear();
+}
+
+void SurfaceHitIndex::rebuild()
+{
+    m_rebuildCount++;
+
+    // clear() keeps the capacity, so a rebuild does not allocate in the steady state
+    m_entries.clear();
+    m_entryIndex.clear();
+    collect(m_root);
+    rebucketAll();
+    watchAncestors();
+}
+
+// Same traversal as the paint order walk it replaces: children topmost
+// first, then the item itself. Hidden or disabled subtrees are skipped,
+// their surfaces come back through visibleChanged or enabledChanged.
+void SurfaceHitIndex::collect(QQuickItem *base)
+{
+    if (!base)
+        return;
+
+    if (!base->isVisible() || !base->isEnabled())
+        return;
+
+    const QList<QQuickItem*> children = QQuickItemPrivate::get(base)->paintOrderChildItems();
+    for (int ii = children.count() - 1; ii >= 0; --ii)
+        collect(children.at(ii));
+
+    WebOSSurfaceItem *webosSurfaceItem = qobject_cast<WebOSSurfaceItem*>(base);
+    if (webosSurfaceItem) {
+        // Surfaces not added explicitly are followed from now on as well
+        if (!m_items.contains(webosSurfaceItem))
+            addItem(webosSurfaceItem);
+
+        Entry entry;
+        entry.item = webosSurfaceItem;
+        m_entryIndex.insert(webosSurfaceItem, m_entries.size());
+        m_entries.append(entry);
+    }
+}
+
+// Follows the ancestors of all surfaces up to the root, and no others
+void SurfaceHitIndex::watchAncestors()
+{
+    QSet<QQuickItem *> ancestors;
+    for (WebOSSurfaceItem *item : qAsConst(m_items)) {
+        for (QQuickItem *p = item->parentItem(); p && !ancestors.contains(p); p = p->parentItem()) {
+            ancestors.insert(p);
+            if (p == m_root)
+                break;
+        }
+    }
+
+    for (QQuickItem *p : qAsConst(m_ancestors)) {
+        if (!ancestors.contains(p) && !m_items.contains(qobject_cast<WebOSSurfaceItem *>(p)))
+            unwatch(p);
+    }
+    for (QQuickItem *p : qAsConst(ancestors))
+        watch(p);
+
+    m_ancestors.swap(ancestors);
+}
+
+bool SurfaceHitIndex::cellRange(const QRectF &rect, int *c0, int *c1, int *r0, int *r1) const
+{
+    const QRectF r = rect & QRectF(QPointF(0, 0), m_sceneSize);
+    if (r.isEmpty())
+        return false;
+    *c0 = qBound(0, int(r.left() / CELL_SIZE), m_columns - 1);
+    *c1 = qBound(0, int(r.right() / CELL_SIZE), m_columns - 1);
+    *r0 = qBound(0, int(r.top() / CELL_SIZE), m_rows - 1);
+    *r1 = qBound(0, int(r.bottom() / CELL_SIZE), m_rows - 1);
+    return true;
+}
+
+// Cells hold entry indices in ascending order, which is topmost first
+void SurfaceHitIndex::bucket(int index)
+{
+    int c0, c1, r0, r1;
+    if (!cellRange(m_entries.at(index).sceneRect, &c0, &c1, &r0, &r1))
+        return;
+    for (int row = r0; row <= r1; ++row) {
+        for (int col = c0; col <= c1; ++col) {
+            QVector<int> &cell = m_cells[row * m_columns + col];
+            cell.insert(std::lower_bound(cell.begin(), cell.end(), index), index);
+        }
+    }
+}
+
+void SurfaceHitIndex::unbucket(int index)
+{
+    int c0, c1, r0, r1;
+    if (!cellRange(m_entries.at(index).sceneRect, &c0, &c1, &r0, &r1))
+        return;
+    for (int row = r0; row <= r1; ++row) {
+        for (int col = c0; col <= c1; ++col) {
+            QVector<int> &cell = m_cells[row * m_columns + col];
+            auto it = std::lower_bound(cell.begin(), cell.end(), index);
+            if (it != cell.end() && *it == index)
+                cell.erase(it);
+        }
+    }
+}
+
+void SurfaceHitIndex::rebucketAll()
+{
+    const int columns = qMax(1, qCeil(m_sceneSize.width() / CELL_SIZE));
+    const int rows = qMax(1, qCeil(m_sceneSize.height() / CELL_SIZE));
+    if (columns != m_columns || rows != m_rows) {
+        m_columns = columns;
+        m_rows = rows;
+        m_cells.resize(m_columns * m_rows);
+    }
+    for (QVector<int> &cell : m_cells)
+        cell.clear();
+
+    for (int i = 0; i < m_entries.size(); ++i) {
+        Entry &entry = m_entries[i];
+        if (entry.item)
+            entry.sceneRect = entry.item->mapRectToScene(entry.item->boundingRect());
+        else
+            entry.sceneRect = QRectF();
+        bucket(i);
+    }
+}
+
+bool SurfaceHitIndex::hit(const Entry &entry, const QPointF &scenePoint) const
+{
+    WebOSSurfaceItem *item = entry.item.data();
+    // The bounds are a quick reject, contains() has the final say
+    if (!item || !entry.sceneRect.contains(scenePoint) ||
+        !item->isVisible() || !item->isEnabled() ||
+        !item->QQuickItem::contains(item->mapFromScene(scenePoint)))
+        return false;
+
+    // Culling has no signal, so it is checked on the candidate
+    for (QQuickItem *p = item; p; p = p->parentItem()) {
+        if (QQuickItemPrivate::get(p)->culled)
+            return false;
+        if (p == m_root)
+            break;
+    }
+    return true;
+}
+
+WebOSSurfaceItem *SurfaceHitIndex::itemAt(const QPointF &scenePoint)
+{
+    update();
+
+    const int col = qFloor(scenePoint.x() / CELL_SIZE);
+    const int row = qFloor(scenePoint.y() / CELL_SIZE);
+
+    if (col >= 0 && col < m_columns && row >= 0 && row < m_rows) {
+        for (int i : m_cells.at(row * m_columns + col)) {
+            if (hit(m_entries.at(i), scenePoint))
+                return m_entries.at(i).item.data();
+        }
+        return nullptr;
+    }
+
+    // Outside of the scene, not worth a grid
+    for (const Entry &entry : qAsConst(m_entries)) {
+        if (hit(entry, scenePoint))
+            return entry.item.data();
+    }
+    return nullptr;
+}
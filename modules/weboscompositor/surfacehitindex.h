@@ -0,0 +1,103 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef SURFACEHITINDEX_H
+#define SURFACEHITINDEX_H
+
+#include <WebOSCoreCompositor/weboscompositorexport.h>
+
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QRectF>
+#include <QSet>
+#include <QVector>
+
+class QQuickItem;
+class WebOSSurfaceItem;
+
+/* Scene-space index of the visible WebOSSurfaceItems under a root item
+   for hit testing. Entries are kept topmost first, as the paint order
+   walk would find them, and bucketed into a uniform grid over the scene.
+
+   The index follows the signals of the added surface items and of their
+   ancestors. A move or resize only rebuckets the affected entries. A
+   change in stacking, visibility, enabled state or parent re-collects the
+   entries, reusing the existing allocations. Both happen lazily on the
+   next lookup. Restacking with stackBefore()/stackAfter() emits no signal
+   and needs an explicit invalidate(). */
+class WEBOS_COMPOSITOR_EXPORT SurfaceHitIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SurfaceHitIndex(QQuickItem *root, QObject *parent = nullptr);
+
+    void setSceneSize(const QSizeF &sceneSize);
+
+    void addItem(WebOSSurfaceItem *item);
+    void removeItem(WebOSSurfaceItem *item);
+    void invalidate();
+
+    WebOSSurfaceItem *itemAt(const QPointF &scenePoint);
+
+    // Number of times the entries were re-collected, for tests
+    int rebuildCount() const { return m_rebuildCount; }
+
+private:
+    struct Entry {
+        QPointer<WebOSSurfaceItem> item;
+        QRectF sceneRect;
+    };
+
+    void update();
+    void rebuild();
+    void collect(QQuickItem *base);
+    void watchAncestors();
+    void watch(QQuickItem *item);
+    void unwatch(QQuickItem *item);
+
+    void bucket(int index);
+    void unbucket(int index);
+    void rebucketAll();
+    bool cellRange(const QRectF &rect, int *c0, int *c1, int *r0, int *r1) const;
+    bool hit(const Entry &entry, const QPointF &scenePoint) const;
+
+    void markGeometryDirty(QQuickItem *item);
+    void markOrderDirty() { m_orderDirty = true; }
+
+    QQuickItem *m_root;
+    QSizeF m_sceneSize;
+
+    // Surface items to index, whether currently visible or not
+    QSet<WebOSSurfaceItem *> m_items;
+    // Surface items and their ancestors with signal connections
+    QHash<QQuickItem *, QVector<QMetaObject::Connection>> m_watched;
+    QSet<QQuickItem *> m_ancestors;
+
+    QVector<Entry> m_entries;
+    QHash<const QQuickItem *, int> m_entryIndex;
+    QVector<QVector<int>> m_cells;
+    int m_columns = 0;
+    int m_rows = 0;
+
+    bool m_orderDirty = true;
+    bool m_allGeometryDirty = false;
+    QSet<WebOSSurfaceItem *> m_geometryDirty;
+    int m_rebuildCount = 0;
+};
+
+#endif // SURFACEHITINDEX_H
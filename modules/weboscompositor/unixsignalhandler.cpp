@@ -45,6 +45,9 @@ UnixSignalHandler::UnixSignalHandler(QObject* parent)
 
     if (sigaction(SIGHUP, &hup, 0) != 0)
         qWarning() << "Can't register unix signal handler.";
+
+    if (sigaction(SIGUSR1, &hup, 0) != 0)
+        qWarning() << "Can't register unix signal handler for SIGUSR1.";
 }
 
 UnixSignalHandler::~UnixSignalHandler()
@@ -73,6 +76,9 @@ void UnixSignalHandler::handleSignal()
         case SIGHUP:
             emit sighup();
             break;
+        case SIGUSR1:
+            emit sigusr1();
+            break;
         }
     }
 
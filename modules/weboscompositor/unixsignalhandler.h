@@ -37,6 +37,7 @@ public slots:
 
 signals:
     void sighup();
+    void sigusr1();
 
 private:
     static int m_sigFd[2];
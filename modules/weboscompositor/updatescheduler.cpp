@@ -17,17 +17,29 @@
 #include <qpa/qplatformscreen.h>
 #include <qpa/qplatformnativeinterface.h>
 
+#include <QWaylandSurface>
+#include <QWaylandCompositor>
+#include <QWaylandView>
+#include <QtWaylandCompositor/private/qwaylandcompositor_p.h>
+#include <private/qquickitem_p.h>
+#include <private/qquickwindow_p.h>
+
 #include "updatescheduler.h"
 #include "weboscompositorwindow.h"
+#include "webossurfaceitem.h"
 #include "weboscompositortracer.h"
+#include "weboscompositorlogging.h"
 #include "securecoding.h"
 
-#if QT_VERSION < QT_VERSION_CHECK(6,0,0)
 #include <QGuiApplication>
 #include <QScreen>
+
+#if QT_VERSION < QT_VERSION_CHECK(6,0,0)
 #include <QtMath>
 #endif
 
+#include <limits>
+
 static constexpr int STATIC_SWAP_BUFFER_TIME = 2;
 
 /* Increasing this value, frame_callback is sent earlier,
@@ -45,6 +57,35 @@ static constexpr int RENDER_FLUCTUATION_BUFFER_TIME = 4;
 static int s_default_update_idle_time = qgetenv("WEBOS_UPDATE_IDLE_TIME").toInt();
 static bool debug_render = qgetenv("WEBOS_UPDATE_DEBUG").toInt() == 1;
 
+/* Number of vsyncs between frame callbacks for hidden surface items
+   with the default throttle policy. 1 or less means no throttling. */
+static int s_hidden_frame_divisor = qgetenv("WEBOS_UPDATE_HIDDEN_FRAME_DIVISOR").toInt();
+
+// Interval in frames to notify the change of frame timing statistics
+static constexpr quint32 TIMING_STATS_NOTIFY_FRAMES = 60;
+
+/* Time reserved before the predicted vsync on top of the rendering
+   cost. It grows on every missed frame and shrinks back after a while
+   of frames on time. In nanoseconds. */
+static constexpr qint64 DEADLINE_MARGIN_MIN = 500000;
+static constexpr qint64 DEADLINE_MARGIN_STEP = 250000;
+static constexpr quint32 DEADLINE_MARGIN_DECAY_FRAMES = 60;
+
+/* Content rate matching is off while the scene itself (animations
+   without any surface damage) has been updated within this time. */
+static constexpr int SCENE_IDLE_TIME = 500;
+
+static QLoggingCategory::CategoryFilter s_previousCategoryFilter = nullptr;
+
+// Keeps lsm.scheduler debug output on whenever the rules are reapplied
+static void schedulerDebugFilter(QLoggingCategory *category)
+{
+    if (s_previousCategoryFilter)
+        s_previousCategoryFilter(category);
+    if (qstrcmp(category->categoryName(), lsmScheduler().categoryName()) == 0)
+        category->setEnabled(QtDebugMsg, true);
+}
+
 /* This is from another thread which handles drm event */
 void UpdateScheduler::pageFlipNotifier(WebOSCompositorWindow* win, unsigned int seq, unsigned int tv_sec, unsigned int tv_usec)
 {
@@ -58,8 +99,8 @@ void UpdateScheduler::pageFlipNotifier(WebOSCompositorWindow* win, unsigned int
     if (debug_render) {
         struct timespec ts;
         clock_gettime(CLOCK_MONOTONIC, &ts);
-        qDebug() << "timestamp" << ts.tv_sec << ts.tv_nsec / 1000 << "us";
-        qDebug() << upsched << "seq" << seq << "Backend timestamp" << tv_sec << tv_usec << "us";
+        qCDebug(lsmScheduler) << "timestamp" << ts.tv_sec << ts.tv_nsec / 1000 << "us";
+        qCDebug(lsmScheduler) << upsched << "seq" << seq << "Backend timestamp" << tv_sec << tv_usec << "us";
     }
 
     // NOTE: To be optimized for each backend
@@ -78,6 +119,14 @@ void UpdateScheduler::pageFlipNotifier(WebOSCompositorWindow* win, unsigned int
 UpdateScheduler::UpdateScheduler(WebOSCompositorWindow *window)
     : m_window(window)
 {
+    // WEBOS_UPDATE_DEBUG chains a category filter rather than replacing
+    // the filter rules of the application
+    static bool debugFilterSet = []() {
+        if (debug_render)
+            s_previousCategoryFilter = QLoggingCategory::installFilter(schedulerDebugFilter);
+        return debug_render;
+    }();
+    Q_UNUSED(debugFilterSet);
     init();
 }
 
@@ -96,28 +145,30 @@ void UpdateScheduler::init()
 
     // Get VSync interval
     m_vsyncInterval = 1.0 / m_window->screen()->refreshRate() * 1000;
+    m_vsyncNsecsInterval = double2int(m_vsyncInterval * 1000000);
+    m_vsyncPredictor.setNominalPeriod(m_vsyncNsecsInterval);
+    m_deadlineMargin = DEADLINE_MARGIN_MIN;
 
     m_adaptiveUpdate = (qgetenv("WEBOS_COMPOSITOR_ADAPTIVE_UPDATE").toInt() == 1);
     m_adaptiveFrame = (qgetenv("WEBOS_COMPOSITOR_ADAPTIVE_FRAME_CALLBACK").toInt() == 1);
+    m_contentRateMatch = (qgetenv("WEBOS_COMPOSITOR_CONTENT_RATE_MATCH").toInt() == 1);
 
     // Adaptive frame callback requires adaptive update
     if (m_adaptiveFrame && !m_adaptiveUpdate)
         m_adaptiveFrame = false;
 
     if (!m_adaptiveUpdate) {
-        qInfo() << "Default update interval" << defaultUpdateInterval << "for window" << m_window << "vsyncInterval:" << m_vsyncInterval;
+        qCInfo(lsmScheduler) << "Default update interval" << defaultUpdateInterval << "for window" << m_window << "vsyncInterval:" << m_vsyncInterval;
         return;
     }
 
-    qInfo() << "Adaptive update interval for window" << m_window << "vsyncInterval:" << m_vsyncInterval;
+    qCInfo(lsmScheduler) << "Adaptive update interval for window" << m_window << "vsyncInterval:" << m_vsyncInterval;
 
     if (defaultUpdateInterval != 0)
-        qWarning() << "QT_QPA_UPDATE_IDLE_TIME should be 0 but" << defaultUpdateInterval;
+        qCWarning(lsmScheduler) << "QT_QPA_UPDATE_IDLE_TIME should be 0 but" << defaultUpdateInterval;
 
     m_updateTimerInterval = s_default_update_idle_time; // changes adaptively per every frame
-    m_updateTimer.setTimerType(Qt::PreciseTimer);
-    m_updateTimer.setSingleShot(true);
-    connect(&m_updateTimer, &QTimer::timeout, this, &UpdateScheduler::deliverUpdateRequest);
+    connect(&m_updateTimer, &DeadlineTimer::timeout, this, &UpdateScheduler::deliverUpdateRequest);
 
     // Adaptive Frame
     m_window->output()->setAutomaticFrameCallback(!m_adaptiveFrame);
@@ -129,10 +180,27 @@ void UpdateScheduler::init()
 
         connect(&m_frameTimer, &QTimer::timeout, this, &UpdateScheduler::sendFrame);
         connect(m_window, &QQuickWindow::afterRendering, this, &UpdateScheduler::scheduleFrameCallback);
-        qInfo() << "Adaptive frame callback for window" << m_window << m_frameTimerInterval;
+        qCInfo(lsmScheduler) << "Adaptive frame callback for window" << m_window << m_frameTimerInterval;
     }
 
-    qInfo() << "Adaptive update with pageflip notifier" << hasPageFlipNotifier;
+    qCInfo(lsmScheduler) << "Adaptive update with pageflip notifier" << hasPageFlipNotifier;
+
+    // Content rate matching relies on the vsync prediction
+    if (m_contentRateMatch && !hasPageFlipNotifier) {
+        qCWarning(lsmScheduler) << "Content rate matching requires pageflip notifier, disabled for window" << m_window;
+        m_contentRateMatch = false;
+    }
+
+    if (m_contentRateMatch) {
+        m_panelRate = m_window->screen()->refreshRate();
+        // Optional, to switch the display mode to match the content
+        QPlatformNativeInterface *nativeInterface = QGuiApplication::platformNativeInterface();
+        if (nativeInterface)
+            m_setContentRateFunc = (bool(*)(QScreen*, qreal))
+                nativeInterface->nativeResourceForScreen("setContentRateFunc", m_window->screen());
+        connect(m_window->screen(), &QScreen::refreshRateChanged, this, &UpdateScheduler::onRefreshRateChanged);
+        qCInfo(lsmScheduler) << "Content rate matching for window" << m_window << "panel rate" << m_panelRate << "mode switch" << (m_setContentRateFunc != nullptr);
+    }
 
     // For legacy adaptive update
     if (!hasPageFlipNotifier) {
@@ -142,6 +210,7 @@ void UpdateScheduler::init()
         connect(this, &UpdateScheduler::legacyPageFlipped, this, &UpdateScheduler::onLegacyPageFlipped);
     } else {
         // scheduling next update in frameFinished
+        connect(this, &UpdateScheduler::pageFlipped, this, &UpdateScheduler::onPageFlipped);
         connect(this, &UpdateScheduler::pageFlipped, this, &UpdateScheduler::frameFinished);
         connect(this, &UpdateScheduler::frameMissed, this, &UpdateScheduler::onFrameMissed);
         connect(m_window, &QQuickWindow::frameSwapped, this, &UpdateScheduler::onFrameSwapped);
@@ -167,8 +236,8 @@ bool UpdateScheduler::updateRequested()
         if (debug_render) {
             struct timespec ts;
             clock_gettime(CLOCK_MONOTONIC, &ts);
-            qDebug() << "sinceDamaged:" << m_sinceSurfaceDamaged.elapsed() << "ms" << "framesOnUpdate" << m_framesOnUpdate << "timestamp" << ts.tv_sec << ts.tv_nsec / 1000 << "us";
-            qDebug() << "updateTimer:" << m_updateTimer.isActive() << "m_frameSwapped:" << m_frameSwapped;
+            qCDebug(lsmScheduler) << "sinceDamaged:" << m_sinceSurfaceDamaged.elapsed() << "ms" << "framesOnUpdate" << m_framesOnUpdate << "timestamp" << ts.tv_sec << ts.tv_nsec / 1000 << "us";
+            qCDebug(lsmScheduler) << "updateTimer:" << m_updateTimer.isActive() << "m_frameSwapped:" << m_frameSwapped;
         }
 
         m_hasUnhandledUpdateRequest = true;
@@ -177,7 +246,7 @@ bool UpdateScheduler::updateRequested()
     // First UpdateRequest, just fall through to start sync
 
     if (debug_render)
-        qDebug() << "updateRequested without timer." << "sinceDamaged:" << m_sinceSurfaceDamaged.elapsed() << "ms";
+        qCDebug(lsmScheduler) << "updateRequested without timer." << "sinceDamaged:" << m_sinceSurfaceDamaged.elapsed() << "ms";
     // This path will immediately handle UpdateRequest, so start to track the frame
     frameStarted();
     return false;
@@ -192,7 +261,7 @@ void UpdateScheduler::deliverUpdateRequest()
         if (m_hasUnhandledUpdateRequest) {
             if (m_frameSwapped == false) {
                 if (debug_render) {
-                    qDebug() << "Skip update since onFrameSwapped is not called after frameFinished";
+                    qCDebug(lsmScheduler) << "Skip update since onFrameSwapped is not called after frameFinished";
                 }
                 return;
             }
@@ -206,10 +275,10 @@ void UpdateScheduler::deliverUpdateRequest()
             struct timespec ts;
             clock_gettime(CLOCK_MONOTONIC, &ts);
 
-            qDebug() << "no update since framecallback. timestamp" << ts.tv_sec << ts.tv_nsec / 1000 << "us";
+            qCDebug(lsmScheduler) << "no update since framecallback. timestamp" << ts.tv_sec << ts.tv_nsec / 1000 << "us";
         }
     } else {
-        qWarning() << "deliverUpdateRequest is called for" << m_window << "while adaptiveUpdate is NOT set!";
+        qCWarning(lsmScheduler) << "deliverUpdateRequest is called for" << m_window << "while adaptiveUpdate is NOT set!";
     }
 }
 
@@ -221,27 +290,47 @@ void UpdateScheduler::checkTimeout()
     // When the remaining time of QTimer is 0, it means that the timer has
     // expired but is being delayed due to other events and we need to
     // take actions needed right away.
-    if (m_adaptiveUpdate && m_updateTimer.remainingTime() == 0) {
+    if (m_adaptiveUpdate && m_updateTimer.remainingTimeNs() == 0) {
         if (debug_render)
-            qDebug() << "Timeout for updateTimer";
+            qCDebug(lsmScheduler) << "Timeout for updateTimer";
         m_updateTimer.stop();
         deliverUpdateRequest();
     }
 
     if (m_adaptiveFrame && m_frameTimer.remainingTime() == 0) {
         if (debug_render)
-            qDebug() << "Timeout for frameTimer";
+            qCDebug(lsmScheduler) << "Timeout for frameTimer";
         m_frameTimer.stop();
         sendFrame();
     }
 }
 
-void UpdateScheduler::surfaceDamaged()
+void UpdateScheduler::surfaceDamaged(WebOSSurfaceItem *item)
 {
     PMTRACE_FUNCTION;
 
     static QElapsedTimer damagedInterval;
 
+    if (m_contentRateMatch && item) {
+        trackItem(item);
+        m_contentRateDetector.addCommit(item, DeadlineTimer::now());
+    }
+
+    if (m_adaptiveFrame && item) {
+        trackItem(item);
+        auto it = m_surfaceFrames.find(item);
+        if (it == m_surfaceFrames.end())
+            it = m_surfaceFrames.insert(item, SurfaceFrame());
+
+        if (it->sinceSendFrame.isValid()) {
+            it->frameToDamaged = it->sinceSendFrame.elapsed();
+            it->sinceSendFrame.invalidate();
+
+            if (debug_render)
+                qCDebug(lsmScheduler) << item << "frameToDamaged" << it->frameToDamaged << "ms";
+        }
+    }
+
     if (m_adaptiveFrame && m_sinceSendFrame.isValid()) {
         m_frameToDamaged = m_sinceSendFrame.elapsed();
 
@@ -249,31 +338,131 @@ void UpdateScheduler::surfaceDamaged()
         m_sinceSurfaceDamaged.start();
 
         if (debug_render)
-            qDebug() << "frameToDamaged" << m_frameToDamaged << "ms";
+            qCDebug(lsmScheduler) << "frameToDamaged" << m_frameToDamaged << "ms";
     }
     damagedInterval.start();
 }
 
+void UpdateScheduler::trackItem(WebOSSurfaceItem *item)
+{
+    if (m_trackedItems.contains(item))
+        return;
+
+    m_trackedItems.insert(item);
+    connect(item, &QObject::destroyed, this, [this, item]() {
+        m_trackedItems.remove(item);
+        m_surfaceFrames.remove(item);
+        m_contentRateDetector.remove(item);
+    });
+}
+
+int UpdateScheduler::defaultFrameThrottlePolicy(WebOSSurfaceItem *item)
+{
+    if (item->isVisible() && item->itemState() == WebOSSurfaceItem::ItemStateNormal)
+        return 1;
+    return s_hidden_frame_divisor;
+}
+
+bool UpdateScheduler::isThrottled(WebOSSurfaceItem *item, const SurfaceFrame &frame) const
+{
+    int divisor = m_throttlePolicy ? m_throttlePolicy(item) : 1;
+    return divisor > 1 && m_vsyncCount - frame.lastSentVsync < (quint32) divisor;
+}
+
+void UpdateScheduler::sendFrameToSurface(WebOSSurfaceItem *item, SurfaceFrame &frame)
+{
+    frame.handled = true;
+    frame.throttled = isThrottled(item, frame);
+    if (frame.throttled || !item->surface())
+        return;
+
+    // No surfaceDamaged since the last frame callback for this surface.
+    // It means that rendering time on client exceeds the vsync interval.
+    if (frame.sinceSendFrame.isValid())
+        frame.frameTimerInterval = 0;
+
+    frame.sinceSendFrame.start();
+    frame.lastSentVsync = m_vsyncCount;
+    item->surface()->sendFrameCallbacks();
+}
+
+/* Sends frame callbacks to the rest of the surfaces on the output,
+   such as sub-surfaces and cursors, except the throttled ones. */
+void UpdateScheduler::sendFrameToOutput()
+{
+    QWaylandOutput *output = m_window->output();
+    QList<QWaylandSurface *> throttled;
+
+    for (auto it = m_surfaceFrames.begin(); it != m_surfaceFrames.end(); ++it) {
+        if (it->throttled && it.key()->surface())
+            throttled << it.key()->surface();
+    }
+
+    if (throttled.isEmpty()) {
+        output->sendFrameCallbacks();
+        return;
+    }
+
+    QWaylandCompositor *compositor = output->compositor();
+    const QList<QWaylandSurface *> surfaces = QWaylandCompositorPrivate::get(compositor)->all_surfaces;
+    for (QWaylandSurface *surface : surfaces) {
+        if (throttled.contains(surface) || !surface->hasContent())
+            continue;
+        QWaylandView *view = surface->primaryView();
+        if (view && view->output() == output)
+            surface->sendFrameCallbacks();
+    }
+    wl_display_flush_clients(compositor->display());
+}
+
 void UpdateScheduler::sendFrame()
 {
     static QElapsedTimer frameInterval;
     PMTRACE_FUNCTION;
     QWaylandOutput *output = m_window->output();
     if (m_adaptiveFrame && output) {
+        // Send to each surface whose time has come, and keep the timer
+        // running for the next one until the output deadline.
+        // Without scheduling (legacy notifier), everything goes at once.
+        qint64 now = m_sinceFrameScheduled.isValid() ? m_sinceFrameScheduled.elapsed() : std::numeric_limits<int>::max();
+        qint64 next = m_outputFrameInterval;
+
+        for (auto it = m_surfaceFrames.begin(); it != m_surfaceFrames.end();) {
+            if (it.key()->window() != m_window) {
+                it = m_surfaceFrames.erase(it);
+                continue;
+            }
+            if (!it->handled) {
+                if (it->frameTimerInterval <= now)
+                    sendFrameToSurface(it.key(), *it);
+                else
+                    next = qMin(next, (qint64) it->frameTimerInterval);
+            }
+            ++it;
+        }
+
+        if (now < next) {
+            m_frameTimer.start(next - now);
+            return;
+        }
+
+        m_sinceFrameScheduled.invalidate();
+
         if (m_sinceSendFrame.isValid()) {
             // No surfaceDamaged called since the last frame.
             // It means that rendering time on client exceeds the vsync interval.
             m_frameTimerInterval = 0;
         }
         m_sinceSendFrame.start();
-        output->sendFrameCallbacks();
+        sendFrameToOutput();
 
         if (m_sinceSurfaceDamaged.isValid()) {
             qint64 damageToFrame = m_sinceSurfaceDamaged.elapsed();
+            m_pendingTiming[FrameTimingStats::DamageToFrameCallback] = m_sinceSurfaceDamaged.nsecsElapsed() / 1000;
             if (debug_render)
-                qDebug() << "damagedToFrame" <<  damageToFrame << "ms" << "vsyncElapsed" << m_vsyncElapsedTimer.elapsed() << "ms" << "frame interval" << frameInterval.elapsed() << "timer" << m_frameTimerInterval;
+                qCDebug(lsmScheduler) << "damagedToFrame" <<  damageToFrame << "ms" << "vsyncElapsed" << m_vsyncElapsedTimer.elapsed() << "ms" << "frame interval" << frameInterval.elapsed() << "timer" << m_frameTimerInterval;
             if (damageToFrame > m_vsyncInterval * 2 && debug_render)
-                qDebug() << "Elapsed since surface damaged until sending a frame callback:" << damageToFrame << "ms";
+                qCDebug(lsmScheduler) << "Elapsed since surface damaged until sending a frame callback:" << damageToFrame << "ms";
 
             m_sinceSurfaceDamaged.invalidate();
         }
@@ -290,20 +479,44 @@ void UpdateScheduler::scheduleFrameCallback()
     // How long takes from last vsync
     int elapsed = (m_vsyncElapsedTimer.nsecsElapsed() % m_vsyncNsecsInterval) / 1000000;
     int remain = double2int(m_vsyncInterval - elapsed);
+    if (m_vsyncPredictor.isLocked()) {
+        qint64 now = DeadlineTimer::now();
+        remain = (m_vsyncPredictor.nextFlipAfter(now) - now) / 1000000;
+    }
     int nextFrameTime = remain + m_updateTimerInterval - (m_frameToDamaged + RENDER_FLUCTUATION_BUFFER_TIME);
     nextFrameTime = nextFrameTime < 0 ? 0 : nextFrameTime;
     m_frameTimerInterval = nextFrameTime <= m_frameTimerInterval
         ? nextFrameTime : m_frameTimerInterval + 1;
 
     if (debug_render)
-        qDebug() << "sinceVsync" << elapsed << "m_frameToDamaged" << m_frameToDamaged << "next" << nextFrameTime << "timer" << m_frameTimerInterval;
+        qCDebug(lsmScheduler) << "sinceVsync" << elapsed << "m_frameToDamaged" << m_frameToDamaged << "next" << nextFrameTime << "timer" << m_frameTimerInterval;
 
     if (m_adaptiveFrame) {
         if (m_frameTimer.isActive()) {
-            qDebug() << "frameTimer is still active, skipped";
+            qCDebug(lsmScheduler) << "frameTimer is still active, skipped";
             return;
         }
-        m_frameTimer.start(m_frameTimerInterval);
+
+        // Each surface gets its frame callback as late as its own
+        // rendering time allows, so a slow client doesn't pace others.
+        int first = m_surfaceFrames.isEmpty() ? m_frameTimerInterval : std::numeric_limits<int>::max();
+        m_outputFrameInterval = m_surfaceFrames.isEmpty() ? m_frameTimerInterval : 0;
+        for (auto it = m_surfaceFrames.begin(); it != m_surfaceFrames.end(); ++it) {
+            int next = remain + m_updateTimerInterval - (it->frameToDamaged + RENDER_FLUCTUATION_BUFFER_TIME);
+            next = next < 0 ? 0 : next;
+            it->frameTimerInterval = next <= it->frameTimerInterval ? next : it->frameTimerInterval + 1;
+            it->handled = false;
+            it->throttled = false;
+
+            first = qMin(first, it->frameTimerInterval);
+            m_outputFrameInterval = qMax(m_outputFrameInterval, it->frameTimerInterval);
+
+            if (debug_render)
+                qCDebug(lsmScheduler) << it.key() << "frameToDamaged" << it->frameToDamaged << "next" << next << "timer" << it->frameTimerInterval;
+        }
+
+        m_sinceFrameScheduled.start();
+        m_frameTimer.start(first);
     }
 }
 
@@ -327,7 +540,7 @@ void UpdateScheduler::onBeforeSynchronizing()
 void UpdateScheduler::renderingAborted() {
     PMTRACE_FUNCTION;
 
-    qInfo() << "renderingAborted" << "m_hasUnhandledUpdateRequest:" << m_hasUnhandledUpdateRequest;
+    qCInfo(lsmScheduler) << "renderingAborted" << "m_hasUnhandledUpdateRequest:" << m_hasUnhandledUpdateRequest;
 
     m_framesOnUpdate = 0;
     m_frameSwapped = true;
@@ -350,6 +563,10 @@ void UpdateScheduler::onAfterRendering()
 void UpdateScheduler::setNextUpdateWithDefaultNotifier()
 {
     PMTRACE_FUNCTION;
+    if (m_sinceUpdateRequest.isValid())
+        m_pendingTiming[FrameTimingStats::UpdateRequestToSwap] = m_sinceUpdateRequest.nsecsElapsed() / 1000;
+    m_sinceSwap.start();
+
     // Assume that page flip happens just after the swapbuffer with the constant time
     int timeSinceRenderingToSwapBuffer = m_timeSpentForRendering + STATIC_SWAP_BUFFER_TIME;
     m_updateTimerInterval =
@@ -363,8 +580,15 @@ void UpdateScheduler::onLegacyPageFlipped()
     if (Q_LIKELY(m_framesOnUpdate > 0))
         m_framesOnUpdate--;
 
+    m_vsyncCount++;
+    addTimingRecord();
+    for (auto it = m_surfaceFrames.begin(); it != m_surfaceFrames.end(); ++it) {
+        it->handled = false;
+        it->throttled = false;
+    }
+
     if (m_adaptiveUpdate) {
-        m_updateTimer.start(m_updateTimerInterval);
+        m_updateTimer.startAfter((qint64) m_updateTimerInterval * 1000000);
     }
 
     if (m_adaptiveFrame)
@@ -379,13 +603,135 @@ void UpdateScheduler::onFrameMissed()
     PMTRACE_FUNCTION;
 
     if (debug_render)
-        qDebug() << "FrameMissed";
+        qCDebug(lsmScheduler) << "FrameMissed";
     m_updateTimerInterval--;
 
     if (m_updateTimerInterval < 0)
         m_updateTimerInterval = 0;
 
     m_frameCount = 0;
+    m_pendingMissed = true;
+
+    m_framesOnTime = 0;
+    m_deadlineMargin = qMin(m_deadlineMargin + DEADLINE_MARGIN_STEP, (qint64) m_vsyncNsecsInterval / 2);
+}
+
+void UpdateScheduler::onPageFlipped(quint32 seq, quint32 tv_sec, quint32 tv_nsec)
+{
+    m_vsyncPredictor.addFlip(seq, (qint64) tv_sec * 1000000000 + tv_nsec);
+
+    if (m_vsyncPredictor.isLocked()) {
+        m_vsyncNsecsInterval = m_vsyncPredictor.period();
+        m_vsyncInterval = m_vsyncNsecsInterval / 1000000.0;
+    }
+
+    if (++m_framesOnTime >= DEADLINE_MARGIN_DECAY_FRAMES) {
+        m_framesOnTime = 0;
+        m_deadlineMargin = qMax(m_deadlineMargin - DEADLINE_MARGIN_STEP, DEADLINE_MARGIN_MIN);
+    }
+}
+
+void UpdateScheduler::onRefreshRateChanged(qreal refreshRate)
+{
+    if (refreshRate <= 0)
+        return;
+
+    qCInfo(lsmScheduler) << "Refresh rate changed to" << refreshRate << "for window" << m_window;
+    m_vsyncInterval = 1.0 / refreshRate * 1000;
+    m_vsyncNsecsInterval = double2int(m_vsyncInterval * 1000000);
+    m_vsyncPredictor.setNominalPeriod(m_vsyncNsecsInterval);
+    m_contentTarget = 0;
+}
+
+void UpdateScheduler::updateContentRate()
+{
+    qreal rate = 0;
+
+    if (!m_sinceSceneUpdate.isValid() || m_sinceSceneUpdate.elapsed() > SCENE_IDLE_TIME)
+        rate = m_contentRateDetector.dominantRate(DeadlineTimer::now());
+
+    // Not worth unless the content is well below the panel rate
+    if (rate * 1.5 > m_panelRate)
+        rate = 0;
+
+    if (qFuzzyCompare(rate + 1, m_contentRateHz + 1))
+        return;
+
+    qCInfo(lsmScheduler) << "Content rate" << rate << "(panel rate" << m_panelRate << ") for window" << m_window;
+    m_contentRateHz = rate;
+    m_contentTarget = 0;
+
+    // Fall back to frame skipping unless the platform matches the mode
+    if (m_setContentRateFunc)
+        m_contentRateModeSet = m_setContentRateFunc(m_window->screen(), rate) && rate > 0;
+}
+
+/* Starts the update so that it finishes just before the predicted vsync,
+   but not later than the maximum idle time after the last flip. */
+void UpdateScheduler::startUpdateTimer()
+{
+    if (!m_vsyncPredictor.isValid()) {
+        m_updateTimer.startAfter((qint64) m_updateTimerInterval * 1000000);
+        return;
+    }
+
+    qint64 now = DeadlineTimer::now();
+    qint64 nextFlip = m_vsyncPredictor.nextFlipAfter(now);
+
+    // Skip vsyncs to follow the content rate, aiming at the vsync
+    // nearest to the ideal time of each content frame for even pacing.
+    bool pacing = m_contentRateHz > 0 && !m_contentRateModeSet;
+    if (pacing) {
+        qint64 contentInterval = 1000000000 / m_contentRateHz;
+        if (m_contentTarget == 0 || m_contentTarget + contentInterval < nextFlip)
+            m_contentTarget = nextFlip;
+        else
+            m_contentTarget += contentInterval;
+        nextFlip = qMax(nextFlip, m_vsyncPredictor.nextFlipAfter(m_contentTarget - m_vsyncPredictor.period() / 2));
+    }
+
+    qint64 deadline = nextFlip - (m_renderCost + m_deadlineMargin);
+    qint64 latest = m_vsyncPredictor.lastFlip() + (qint64) s_default_update_idle_time * 1000000;
+
+    if (!pacing)
+        deadline = qMin(deadline, latest);
+    deadline = qMax(deadline, now);
+    // Idle time after the flip, used for the frame callback as well
+    m_updateTimerInterval = (int) ((deadline - m_vsyncPredictor.lastFlip()) / 1000000);
+
+    if (debug_render)
+        qCDebug(lsmScheduler) << "nextFlip in" << (nextFlip - now) / 1000 << "us" << "update in" << (deadline - now) / 1000 << "us"
+                 << "renderCost" << m_renderCost / 1000 << "us" << "margin" << m_deadlineMargin / 1000 << "us";
+
+    m_updateTimer.start(deadline);
+}
+
+void UpdateScheduler::addTimingRecord()
+{
+    m_pendingTiming[FrameTimingStats::SwapToPageFlip] = m_sinceSwap.isValid() ? m_sinceSwap.nsecsElapsed() / 1000 : 0;
+    m_timingStats.addFrame(m_pendingTiming, m_pendingMissed);
+
+    for (int m = 0; m < FrameTimingStats::MetricCount; m++)
+        m_pendingTiming[m] = 0;
+    m_pendingMissed = false;
+    m_sinceSwap.invalidate();
+
+    if (m_timingStats.frames() % TIMING_STATS_NOTIFY_FRAMES == 0)
+        emit timingStatsUpdated();
+}
+
+/* Whether the frame to come has more than new content of surface items,
+   judged by the items to be synchronized as WebOSCompositorWindow does
+   for damage tracking. Animations dirty their items every frame. */
+bool UpdateScheduler::sceneChanged() const
+{
+    QQuickWindowPrivate *d = QQuickWindowPrivate::get(m_window);
+    for (QQuickItem *item = d->dirtyItemList; item; item = QQuickItemPrivate::get(item)->nextDirtyItem) {
+        if (!qobject_cast<WebOSSurfaceItem *>(item) ||
+            (QQuickItemPrivate::get(item)->dirtyAttributes & ~QQuickItemPrivate::Content))
+            return true;
+    }
+    return false;
 }
 
 void UpdateScheduler::frameStarted()
@@ -394,16 +740,22 @@ void UpdateScheduler::frameStarted()
 
     QElapsedTimer timer;
     timer.start();
+    m_sinceUpdateRequest.start();
+
+    // Surface damage may come along with changes of the scene, such as
+    // an animation or cursor over a video, which keep the full rate
+    if (sceneChanged())
+        m_sinceSceneUpdate.start();
 
     m_framesOnUpdate++;
     if (m_framesOnUpdate > 1) {
-        qWarning() << "frames on update is " << m_framesOnUpdate << " (over 1)";
+        qCWarning(lsmScheduler) << "frames on update is " << m_framesOnUpdate << " (over 1)";
     }
 
     if (debug_render) {
         struct timespec ts;
         clock_gettime(CLOCK_MONOTONIC, &ts);
-        qDebug() << "sinceDamaged:" << m_sinceSurfaceDamaged.elapsed() << "ms" << "sinceVsync" << m_vsyncElapsedTimer.elapsed() << "ms" << "timestamp" << ts.tv_sec << ts.tv_nsec / 1000 << "us";
+        qCDebug(lsmScheduler) << "sinceDamaged:" << m_sinceSurfaceDamaged.elapsed() << "ms" << "sinceVsync" << m_vsyncElapsedTimer.elapsed() << "ms" << "timestamp" << ts.tv_sec << ts.tv_nsec / 1000 << "us";
         m_frameTimerQueue << timer;
     }
 
@@ -414,23 +766,31 @@ void UpdateScheduler::onFrameSwapped()
 {
     PMTRACE_FUNCTION;
 
+    if (m_sinceUpdateRequest.isValid()) {
+        qint64 cost = m_sinceUpdateRequest.nsecsElapsed();
+        m_pendingTiming[FrameTimingStats::UpdateRequestToSwap] = cost / 1000;
+        // Follow increase immediately and decrease slowly
+        m_renderCost = cost > m_renderCost ? cost : m_renderCost - (m_renderCost - cost) / 16;
+    }
+    m_sinceSwap.start();
+
     if (debug_render) {
         int updateRequestToSwap = 0;
         struct timespec ts;
         clock_gettime(CLOCK_MONOTONIC, &ts);
-        qDebug() << "timestamp" << ts.tv_sec << ts.tv_nsec / 1000 << "us";
+        qCDebug(lsmScheduler) << "timestamp" << ts.tv_sec << ts.tv_nsec / 1000 << "us";
 
         if (Q_LIKELY(!m_frameTimerQueue.isEmpty())) {
             QElapsedTimer timer = m_frameTimerQueue.head();
             updateRequestToSwap = timer.nsecsElapsed()/1000;
-            qDebug() << "updateRequestToSwap" << updateRequestToSwap << "us";
+            qCDebug(lsmScheduler) << "updateRequestToSwap" << updateRequestToSwap << "us";
         }
     }
 
     if(m_framesOnUpdate == 0) {
-        qDebug() << "onFrameSwapped is called after frameFinished";
+        qCDebug(lsmScheduler) << "onFrameSwapped is called after frameFinished";
         if(!m_updateTimer.isActive()) {
-            m_updateTimer.start(0);
+            m_updateTimer.startAfter(0);
         }
     }
 
@@ -446,6 +806,10 @@ void UpdateScheduler::frameFinished()
     if (Q_LIKELY(m_framesOnUpdate > 0))
         m_framesOnUpdate--;
 
+    m_vsyncCount++;
+    addTimingRecord();
+    if (m_contentRateMatch)
+        updateContentRate();
     m_frameCount++;
     // Try to have more idle time if frame hits on time for some duration.
     if (m_frameCount >= threshHold) {
@@ -457,11 +821,11 @@ void UpdateScheduler::frameFinished()
     m_updateTimerInterval = qMin(m_updateTimerInterval, s_default_update_idle_time);
 
     if (m_adaptiveUpdate && m_framesOnUpdate == 0) {
-        m_updateTimer.start(m_updateTimerInterval);
+        startUpdateTimer();
     }
 
     if (debug_render)
-        qDebug() << "m_framesOnUpdate" << m_framesOnUpdate << "m_updateTimerInterval" << m_updateTimerInterval << "m_frameTimerInterval" << m_frameTimerInterval;
+        qCDebug(lsmScheduler) << "m_framesOnUpdate" << m_framesOnUpdate << "m_updateTimerInterval" << m_updateTimerInterval << "m_frameTimerInterval" << m_frameTimerInterval;
 
     m_vsyncElapsedTimer.start();
 }
@@ -479,7 +843,7 @@ void UpdateScheduler::profileFrame(quint32 seq, quint32 tv_sec, quint32 tv_nsec)
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC, &ts);
 
-    qDebug() << "updateRequestToFlip" << updateRequestToFlip << "us framesInterval" << frameIntervalTimer.nsecsElapsed()/1000000.0 << "timestamp" << ts.tv_sec << ts.tv_nsec/1000 << "us";
+    qCDebug(lsmScheduler) << "updateRequestToFlip" << updateRequestToFlip << "us framesInterval" << frameIntervalTimer.nsecsElapsed()/1000000.0 << "timestamp" << ts.tv_sec << ts.tv_nsec/1000 << "us";
     emit m_window->frameProfileUpdated(updateRequestToFlip, frameIntervalTimer.nsecsElapsed()/1000);
     frameIntervalTimer.start();
 }
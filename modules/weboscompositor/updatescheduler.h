@@ -20,15 +20,30 @@
 #include <WebOSCoreCompositor/weboscompositorexport.h>
 
 #include <QQueue>
+#include <QHash>
+#include <QSet>
 #include <QTimer>
 #include <QElapsedTimer>
 #include <QLoggingCategory>
 
+#include <functional>
+
+#include "frametimingstats.h"
+#include "deadlinetimer.h"
+#include "vsyncpredictor.h"
+#include "contentratedetector.h"
+
+class QScreen;
 class WebOSCompositorWindow;
+class WebOSSurfaceItem;
 
 class WEBOS_COMPOSITOR_EXPORT UpdateScheduler : public QObject{
     Q_OBJECT
 public:
+    /* Returns the number of vsyncs between frame callbacks for the item.
+       1 or less means no throttling. Applied with adaptive frame callback only. */
+    typedef std::function<int(WebOSSurfaceItem *)> FrameThrottlePolicy;
+
     UpdateScheduler(WebOSCompositorWindow *);
 
     void init();
@@ -38,22 +53,33 @@ public:
 
     void checkTimeout();
 
-    void surfaceDamaged();
+    void surfaceDamaged(WebOSSurfaceItem *item = nullptr);
     void sendFrame();
 
+    void setFrameThrottlePolicy(FrameThrottlePolicy policy) { m_throttlePolicy = policy; }
+    static int defaultFrameThrottlePolicy(WebOSSurfaceItem *item);
+
     void frameStarted();
 
     bool vsyncCorrection();
 
     static void pageFlipNotifier(WebOSCompositorWindow* win, unsigned int seq, unsigned int tv_sec, unsigned int tv_usec);
 
+    qreal contentRate() const { return m_contentRateHz; }
+
+    const FrameTimingStats &timingStats() const { return m_timingStats; }
+    void resetTimingStats() { m_timingStats.reset(); }
+
 signals:
     void frameMissed();
     void pageFlipped(quint32, quint32, quint32);
     void legacyPageFlipped();
+    void timingStatsUpdated();
 
 private slots:
     void frameFinished();
+    void onPageFlipped(quint32, quint32, quint32);
+    void onRefreshRateChanged(qreal refreshRate);
     void profileFrame(quint32, quint32, quint32);
     void onFrameSwapped();
     void onFrameMissed();
@@ -69,13 +95,32 @@ private slots:
     void renderingAborted();
 
 private:
+    // Frame callback pacing for each surface item
+    struct SurfaceFrame {
+        QElapsedTimer sinceSendFrame;
+        int frameToDamaged = 0;
+        int frameTimerInterval = 0;
+        quint32 lastSentVsync = 0;
+        bool handled = true; // for the current vsync
+        bool throttled = false;
+    };
+
+    bool isThrottled(WebOSSurfaceItem *item, const SurfaceFrame &frame) const;
+    void sendFrameToSurface(WebOSSurfaceItem *item, SurfaceFrame &frame);
+    void sendFrameToOutput();
+    void addTimingRecord();
+    void startUpdateTimer();
+    void trackItem(WebOSSurfaceItem *item);
+    void updateContentRate();
+    bool sceneChanged() const;
+
     WebOSCompositorWindow *m_window = nullptr;
 
     qreal m_vsyncInterval = 1.0 / 60 * 1000;
 
     bool m_adaptiveUpdate = false;
 
-    QTimer m_updateTimer;
+    DeadlineTimer m_updateTimer;
     bool m_hasUnhandledUpdateRequest = false;
     int m_updateTimerInterval = 0;
 
@@ -88,8 +133,32 @@ private:
 
     int m_frameToDamaged = 0;
 
+    QSet<WebOSSurfaceItem *> m_trackedItems;
+    QHash<WebOSSurfaceItem *, SurfaceFrame> m_surfaceFrames;
+    FrameThrottlePolicy m_throttlePolicy = &UpdateScheduler::defaultFrameThrottlePolicy;
+    QElapsedTimer m_sinceFrameScheduled;
+    int m_outputFrameInterval = 0;
+    quint32 m_vsyncCount = 0;
+
     int m_vsyncNsecsInterval = 1000000000 / 60;
 
+    // Deadline based update with page flip notifier
+    VsyncPredictor m_vsyncPredictor;
+    qint64 m_renderCost = 0; // update request to swap, in ns
+    qint64 m_deadlineMargin = 0; // in ns
+    quint32 m_framesOnTime = 0;
+
+    // Content rate matching
+    bool m_contentRateMatch = false;
+    ContentRateDetector m_contentRateDetector;
+    qreal m_panelRate = 60;
+    qreal m_contentRateHz = 0;
+    bool m_contentRateModeSet = false;
+    qint64 m_contentTarget = 0;
+    // Since the last frame that changed more than surface content
+    QElapsedTimer m_sinceSceneUpdate;
+    bool (*m_setContentRateFunc)(QScreen *, qreal) = nullptr;
+
     //Debug Timers
     QElapsedTimer m_sinceSendFrame;
     QElapsedTimer m_sinceSurfaceDamaged;
@@ -101,6 +170,13 @@ private:
     int m_timeSpentForRendering;
 
     bool m_frameSwapped = true;
+
+    // Frame timing statistics
+    FrameTimingStats m_timingStats;
+    QElapsedTimer m_sinceUpdateRequest;
+    QElapsedTimer m_sinceSwap;
+    quint32 m_pendingTiming[FrameTimingStats::MetricCount] = {};
+    bool m_pendingMissed = false;
 };
 
 #endif // UPDATESCHEDULER_H
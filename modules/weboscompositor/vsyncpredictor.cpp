@@ -0,0 +1,124 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <QDebug>
+
+#include "vsyncpredictor.h"
+
+VsyncPredictor::VsyncPredictor(qint64 nominalPeriod)
+    : m_nominalPeriod(nominalPeriod)
+    , m_period(nominalPeriod)
+{
+}
+
+void VsyncPredictor::setNominalPeriod(qint64 period)
+{
+    if (period <= 0 || period == m_nominalPeriod)
+        return;
+
+    m_nominalPeriod = period;
+    reset();
+}
+
+void VsyncPredictor::reset()
+{
+    m_head = 0;
+    m_count = 0;
+    m_period = m_nominalPeriod;
+    m_phase = 0;
+}
+
+void VsyncPredictor::addFlip(quint32 sequence, qint64 timestamp)
+{
+    if (m_count > 0) {
+        const Sample &last = m_samples[(m_head + MAX_SAMPLES - 1) % MAX_SAMPLES];
+        quint32 gap = sequence - last.sequence;
+        if (gap == 0 || gap > MAX_SEQUENCE_GAP || timestamp <= last.timestamp) {
+            reset();
+        } else if (isLocked()) {
+            // A flip far from the prediction means the timing has changed
+            // (mode set, VRR, clock jump), so start over.
+            qint64 predicted = m_phase + (qint64) gap * m_period;
+            if (qAbs(timestamp - predicted) > m_period / 2) {
+                qInfo() << "Vsync prediction off by" << (timestamp - predicted) << "ns, reset";
+                reset();
+            }
+        }
+    }
+
+    m_samples[m_head] = { sequence, timestamp };
+    m_head = (m_head + 1) % MAX_SAMPLES;
+    if (m_count < MAX_SAMPLES)
+        m_count++;
+
+    fit();
+}
+
+void VsyncPredictor::fit()
+{
+    const Sample &last = m_samples[(m_head + MAX_SAMPLES - 1) % MAX_SAMPLES];
+
+    if (!isLocked()) {
+        m_phase = last.timestamp;
+        m_period = m_nominalPeriod;
+        return;
+    }
+
+    // Least squares of timestamp over sequence, relative to the last
+    // sample to keep the values small enough for double precision.
+    double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+    for (int i = 0; i < m_count; i++) {
+        const Sample &s = m_samples[i];
+        double x = -(double) (quint32) (last.sequence - s.sequence);
+        double y = (double) (s.timestamp - last.timestamp);
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumXY += x * y;
+    }
+
+    double n = m_count;
+    double denom = n * sumXX - sumX * sumX;
+    if (denom <= 0) {
+        m_phase = last.timestamp;
+        return;
+    }
+
+    double slope = (n * sumXY - sumX * sumY) / denom;
+    double intercept = (sumY - slope * sumX) / n;
+
+    // Out of sane range, keep the nominal period
+    if (slope < m_nominalPeriod / 2 || slope > m_nominalPeriod * 2) {
+        m_period = m_nominalPeriod;
+        m_phase = last.timestamp;
+        return;
+    }
+
+    m_period = (qint64) slope;
+    m_phase = last.timestamp + (qint64) intercept;
+}
+
+qint64 VsyncPredictor::nextFlipAfter(qint64 time) const
+{
+    qint64 p = period();
+    if (!isValid() || p <= 0)
+        return time + p;
+
+    if (time < m_phase)
+        return m_phase;
+
+    return m_phase + ((time - m_phase) / p + 1) * p;
+}
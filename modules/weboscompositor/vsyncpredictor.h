@@ -0,0 +1,69 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef VSYNCPREDICTOR_H
+#define VSYNCPREDICTOR_H
+
+#include <WebOSCoreCompositor/weboscompositorexport.h>
+
+#include <QtGlobal>
+
+/* Predicts upcoming vsync times from the page flip sequence numbers and
+   timestamps by a linear regression over the recent flips.
+   Timestamps are in nanoseconds of CLOCK_MONOTONIC. */
+class WEBOS_COMPOSITOR_EXPORT VsyncPredictor
+{
+public:
+    explicit VsyncPredictor(qint64 nominalPeriod = 1000000000 / 60);
+
+    void setNominalPeriod(qint64 period);
+    void addFlip(quint32 sequence, qint64 timestamp);
+    void reset();
+
+    // Having any flip to predict from
+    bool isValid() const { return m_count > 0; }
+    // Having enough flips for the regression
+    bool isLocked() const { return m_count >= MIN_SAMPLES; }
+
+    qint64 period() const { return isLocked() ? m_period : m_nominalPeriod; }
+    qint64 lastFlip() const { return m_phase; }
+    // The first vsync time later than the given time
+    qint64 nextFlipAfter(qint64 time) const;
+
+private:
+    void fit();
+
+    static constexpr int MAX_SAMPLES = 16;
+    static constexpr int MIN_SAMPLES = 4;
+    // Flips farther apart than this are regarded as a new start
+    static constexpr quint32 MAX_SEQUENCE_GAP = 120;
+
+    struct Sample {
+        quint32 sequence;
+        qint64 timestamp;
+    };
+
+    Sample m_samples[MAX_SAMPLES];
+    int m_head = 0;
+    int m_count = 0;
+
+    qint64 m_nominalPeriod;
+    qint64 m_period;
+    // Fitted time of the last flip
+    qint64 m_phase = 0;
+};
+
+#endif // VSYNCPREDICTOR_H
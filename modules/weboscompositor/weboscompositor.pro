@@ -37,6 +37,11 @@ DEFINES += WEBOS_INSTALL_QML=\\\"$$WEBOS_INSTALL_QML\\\" \
     DEFINES += USE_PMLOGLIB
 }
 
+# Compile out debug level logging of the module
+no_debug_log {
+    DEFINES += QT_NO_DEBUG_OUTPUT
+}
+
 # This is needed to use QWaylandQuickSurface with qtwayland 5.12
 DEFINES += QT_WAYLAND_COMPOSITOR_QUICK
 
@@ -71,6 +76,14 @@ HEADERS += \
     compositorextensionfactory.h \
     unixsignalhandler.h \
     updatescheduler.h \
+    frametimingstats.h \
+    asynclogger.h \
+    weboscompositorlogging.h \
+    surfacehitindex.h \
+    cursorimagecache.h \
+    deadlinetimer.h \
+    vsyncpredictor.h \
+    contentratedetector.h \
     profiler.h \
     debugtypes.h
 
@@ -94,6 +107,14 @@ SOURCES += \
     compositorextensionfactory.cpp \
     unixsignalhandler.cpp \
     updatescheduler.cpp \
+    frametimingstats.cpp \
+    asynclogger.cpp \
+    weboscompositorlogging.cpp \
+    surfacehitindex.cpp \
+    cursorimagecache.cpp \
+    deadlinetimer.cpp \
+    vsyncpredictor.cpp \
+    contentratedetector.cpp \
     profiler.cpp \
     debugtypes.cpp
 
@@ -0,0 +1,68 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "weboscompositorlogging.h"
+
+#include <time.h>
+
+Q_LOGGING_CATEGORY(lsmInput, "lsm.input", QtInfoMsg)
+Q_LOGGING_CATEGORY(lsmScheduler, "lsm.scheduler", QtInfoMsg)
+Q_LOGGING_CATEGORY(lsmForeign, "lsm.foreign", QtInfoMsg)
+Q_LOGGING_CATEGORY(lsmShell, "lsm.shell", QtInfoMsg)
+Q_LOGGING_CATEGORY(lsmModel, "lsm.model", QtInfoMsg)
+Q_LOGGING_CATEGORY(lsmCursor, "lsm.cursor", QtInfoMsg)
+
+static inline qint64 monotonicNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+LogRateLimiter::LogRateLimiter(int ratePerSecond, int burst)
+    : m_intervalNs(1000000000LL / qMax(1, ratePerSecond))
+    , m_burstNs(m_intervalNs * qMax(0, burst - 1))
+    , m_tat(0)
+    , m_suppressed(0)
+{
+}
+
+bool LogRateLimiter::tryAcquire(Suppressed *suppressed)
+{
+    const qint64 now = monotonicNs();
+    qint64 tat = m_tat.load(std::memory_order_relaxed);
+    do {
+        const qint64 start = qMax(tat, now);
+        if (start - m_burstNs > now) {
+            m_suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (m_tat.compare_exchange_weak(tat, start + m_intervalNs, std::memory_order_relaxed))
+            break;
+    } while (true);
+
+    suppressed->count = m_suppressed.exchange(0, std::memory_order_relaxed);
+    return true;
+}
+
+QDebug operator<<(QDebug dbg, const LogRateLimiter::Suppressed &suppressed)
+{
+    if (suppressed.count > 0) {
+        QDebugStateSaver saver(dbg);
+        dbg.nospace() << "[" << suppressed.count << " suppressed]";
+    }
+    return dbg;
+}
@@ -0,0 +1,94 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef WEBOSCOMPOSITORLOGGING_H
+#define WEBOSCOMPOSITORLOGGING_H
+
+#include <WebOSCoreCompositor/weboscompositorexport.h>
+
+#include <QDebug>
+#include <QLoggingCategory>
+
+#include <atomic>
+
+/* Logging categories of the compositor hot paths.
+   Debug output is disabled by default and can be turned on with
+   QT_LOGGING_RULES, e.g. "lsm.input.debug=true". qCDebug and friends
+   check the category before evaluating any argument.
+   Building with CONFIG+=no_debug_log compiles debug sites out. */
+WEBOS_COMPOSITOR_EXPORT Q_DECLARE_LOGGING_CATEGORY(lsmInput)
+WEBOS_COMPOSITOR_EXPORT Q_DECLARE_LOGGING_CATEGORY(lsmScheduler)
+WEBOS_COMPOSITOR_EXPORT Q_DECLARE_LOGGING_CATEGORY(lsmForeign)
+WEBOS_COMPOSITOR_EXPORT Q_DECLARE_LOGGING_CATEGORY(lsmShell)
+WEBOS_COMPOSITOR_EXPORT Q_DECLARE_LOGGING_CATEGORY(lsmModel)
+WEBOS_COMPOSITOR_EXPORT Q_DECLARE_LOGGING_CATEGORY(lsmCursor)
+
+/* Token bucket for a single call site, allowing a burst of messages
+   and then ratePerSecond on average. Lock-free, so call sites shared
+   by threads need no extra care. */
+class WEBOS_COMPOSITOR_EXPORT LogRateLimiter
+{
+public:
+    struct Suppressed {
+        quint32 count = 0;
+        bool done = false;
+    };
+
+    LogRateLimiter(int ratePerSecond, int burst);
+
+    // Returns whether a message may be logged now. If so, suppressed is
+    // set to the number of messages dropped since the last one.
+    bool tryAcquire(Suppressed *suppressed);
+
+private:
+    const qint64 m_intervalNs;
+    const qint64 m_burstNs;
+    // Theoretical arrival time of the next message, as in GCRA
+    std::atomic<qint64> m_tat;
+    std::atomic<quint32> m_suppressed;
+};
+
+WEBOS_COMPOSITOR_EXPORT QDebug operator<<(QDebug dbg, const LogRateLimiter::Suppressed &suppressed);
+
+// Like qCDebug, the arguments are not evaluated if the message is dropped.
+// The limiter is a static local of a lambda, so every call site has its own.
+#define LSM_RATE_LIMITED_LOGGER(category, level, ratePerSecond, burst) \
+    for (LogRateLimiter::Suppressed lsm_suppressed = LogRateLimiter::Suppressed(); \
+         !lsm_suppressed.done && category().is##level##Enabled() && \
+             [] () -> LogRateLimiter & { static LogRateLimiter limiter(ratePerSecond, burst); return limiter; }().tryAcquire(&lsm_suppressed); \
+         lsm_suppressed.done = true)
+
+#if defined(QT_NO_DEBUG_OUTPUT)
+#define qCDebugLimited(category, ratePerSecond, burst) QT_NO_QDEBUG_MACRO()
+#else
+#define qCDebugLimited(category, ratePerSecond, burst) \
+    LSM_RATE_LIMITED_LOGGER(category, Debug, ratePerSecond, burst) \
+        QMessageLogger(QT_MESSAGELOG_FILE, QT_MESSAGELOG_LINE, QT_MESSAGELOG_FUNC, category().categoryName()).debug() << lsm_suppressed
+#endif
+
+#if defined(QT_NO_INFO_OUTPUT)
+#define qCInfoLimited(category, ratePerSecond, burst) QT_NO_QDEBUG_MACRO()
+#else
+#define qCInfoLimited(category, ratePerSecond, burst) \
+    LSM_RATE_LIMITED_LOGGER(category, Info, ratePerSecond, burst) \
+        QMessageLogger(QT_MESSAGELOG_FILE, QT_MESSAGELOG_LINE, QT_MESSAGELOG_FUNC, category().categoryName()).info() << lsm_suppressed
+#endif
+
+#define qCWarningLimited(category, ratePerSecond, burst) \
+    LSM_RATE_LIMITED_LOGGER(category, Warning, ratePerSecond, burst) \
+        QMessageLogger(QT_MESSAGELOG_FILE, QT_MESSAGELOG_LINE, QT_MESSAGELOG_FUNC, category().categoryName()).warning() << lsm_suppressed
+
+#endif // WEBOSCOMPOSITORLOGGING_H
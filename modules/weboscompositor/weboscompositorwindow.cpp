@@ -14,6 +14,7 @@
 //
 // SPDX-License-Identifier: Apache-2.0
 
+#include <QQmlComponent>
 #include <QQmlContext>
 #include <QQuickItem>
 #include <QMetaObject>
@@ -26,6 +27,7 @@
 #include <QDebug>
 #include <QStringList>
 #include <QUrlQuery>
+#include <QTransform>
 
 #include <qpa/qplatformscreen.h>
 
@@ -40,12 +42,17 @@
 #include "weboscompositorpluginloader.h"
 #include "weboscompositorconfig.h"
 #include "weboscompositortracer.h"
+#include "weboscompositorlogging.h"
 #include "updatescheduler.h"
 #include "securecoding.h"
 #include "debugtypes.h"
+#include "surfacehitindex.h"
+#include "profiler.h"
 
 static int s_displays = 0;
 
+static bool s_damageTrackingDebug = qgetenv("WEBOS_COMPOSITOR_DAMAGE_TRACKING_DEBUG").toInt() == 1;
+
 WebOSCompositorWindow::WebOSCompositorWindow(QString screenName, QString geometryString, QSurfaceFormat *surfaceFormat)
     : QQuickView()
     , m_compositor(0)
@@ -117,6 +124,14 @@ WebOSCompositorWindow::WebOSCompositorWindow(QString screenName, QString geometr
 
     // Start with cursor invisible
     invalidateCursor();
+
+    // Surface items add themselves once they get into this window
+    m_hitIndex.reset(new SurfaceHitIndex(contentItem()));
+    m_hitIndex->setSceneSize(size());
+    connect(this, &QWindow::widthChanged, this, [this]() { m_hitIndex->setSceneSize(size()); });
+    connect(this, &QWindow::heightChanged, this, [this]() { m_hitIndex->setSceneSize(size()); });
+
+    initDamageTracking();
 }
 
 WebOSCompositorWindow::~WebOSCompositorWindow()
@@ -262,6 +277,8 @@ void WebOSCompositorWindow::setCompositor(WebOSCoreCompositor* compositor)
         // Set global context properties available to qml everywhere
         rootContext()->setContextProperty(QLatin1String("compositor"), m_compositor);
         rootContext()->setContextProperty(QLatin1String("compositorWindow"), this);
+
+        connect(m_compositor, &WebOSCoreCompositor::dumpFrameTimingStats, this, &WebOSCompositorWindow::dumpFrameTimingStats);
     }
 }
 
@@ -293,6 +310,15 @@ bool WebOSCompositorWindow::setCompositorMain(const QUrl& main, const QString& i
     qInfo() << "Using main QML" << m_main << "for window" << this;
 
     if (m_compositor) {
+        const QString output = screen() ? screen()->name() : QString();
+        const bool traceQmlCompile = Profiler::instance() && Profiler::instance()->traceQmlCompile();
+        if (traceQmlCompile) {
+            // Compile ahead so that setSource only instantiates. The
+            // compiled type stays in the type cache of the engine.
+            Profiler::Span span("qml-compile", output);
+            QQmlComponent component(engine(), m_main);
+        }
+        Profiler::Span span(traceQmlCompile ? "qml-instantiate" : "qml-load", output);
         setSource(m_main);
         qInfo() << "Loaded main QML" << m_main << "for window" << this;
     } else {
@@ -513,7 +539,7 @@ void WebOSCompositorWindow::onOutputGeometryPendingExpired()
 void WebOSCompositorWindow::setDefaultCursor()
 {
     /* Qt::ArrowCursor means system default cursor */
-    qDebug() << "Cursor: set the default cursor for" << this;
+    qCDebug(lsmCursor) << "Cursor: set the default cursor for" << this;
     setCursor(QCursor(Qt::ArrowCursor));
 }
 
@@ -539,12 +565,12 @@ void WebOSCompositorWindow::updateCursorFocus(Qt::KeyboardModifiers modifiers)
 {
     QWindow *currentMouseWindow = QGuiApplicationPrivate::currentMouseWindow;
     if (currentMouseWindow && currentMouseWindow != static_cast<QWindow *>(this)) {
-        qDebug() << "Cursor: ignore updateCursorFocus because it's not current mouse window:" << this << " current:" << currentMouseWindow;
+        qCDebug(lsmCursor) << "Cursor: ignore updateCursorFocus because it's not current mouse window:" << this << " current:" << currentMouseWindow;
         return;
     }
 
     if (cursorVisible()) {
-        qDebug() << "Cursor: update cursor by sending a synthesized mouse event(visible case)";
+        qCDebug(lsmCursor) << "Cursor: update cursor by sending a synthesized mouse event(visible case)";
         QPointF localPos = QPointF(mapFromGlobal(QCursor::pos()));
         QPointF globalPos = QPointF(QCursor::pos());
         QMouseEvent *move = new QMouseEvent(QEvent::MouseMove,
@@ -553,7 +579,7 @@ void WebOSCompositorWindow::updateCursorFocus(Qt::KeyboardModifiers modifiers)
                 Qt::MouseEventSynthesizedByApplication);
         QCoreApplication::postEvent(this, move);
     } else {
-        qDebug() << "Cursor: let cursor be updated by upcoming event(invisible case)";
+        qCDebug(lsmCursor) << "Cursor: let cursor be updated by upcoming event(invisible case)";
         invalidateCursor();
     }
 }
@@ -814,6 +840,28 @@ bool WebOSCompositorWindow::hasSecuredContent()
 void WebOSCompositorWindow::initUpdateScheduler()
 {
     m_updateScheduler = new UpdateScheduler(this);
+    connect(m_updateScheduler, &UpdateScheduler::timingStatsUpdated, this, &WebOSCompositorWindow::frameTimingStatsChanged);
+}
+
+QVariantMap WebOSCompositorWindow::frameTimingStats() const
+{
+    return m_updateScheduler ? m_updateScheduler->timingStats().toVariantMap() : QVariantMap();
+}
+
+void WebOSCompositorWindow::resetFrameTimingStats()
+{
+    if (m_updateScheduler) {
+        m_updateScheduler->resetTimingStats();
+        emit frameTimingStatsChanged();
+    }
+}
+
+void WebOSCompositorWindow::dumpFrameTimingStats() const
+{
+    if (m_updateScheduler)
+        m_updateScheduler->timingStats().dump(m_displayName);
+    else
+        qInfo() << "No frame timing statistics for window" << this << "without update scheduler";
 }
 
 // handle UpdateRequest immediately
@@ -824,42 +872,84 @@ void WebOSCompositorWindow::deliverUpdateRequest()
     static_cast<void>(QQuickWindow::event(&request));
 }
 
-//TODO: consider for multiple items
+// Damage without region information, the whole window will be repainted
 void WebOSCompositorWindow::reportSurfaceDamaged(WebOSSurfaceItem* const item)
 {
-    Q_UNUSED(item);
+    m_damageFull = true;
     if (m_updateScheduler)
-        m_updateScheduler->surfaceDamaged();
+        m_updateScheduler->surfaceDamaged(item);
 }
 
-static WebOSSurfaceItem* findWebOSSurfaceItem(QQuickItem *base, const QPointF& point)
+void WebOSCompositorWindow::reportSurfaceDamaged(WebOSSurfaceItem* const item, const QRegion &sceneRegion)
 {
-    if (!base)
-        return nullptr;
+    if (m_damageTracking) {
+        m_damagedRegion += sceneRegion;
+        m_damagedItems.insert(item);
+    }
 
-    if (!base->isVisible() || !base->isEnabled() || QQuickItemPrivate::get(base)->culled)
-        return nullptr;
+    if (m_updateScheduler)
+        m_updateScheduler->surfaceDamaged(item);
+}
 
-    QList<QQuickItem*> children = QQuickItemPrivate::get(base)->paintOrderChildItems();
-    for (int ii = children.count() - 1; ii >= 0; --ii) {
-        QQuickItem *child = children.at(ii);
-        WebOSSurfaceItem *webosSurfaceItem = findWebOSSurfaceItem(child, point);
-        if (webosSurfaceItem)
-            return webosSurfaceItem;
-    }
+void WebOSCompositorWindow::initDamageTracking()
+{
+    m_damageTracking = qgetenv("WEBOS_COMPOSITOR_DAMAGE_TRACKING").toInt() == 1;
+    if (!m_damageTracking)
+        return;
+
+    // Only tracked and reported, rendering is not restricted to the damage
+    qInfo() << "Damage tracking enabled for window" << this;
+    connect(this, &QQuickWindow::beforeSynchronizing, this, &WebOSCompositorWindow::onBeforeSynchronizingDamage, Qt::DirectConnection);
+    connect(this, &QQuickWindow::afterRendering, this, &WebOSCompositorWindow::onAfterRenderingDamage, Qt::DirectConnection);
+}
 
-    WebOSSurfaceItem *webosSurfaceItem = qobject_cast<WebOSSurfaceItem*>(base);
-    if (webosSurfaceItem) {
-        if (webosSurfaceItem->isVisible() && webosSurfaceItem->QQuickItem::contains(webosSurfaceItem->mapFromScene(point)))
-            return webosSurfaceItem;
+/* The GUI thread is blocked while synchronizing, so it is safe to take
+   the damage accumulated so far and look into the dirty items here. */
+void WebOSCompositorWindow::onBeforeSynchronizingDamage()
+{
+    PMTRACE_FUNCTION;
+
+    bool full = m_damageFull || m_damagedRegion.isEmpty();
+
+    // Anything other than the content of a damaged surface item
+    // (animations, geometry changes, non-surface items) damages the whole window.
+    QQuickWindowPrivate *d = QQuickWindowPrivate::get(this);
+    for (QQuickItem *item = d->dirtyItemList; item && !full; item = QQuickItemPrivate::get(item)->nextDirtyItem) {
+        WebOSSurfaceItem *surfaceItem = qobject_cast<WebOSSurfaceItem *>(item);
+        if (!surfaceItem || !m_damagedItems.contains(surfaceItem) ||
+            (QQuickItemPrivate::get(item)->dirtyAttributes & ~QQuickItemPrivate::Content))
+            full = true;
     }
 
-    return nullptr;
+    qreal dpr = devicePixelRatio();
+    m_frameDeviceRect = QRect(QPoint(0, 0), size() * dpr);
+    m_frameDamage = full ? QRegion(m_frameDeviceRect) : QTransform::fromScale(dpr, dpr).map(m_damagedRegion) & m_frameDeviceRect;
+
+    m_damagedRegion = QRegion();
+    m_damagedItems.clear();
+    m_damageFull = false;
+}
+
+void WebOSCompositorWindow::onAfterRenderingDamage()
+{
+    PMTRACE_FUNCTION;
+
+    const QRect damageBounds = m_frameDamage.boundingRect();
+    const int damaged = damageBounds.width() * damageBounds.height();
+
+    if (s_damageTrackingDebug)
+        qDebug() << "Damage tracking:" << this << "damaged" << damaged << "of"
+                 << m_frameDeviceRect.width() * m_frameDeviceRect.height() << "pixels" << damageBounds;
+
+    if (m_damagedPixels.fetchAndStoreRelease(damaged) != damaged) {
+        // This is the render thread, bindings belong to the GUI thread
+        QMetaObject::invokeMethod(this, "damagedPixelsChanged", Qt::QueuedConnection);
+    }
 }
 
 WebOSSurfaceItem* WebOSCompositorWindow::itemAt(const QPointF& point)
 {
-    return findWebOSSurfaceItem(contentItem(), point);
+    return m_hitIndex->itemAt(point);
 }
 
 bool WebOSCompositorWindow::event(QEvent *e)
@@ -878,27 +968,32 @@ bool WebOSCompositorWindow::event(QEvent *e)
     case QEvent::TouchBegin:
     case QEvent::TouchEnd:
     case QEvent::TouchUpdate: {
+        // Nothing to do unless a debug overlay is listening
+        static const QMetaMethod debugTouchSignal = QMetaMethod::fromSignal(&WebOSCompositorWindow::debugTouchUpdated);
+        if (!isSignalConnected(debugTouchSignal))
+            break;
+
         QTouchEvent *touchEvent = static_cast<QTouchEvent*>(e);
-        DebugTouchEvent debugTouchEvent;
+        if (!m_debugTouchEvent)
+            m_debugTouchEvent = new DebugTouchEvent(this);
+        m_debugTouchEvent->clear();
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-        foreach (const QTouchEvent::TouchPoint &touchPoint, touchEvent->points()) {
-            DebugTouchPoint *point = new DebugTouchPoint(touchPoint.id());
+        for (const QTouchEvent::TouchPoint &touchPoint : touchEvent->points()) {
+            DebugTouchPoint *point = m_debugTouchEvent->nextDebugTouchPoint(touchPoint.id());
             point->setPos(touchPoint.position());
             point->setNormalizedPos(touchPoint.normalizedPosition());
             point->setState(touchPoint.state());
-            debugTouchEvent.appendDebugTouchPoint(point);
         }
 #else
-        foreach (const QTouchEvent::TouchPoint &touchPoint, touchEvent->touchPoints()) {
-            DebugTouchPoint *point = new DebugTouchPoint(touchPoint.id());
+        for (const QTouchEvent::TouchPoint &touchPoint : touchEvent->touchPoints()) {
+            DebugTouchPoint *point = m_debugTouchEvent->nextDebugTouchPoint(touchPoint.id());
             point->setPos(touchPoint.pos());
             point->setNormalizedPos(touchPoint.normalizedPos());
             point->setState(touchPoint.state());
-            debugTouchEvent.appendDebugTouchPoint(point);
         }
 #endif
-        emit debugTouchUpdated(&debugTouchEvent);
+        emit debugTouchUpdated(m_debugTouchEvent);
         break;
     }
 
@@ -27,11 +27,16 @@
 #include <QUrl>
 #include <QQuickItem>
 #include <QPointer>
+#include <QRegion>
+#include <QSet>
+#include <QAtomicInt>
+#include <QScopedPointer>
 
 #include <QWaylandQuickOutput>
 
 class QWaylandSeat;
 class DebugTouchEvent;
+class SurfaceHitIndex;
 class WebOSCoreCompositor;
 class WebOSSurfaceItem;
 class WebOSCompositorPluginLoader;
@@ -65,6 +70,10 @@ class WEBOS_COMPOSITOR_EXPORT WebOSCompositorWindow : public QQuickView {
     Q_PROPERTY(QString geometryConfig READ geometryConfig WRITE setGeometryConfig NOTIFY geometryConfigChanged)
     Q_PROPERTY(bool isWideOutputGeometry READ isWideOutputGeometry NOTIFY outputGeometryChanged)
 
+    Q_PROPERTY(bool damageTracking READ damageTracking CONSTANT)
+    Q_PROPERTY(int damagedPixels READ damagedPixels NOTIFY damagedPixelsChanged)
+    Q_PROPERTY(QVariantMap frameTimingStats READ frameTimingStats NOTIFY frameTimingStatsChanged)
+
 public:
     enum AppMirroringState {
         AppMirroringStateInactive = 1,
@@ -150,11 +159,24 @@ public:
 
     void deliverUpdateRequest();
     void reportSurfaceDamaged(WebOSSurfaceItem* const item);
+    void reportSurfaceDamaged(WebOSSurfaceItem* const item, const QRegion &sceneRegion);
     bool hasPageFlipNotifier() const { return m_hasPageFlipNotifier; }
 
     bool isWideOutputGeometry();
 
+    // Damage tracking collects the damaged part of the scene of each frame.
+    // damagedPixels is the size of its bounds in device pixels. The whole
+    // window is still repainted.
+    bool damageTracking() const { return m_damageTracking; }
+    int damagedPixels() const { return m_damagedPixels.loadAcquire(); }
+
+    // Frame timing percentiles in us, available with adaptive update
+    QVariantMap frameTimingStats() const;
+    Q_INVOKABLE void resetFrameTimingStats();
+    Q_INVOKABLE void dumpFrameTimingStats() const;
+
     Q_INVOKABLE WebOSSurfaceItem* itemAt(const QPointF& point);
+    SurfaceHitIndex *hitIndex() const { return m_hitIndex.data(); }
 
 private:
     int stopAppMirroringInternal(WebOSSurfaceItem *source, WebOSSurfaceItem *mirror);
@@ -193,6 +215,8 @@ signals:
     void geometryConfigChanged();
 
     void frameProfileUpdated(int sinceUpdateRequest, int flipInterval); //in us
+    void damagedPixelsChanged();
+    void frameTimingStatsChanged();
 
     void debugTouchUpdated(DebugTouchEvent* evt);
 
@@ -216,6 +240,8 @@ private:
 
     void setOutputGeometryFromString(QString &string);
 
+    void initDamageTracking();
+
     // Keeps track of the item currently receiving mouse events
     QQuickItem *m_mouseGrabberItem;
     QQuickItem *m_tabletGrabberItem = nullptr;
@@ -226,6 +252,10 @@ private slots:
     void onAppMirroringItemChanged(WebOSSurfaceItem *oldItem);
     void onQmlError(const QList<QQmlError> &errors);
 
+    // Damage tracking, called in the render thread
+    void onBeforeSynchronizingDamage();
+    void onAfterRenderingDamage();
+
 private:
     // variables
     WebOSCoreCompositor* m_compositor;
@@ -267,5 +297,22 @@ private:
     QString m_geometryConfig;
 
     UpdateScheduler *m_updateScheduler = nullptr;
+
+    // Damage tracking
+    bool m_damageTracking = false;
+    // Accumulated in the GUI thread until the next sync
+    QRegion m_damagedRegion;
+    QSet<WebOSSurfaceItem *> m_damagedItems;
+    bool m_damageFull = true;
+    // Taken at sync and used in the render thread
+    QRegion m_frameDamage;
+    QRect m_frameDeviceRect;
+    QAtomicInt m_damagedPixels;
+
+    // Reused for every debugTouchUpdated, created on first use
+    DebugTouchEvent *m_debugTouchEvent = nullptr;
+
+    // For itemAt, follows the surface items in this window
+    QScopedPointer<SurfaceHitIndex> m_hitIndex;
 };
 #endif // WEBOSCOMPOSITORWINDOW_H
@@ -71,6 +71,8 @@
 #include "weboswaylandseat.h"
 
 #include "debugtypes.h"
+#include "asynclogger.h"
+#include "weboscompositorlogging.h"
 
 // Need to access QtWayland::Keyboard::focusChanged
 #include <QtWaylandCompositor/private/qwaylandsurface_p.h>
@@ -82,11 +84,33 @@
 static void updateCursorCallback()
 {
     // This function should be called by the main thread, not other threads.
+    // The platform asks for a repaint when the cursor is drawn in software,
+    // which only matters to the window with the pointer and the one that
+    // had it last time, to erase the old cursor.
+    static QPointer<QWindow> s_lastCursorWindow;
+    const QPoint pos = QCursor::pos();
+    QWindow *cursorWindow = nullptr;
     for (QWindow *w : qGuiApp->topLevelWindows()) {
-        WebOSCompositorWindow* window = static_cast<WebOSCompositorWindow*>(w);
+        if (w->isVisible() && w->geometry().contains(pos)) {
+            cursorWindow = w;
+            break;
+        }
+    }
 
-        window->update();
+    if (!cursorWindow) {
+        for (QWindow *w : qGuiApp->topLevelWindows()) {
+            WebOSCompositorWindow* window = static_cast<WebOSCompositorWindow*>(w);
+
+            window->update();
+        }
+        s_lastCursorWindow = nullptr;
+        return;
     }
+
+    static_cast<WebOSCompositorWindow*>(cursorWindow)->update();
+    if (s_lastCursorWindow && s_lastCursorWindow != cursorWindow)
+        static_cast<WebOSCompositorWindow*>(s_lastCursorWindow.data())->update();
+    s_lastCursorWindow = cursorWindow;
 }
 
 class WebOSCoreCompositorPrivate : public QWaylandCompositorPrivate
@@ -105,16 +129,11 @@ QWaylandSeat *WebOSCoreCompositorPrivate::seatFor(QInputEvent *inputEvent)
 {
     Q_Q(WebOSCoreCompositor);
 #ifdef MULTIINPUT_SUPPORT
-    QWaylandSeat *dev = NULL;
     // The first input device in the input device list must be default input device
-    // which is QWaylandSeat, so that it always returns true for isOwner().
-    for (int i = 1; i < seats.size(); i++) {
-        QWaylandSeat *candidate = seats.at(i);
-        if (candidate->isOwner(inputEvent)) {
-            dev = candidate;
-            return dev;
-        }
-    }
+    // which is QWaylandSeat, so it is not in the index but the fallback.
+    QWaylandSeat *dev = q->seatForDeviceId(WebOSInputDevice::getDeviceId(inputEvent));
+    if (dev)
+        return dev;
 
     dev = q->queryInputDevice(inputEvent);
     if (!dev)
@@ -164,22 +183,23 @@ QWaylandSeat *WebOSCoreCompositorPrivate::seatFor(QInputEvent *inputEvent)
 #endif
 }
 
-void WebOSCoreCompositor::logger(QtMsgType type, const QMessageLogContext &context, const QString &message)
+#ifdef USE_PMLOGLIB
+static PmLogContext pmLogContext()
 {
-    const char* function = context.function;
-    QByteArray userMessageUtf8 = message.toUtf8();
-    const char* userMessage = userMessageUtf8.constData();
+    PmLogContext ctx = nullptr;
+    PmLogGetContext("surface-manager", &ctx);
+    return ctx;
+}
+#endif
 
+// Called from both the caller and the async log drainer thread,
+// so state is set up only via thread-safe function-local statics.
+static void writeLog(QtMsgType type, const char *function, const char *userMessage)
+{
 #ifdef USE_PMLOGLIB
-    static PmLogContext pmLogCtx;
-    static bool hasPmLogCtx = false;
+    static const PmLogContext pmLogCtx = pmLogContext();
     static const char* ID = "LSM";
 
-    if (Q_UNLIKELY(!hasPmLogCtx)) {
-        PmLogGetContext("surface-manager", &pmLogCtx);
-        hasPmLogCtx = true;
-    }
-
     switch (type) {
         case QtDebugMsg:
             PmLogDebug(pmLogCtx, "%s, %s", function, userMessage);
@@ -198,7 +218,8 @@ void WebOSCoreCompositor::logger(QtMsgType type, const QMessageLogContext &conte
             break;
     }
 #else
-    static const char* proc = QString(QFileInfo(QCoreApplication::applicationFilePath()).fileName()).toLatin1().constData();
+    static const QByteArray procName = QFileInfo(QCoreApplication::applicationFilePath()).fileName().toLatin1();
+    static const char* proc = procName.constData();
     switch (type) {
         case QtDebugMsg:
             printf("[%s|DEBUG   ] %s :: %s\n", proc, function, userMessage);
@@ -219,6 +240,17 @@ void WebOSCoreCompositor::logger(QtMsgType type, const QMessageLogContext &conte
 #endif
 }
 
+void WebOSCoreCompositor::logger(QtMsgType type, const QMessageLogContext &context, const QString &message)
+{
+    // Output is done by a background thread if WEBOS_COMPOSITOR_ASYNC_LOG=1
+    static AsyncLogger *asyncLogger = AsyncLogger::create(writeLog);
+    if (asyncLogger && asyncLogger->log(type, context.function, message))
+        return;
+
+    QByteArray userMessageUtf8 = message.toUtf8();
+    writeLog(type, context.function, userMessageUtf8.constData());
+}
+
 WebOSCoreCompositor::WebOSCoreCompositor(ExtensionFlags extensions, const char *socketName)
     : QWaylandCompositor(*new WebOSCoreCompositorPrivate(this))
     , m_previousFullscreenSurfaceItem(0)
@@ -368,6 +400,7 @@ void WebOSCoreCompositor::registerWindow(QQuickWindow *window, QString name)
 
         connect(m_unixSignalHandler, &UnixSignalHandler::sighup, this, &WebOSCoreCompositor::reloadConfig);
         connect(m_unixSignalHandler, &UnixSignalHandler::sighup, WebOSCompositorConfig::instance(), &WebOSCompositorConfig::dump);
+        connect(m_unixSignalHandler, &UnixSignalHandler::sigusr1, this, &WebOSCoreCompositor::dumpFrameTimingStats);
 
         // TODO: support multiple keyboard focus
         connect(defaultSeat()->keyboard(), &QWaylandKeyboard::focusChanged, this, &WebOSCoreCompositor::activeSurfaceChanged);
@@ -520,7 +553,7 @@ bool WebOSCoreCompositor::isMapped(WebOSSurfaceItem *item)
     if (webOSWindowExtension())
         return m_surfaceModel->indexFromItem(item).isValid();
     else
-        return m_surfaces.contains(item);
+        return m_surfaceAppIds.contains(item);
 }
 
 /*
@@ -551,21 +584,21 @@ void WebOSCoreCompositor::onSurfaceMapped(QWaylandSurface *surface, WebOSSurface
         item->setItemState(WebOSSurfaceItem::ItemStateNormal);
         if (webOSWindowExtension()) {
             m_surfaceModel->surfaceMapped(item);
-            if (!m_surfaces.contains(item)) {
-                m_surfaces << item;
+            if (!m_surfaceAppIds.contains(item)) {
+                appendToSurfaces(item);
             } else {
                 qDebug() << item << "This item already exists in m_surfaces.";
             }
         } else {
             // if item is still in m_surfaces after deleteProxyFor, it's not a proxy
             // but a normal item
-            if (!m_surfaces.contains(item)) {
+            if (!m_surfaceAppIds.contains(item)) {
                 m_surfaceModel->surfaceMapped(item);
-                m_surfaces << item;
+                appendToSurfaces(item);
             }
         }
 
-        qDebug() << item << "Items in compositor: " <<  getItems();
+        qCDebug(lsmModel) << item << "Items in compositor: " <<  getItems();
         emit surfaceMapped(item);
     }
 }
@@ -659,7 +692,7 @@ void WebOSCoreCompositor::onSurfaceUnmapped(QWaylandSurface *surface, WebOSSurfa
         if (item->appId().isEmpty()) {
             m_surfaceModel->surfaceUnmapped(item);
             emit surfaceUnmapped(item);
-            m_surfaces.removeOne(item);
+            removeFromSurfaces(item);
             m_surfacesOnUpdate.removeOne(item);
         } else {
             processSurfaceItem(item, WebOSSurfaceItem::ItemStateHidden);
@@ -668,7 +701,7 @@ void WebOSCoreCompositor::onSurfaceUnmapped(QWaylandSurface *surface, WebOSSurfa
         if (item->itemState() != WebOSSurfaceItem::ItemStateProxy) {
             m_surfaceModel->surfaceUnmapped(item);
             emit surfaceUnmapped(item);
-            m_surfaces.removeOne(item);
+            removeFromSurfaces(item);
             m_surfacesOnUpdate.removeOne(item);
         } else {
             emit surfaceUnmapped(item); //We have to notify qml even for proxy item
@@ -793,7 +826,7 @@ WebOSSurfaceItem* WebOSCoreCompositor::createProxyItem(const QString& appId, con
     /* Add into recent list */
     m_surfaceModel->surfaceMapped(item);
     /* To be deleted when launched in deleteProxyFor */
-    m_surfaces << item;
+    appendToSurfaces(item);
 
     return item;
 }
@@ -811,8 +844,8 @@ void WebOSCoreCompositor::setProxyFor(WebOSSurfaceItem *item)
     item->setItemState(WebOSSurfaceItem::ItemStateProxy, item->itemStateReason());
 
     // Proxy item should be in the list
-    if (!m_surfaces.contains(item))
-        m_surfaces << item;
+    if (!m_surfaceAppIds.contains(item))
+        appendToSurfaces(item);
 }
 
 void WebOSCoreCompositor::deleteProxyFor(WebOSSurfaceItem* newItem)
@@ -822,18 +855,17 @@ void WebOSCoreCompositor::deleteProxyFor(WebOSSurfaceItem* newItem)
         qWarning() << "[WebOSSurfaceItem] Invalid pointer";
         return;
     }
-    QMutableListIterator<WebOSSurfaceItem*> si(m_surfaces);
-    while (si.hasNext()) {
-        WebOSSurfaceItem* item = si.next();
+    // Copy the bucket as removal below modifies it
+    const QList<WebOSSurfaceItem*> sameAppId = m_surfacesByAppId.value(newItem->appId());
+    foreach (WebOSSurfaceItem* item, sameAppId) {
         if (item == nullptr) {
             qWarning() << "[WebOSSurfaceItem] Invalid pointer";
             continue;
         }
         if (item->itemState() == WebOSSurfaceItem::ItemStateProxy
-                && newItem->appId() == item->appId()
                 && newItem != item) { //we don't want to remove item for mapped surface
             qDebug() << "deleting proxy" << item << " for newItem" << newItem;
-            si.remove();
+            removeFromSurfaces(item);
             m_surfaceModel->surfaceDestroyed(item);
             emit surfaceDestroyed(item);
             delete item;
@@ -844,7 +876,7 @@ void WebOSCoreCompositor::deleteProxyFor(WebOSSurfaceItem* newItem)
 void WebOSCoreCompositor::addSurfaceItem(WebOSSurfaceItem *item)
 {
     m_surfaceModel->surfaceMapped(item);
-    m_surfaces << item;
+    appendToSurfaces(item);
     emit surfaceMapped(item);
 }
 
@@ -861,7 +893,7 @@ void WebOSCoreCompositor::removeSurfaceItem(WebOSSurfaceItem* item, bool emitSur
     m_surfaceModel->surfaceDestroyed(item);
     if (emitSurfaceDestroyed)
         emit surfaceDestroyed(item);
-    m_surfaces.removeOne(item);
+    removeFromSurfaces(item);
     m_surfacesOnUpdate.removeOne(item);
     delete item;
 }
@@ -985,20 +1017,62 @@ bool WebOSCoreCompositor::checkSurfaceItemClosePolicy(const QString &reason, Web
    Mostly, they might be proxy items. */
 WebOSSurfaceItem* WebOSCoreCompositor::getSurfaceItemByAppId(const QString& appId)
 {
-    QMutableListIterator<WebOSSurfaceItem*> si(m_surfaces);
-    while (si.hasNext()) {
-        WebOSSurfaceItem* item = si.next();
-        if (item == nullptr) {
-            qWarning()  << "[WebOSSurfaceItem] Invalid pointer, "
-                        << "appId :" << appId;
-            continue;
-        }
+    auto it = m_surfacesByAppId.constFind(appId);
+    if (it != m_surfacesByAppId.constEnd() && !it.value().isEmpty())
+        return it.value().first();
+    return NULL;
+}
 
-        if (item->appId() == appId) {
-            return item;
-        }
+void WebOSCoreCompositor::appendToSurfaces(WebOSSurfaceItem *item)
+{
+    if (item == nullptr || m_surfaceAppIds.contains(item)) {
+        qWarning() << "[WebOSSurfaceItem] Invalid or duplicated item" << item;
+        return;
+    }
+    m_surfaces << item;
+    m_surfacesByAppId[item->appId()] << item;
+    m_surfaceAppIds.insert(item, item->appId());
+    connect(item, &WebOSSurfaceItem::appIdChanged, this, &WebOSCoreCompositor::onSurfaceAppIdChanged, Qt::UniqueConnection);
+}
+
+void WebOSCoreCompositor::removeFromSurfaces(WebOSSurfaceItem *item)
+{
+    auto it = m_surfaceAppIds.find(item);
+    if (it == m_surfaceAppIds.end())
+        return;
+    auto bucket = m_surfacesByAppId.find(it.value());
+    if (bucket != m_surfacesByAppId.end()) {
+        bucket.value().removeOne(item);
+        if (bucket.value().isEmpty())
+            m_surfacesByAppId.erase(bucket);
+    }
+    m_surfaceAppIds.erase(it);
+    m_surfaces.removeOne(item);
+    disconnect(item, &WebOSSurfaceItem::appIdChanged, this, &WebOSCoreCompositor::onSurfaceAppIdChanged);
+}
+
+void WebOSCoreCompositor::onSurfaceAppIdChanged()
+{
+    WebOSSurfaceItem *item = qobject_cast<WebOSSurfaceItem *>(sender());
+    auto it = m_surfaceAppIds.find(item);
+    if (it == m_surfaceAppIds.end() || it.value() == item->appId())
+        return;
+
+    auto bucket = m_surfacesByAppId.find(it.value());
+    if (bucket != m_surfacesByAppId.end()) {
+        bucket.value().removeOne(item);
+        if (bucket.value().isEmpty())
+            m_surfacesByAppId.erase(bucket);
+    }
+    it.value() = item->appId();
+
+    // appId changes are rare, so rebuild the bucket to keep it in m_surfaces order
+    QList<WebOSSurfaceItem*> &sameAppId = m_surfacesByAppId[item->appId()];
+    sameAppId.clear();
+    foreach (WebOSSurfaceItem *s, m_surfaces) {
+        if (m_surfaceAppIds.value(s) == item->appId())
+            sameAppId << s;
     }
-    return NULL;
 }
 
 void WebOSCoreCompositor::applySurfaceItemClosePolicy(QString reason, const QString &targetAppId)
@@ -1032,11 +1106,11 @@ void WebOSCoreCompositor::processSurfaceItem(WebOSSurfaceItem* item, WebOSSurfac
     PMTRACE_FUNCTION;
 
     if (item == nullptr) {
-        qWarning()  << "[WebOSSurfaceItem] Invalid pointer, "
+        qCWarning(lsmModel)  << "[WebOSSurfaceItem] Invalid pointer, "
                     << "stateToBe :" << stateToBe;
         return;
     }
-    qDebug() << item << item->itemState() << stateToBe << item->itemStateReason() << item->isSurfaced();
+    qCDebug(lsmModel) << item << item->itemState() << stateToBe << item->itemStateReason() << item->isSurfaced();
 
     // Possible state transitions
     // 1) ItemStateNormal
@@ -1054,33 +1128,33 @@ void WebOSCoreCompositor::processSurfaceItem(WebOSSurfaceItem* item, WebOSSurfac
     //    surfaceUnmapped or surfaceDestroyed signal.
     switch (stateToBe) {
     case WebOSSurfaceItem::ItemStateNormal:
-        qWarning() << "no transition to ItemStateNormal for" << item << item->itemState() << item->itemStateReason();
+        qCWarning(lsmModel) << "no transition to ItemStateNormal for" << item << item->itemState() << item->itemStateReason();
         break;
     case WebOSSurfaceItem::ItemStateHidden:
         if (!item->isSurfaced() || !item->surface()->hasContent()) {
             switch (item->itemState()) {
             case WebOSSurfaceItem::ItemStateNormal:
-                qInfo() << "transitioning to ItemStateHidden for" << item << item->itemState() << item->itemStateReason();
+                qCInfo(lsmModel) << "transitioning to ItemStateHidden for" << item << item->itemState() << item->itemStateReason();
                 item->setItemState(WebOSSurfaceItem::ItemStateHidden, item->itemStateReason());
                 // Fall through
             case WebOSSurfaceItem::ItemStateClosing:
             case WebOSSurfaceItem::ItemStateHidden:
                 if(item->itemStateReason().isEmpty()) {
-                    qInfo() << "unhandled case of surfaceUnmapped for " << item << item->itemState() << item->itemStateReason();
+                    qCInfo(lsmModel) << "unhandled case of surfaceUnmapped for " << item << item->itemState() << item->itemStateReason();
                     break;
                 }
-                qInfo() << "handling surfaceUnmapped for " << item << item->itemState() << item->itemStateReason();
+                qCInfo(lsmModel) << "handling surfaceUnmapped for " << item << item->itemState() << item->itemStateReason();
                 emit surfaceUnmapped(item);
                 // reset state reason to re-use
                 item->unsetItemStateReason();
                 break;
             default:
-                qWarning() << "unhandled case of a transition to ItemStateHidden for" << item << item->itemState() << item->itemStateReason();
+                qCWarning(lsmModel) << "unhandled case of a transition to ItemStateHidden for" << item << item->itemState() << item->itemStateReason();
                 break;
 
             }
         } else {
-            qWarning() << "not ready to be ItemStateHidden," << item << item->itemState() << item->itemStateReason();
+            qCWarning(lsmModel) << "not ready to be ItemStateHidden," << item << item->itemState() << item->itemStateReason();
         }
         break;
     case WebOSSurfaceItem::ItemStateProxy:
@@ -1089,11 +1163,11 @@ void WebOSCoreCompositor::processSurfaceItem(WebOSSurfaceItem* item, WebOSSurfac
             case WebOSSurfaceItem::ItemStateNormal:
             case WebOSSurfaceItem::ItemStateHidden:
                 if (!item->itemStateReason().isEmpty() && checkSurfaceItemClosePolicy(item->itemStateReason(), item)) {
-                    qInfo() << "transitioning to ItemStateProxy and ItemStateClosing for" << item << item->itemState() << item->itemStateReason();
+                    qCInfo(lsmModel) << "transitioning to ItemStateProxy and ItemStateClosing for" << item << item->itemState() << item->itemStateReason();
                     setProxyFor(item);
                     processSurfaceItem(item, WebOSSurfaceItem::ItemStateClosing);
                 } else {
-                    qInfo() << "transitioning to ItemStateProxy for" << item << item->itemState() << item->itemStateReason();
+                    qCInfo(lsmModel) << "transitioning to ItemStateProxy for" << item << item->itemState() << item->itemStateReason();
                     setProxyFor(item);
                     emit surfaceDestroyed(item);
                     // reset state reason to re-use
@@ -1101,10 +1175,10 @@ void WebOSCoreCompositor::processSurfaceItem(WebOSSurfaceItem* item, WebOSSurfac
 
                     // Extra clean-up for surface group items
                     if (item->isSurfaceGroupRoot()) {
-                        qInfo() << "closing surface group member items for" << this;
+                        qCInfo(lsmModel) << "closing surface group member items for" << this;
                         item->sendCloseToGroupItems();
                     } else if (item->isPartOfGroup()) {
-                        qInfo() << "closing a surface group member item:" << item;
+                        qCInfo(lsmModel) << "closing a surface group member item:" << item;
                         item->setItemState(WebOSSurfaceItem::ItemStateClosing, item->itemStateReason());
                     }
 
@@ -1117,26 +1191,26 @@ void WebOSCoreCompositor::processSurfaceItem(WebOSSurfaceItem* item, WebOSSurfac
                 }
                 break;
             case WebOSSurfaceItem::ItemStateClosing:
-                qInfo() << "handling surfaceDestroyed for " << item << item->itemState() << item->itemStateReason();
+                qCInfo(lsmModel) << "handling surfaceDestroyed for " << item << item->itemState() << item->itemStateReason();
                 // remove item
                 removeSurfaceItem(item, true);
                 break;
             default:
-                qWarning() << "unhandled case of the transition to ItemStateProxy for" << item << item->itemState() << item->itemStateReason();
+                qCWarning(lsmModel) << "unhandled case of the transition to ItemStateProxy for" << item << item->itemState() << item->itemStateReason();
                 break;
             }
         } else {
-            qWarning() << "not ready to be ItemStateProxy," << item << item->itemState() << item->itemStateReason();
+            qCWarning(lsmModel) << "not ready to be ItemStateProxy," << item << item->itemState() << item->itemStateReason();
         }
         break;
     case WebOSSurfaceItem::ItemStateClosing:
-        qInfo() << "transitioning to ItemStateClosing for" << item << item->itemState() << item->itemStateReason();
+        qCInfo(lsmModel) << "transitioning to ItemStateClosing for" << item << item->itemState() << item->itemStateReason();
         item->setItemState(WebOSSurfaceItem::ItemStateClosing, item->itemStateReason());
         if (!item->isSurfaced() || !item->surface()->hasContent()) {
             // remove item
             removeSurfaceItem(item, true);
         } else {
-            qWarning() << "item is not yet ready to be removed," << item << item->itemState() << item->itemStateReason();
+            qCWarning(lsmModel) << "item is not yet ready to be removed," << item << item->itemState() << item->itemStateReason();
         }
         break;
     default:
@@ -1552,17 +1626,21 @@ bool WebOSCoreCompositor::EventPreprocessor::eventFilter(QObject *obj, QEvent *e
     if (event->type() == QEvent::KeyPress || event->type() == QEvent::KeyRelease) {
         QKeyEvent *ke = static_cast<QKeyEvent *>(event);
 
-        qDebug() << ke;
+        qCDebug(lsmInput) << ke;
 #ifdef MULTIINPUT_SUPPORT
         // Make sure input device ready before synchronizing modifier state.
         m_compositor->seatFor(ke);
 
-        // Update key modifier state for all input devices
-        // so that they're always in sync with lock state.
-        foreach (QWaylandSeat *dev, m_compositor->inputDevices()) {
-            WebOSKeyboard *keyboard = qobject_cast<WebOSKeyboard *>(dev->keyboard());
-            if (keyboard)
-                keyboard->updateModifierState(ke->nativeScanCode(), (ke->type() == QEvent::KeyPress)? WL_KEYBOARD_KEY_STATE_PRESSED : WL_KEYBOARD_KEY_STATE_RELEASED, ke->isAutoRepeat());
+        // All input devices share one modifier state so that they're
+        // always in sync with lock state. Update it once and only let
+        // keyboards tell their clients if it changed.
+        WebOSKeyboard *keyboard = qobject_cast<WebOSKeyboard *>(m_compositor->defaultSeat()->keyboard());
+        if (keyboard && keyboard->updateSharedModifierState(ke->nativeScanCode(), (ke->type() == QEvent::KeyPress)? WL_KEYBOARD_KEY_STATE_PRESSED : WL_KEYBOARD_KEY_STATE_RELEASED, ke->isAutoRepeat())) {
+            foreach (QWaylandSeat *dev, m_compositor->inputDevices()) {
+                WebOSKeyboard *devKeyboard = qobject_cast<WebOSKeyboard *>(dev->keyboard());
+                if (devKeyboard)
+                    devKeyboard->syncModifiers();
+            }
         }
 #else
         WebOSKeyboard *keyboard = qobject_cast<WebOSKeyboard *>(m_compositor->defaultSeat()->keyboard());
@@ -1573,12 +1651,12 @@ bool WebOSCoreCompositor::EventPreprocessor::eventFilter(QObject *obj, QEvent *e
 
     if (event->type() == QEvent::MouseButtonPress || event->type() == QEvent::MouseButtonRelease) {
         QMouseEvent *me = static_cast<QMouseEvent *>(event);
-        qDebug() << me;
+        qCDebug(lsmInput) << me;
     }
 
     if (event->type() == QEvent::TouchBegin || event->type() == QEvent::TouchEnd) {
         QTouchEvent *te = static_cast<QTouchEvent *>(event);
-        qDebug() << te;
+        qCDebug(lsmInput) << te;
     }
 
 #ifdef MULTIINPUT_SUPPORT
@@ -1623,12 +1701,45 @@ void WebOSCoreCompositor::registerSeat(QWaylandSeat *seat)
 {
     Q_D(WebOSCoreCompositor);
     d->seats.append(seat);
+    m_registeredSeats.insert(seat);
+
+    WebOSInputDevice *device = qobject_cast<WebOSInputDevice *>(seat);
+    if (device && device->id() >= 0 && !m_seatsByDeviceId.contains(device->id()))
+        m_seatsByDeviceId.insert(device->id(), seat);
 }
 
 void WebOSCoreCompositor::unregisterSeat(QWaylandSeat *seat)
 {
     Q_D(WebOSCoreCompositor);
     d->seats.removeOne(seat);
+    m_registeredSeats.remove(seat);
+
+    WebOSInputDevice *device = qobject_cast<WebOSInputDevice *>(seat);
+    if (device)
+        updateSeatDeviceId(device, device->id());
+}
+
+/* Keeps m_seatsByDeviceId in sync when a seat gets a new device id or
+   goes away. If several seats share an id, the first registered wins
+   as it did when seats were scanned in order. */
+void WebOSCoreCompositor::updateSeatDeviceId(WebOSInputDevice *seat, int oldDeviceId)
+{
+    Q_D(WebOSCoreCompositor);
+
+    if (oldDeviceId >= 0 && m_seatsByDeviceId.value(oldDeviceId) == seat) {
+        m_seatsByDeviceId.remove(oldDeviceId);
+        // Rare, so just look for another seat with the same id
+        for (int i = 1; i < d->seats.size(); i++) {
+            WebOSInputDevice *other = qobject_cast<WebOSInputDevice *>(d->seats.at(i));
+            if (other && other != seat && other->id() == oldDeviceId) {
+                m_seatsByDeviceId.insert(oldDeviceId, other);
+                break;
+            }
+        }
+    }
+
+    if (m_registeredSeats.contains(seat) && seat->id() >= 0 && !m_seatsByDeviceId.contains(seat->id()))
+        m_seatsByDeviceId.insert(seat->id(), seat);
 }
 
 WebOSSurfaceItem* WebOSCoreCompositor::createSurfaceItem(QWaylandQuickSurface *surface)
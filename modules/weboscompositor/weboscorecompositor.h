@@ -22,6 +22,8 @@
 #include <QObject>
 #include <QList>
 #include <QMap>
+#include <QHash>
+#include <QSet>
 #include <QQuickWindow>
 #include <QJSValue>
 
@@ -217,6 +219,9 @@ public:
 
     void registerSeat(QWaylandSeat *seat);
     void unregisterSeat(QWaylandSeat *seat);
+    bool isRegisteredSeat(QWaylandSeat *seat) const { return m_registeredSeats.contains(seat); }
+    QWaylandSeat *seatForDeviceId(int deviceId) const { return m_seatsByDeviceId.value(deviceId, nullptr); }
+    void updateSeatDeviceId(WebOSInputDevice *seat, int oldDeviceId);
 
     // setOutputGeometry must be called before QWaylandWindow registerWindow!!!
     QRect outputGeometry() const { return m_outputGeometry; }
@@ -265,6 +270,7 @@ signals:
 
     //Unix signals to QT signals;
     void reloadConfig(); //SIGHUP
+    void dumpFrameTimingStats(); //SIGUSR1
 
     void inputMethodChanged();
     void keyFilterChanged();
@@ -318,6 +324,8 @@ private:
     bool checkSurfaceItemClosePolicy(const QString &reason, WebOSSurfaceItem *item);
     void processSurfaceItem(WebOSSurfaceItem* item, WebOSSurfaceItem::ItemState stateToBe);
     WebOSSurfaceItem* getSurfaceItemByAppId(const QString& appId);
+    void appendToSurfaces(WebOSSurfaceItem *item);
+    void removeFromSurfaces(WebOSSurfaceItem *item);
 
 private slots:
     /*
@@ -328,6 +336,7 @@ private slots:
     void onSurfaceUnmapped(QWaylandSurface *surface, WebOSSurfaceItem *item);
     void onSurfaceDestroyed(QWaylandSurface *surface, WebOSSurfaceItem *item);
     void onSurfaceSizeChanged();
+    void onSurfaceAppIdChanged();
 
 private:
     // variables
@@ -340,6 +349,9 @@ private:
 
     /*! Holds the surfaces that have been mapped or are proxies */
     QList<WebOSSurfaceItem*> m_surfaces;
+    /*! Indexes m_surfaces by appId, each bucket in the order of m_surfaces */
+    QHash<QString, QList<WebOSSurfaceItem*>> m_surfacesByAppId;
+    QHash<WebOSSurfaceItem*, QString> m_surfaceAppIds;
     QHash<QString, CompositorExtension *> m_extensions;
     QVariantMap m_surfaceItemClosePolicy;
 
@@ -363,6 +375,10 @@ private:
     QList<WebOSSurfaceItem*> m_surfacesOnUpdate;
     QVector<WebOSCompositorWindow *> m_windows;
 
+    // Seats registered by WebOSInputDevice, indexed by device id
+    QSet<QWaylandSeat *> m_registeredSeats;
+    QHash<int, QWaylandSeat *> m_seatsByDeviceId;
+
     //Global tick counter to get absolute time stamp for recent window model and LRU surface
     quint32 m_fullscreenTick;
 
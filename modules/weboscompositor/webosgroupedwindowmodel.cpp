@@ -1,4 +1,4 @@
-// Copyright (c) 2015-2018 LG Electronics, Inc.
+// Copyright (c) 2015-2024 LG Electronics, Inc.
 //
 // Licensed under the Apache License, Version 2.0 (the "License");
 // you may not use this file except in compliance with the License.
@@ -17,6 +17,7 @@
 #include "webosgroupedwindowmodel.h"
 
 #include "webossurfaceitem.h"
+#include "webossurfacemodel.h"
 #include "weboscompositortracer.h"
 
 WebOSGroupedWindowModel::WebOSGroupedWindowModel()
@@ -24,55 +25,115 @@ WebOSGroupedWindowModel::WebOSGroupedWindowModel()
 {
     PMTRACE_FUNCTION;
     connect(this, SIGNAL(rowsAboutToBeRemoved(const QModelIndex&, int, int)), this, SLOT(itemRemoved(const QModelIndex &, int, int)));
+    connect(this, SIGNAL(rowsInserted(const QModelIndex&, int, int)), this, SLOT(itemsInserted(const QModelIndex &, int, int)));
+    // Rows can come and go without insert and remove signals
+    connect(this, &QAbstractItemModel::layoutChanged, this, &WebOSGroupedWindowModel::handleLayoutChange);
+    connect(this, &QAbstractItemModel::modelReset, this, &WebOSGroupedWindowModel::syncTrackedItems);
+    connect(this, &WebOSWindowModel::lockedChanged, this, &WebOSGroupedWindowModel::handleLockedChange);
 }
 
 WebOSGroupedWindowModel::~WebOSGroupedWindowModel()
 {
     PMTRACE_FUNCTION;
+    foreach (WebOSSurfaceItem* item, m_trackedItems) {
+        disconnect(item, SIGNAL(zOrderChanged(int)), this, SLOT(handleZOrderChange()));
+        item->setGroupedWindowModel(0);
+    }
+}
+
+void WebOSGroupedWindowModel::trackItem(WebOSSurfaceItem* item)
+{
+    if (item && !m_trackedItems.contains(item)) {
+        m_trackedItems.insert(item);
+        connect(item, SIGNAL(zOrderChanged(int)), this, SLOT(handleZOrderChange()), Qt::UniqueConnection);
+        item->setGroupedWindowModel(this);
+    }
+}
+
+void WebOSGroupedWindowModel::untrackItem(WebOSSurfaceItem* item)
+{
+    if (item && m_trackedItems.remove(item)) {
+        m_pendingZOrderItems.remove(item);
+        disconnect(item, SIGNAL(zOrderChanged(int)), this, SLOT(handleZOrderChange()));
+        item->setGroupedWindowModel(0);
+    }
+}
+
+void WebOSGroupedWindowModel::itemsInserted(const QModelIndex& parent, int start, int end)
+{
+    for (int row = start; row <= end; row++)
+        trackItem(data(index(row, 0, parent)).value<WebOSSurfaceItem*>());
+}
+
+void WebOSGroupedWindowModel::handleLayoutChange(const QList<QPersistentModelIndex> &parents, QAbstractItemModel::LayoutChangeHint hint)
+{
+    Q_UNUSED(parents);
+    // Sorting only moves rows that are tracked already
+    if (hint != QAbstractItemModel::VerticalSortHint)
+        syncTrackedItems();
+}
+
+void WebOSGroupedWindowModel::syncTrackedItems()
+{
+    PMTRACE_FUNCTION;
+    QSet<WebOSSurfaceItem*> items;
     int count = QSortFilterProxyModel::rowCount();
     for (int rowNumber = 0; rowNumber < count; rowNumber++) {
         WebOSSurfaceItem* item = get(rowNumber).value<WebOSSurfaceItem*>();
-        if (item) {
-            disconnect(item, SIGNAL(zOrderChanged(int)), this, SLOT(handleZOrderChange()));
-            item->setGroupedWindowModel(0);
-        }
+        if (item)
+            items.insert(item);
     }
+
+    foreach (WebOSSurfaceItem* item, m_trackedItems - items)
+        untrackItem(item);
+    foreach (WebOSSurfaceItem* item, items)
+        trackItem(item);
 }
 
-bool WebOSGroupedWindowModel::filterAcceptsRow(int sourceRow,
-         const QModelIndex &sourceParent) const
+void WebOSGroupedWindowModel::handleZOrderChange() {
+    WebOSSurfaceItem* item = qobject_cast<WebOSSurfaceItem*>(sender());
+    if (!item || !m_trackedItems.contains(item))
+        return;
+
+    // Deferred as before, so that bindings depending on the new z order
+    // are updated by the time the row gets sorted
+    if (m_pendingZOrderItems.isEmpty())
+        QMetaObject::invokeMethod(this, "flushZOrderChanges", Qt::QueuedConnection);
+    m_pendingZOrderItems.insert(item);
+}
+
+void WebOSGroupedWindowModel::flushZOrderChanges()
 {
     PMTRACE_FUNCTION;
+    // Without dynamicSortFilter the rows would not move, so wait for unlock
+    if (m_pendingZOrderItems.isEmpty() || locked())
+        return;
 
-    bool accepts = false;
-    accepts = WebOSWindowModel::filterAcceptsRow(sourceRow, sourceParent);
-
-    if (accepts) {
-        QModelIndex index0 = sourceModel()->index(sourceRow, 0, sourceParent);
-        WebOSSurfaceItem* item = sourceModel()->data(index0).value<WebOSSurfaceItem*>();
-        if (item) {
-            bool isconnected = connect(item, SIGNAL(zOrderChanged(int)), this, SLOT(handleZOrderChange()));
-            if (isconnected) {
-                item->setGroupedWindowModel((WebOSGroupedWindowModel*)this);
-            }
-        }
+    WebOSSurfaceModel* source = qobject_cast<WebOSSurfaceModel*>(sourceModel());
+    if (!source || m_filterDirty) {
+        // A full invalidation is pending or there's no way to do better
+        m_pendingZOrderItems.clear();
+        deferInvalidate();
+        return;
     }
 
-    return accepts;
+    // The proxy re-filters and moves only the rows of the changed items.
+    // Other models on the same source just re-evaluate those rows.
+    QSet<WebOSSurfaceItem*> items;
+    items.swap(m_pendingZOrderItems);
+    foreach (WebOSSurfaceItem* item, items)
+        source->notifyItemChanged(item);
 }
 
-void WebOSGroupedWindowModel::handleZOrderChange() {
-    m_filterDirty = true;
-    emit deferredInvalidate();
+void WebOSGroupedWindowModel::handleLockedChange()
+{
+    // Unlocking has sorted all rows again, the pending ones included
+    if (!locked())
+        m_pendingZOrderItems.clear();
 }
 
 void WebOSGroupedWindowModel::itemRemoved(const QModelIndex& parent, int start, int end)
 {
-    for (int row = start; row <= end; row++) {
-        WebOSSurfaceItem* item = data(index(row, 0, parent)).value<WebOSSurfaceItem*>();
-        if (item) {
-            disconnect(item, SIGNAL(zOrderChanged(int)), this, SLOT(handleZOrderChange()));
-            item->setGroupedWindowModel(0);
-        }
-    }
+    for (int row = start; row <= end; row++)
+        untrackItem(data(index(row, 0, parent)).value<WebOSSurfaceItem*>());
 }
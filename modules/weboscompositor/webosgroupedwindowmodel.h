@@ -1,4 +1,4 @@
-// Copyright (c) 2015-2021 LG Electronics, Inc.
+// Copyright (c) 2015-2024 LG Electronics, Inc.
 //
 // Licensed under the Apache License, Version 2.0 (the "License");
 // you may not use this file except in compliance with the License.
@@ -20,6 +20,8 @@
 
 #include "weboswindowmodel.h"
 
+#include <QSet>
+
 class WEBOS_COMPOSITOR_EXPORT WebOSGroupedWindowModel : public WebOSWindowModel {
     Q_OBJECT
 
@@ -31,8 +33,21 @@ public slots:
      void handleZOrderChange();
      void itemRemoved(const QModelIndex& parent, int start, int end);
 
-protected:
-     virtual bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+private slots:
+     void itemsInserted(const QModelIndex& parent, int start, int end);
+     void handleLayoutChange(const QList<QPersistentModelIndex> &parents, QAbstractItemModel::LayoutChangeHint hint);
+     void syncTrackedItems();
+     void flushZOrderChanges();
+     void handleLockedChange();
+
+private:
+     void trackItem(WebOSSurfaceItem* item);
+     void untrackItem(WebOSSurfaceItem* item);
+
+     // Items in the model, connected to zOrderChanged
+     QSet<WebOSSurfaceItem*> m_trackedItems;
+     // Kept while locked, the model is sorted again once unlocked
+     QSet<WebOSSurfaceItem*> m_pendingZOrderItems;
 };
 
 #endif
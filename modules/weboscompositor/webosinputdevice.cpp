@@ -41,10 +41,8 @@ WebOSInputDevice::WebOSInputDevice(QWaylandCompositor *compositor)
         if (this_wkeyboard)
             this_wkeyboard->startGrab(wkeyboard->currentGrab());
     }
-#if QT_VERSION < QT_VERSION_CHECK(6,0,0)
-    /* We use multiple keyboard device but use same modifier state */
-    updateModifierState(wcompositor->defaultSeat());
-#endif
+    /* We use multiple keyboard device but use same modifier state,
+       WebOSKeyboard shares it so there's nothing to copy */
 }
 
 // This constuctor is for window-dedicated device, not multi-input support
@@ -70,7 +68,9 @@ void WebOSInputDevice::setDeviceId(QInputEvent *event)
     int deviceId = getDeviceId(event);
 
     if (m_deviceId != deviceId ) {
+        int oldDeviceId = m_deviceId;
         m_deviceId = deviceId;
+        static_cast<WebOSCoreCompositor *>(m_compositor)->updateSeatDeviceId(this, oldDeviceId);
         emit deviceIdChanged();
     }
 }
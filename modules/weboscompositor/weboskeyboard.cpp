@@ -1,4 +1,4 @@
-// Copyright (c) 2019-2021 LG Electronics, Inc.
+// Copyright (c) 2019-2024 LG Electronics, Inc.
 //
 // Licensed under the Apache License, Version 2.0 (the "License");
 // you may not use this file except in compliance with the License.
@@ -17,8 +17,71 @@
 #include <QWaylandCompositor>
 #include <QtWaylandCompositor/private/qwaylandkeyboard_p.h>
 
+WebOSModifierState::~WebOSModifierState()
+{
+#if QT_CONFIG(xkbcommon)
+    if (m_state)
+        xkb_state_unref(m_state);
+#endif
+}
+
+QSharedPointer<WebOSModifierState> WebOSModifierState::instance()
+{
+    // Lives as long as any keyboard refers to it
+    static QWeakPointer<WebOSModifierState> s_instance;
+    QSharedPointer<WebOSModifierState> state = s_instance.toStrongRef();
+    if (!state) {
+        state.reset(new WebOSModifierState);
+        s_instance = state;
+    }
+    return state;
+}
+
+bool WebOSModifierState::updateKey(xkb_state *source, uint code, uint32_t state)
+{
+#if QT_CONFIG(xkbcommon)
+    if (!source)
+        return false;
+
+    xkb_keymap *keymap = xkb_state_get_keymap(source);
+    if (Q_UNLIKELY(keymap != m_keymap)) {
+        // New keymap, keep the locks across it
+        if (m_state)
+            xkb_state_unref(m_state);
+        m_keymap = keymap;
+        m_state = xkb_state_new(keymap);
+        if (!m_state)
+            return false;
+        xkb_state_update_mask(m_state, 0, 0, locked, 0, 0, group);
+    }
+
+    xkb_state_update_key(m_state, code, state == WL_KEYBOARD_KEY_STATE_PRESSED ? XKB_KEY_DOWN : XKB_KEY_UP);
+
+    xkb_mod_mask_t d = xkb_state_serialize_mods(m_state, (xkb_state_component)XKB_STATE_DEPRESSED);
+    xkb_mod_mask_t l = xkb_state_serialize_mods(m_state, (xkb_state_component)XKB_STATE_LATCHED);
+    xkb_mod_mask_t k = xkb_state_serialize_mods(m_state, (xkb_state_component)XKB_STATE_LOCKED);
+    xkb_mod_mask_t g = xkb_state_serialize_group(m_state, (xkb_state_component)XKB_STATE_EFFECTIVE);
+
+    if (depressed == d && latched == l && locked == k && group == g)
+        return false;
+
+    depressed = d;
+    latched = l;
+    locked = k;
+    group = g;
+    serial++;
+    return true;
+#else
+    Q_UNUSED(source);
+    Q_UNUSED(code);
+    Q_UNUSED(state);
+    return false;
+#endif
+}
+
 WebOSKeyboard::WebOSKeyboard(QWaylandSeat *seat)
     : QWaylandKeyboard(seat)
+    , m_modifierState(WebOSModifierState::instance())
 {
     m_pendingFocusDestroyListener = new QWaylandDestroyListener();
     connect(m_pendingFocusDestroyListener, &QWaylandDestroyListener::fired, this, &WebOSKeyboard::pendingFocusDestroyed);
@@ -48,46 +111,73 @@ void WebOSKeyboard::setFocus(QWaylandSurface *surface)
         m_grab->focused(surface);
 
     QWaylandKeyboard::setFocus(surface);
+
+    // A new client gets the shared state, not the one of this keyboard
+    syncModifiers();
 }
 
 void WebOSKeyboard::updateModifierState(uint code, uint32_t state, bool repeat)
+{
+    if (updateSharedModifierState(code, state, repeat))
+        syncModifiers();
+}
+
+bool WebOSKeyboard::updateSharedModifierState(uint code, uint32_t state, bool repeat)
 {
     Q_D(QWaylandKeyboard);
 
 #if QT_CONFIG(xkbcommon)
-    auto xkb_state = d->xkbState();
+    if (repeat)
+        return false;
 
-    if (!xkb_state || repeat)
-        return;
+    return m_modifierState->updateKey(d->xkbState(), code, state);
+#else
+    Q_UNUSED(repeat);
+    d->updateModifierState(code, state);
+    return false;
+#endif
+}
 
-    xkb_state_update_key(xkb_state, code, state == WL_KEYBOARD_KEY_STATE_PRESSED ? XKB_KEY_DOWN : XKB_KEY_UP);
+void WebOSKeyboard::syncModifiers(bool force)
+{
+#if QT_CONFIG(xkbcommon)
+    Q_D(QWaylandKeyboard);
+    const WebOSModifierState &mods = *m_modifierState;
 
-    xkb_mod_mask_t depressed = xkb_state_serialize_mods(xkb_state, (xkb_state_component)XKB_STATE_DEPRESSED);
-    xkb_mod_mask_t latched = xkb_state_serialize_mods(xkb_state, (xkb_state_component)XKB_STATE_LATCHED);
-    xkb_mod_mask_t locked = xkb_state_serialize_mods(xkb_state, (xkb_state_component)XKB_STATE_LOCKED);
-    xkb_mod_mask_t grp = xkb_state_serialize_group(xkb_state, (xkb_state_component)XKB_STATE_EFFECTIVE);
+    if (m_grab) {
+        if (!force && m_grabSentSerial == mods.serial)
+            return;
+        m_grabSentSerial = mods.serial;
+        qDebug() << "Updating modifiers for grabber" << m_grab << mods.depressed << mods.latched << mods.locked << mods.group;
+        m_grab->modifiers(compositor()->nextSerial(), mods.depressed, mods.latched, mods.locked, mods.group);
+        return;
+    }
 
-    if (this->modsDepressed == depressed && this->modsLatched == latched && this->modsLocked == locked && this->group == grp)
+    // Nobody to tell, the next focused client gets it
+    if (!d->focusResource)
         return;
 
-    this->modsDepressed = depressed;
-    this->modsLatched = latched;
-    this->modsLocked = locked;
-    this->group = grp;
+    if (!force) {
+        if (m_sentFocus == focus()) {
+            if (m_sentSerial == mods.serial)
+                return;
+        } else if (mods.serial == 0) {
+            // Still the initial state that enter carries already
+            m_sentFocus = focus();
+            return;
+        }
+    }
+    m_sentSerial = mods.serial;
+    m_sentFocus = focus();
 
-    if (m_grab) {
-        qDebug() << "Updating modifiers for grabber" << m_grab << depressed << latched << locked << grp;
-        m_grab->modifiers(compositor()->nextSerial(), depressed, latched, locked, grp);
-    } else {
-        qDebug() << "Updating modifiers for keyboard" << this << depressed << latched << locked << grp;
+    qDebug() << "Updating modifiers for keyboard" << this << mods.depressed << mods.latched << mods.locked << mods.group;
 #if QT_VERSION >= QT_VERSION_CHECK(6,0,0)
-        d->send_modifiers(compositor()->nextSerial(), depressed, latched, locked, grp);
+    d->send_modifiers(compositor()->nextSerial(), mods.depressed, mods.latched, mods.locked, mods.group);
 #else
-        d->modifiers(compositor()->nextSerial(), depressed, latched, locked, grp);
+    d->modifiers(compositor()->nextSerial(), mods.depressed, mods.latched, mods.locked, mods.group);
 #endif
-    }
 #else
-    d->updateModifierState(code, state);
+    Q_UNUSED(force);
 #endif
 }
 
@@ -143,15 +233,10 @@ void WebOSKeyboard::startGrab(KeyboardGrabber *grab)
 
 void WebOSKeyboard::endGrab()
 {
-    Q_D(QWaylandKeyboard);
     m_grab = nullptr;
+    // Also sends modifiers changed during the grab, as the grabber got
+    // them rather than the client
     setFocus(m_pendingFocus);
-
-#if QT_VERSION < QT_VERSION_CHECK(6,0,0)
-    //Modifier state can be changed during grab status.
-    //So send it again.
-    d->updateModifierState(this);
-#endif
 }
 
 KeyboardGrabber *WebOSKeyboard::currentGrab() const
@@ -19,9 +19,37 @@
 #include <WebOSCoreCompositor/weboscompositorexport.h>
 
 #include <QWaylandKeyboard>
+#include <QSharedPointer>
+#include <QPointer>
 
 class QWaylandSurface;
 class QWaylandDestroyListener;
+struct xkb_state;
+struct xkb_keymap;
+
+// Modifier and lock state shared by the keyboards of all seats, so that a
+// key updates it only once however many seats there are.
+class WebOSModifierState
+{
+public:
+    ~WebOSModifierState();
+
+    static QSharedPointer<WebOSModifierState> instance();
+
+    // Returns whether the serialized modifiers changed
+    bool updateKey(xkb_state *source, uint code, uint32_t state);
+
+    uint32_t depressed = 0;
+    uint32_t latched = 0;
+    uint32_t locked = 0;
+    uint32_t group = 0;
+    // Bumped on every change
+    quint32 serial = 0;
+
+private:
+    xkb_state *m_state = nullptr;
+    xkb_keymap *m_keymap = nullptr;
+};
 
 struct KeyboardGrabber
 {
@@ -55,6 +83,13 @@ public:
 
     virtual void updateModifierState(uint code, uint32_t state, bool repeat);
 
+    // Updates the shared state only, returns whether it changed.
+    // Call syncModifiers() of each keyboard afterwards.
+    bool updateSharedModifierState(uint code, uint32_t state, bool repeat);
+    // Sends the shared state to the focused client unless it has it already
+    void syncModifiers(bool force = false);
+    const WebOSModifierState &modifierState() const { return *m_modifierState; }
+
     void startGrab(KeyboardGrabber *grab);
     void endGrab();
     KeyboardGrabber *currentGrab() const;
@@ -68,10 +103,12 @@ private:
     QWaylandSurface *m_pendingFocus = nullptr;
     QWaylandDestroyListener* m_pendingFocusDestroyListener = nullptr;
 
-    uint32_t modsDepressed = 0;
-    uint32_t modsLatched = 0;
-    uint32_t modsLocked = 0;
-    uint32_t group = 0;
+    QSharedPointer<WebOSModifierState> m_modifierState;
+    // Serial of the shared state last sent and the client it went to
+    quint32 m_sentSerial = 0;
+    QPointer<QWaylandSurface> m_sentFocus;
+    // Serial last sent to the grabber
+    quint32 m_grabSentSerial = 0;
 };
 
 #endif //WEBOS_KEYBOARD_H
@@ -16,6 +16,7 @@
 
 #include "weboskeyfilter.h"
 #include <QDebug>
+#include <QMetaObject>
 
 WebOSKeyFilter::WebOSKeyFilter(QObject *parent)
     : QObject(parent)
@@ -31,7 +32,6 @@ WebOSKeyFilter::~WebOSKeyFilter()
 
 bool WebOSKeyFilter::handleKeyEvent(int keycode, bool pressed, bool autoRepeat, quint32 nativeModifiers)
 {
-    QVariant key(keycode);
     QVariant ret;
 
     m_wasAutoRepeat = autoRepeat;
@@ -40,12 +40,7 @@ bool WebOSKeyFilter::handleKeyEvent(int keycode, bool pressed, bool autoRepeat,
     if (Q_LIKELY(!m_preProcess.isEmpty())) {
         // m_preProcess should have one of following prototypes:
         //  - QVariant func(QVariant key, QVariant pressed, QVariant m_wasAutoRepeat);
-        if (QMetaObject::invokeMethod(const_cast<WebOSKeyFilter*>(this), m_preProcess.toLatin1().constData(),
-                                   Q_RETURN_ARG(QVariant, ret),
-                                   Q_ARG(QVariant, key),
-                                   Q_ARG(QVariant, pressed),
-                                   Q_ARG(QVariant, m_wasAutoRepeat))) {
-
+        if (invokeHook(m_preProcess, m_preProcessMethod, keycode, pressed, &ret)) {
             switch (ret.toInt()) {
             case WebOSKeyPolicy::NotAccepted:
                 return false;
@@ -60,6 +55,18 @@ bool WebOSKeyFilter::handleKeyEvent(int keycode, bool pressed, bool autoRepeat,
         }
     }
 
+    // native key policies
+    if (!m_policies.isEmpty()) {
+        switch (evaluateKeyPolicies(keycode, pressed, autoRepeat, nativeModifiers)) {
+        case WebOSKeyPolicy::NotAccepted:
+            return false;
+        case WebOSKeyPolicy::Accepted:
+            return true;
+        case WebOSKeyPolicy::NextPolicy:
+            break;
+        }
+    }
+
     // main key handler
     if (Q_LIKELY(!m_handlerList.isEmpty())) {
         QJSValueList args;
@@ -92,12 +99,7 @@ bool WebOSKeyFilter::handleKeyEvent(int keycode, bool pressed, bool autoRepeat,
     if (Q_LIKELY(!m_fallback.isEmpty())) {
         // m_fallback should have one of following prototypes:
         //  - QVariant func(QVariant key, QVariant pressed, QVariant m_wasAutoRepeat);
-        if (QMetaObject::invokeMethod(const_cast<WebOSKeyFilter*>(this), m_fallback.toLatin1().constData(),
-                                   Q_RETURN_ARG(QVariant, ret),
-                                   Q_ARG(QVariant, key),
-                                   Q_ARG(QVariant, pressed),
-                                   Q_ARG(QVariant, m_wasAutoRepeat))) {
-
+        if (invokeHook(m_fallback, m_fallbackMethod, keycode, pressed, &ret)) {
             switch (ret.toInt()) {
             case WebOSKeyPolicy::Accepted:
                 return true;
@@ -158,3 +160,175 @@ void WebOSKeyFilter::addKeyFilter(QJSValue keyFilter, QString handlerName)
     m_handlerList.append(pair);
     qDebug() << "KeyFilter added:" << handlerName;
 }
+
+bool WebOSKeyFilter::invokeHook(const QString &name, QMetaMethod &method, int keycode, bool pressed, QVariant *ret)
+{
+    // Resolved on first use, as functions declared in QML are not
+    // known to the meta object yet when the property is assigned
+    if (Q_UNLIKELY(!method.isValid())) {
+        const QByteArray signature = QMetaObject::normalizedSignature(
+            (name + QStringLiteral("(QVariant,QVariant,QVariant)")).toLatin1().constData());
+        const int index = metaObject()->indexOfMethod(signature.constData());
+        if (index < 0) {
+            // Let invokeMethod sort out other prototypes, if any
+            return QMetaObject::invokeMethod(this, name.toLatin1().constData(),
+                                             Q_RETURN_ARG(QVariant, *ret),
+                                             Q_ARG(QVariant, keycode),
+                                             Q_ARG(QVariant, pressed),
+                                             Q_ARG(QVariant, m_wasAutoRepeat));
+        }
+        method = metaObject()->method(index);
+    }
+
+    return method.invoke(this, Qt::DirectConnection,
+                         Q_RETURN_ARG(QVariant, *ret),
+                         Q_ARG(QVariant, keycode),
+                         Q_ARG(QVariant, pressed),
+                         Q_ARG(QVariant, m_wasAutoRepeat));
+}
+
+bool WebOSKeyFilter::matches(const KeyPolicyEntry &entry, bool pressed, bool autoRepeat, quint32 nativeModifiers) const
+{
+    if (entry.pressed >= 0 && entry.pressed != (pressed ? 1 : 0))
+        return false;
+    if (entry.autoRepeat >= 0 && entry.autoRepeat != (autoRepeat ? 1 : 0))
+        return false;
+    if ((nativeModifiers & entry.modifierMask) != entry.modifiers)
+        return false;
+    if (!entry.state.isEmpty() && m_activeStates.contains(entry.state) == entry.stateNegated)
+        return false;
+    return true;
+}
+
+int WebOSKeyFilter::evaluateKeyPolicies(int keycode, bool pressed, bool autoRepeat, quint32 nativeModifiers)
+{
+    static const QVector<int> none;
+    const auto it = m_policiesByKey.constFind(keycode);
+    const QVector<int> &forKey = it != m_policiesByKey.constEnd() ? it.value() : none;
+    const QVector<int> &forAny = m_policiesForAnyKey;
+
+    // Merge both lists so that policies apply in the order they were added
+    int k = 0, a = 0;
+    while (k < forKey.size() || a < forAny.size()) {
+        int index;
+        if (a >= forAny.size() || (k < forKey.size() && forKey.at(k) < forAny.at(a)))
+            index = forKey.at(k++);
+        else
+            index = forAny.at(a++);
+
+        const KeyPolicyEntry &entry = m_policies.at(index);
+        if (!matches(entry, pressed, autoRepeat, nativeModifiers))
+            continue;
+
+        if (!entry.handler.isCallable()) {
+            if (entry.action != WebOSKeyPolicy::NextPolicy)
+                return entry.action;
+            continue;
+        }
+
+        // Copy, as the handler may change the policy table
+        QJSValue handler = entry.handler;
+        const QString name = entry.name;
+        const quint32 generation = m_policyGeneration;
+        QJSValue callResult = handler.call(QJSValueList() << keycode << pressed << autoRepeat << nativeModifiers);
+        if (callResult.isError() || callResult.isUndefined()) {
+            qWarning() << "Error calling policy" << name << ":" << callResult.toString();
+        } else {
+            const int result = callResult.toInt();
+            if (result == WebOSKeyPolicy::NotAccepted || result == WebOSKeyPolicy::Accepted)
+                return result;
+        }
+        // The lists iterated may be gone
+        if (generation != m_policyGeneration)
+            break;
+    }
+
+    return WebOSKeyPolicy::NextPolicy;
+}
+
+void WebOSKeyFilter::addKeyPolicy(QJSValue policy, QString policyName)
+{
+    if (!policy.isObject()) {
+        qWarning() << "Key policy" << policyName << "is not an object";
+        return;
+    }
+
+    KeyPolicyEntry entry;
+    entry.name = policyName;
+
+    QJSValue v = policy.property(QStringLiteral("pressed"));
+    if (v.isBool())
+        entry.pressed = v.toBool() ? 1 : 0;
+    v = policy.property(QStringLiteral("autoRepeat"));
+    if (v.isBool())
+        entry.autoRepeat = v.toBool() ? 1 : 0;
+    v = policy.property(QStringLiteral("modifiers"));
+    if (v.isNumber()) {
+        entry.modifiers = v.toUInt();
+        v = policy.property(QStringLiteral("modifierMask"));
+        entry.modifierMask = v.isNumber() ? v.toUInt() : entry.modifiers;
+        entry.modifiers &= entry.modifierMask;
+    }
+    v = policy.property(QStringLiteral("state"));
+    if (v.isString()) {
+        entry.state = v.toString();
+        if (entry.state.startsWith(QLatin1Char('!'))) {
+            entry.stateNegated = true;
+            entry.state.remove(0, 1);
+        }
+    }
+    v = policy.property(QStringLiteral("handler"));
+    if (v.isCallable()) {
+        entry.handler = v;
+    } else {
+        v = policy.property(QStringLiteral("action"));
+        if (!v.isNumber()) {
+            qWarning() << "Key policy" << policyName << "has neither action nor handler";
+            return;
+        }
+        entry.action = v.toInt();
+    }
+
+    QVector<int> keys;
+    v = policy.property(QStringLiteral("keys"));
+    if (v.isArray()) {
+        const int length = v.property(QStringLiteral("length")).toInt();
+        for (int i = 0; i < length; i++)
+            keys.append(v.property(i).toInt());
+    } else {
+        v = policy.property(QStringLiteral("key"));
+        if (v.isNumber())
+            keys.append(v.toInt());
+    }
+
+    const int index = m_policies.size();
+    m_policies.append(entry);
+    m_policyGeneration++;
+    if (keys.isEmpty()) {
+        m_policiesForAnyKey.append(index);
+    } else {
+        for (int key : keys) {
+            QVector<int> &bucket = m_policiesByKey[key];
+            if (bucket.isEmpty() || bucket.last() != index)
+                bucket.append(index);
+        }
+    }
+    qDebug() << "KeyPolicy added:" << policyName << "for" << (keys.isEmpty() ? QStringLiteral("any key") : QString::number(keys.size()) + QStringLiteral(" key(s)"));
+}
+
+void WebOSKeyFilter::resetKeyPolicies()
+{
+    m_policies.clear();
+    m_policiesByKey.clear();
+    m_policiesForAnyKey.clear();
+    m_policyGeneration++;
+    qDebug() << "All keyPolicies are removed";
+}
+
+void WebOSKeyFilter::setPolicyState(QString state, bool active)
+{
+    if (active)
+        m_activeStates.insert(state);
+    else
+        m_activeStates.remove(state);
+}
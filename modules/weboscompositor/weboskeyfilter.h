@@ -23,6 +23,10 @@
 #include <QKeyEvent>
 #include <QJSValue>
 #include <QPointer>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QMetaMethod>
 
 class QQmlEngine;
 
@@ -69,10 +73,10 @@ public:
     ~WebOSKeyFilter();
 
     QString preProcess() const { return m_preProcess; }
-    void setPreProcess(QString func) { m_preProcess = func; }
+    void setPreProcess(QString func) { m_preProcess = func; m_preProcessMethod = QMetaMethod(); }
 
     QString fallback() const { return m_fallback; }
-    void setFallback(QString func) { m_fallback = func; }
+    void setFallback(QString func) { m_fallback = func; m_fallbackMethod = QMetaMethod(); }
 
     void keyFocusChanged();
 
@@ -81,16 +85,51 @@ public:
     Q_INVOKABLE void resetKeyFilters();
     Q_INVOKABLE void addKeyFilter(QJSValue keyFilter, QString handlerName = QStringLiteral("unknown"));
 
+    // Native key policy table, evaluated after preProcess and before the
+    // key filters. A policy is an object with optional matchers
+    //   key or keys, pressed, autoRepeat, modifiers and modifierMask,
+    //   state ("name" or "!name", see setPolicyState)
+    // and either an action (WebOSKeyPolicy.Result) or a handler function
+    // called like a key filter. Policies are tried in the order added.
+    Q_INVOKABLE void addKeyPolicy(QJSValue policy, QString policyName = QStringLiteral("unknown"));
+    Q_INVOKABLE void resetKeyPolicies();
+    Q_INVOKABLE void setPolicyState(QString state, bool active);
+
 protected:
     bool eventFilter(QObject *obj, QEvent *event) override;
 
 private:
+    struct KeyPolicyEntry {
+        QString name;
+        int pressed = -1;       // -1 for any, otherwise 0 or 1
+        int autoRepeat = -1;
+        quint32 modifiers = 0;
+        quint32 modifierMask = 0;
+        QString state;
+        bool stateNegated = false;
+        int action = WebOSKeyPolicy::NextPolicy;
+        QJSValue handler;
+    };
+
+    int evaluateKeyPolicies(int keycode, bool pressed, bool autoRepeat, quint32 nativeModifiers);
+    bool matches(const KeyPolicyEntry &entry, bool pressed, bool autoRepeat, quint32 nativeModifiers) const;
+    bool invokeHook(const QString &name, QMetaMethod &method, int keycode, bool pressed, QVariant *ret);
+
     QString m_preProcess;
     QString m_fallback;
+    QMetaMethod m_preProcessMethod;
+    QMetaMethod m_fallbackMethod;
     bool m_disallowRelease;
     bool m_wasAutoRepeat;
 
     QList<QPair<QString, QJSValue>> m_handlerList;
+
+    QVector<KeyPolicyEntry> m_policies;
+    // Indices into m_policies, ascending
+    QHash<int, QVector<int>> m_policiesByKey;
+    QVector<int> m_policiesForAnyKey;
+    QSet<QString> m_activeStates;
+    quint32 m_policyGeneration = 0;
 };
 
 #endif // WEBOSKEYFILTER_H
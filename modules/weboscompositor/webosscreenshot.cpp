@@ -1,4 +1,4 @@
-// Copyright (c) 2014-2021 LG Electronics, Inc.
+// Copyright (c) 2014-2024 LG Electronics, Inc.
 //
 // Licensed under the Apache License, Version 2.0 (the "License");
 // you may not use this file except in compliance with the License.
@@ -23,11 +23,287 @@
 #include <GLES2/gl2ext.h>
 
 #include <QImage>
+#include <QDebug>
 #include <QGuiApplication>
 #include <QFileInfo>
 #include <QDir>
 #include <QFile>
 #include <QQuickWindow>
+#include <QCoreApplication>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QPointer>
+
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ 0x88E1
+#endif
+#ifndef GL_MAP_READ_BIT
+#define GL_MAP_READ_BIT 0x0001
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#endif
+#ifndef GL_TIMEOUT_EXPIRED
+#define GL_TIMEOUT_EXPIRED 0x911B
+#endif
+#ifndef GL_WAIT_FAILED
+#define GL_WAIT_FAILED 0x911D
+#endif
+#ifndef GL_READ_FRAMEBUFFER
+#define GL_READ_FRAMEBUFFER 0x8CA8
+#endif
+#ifndef GL_DRAW_FRAMEBUFFER
+#define GL_DRAW_FRAMEBUFFER 0x8CA9
+#endif
+#ifndef GL_RGBA8
+#define GL_RGBA8 0x8058
+#endif
+
+// Frames to poll the readback before waiting for it
+static constexpr int MAX_READBACK_POLLS = 4;
+// Maximum time to wait for the readback after polling, in ns
+static constexpr quint64 READBACK_WAIT_TIMEOUT = 100000000;
+
+/* State of an asynchronous screenshot shared by the stages:
+   readback in the render thread, then encoding in a worker thread. */
+struct AsyncScreenShotRequest {
+    QPointer<WebOSScreenShot> source;
+    QQuickWindow *window = nullptr;
+    // Fixed at take, the item itself is only looked at once while
+    // synchronizing, when the GUI thread is blocked, for its texture
+    bool isWindow = true;
+    QPointer<WebOSSurfaceItem> syncTarget;
+    GLuint texture = 0;
+    QString path;
+    QByteArray format;
+    // In device pixels, top-left origin
+    QRect sourceRect;
+    int sourceHeight = 0;
+    QSize size;
+
+    QSize readSize;
+    bool flipped = false;
+    GLuint pbo = 0;
+    GLsync fence = nullptr;
+    int polls = 0;
+    QImage image;
+
+    // Window contents are read bottom-up unless flipped by the blit
+    bool flip() const { return isWindow && !flipped; }
+};
+
+/* Encodes the image in a worker thread and reports back to the GUI thread */
+class AsyncScreenShotEncodeTask : public QRunnable
+{
+public:
+    AsyncScreenShotEncodeTask(QSharedPointer<AsyncScreenShotRequest> request, WebOSScreenShot::ScreenShotErrors error)
+        : m_request(request), m_error(error) {}
+
+    void run() override
+    {
+        PMTRACE_FUNCTION;
+        if (m_error == WebOSScreenShot::SUCCESS) {
+            QImage image = m_request->image;
+            if (m_request->flip())
+                image = image.mirrored();
+            // Not scaled on the GPU
+            if (image.size() != m_request->size)
+                image = image.scaled(m_request->size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+            if (!WebOSScreenShot::saveImage(image, m_request->path, m_request->format))
+                m_error = WebOSScreenShot::UNABLE_TO_SAVE;
+        }
+        // Release the pixels before going back
+        m_request->image = QImage();
+
+        QSharedPointer<AsyncScreenShotRequest> request = m_request;
+        int error = m_error;
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [request, error]() {
+            if (request->source)
+                QMetaObject::invokeMethod(request->source.data(), "onAsyncTakeFinished", Qt::DirectConnection,
+                                          Q_ARG(QString, request->path), Q_ARG(int, error));
+        }, Qt::QueuedConnection);
+    }
+
+private:
+    QSharedPointer<AsyncScreenShotRequest> m_request;
+    int m_error;
+};
+
+/* Starts the readback into a pixel buffer object and picks it up in a
+   later frame once the GPU is done, not to stall the render thread.
+   Without pixel buffer objects (GLES2) pixels are read right away. */
+class AsyncScreenShotTask : public QRunnable
+{
+public:
+    AsyncScreenShotTask(QSharedPointer<AsyncScreenShotRequest> request) : m_request(request) {}
+
+    ~AsyncScreenShotTask()
+    {
+        // Dropped without running, e.g. the window is gone
+        if (!m_ran)
+            finish(WebOSScreenShot::UNABLE_TO_SAVE);
+    }
+
+    void run() override
+    {
+        PMTRACE_FUNCTION;
+        m_ran = true;
+        QOpenGLContext *context = QOpenGLContext::currentContext();
+        if (!context) {
+            finish(WebOSScreenShot::UNABLE_TO_SAVE);
+            return;
+        }
+
+        if (m_request->fence)
+            pollReadback(context->extraFunctions());
+        else
+            startReadback(context);
+    }
+
+private:
+    void startReadback(QOpenGLContext *context)
+    {
+        QOpenGLExtraFunctions *f = context->extraFunctions();
+        bool gles3 = context->format().majorVersion() >= 3;
+
+        GLint previousFbo = 0;
+        GLuint fbo = 0;
+        f->glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFbo);
+
+        const bool isWindow = m_request->isWindow;
+        if (!isWindow) {
+            // Runs at the synchronizing stage, see takeAsync
+            WebOSSurfaceItem *target = m_request->syncTarget.data();
+            m_request->texture = target ? (GLuint) target->texture() : 0;
+            m_request->syncTarget.clear();
+            if (!m_request->texture) {
+                finish(WebOSScreenShot::NO_SURFACE);
+                return;
+            }
+            f->glGenFramebuffers(1, &fbo);
+            f->glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            f->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_request->texture, 0);
+        } else {
+            f->glBindFramebuffer(GL_FRAMEBUFFER, context->defaultFramebufferObject());
+        }
+
+        // Texture rows are top-down, the window framebuffer is bottom-up
+        const QRect &src = m_request->sourceRect;
+        QRect readRect = !isWindow ? src
+            : QRect(src.x(), m_request->sourceHeight - src.y() - src.height(), src.width(), src.height());
+
+        // Downscale on the GPU so that only the small result is read back
+        GLuint scaledFbo = 0;
+        GLuint scaledRenderbuffer = 0;
+        const QSize &size = m_request->size;
+        if (gles3 && size != src.size()) {
+            f->glGenRenderbuffers(1, &scaledRenderbuffer);
+            f->glBindRenderbuffer(GL_RENDERBUFFER, scaledRenderbuffer);
+            f->glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.width(), size.height());
+            f->glGenFramebuffers(1, &scaledFbo);
+            f->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, scaledFbo);
+            f->glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, scaledRenderbuffer);
+            f->glBindFramebuffer(GL_READ_FRAMEBUFFER, isWindow ? context->defaultFramebufferObject() : fbo);
+
+            // Flip the window contents in the same pass
+            m_request->flipped = isWindow;
+            f->glBlitFramebuffer(readRect.x(), readRect.y(), readRect.x() + readRect.width(), readRect.y() + readRect.height(),
+                                 0, m_request->flipped ? size.height() : 0, size.width(), m_request->flipped ? 0 : size.height(),
+                                 GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+            f->glBindFramebuffer(GL_FRAMEBUFFER, scaledFbo);
+            readRect = QRect(QPoint(0, 0), size);
+        }
+
+        m_request->readSize = readRect.size();
+        int bytes = readRect.width() * readRect.height() * 4;
+
+        bool usePbo = gles3;
+        if (usePbo) {
+            f->glGenBuffers(1, &m_request->pbo);
+            f->glBindBuffer(GL_PIXEL_PACK_BUFFER, m_request->pbo);
+            f->glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+            f->glReadPixels(readRect.x(), readRect.y(), readRect.width(), readRect.height(), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            f->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            m_request->fence = f->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        } else {
+            m_request->image = QImage(readRect.size(), QImage::Format_RGBA8888_Premultiplied);
+            f->glReadPixels(readRect.x(), readRect.y(), readRect.width(), readRect.height(), GL_RGBA, GL_UNSIGNED_BYTE, m_request->image.bits());
+        }
+
+        f->glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+        if (fbo)
+            f->glDeleteFramebuffers(1, &fbo);
+        if (scaledFbo) {
+            f->glDeleteFramebuffers(1, &scaledFbo);
+            f->glDeleteRenderbuffers(1, &scaledRenderbuffer);
+        }
+
+        if (usePbo)
+            scheduleNext();
+        else
+            finish(WebOSScreenShot::SUCCESS);
+    }
+
+    void pollReadback(QOpenGLExtraFunctions *f)
+    {
+        // Not ready yet, check again in the next frame
+        bool lastPoll = ++m_request->polls >= MAX_READBACK_POLLS;
+        GLenum result = f->glClientWaitSync(m_request->fence, lastPoll ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                            lastPoll ? READBACK_WAIT_TIMEOUT : 0);
+        if (result == GL_TIMEOUT_EXPIRED && !lastPoll) {
+            scheduleNext();
+            return;
+        }
+
+        f->glDeleteSync(m_request->fence);
+        m_request->fence = nullptr;
+
+        WebOSScreenShot::ScreenShotErrors error = WebOSScreenShot::UNABLE_TO_SAVE;
+        if (result != GL_TIMEOUT_EXPIRED && result != GL_WAIT_FAILED) {
+            const QSize &size = m_request->readSize;
+            f->glBindBuffer(GL_PIXEL_PACK_BUFFER, m_request->pbo);
+            void *pixels = f->glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size.width() * size.height() * 4, GL_MAP_READ_BIT);
+            if (pixels) {
+                m_request->image = QImage(size, QImage::Format_RGBA8888_Premultiplied);
+                memcpy(m_request->image.bits(), pixels, size.width() * size.height() * 4);
+                f->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                error = WebOSScreenShot::SUCCESS;
+            }
+            f->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        } else {
+            qWarning() << "Screenshot readback is not completed in time";
+        }
+
+        f->glDeleteBuffers(1, &m_request->pbo);
+        m_request->pbo = 0;
+        finish(error);
+    }
+
+    void scheduleNext()
+    {
+        QQuickWindow *window = m_request->window;
+        window->scheduleRenderJob(new AsyncScreenShotTask(m_request), QQuickWindow::AfterRenderingStage);
+        // Make sure that there is a next frame to run the job
+        QMetaObject::invokeMethod(window, "update", Qt::QueuedConnection);
+    }
+
+    void finish(WebOSScreenShot::ScreenShotErrors error)
+    {
+        QThreadPool::globalInstance()->start(new AsyncScreenShotEncodeTask(m_request, error));
+    }
+
+    QSharedPointer<AsyncScreenShotRequest> m_request;
+    bool m_ran = false;
+};
 
 WebOSScreenShot::WebOSScreenShot()
     : m_target(nullptr)
@@ -36,10 +312,14 @@ WebOSScreenShot::WebOSScreenShot()
 {
 }
 
-WebOSScreenShot::ScreenShotErrors WebOSScreenShot::take()
+static QRect toDevicePixels(const QRect& rect, qreal dpr)
 {
-    PMTRACE_FUNCTION;
-    QQuickWindow* win = m_window ? m_window : qobject_cast<QQuickWindow*>(QGuiApplication::focusWindow());
+    return QRectF(QPointF(rect.topLeft()) * dpr, QSizeF(rect.size()) * dpr).toAlignedRect();
+}
+
+WebOSScreenShot::ScreenShotErrors WebOSScreenShot::validate(QQuickWindow*& win, QSize& sourceSize)
+{
+    win = m_window ? m_window : qobject_cast<QQuickWindow*>(QGuiApplication::focusWindow());
     if (win == nullptr) {
         // try to take screenshot but the active window is not a quick window
         // (unlikely)
@@ -52,7 +332,6 @@ WebOSScreenShot::ScreenShotErrors WebOSScreenShot::take()
         return INVALID_PATH;
     }
 
-    QImage img;
     if (m_target) {
         if (!m_target->surface() || !m_target->window()) {
             emit screenShotError(NO_SURFACE);
@@ -63,34 +342,69 @@ WebOSScreenShot::ScreenShotErrors WebOSScreenShot::take()
             return HAS_SECURED_CONTENT;
         }
 #if QT_VERSION >= QT_VERSION_CHECK(6,0,0)
-        m_size = m_target->surface()->bufferSize();
+        sourceSize = m_target->surface()->bufferSize();
 #else
-        m_size = m_target->surface()->size();
+        sourceSize = m_target->surface()->size();
 #endif
+    } else {
+        WebOSCompositorWindow *compositorWindow = qobject_cast<WebOSCompositorWindow *>(win);
+        if (compositorWindow && compositorWindow->hasSecuredContent()) {
+            emit screenShotError(HAS_SECURED_CONTENT);
+            return HAS_SECURED_CONTENT;
+        }
+        sourceSize = win->size();
+    }
+
+    m_captureRect = QRect(QPoint(0, 0), sourceSize);
+    if (m_sourceRect.isValid())
+        m_captureRect &= m_sourceRect;
+    if (m_captureRect.isEmpty()) {
+        emit screenShotError(INVALID_SOURCE_RECT);
+        return INVALID_SOURCE_RECT;
+    }
 
-        img = QImage(m_size, QImage::Format_ARGB32_Premultiplied);
+    m_size = m_targetSize.isValid() ? m_targetSize : m_captureRect.size();
+
+    return SUCCESS;
+}
+
+WebOSScreenShot::ScreenShotErrors WebOSScreenShot::take()
+{
+    PMTRACE_FUNCTION;
+    QQuickWindow* win = nullptr;
+    QSize sourceSize;
+    ScreenShotErrors error = validate(win, sourceSize);
+    if (error != SUCCESS)
+        return error;
+
+    QImage img;
+    QRect captureRect = m_captureRect;
+    if (m_target) {
+        img = QImage(sourceSize, QImage::Format_ARGB32_Premultiplied);
 
         // gets destroyed automatically after run()
         ScreenShotTask* task = new ScreenShotTask(this, &img);
 
         // we need to wait for the runnable to finish
-        // we could make this api asynchronous instead
+        // use takeAsync() not to block the compositor
         win->scheduleRenderJob(task, QQuickWindow::AfterRenderingStage);
         // this will render the scene graph and trigger the runnable to run
         win->grabWindow();
     } else {
-        WebOSCompositorWindow *compositorWindow = qobject_cast<WebOSCompositorWindow *>(win);
-        if (compositorWindow && compositorWindow->hasSecuredContent()) {
-            emit screenShotError(HAS_SECURED_CONTENT);
-            return HAS_SECURED_CONTENT;
-        }
         // Grab full window. we could use the task as well,
         // but I think we should re-use Qt code if available.
-        m_size = win->size();
         img = win->grabWindow();
+        captureRect = toDevicePixels(captureRect, (qreal) img.width() / win->width());
     }
 
-    if (img.save(m_path, m_format.toStdString().c_str())) {
+    // Crop and scale on the CPU, takeAsync() does it on the GPU
+    if (captureRect != img.rect())
+        img = img.copy(captureRect);
+    if (m_targetSize.isValid() && img.size() != m_size)
+        img = img.scaled(m_size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    m_size = img.size();
+
+    if (saveImage(img, m_path, m_format.toLatin1())) {
         emit screenShotSaved(m_path);
         return SUCCESS;
     } else {
@@ -99,6 +413,64 @@ WebOSScreenShot::ScreenShotErrors WebOSScreenShot::take()
     }
 }
 
+WebOSScreenShot::ScreenShotErrors WebOSScreenShot::takeAsync()
+{
+    PMTRACE_FUNCTION;
+    if (m_busy) {
+        qWarning() << "Previous screenshot is still in progress for" << this;
+        emit screenShotError(UNABLE_TO_SAVE);
+        return UNABLE_TO_SAVE;
+    }
+
+    QQuickWindow* win = nullptr;
+    QSize sourceSize;
+    ScreenShotErrors error = validate(win, sourceSize);
+    if (error != SUCCESS)
+        return error;
+
+    QSharedPointer<AsyncScreenShotRequest> request(new AsyncScreenShotRequest);
+    request->source = this;
+    request->window = win;
+    request->isWindow = !m_target;
+    request->syncTarget = m_target;
+    request->path = m_path;
+    request->format = m_format.toLatin1();
+    if (m_target) {
+        request->sourceRect = m_captureRect;
+        request->sourceHeight = sourceSize.height();
+        request->size = m_size;
+    } else {
+        // Window contents are read from the framebuffer in device pixels
+        qreal dpr = win->devicePixelRatio();
+        request->sourceRect = toDevicePixels(m_captureRect, dpr);
+        request->sourceHeight = qRound(sourceSize.height() * dpr);
+        request->size = m_targetSize.isValid() ? m_size : request->sourceRect.size();
+        m_size = request->size;
+    }
+
+    // Texture of the target is valid after synchronizing while the GUI
+    // thread is blocked, the window contents are after rendering.
+    win->scheduleRenderJob(new AsyncScreenShotTask(request),
+                           m_target ? QQuickWindow::AfterSynchronizingStage : QQuickWindow::AfterRenderingStage);
+    win->update();
+
+    m_busy = true;
+    emit busyChanged();
+
+    return SUCCESS;
+}
+
+void WebOSScreenShot::onAsyncTakeFinished(const QString& path, int error)
+{
+    m_busy = false;
+    emit busyChanged();
+
+    if (error == SUCCESS)
+        emit screenShotSaved(path);
+    else
+        emit screenShotError(static_cast<ScreenShotError>(error));
+}
+
 void WebOSScreenShot::unsetTarget()
 {
     setTarget(nullptr);
@@ -134,6 +506,40 @@ void WebOSScreenShot::setFormat(const QString& format)
     }
 }
 
+void WebOSScreenShot::setSourceRect(const QRect& rect)
+{
+    if (rect != m_sourceRect) {
+        m_sourceRect = rect;
+        emit sourceRectChanged();
+    }
+}
+
+void WebOSScreenShot::setTargetSize(const QSize& size)
+{
+    if (size != m_targetSize) {
+        m_targetSize = size;
+        emit targetSizeChanged();
+    }
+}
+
+bool WebOSScreenShot::saveImage(const QImage& image, const QString& path, const QByteArray& format)
+{
+    if (qstricmp(format.constData(), "RAW") != 0)
+        return image.save(path, format.constData());
+
+    QImage raw = image.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    const qint64 rowBytes = raw.width() * 4;
+    for (int y = 0; y < raw.height(); y++) {
+        if (file.write(reinterpret_cast<const char *>(raw.constScanLine(y)), rowBytes) != rowBytes)
+            return false;
+    }
+    return true;
+}
+
 void WebOSScreenShot::setWindow(QQuickWindow* window)
 {
     if (m_window != window) {
@@ -19,6 +19,7 @@
 
 #include <QObject>
 #include <QSize>
+#include <QRect>
 #include <QRunnable>
 #include <QQuickWindow>
 
@@ -35,9 +36,16 @@ class WEBOS_COMPOSITOR_EXPORT WebOSScreenShot : public QObject
     Q_MOC_INCLUDE("webossurfaceitem.h")
 #endif
     Q_PROPERTY(QString path READ path WRITE setPath NOTIFY pathChanged)
+    // Image formats supported by QImage, or "RAW" for premultiplied
+    // RGBA8888 pixels in top-down rows without any header or padding
     Q_PROPERTY(QString format READ format WRITE setFormat NOTIFY formatChanged)
     Q_PROPERTY(QSize size READ size)
+    // Part of the target or window to capture, the whole if not valid
+    Q_PROPERTY(QRect sourceRect READ sourceRect WRITE setSourceRect NOTIFY sourceRectChanged)
+    // Size of the result image, the size of sourceRect if not valid
+    Q_PROPERTY(QSize targetSize READ targetSize WRITE setTargetSize NOTIFY targetSizeChanged)
     Q_PROPERTY(QQuickWindow* window READ window WRITE setWindow NOTIFY windowChanged)
+    Q_PROPERTY(bool busy READ busy NOTIFY busyChanged)
 
 public:
     enum ScreenShotError {
@@ -46,7 +54,8 @@ public:
         INVALID_PATH,
         UNABLE_TO_SAVE,
         INVALID_ACTIVE_WINDOW,
-        HAS_SECURED_CONTENT
+        HAS_SECURED_CONTENT,
+        INVALID_SOURCE_RECT
     };
     Q_DECLARE_FLAGS(ScreenShotErrors, ScreenShotError)
 
@@ -63,11 +72,24 @@ public:
 
     QSize size() const { return m_size; }
 
+    QRect sourceRect() const { return m_sourceRect; }
+    void setSourceRect(const QRect& rect);
+
+    QSize targetSize() const { return m_targetSize; }
+    void setTargetSize(const QSize& size);
+
+    static bool saveImage(const QImage& image, const QString& path, const QByteArray& format);
+
     QQuickWindow* window() const { return m_window; }
     void setWindow(QQuickWindow* window);
 
+    bool busy() const { return m_busy; }
+
 public slots:
     virtual ScreenShotErrors take();
+    // Returns immediately, the result is notified by screenShotSaved
+    // or screenShotError once the file is written.
+    ScreenShotErrors takeAsync();
 
 signals:
     void screenShotSaved(const QString& path);
@@ -76,6 +98,9 @@ signals:
     void targetChanged();
     void pathChanged();
     void formatChanged();
+    void busyChanged();
+    void sourceRectChanged();
+    void targetSizeChanged();
 
 protected:
     WebOSSurfaceItem* m_target;
@@ -86,9 +111,18 @@ protected:
 
 private:
     bool isValidPath(const QString& path) const;
+    ScreenShotErrors validate(QQuickWindow*& win, QSize& sourceSize);
+
+    bool m_busy = false;
+
+    QRect m_sourceRect;
+    QSize m_targetSize;
+    // Resolved from sourceRect for the current capture
+    QRect m_captureRect;
 
 private slots:
     void unsetTarget();
+    void onAsyncTakeFinished(const QString& path, int error);
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(WebOSScreenShot::ScreenShotErrors)
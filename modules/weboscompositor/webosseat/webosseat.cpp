@@ -67,18 +67,11 @@ WebOSInputDevice* WebOSInputManager::findWebOSInputDevice(struct ::wl_resource *
     if (seatDefault == seatResource)
         return NULL;
 
-    QWaylandSeat *findInputDev = NULL;
-    QList<QWaylandSeat *> seats = m_compositor->inputDevices();
-    foreach (QWaylandSeat *seat, seats)
-    {
-        if (seat == seatResource) {
-            findInputDev = seat;
-            return static_cast<WebOSInputDevice*>(seat);
-        }
-    }
+    if (m_compositor->isRegisteredSeat(seatResource))
+        return static_cast<WebOSInputDevice*>(seatResource);
 
     qWarning() << "SHOULD NOT HAPPEN! All input devices except default MUST HAVE WebOSInputDevice!";
-    Q_ASSERT(seatDefault == seatResource || findInputDev);
+    Q_ASSERT(seatDefault == seatResource);
     return NULL;
 }
 
@@ -21,7 +21,10 @@
 #include "webossurfacemodel.h"
 #include "weboscorecompositor.h"
 #include "weboscompositorwindow.h"
+#include "surfacehitindex.h"
 #include "weboscompositortracer.h"
+#include "weboscompositorlogging.h"
+#include "cursorimagecache.h"
 #include "webosshellsurface.h"
 #include "webosinputmethod.h"
 #include "webosforeign.h"
@@ -36,6 +39,8 @@
 #include <QQmlEngine>
 #include <QOpenGLTexture>
 #include <QDebug>
+#include <QHash>
+#include <QMetaProperty>
 
 #include <qweboskeyextension.h>
 
@@ -181,6 +186,10 @@ void WebOSSurfaceItem::handleWindowChanged()
 
     setDisplayId(window() ? static_cast<WebOSCompositorWindow *>(window())->displayId() : -1);
 
+    // The index of the old window drops the item by itself
+    if (window())
+        static_cast<WebOSCompositorWindow *>(window())->hitIndex()->addItem(this);
+
     if (!window()) {
         // Unset direct update whenever it gets removed from the scene
         setDirectUpdateOnPlane(false);
@@ -570,7 +579,7 @@ void WebOSSurfaceItem::touchEvent(QTouchEvent *event)
             }
         }
         if (e.type() == QEvent::TouchBegin || e.type() == QEvent::TouchEnd)
-            qInfo() << this << &e << seat;
+            qCInfoLimited(lsmInput, 20, 40) << this << &e << seat;
 
         seat->sendFullTouchEvent(surface(), &e);
     } else {
@@ -884,6 +893,62 @@ void WebOSSurfaceItem::setWindowProperty(const QString& key, const QVariant& val
     }
 }
 
+typedef QHash<QString, WebOSSurfaceItem::WindowPropertyInfo> WindowPropertyTable;
+
+static WindowPropertyTable buildWindowPropertyTable(const QMetaObject *mo)
+{
+    WindowPropertyTable table;
+
+    for (int i = 0; i < mo->propertyCount(); ++i) {
+        QMetaProperty property = mo->property(i);
+        if (property.hasNotifySignal())
+            table[QString::fromLatin1(property.name())].notifySignal = property.notifySignal();
+    }
+
+    table[QStringLiteral("appId")].apply = [](WebOSSurfaceItem *item, const QVariant &value) {
+        item->setAppId(value.toString());
+    };
+    table[QStringLiteral("_WEBOS_WINDOW_TYPE")].apply = [](WebOSSurfaceItem *item, const QVariant &value) {
+        item->setType(value.toString());
+    };
+    table[QStringLiteral("_WEBOS_WINDOW_CLASS")].apply = [](WebOSSurfaceItem *item, const QVariant &value) {
+        item->setWindowClass(WebOSSurfaceItem::WindowClass(value.toInt()), false);
+    };
+    table[QStringLiteral("title")].apply = [](WebOSSurfaceItem *item, const QVariant &value) {
+        item->setTitle(value.toString(), false);
+    };
+    table[QStringLiteral("subtitle")].apply = [](WebOSSurfaceItem *item, const QVariant &value) {
+        item->setSubtitle(value.toString(), false);
+    };
+    table[QStringLiteral("params")].apply = [](WebOSSurfaceItem *item, const QVariant &value) {
+        item->setParams(value.toString());
+    };
+    table[QStringLiteral("_WEBOS_LAUNCH_PREV_APP_AFTER_CLOSING")].apply = [](WebOSSurfaceItem *item, const QVariant &value) {
+        item->setLaunchLastApp(value.toBool());
+    };
+    table[QStringLiteral("_WEBOS_LAUNCH_LAST_INPUT_APP_AFTER_CLOSING")].apply = [](WebOSSurfaceItem *item, const QVariant &value) {
+        item->setLaunchLastInputApp(value.toBool());
+    };
+    table[QStringLiteral("displayAffinity")].apply = [](WebOSSurfaceItem *item, const QVariant &value) {
+        item->setDisplayAffinity(value.toInt());
+    };
+
+    return table;
+}
+
+const WebOSSurfaceItem::WindowPropertyInfo *WebOSSurfaceItem::windowPropertyInfo(const QMetaObject *mo, const QString &name)
+{
+    // Subclasses may add properties, so there is a table per metaobject
+    static QHash<const QMetaObject *, WindowPropertyTable> s_tables;
+
+    QHash<const QMetaObject *, WindowPropertyTable>::iterator tableIt = s_tables.find(mo);
+    if (tableIt == s_tables.end())
+        tableIt = s_tables.insert(mo, buildWindowPropertyTable(mo));
+
+    WindowPropertyTable::const_iterator it = tableIt->constFind(name);
+    return it != tableIt->constEnd() ? &it.value() : nullptr;
+}
+
 void WebOSSurfaceItem::updateProperties(const QVariantMap &properties, const QString &name, const QVariant &value)
 {
     if (!surface()) {
@@ -891,25 +956,9 @@ void WebOSSurfaceItem::updateProperties(const QVariantMap &properties, const QSt
         return;
     }
 
-    if (name == QLatin1String("appId")) {
-        setAppId(value.toString());
-    } else if (name == QLatin1String("_WEBOS_WINDOW_TYPE")) {
-        setType(value.toString());
-    } else if (name == QLatin1String("_WEBOS_WINDOW_CLASS")) {
-        setWindowClass(WebOSSurfaceItem::WindowClass(value.toInt()), false);
-    } else if (name == QLatin1String("title")) {
-        setTitle(value.toString(), false);
-    } else if (name == QLatin1String("subtitle")) {
-        setSubtitle(value.toString(), false);
-    } else if (name == QLatin1String("params")) {
-        setParams(value.toString());
-    } else if (name == QLatin1String("_WEBOS_LAUNCH_PREV_APP_AFTER_CLOSING")) {
-        setLaunchLastApp(value.toBool());
-    } else if (name == QLatin1String("_WEBOS_LAUNCH_LAST_INPUT_APP_AFTER_CLOSING")) {
-        setLaunchLastInputApp(value.toBool());
-    } else if (name == QLatin1String("displayAffinity")) {
-        setDisplayAffinity(value.toInt());
-    }
+    const WindowPropertyInfo *info = windowPropertyInfo(metaObject(), name);
+    if (info && info->apply)
+        info->apply(this, value);
 
     emit windowPropertiesChanged(properties);
 }
@@ -1251,12 +1300,14 @@ void WebOSSurfaceItem::requestStateChange(Qt::WindowState state)
 void WebOSSurfaceItem::onSurfaceDamaged(const QRegion &region)
 {
     PMTRACE_FUNCTION;
-    Q_UNUSED(region);
     PMTRACE_KEY_VALUE_LOG("appFirstFrame", appId().toStdString().c_str());
 
     if (window()) {
         WebOSCompositorWindow *w = static_cast<WebOSCompositorWindow *>(window());
-        w->reportSurfaceDamaged(this);
+        if (w->damageTracking())
+            w->reportSurfaceDamaged(this, mapDamageToScene(region));
+        else
+            w->reportSurfaceDamaged(this);
     }
 
     /* Some surfaces can try to render after it is detached from scengraph.
@@ -1270,6 +1321,30 @@ void WebOSSurfaceItem::onSurfaceDamaged(const QRegion &region)
     }
 }
 
+// Maps the damage in surface coordinates to the scene coordinates
+QRegion WebOSSurfaceItem::mapDamageToScene(const QRegion &region) const
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6,0,0)
+    QSize surfaceSize = surface() ? surface()->bufferSize() : QSize();
+#else
+    QSize surfaceSize = surface() ? surface()->size() : QSize();
+#endif
+    // Not able to tell where the damage is, so take the whole item
+    if (surfaceSize.isEmpty() || region.isEmpty())
+        return QRegion(mapRectToScene(QRectF(0, 0, width(), height())).toAlignedRect());
+
+    qreal sx = width() / surfaceSize.width();
+    qreal sy = height() / surfaceSize.height();
+
+    QRegion sceneRegion;
+    for (const QRect &r : region) {
+        QRectF itemRect(r.x() * sx, r.y() * sy, r.width() * sx, r.height() * sy);
+        // Extend by a pixel to cover the filtering at the edges
+        sceneRegion += mapRectToScene(itemRect).toAlignedRect().adjusted(-1, -1, 1, 1);
+    }
+    return sceneRegion;
+}
+
 void WebOSSurfaceItem::setNotifyPositionToClient(bool notify)
 {
 
@@ -1557,29 +1632,29 @@ void WebOSSurfaceItem::contentOrientationChanged()
 void WebOSSurfaceItem::setCursorSurface(QWaylandSurface *surface, int hotSpotX, int hotSpotY)
 {
     if (m_cursorView.surface() == surface && m_cursorHotSpotX == hotSpotX && m_cursorHotSpotY == hotSpotY) {
-        qWarning() << "Cursor: attempting to set the same cursor surface, ignored" << surface << hotSpotX << hotSpotY;
+        qCWarning(lsmCursor) << "Cursor: attempting to set the same cursor surface, ignored" << surface << hotSpotX << hotSpotY;
     } else {
         if (!surface) {
             // Ignore null cursor surface because we use a different way to hide the cursor
             // by setting hotspot as 254. (see WebOSCoreCompositor::getCursor)
-            qWarning() << "Cursor: null cursor has no effect in webOS";
+            qCWarning(lsmCursor) << "Cursor: null cursor has no effect in webOS";
             return;
         }
 
-        qDebug() << "Cursor: updating cursor with surface" << surface << hotSpotX << hotSpotY;
+        qCDebug(lsmCursor) << "Cursor: updating cursor with surface" << surface << hotSpotX << hotSpotY;
 
         QCursor cursor;
         bool staticCursor = false;
 
         if (m_compositor->getCursor(surface, hotSpotX, hotSpotY, cursor)) {
-            qDebug() << "Cursor: use the cursor designated by compositor" << cursor;
+            qCDebug(lsmCursor) << "Cursor: use the cursor designated by compositor" << cursor;
             staticCursor = true;
         } else {
             staticCursor = false;
         }
 
         if (m_cursorView.surface()) {
-            qDebug() << "Cursor: disconnect old cursor surface" << m_cursorView.surface() << "static:" << staticCursor;
+            qCDebug(lsmCursor) << "Cursor: disconnect old cursor surface" << m_cursorView.surface() << "static:" << staticCursor;
             QObject::disconnect(m_cursorView.surface(), SIGNAL(redraw()), this, SLOT(updateCursor()));
         }
 
@@ -1590,10 +1665,10 @@ void WebOSSurfaceItem::setCursorSurface(QWaylandSurface *surface, int hotSpotX,
         m_cursorHotSpotX = hotSpotX;
         m_cursorHotSpotY = hotSpotY;
         if (staticCursor) {
-            qDebug() << "Cursor: set a static cursor" << cursor;
+            qCDebug(lsmCursor) << "Cursor: set a static cursor" << cursor;
             setCursor(cursor);
         } else if (surface) {
-            qDebug() << "Cursor: set a live cursor with cursor surface" << surface << "static:" << staticCursor;
+            qCDebug(lsmCursor) << "Cursor: set a live cursor with cursor surface" << surface << "static:" << staticCursor;
             connect(surface, SIGNAL(redraw()), this, SLOT(updateCursor()), Qt::UniqueConnection);
         }
     }
@@ -1602,17 +1677,16 @@ void WebOSSurfaceItem::setCursorSurface(QWaylandSurface *surface, int hotSpotX,
 void WebOSSurfaceItem::updateCursor()
 {
     m_cursorView.advance();
-    QImage image = m_cursorView.currentBuffer().image().copy();
-    if (!image.isNull()) {
-        if (m_cursorHotSpotX >= 0 && m_cursorHotSpotX <= image.size().width() &&
-            m_cursorHotSpotY >= 0 && m_cursorHotSpotY <= image.size().height()) {
-            qDebug() << "Cursor: live updating cursor with surface" << m_cursorView.surface() << m_cursorHotSpotX << m_cursorHotSpotY;
-            QCursor c(QPixmap::fromImage(image), m_cursorHotSpotX, m_cursorHotSpotY);
+    QCursor c;
+    if (CursorImageCache::instance()->cursorFor(m_cursorView.currentBuffer(), m_cursorHotSpotX, m_cursorHotSpotY, &c)) {
+        // Cached cursors share the pixmap, so an unchanged frame compares equal
+        if (cursor() != c) {
+            qCDebug(lsmCursor) << "Cursor: live updating cursor with surface" << m_cursorView.surface() << m_cursorHotSpotX << m_cursorHotSpotY;
             setCursor(c);
-            return;
         }
+        return;
     }
-    qWarning() << "Cursor: fallback to the default cursor";
+    qCWarning(lsmCursor) << "Cursor: fallback to the default cursor";
     setCursor(QCursor(Qt::ArrowCursor));
 }
 
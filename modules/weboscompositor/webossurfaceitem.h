@@ -19,6 +19,7 @@
 
 #include <WebOSCoreCompositor/weboscompositorexport.h>
 
+#include <QMetaMethod>
 #include <QObject>
 #include <QPointer>
 #include <QFlags>
@@ -560,6 +561,16 @@ public:
         return (!surface || surface->views().isEmpty()) ? nullptr : qobject_cast<WebOSSurfaceItem*>(surface->views().first()->renderObject());
     }
 
+    // What a window property set by the client maps to
+    struct WindowPropertyInfo {
+        // NOTIFY signal of the Q_PROPERTY of the same name, if any
+        QMetaMethod notifySignal;
+        // Typed setter of the item state that follows the property, if any
+        void (*apply)(WebOSSurfaceItem *item, const QVariant &value) = nullptr;
+    };
+    // Built once per metaobject, nullptr if the name maps to nothing
+    static const WindowPropertyInfo *windowPropertyInfo(const QMetaObject *mo, const QString &name);
+
 #if QT_VERSION < QT_VERSION_CHECK(6,0,0)
     QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
 #endif
@@ -685,6 +696,7 @@ private:
     // methods
     void setDisplayId(int id);
     bool getCursorFromSurface(QWaylandSurface *surface, int hotSpotX, int hotSpotY, QCursor& cursor);
+    QRegion mapDamageToScene(const QRegion &region) const;
 
 private slots:
     void handleWindowChanged();
@@ -18,11 +18,15 @@
 #include "webossurfaceitem.h"
 #include <QDebug>
 #include "weboscompositortracer.h"
+#include "weboscompositorlogging.h"
+
+#include <algorithm>
 
 WebOSSurfaceModel::WebOSSurfaceModel(QObject *parent)
     : m_dataDirty(false)
     , m_firstDirtyIndex(0)
     , m_lastDirtyIndex(0)
+    , m_coalesceDataChanged(qgetenv("WEBOS_SURFACE_MODEL_COALESCE_CHANGES").toInt() == 1)
 {
     Q_UNUSED(parent)
     roles[0] = "surfaceItem";
@@ -30,7 +34,14 @@ WebOSSurfaceModel::WebOSSurfaceModel(QObject *parent)
     // This allows us to collect item updates from one function into a single model update
     // FIXME: Disabling defered dataChanged signal as it breaks the surface logic in QML side
     // connect(this, SIGNAL(deferDataChanged()), this, SLOT(handleDeferDataChanged()), Qt::QueuedConnection);
-    connect(this, SIGNAL(deferDataChanged()), this, SLOT(handleDeferDataChanged()), Qt::DirectConnection);
+    // Coalescing is therefore opt-in, for the deployments whose QML doesn't
+    // rely on seeing the change synchronously.
+    if (m_coalesceDataChanged) {
+        qCInfo(lsmModel) << "Coalescing dataChanged of surface items";
+        connect(this, SIGNAL(deferDataChanged()), this, SLOT(flushDataChanged()), Qt::QueuedConnection);
+    } else {
+        connect(this, SIGNAL(deferDataChanged()), this, SLOT(handleDeferDataChanged()), Qt::DirectConnection);
+    }
 }
 
 WebOSSurfaceModel::~WebOSSurfaceModel()
@@ -73,7 +84,9 @@ void WebOSSurfaceModel::appendRows(const QList<WebOSSurfaceItem *> &items)
     foreach (WebOSSurfaceItem *item, items) {
         connect(item, SIGNAL(dataChanged()), SLOT(handleItemChange()));
         connect(item, SIGNAL(windowClassChanged()), SLOT(handleItemChange()));
+        m_positions.insert(item, m_firstPosition + m_list.size());
         m_list.append(item);
+        indexItem(item);
     }
     endInsertRows();
 }
@@ -84,6 +97,8 @@ void WebOSSurfaceModel::insertRow(int row, WebOSSurfaceItem *item)
     beginInsertRows(QModelIndex(), row, row);
     connect(item, SIGNAL(fullscreenChanged(bool)), SLOT(handleItemChange()));
     m_list.insert(row, item);
+    insertPosition(row);
+    indexItem(item);
     endInsertRows();
 }
 
@@ -94,7 +109,11 @@ bool WebOSSurfaceModel::removeRow(int row, const QModelIndex &parent)
     if (row < 0 || row >= m_list.size())
         return false;
     beginRemoveRows(QModelIndex(), row, row);
-    delete m_list.takeAt(row);
+    WebOSSurfaceItem* item = m_list.at(row);
+    unindexItem(item);
+    removePosition(row);
+    m_list.removeAt(row);
+    delete item;
     endRemoveRows();
     return true;
 }
@@ -106,8 +125,13 @@ bool WebOSSurfaceModel::removeRows(int row, int count, const QModelIndex &parent
     if (row < 0 || (row + count) >= m_list.size())
         return false;
     beginRemoveRows(QModelIndex(), row, row + count - 1);
-    for (int i = 0; i < count; ++i)
-        delete m_list.takeAt(row);
+    for (int i = 0; i < count; ++i) {
+        WebOSSurfaceItem* item = m_list.at(row);
+        unindexItem(item);
+        removePosition(row);
+        m_list.removeAt(row);
+        delete item;
+    }
     endRemoveRows();
     return true;
 }
@@ -116,7 +140,10 @@ WebOSSurfaceItem* WebOSSurfaceModel::takeRow(int row)
 {
     PMTRACE_FUNCTION;
     beginRemoveRows(QModelIndex(), row, row);
-    WebOSSurfaceItem* item = m_list.takeAt(row);
+    WebOSSurfaceItem* item = m_list.at(row);
+    unindexItem(item);
+    removePosition(row);
+    m_list.removeAt(row);
     endRemoveRows();
     return item;
 }
@@ -125,21 +152,16 @@ QModelIndex WebOSSurfaceModel::indexFromItem(const WebOSSurfaceItem *item) const
 {
     PMTRACE_FUNCTION;
     Q_ASSERT(item);
-    for (int row = 0; row < m_list.size(); ++row) {
-        if (m_list.at(row) == item)
-            return index(row);
-    }
-    return QModelIndex();
+    const int row = rowOf(item);
+    return row >= 0 ? index(row) : QModelIndex();
 }
 
 WebOSSurfaceItem* WebOSSurfaceModel::surfaceItemForAppId(const QString& appId)
 {
     PMTRACE_FUNCTION;
-    for (int row = 0; row < m_list.size(); ++row) {
-        WebOSSurfaceItem* item = static_cast<WebOSSurfaceItem*>(m_list.at(row));
-        if (item->appId() == appId)
-            return item;
-    }
+    auto it = m_appIdIndex.constFind(appId);
+    if (it != m_appIdIndex.constEnd() && !it.value().isEmpty())
+        return it.value().first();
     return NULL;
 }
 
@@ -155,27 +177,150 @@ WebOSSurfaceItem* WebOSSurfaceModel::surfaceItemForIndex(int index)
 WebOSSurfaceItem* WebOSSurfaceModel::getLastRecentItem()
 {
     PMTRACE_FUNCTION;
-    for (int row = 0; row < m_list.size(); ++row) {
-        WebOSSurfaceItem* item = static_cast<WebOSSurfaceItem*>(m_list.at(row));
-        QVariantMap windowProperties = item->windowProperties();
-        QString surfaceType = windowProperties.value(QLatin1String("_WEBOS_WINDOW_TYPE")).toString();
-        if ((surfaceType.isEmpty() || // This is for plain Qt apps that do not set window type.
-             surfaceType == QLatin1String("_WEBOS_WINDOW_TYPE_CARD")))
-            return item;
-    }
-    return NULL;
+    // The type mirrors the _WEBOS_WINDOW_TYPE window property.
+    // Empty type is for plain Qt apps that do not set window type.
+    WebOSSurfaceItem* plain = firstOfType(QString());
+    WebOSSurfaceItem* card = firstOfType(QStringLiteral("_WEBOS_WINDOW_TYPE_CARD"));
+    if (plain && card)
+        return m_positions.value(plain) < m_positions.value(card) ? plain : card;
+    return plain ? plain : card;
 }
 
 void WebOSSurfaceModel::clear()
 {
     qDeleteAll(m_list);
     m_list.clear();
+    m_positions.clear();
+    m_firstPosition = 0;
+    m_appIdIndex.clear();
+    m_typeIndex.clear();
+    m_indexedKeys.clear();
+    m_dirtyItems.clear();
+}
+
+WebOSSurfaceItem* WebOSSurfaceModel::firstOfType(const QString &type) const
+{
+    auto it = m_typeIndex.constFind(type);
+    if (it != m_typeIndex.constEnd() && !it.value().isEmpty())
+        return it.value().first();
+    return NULL;
+}
+
+int WebOSSurfaceModel::rowOf(const WebOSSurfaceItem *item) const
+{
+    auto it = m_positions.constFind(item);
+    return it != m_positions.constEnd() ? it.value() - m_firstPosition : -1;
+}
+
+// Called once the item is in m_list at the row
+void WebOSSurfaceModel::insertPosition(int row)
+{
+    if (row < m_list.size() / 2) {
+        for (int i = 0; i < row; ++i)
+            --m_positions[m_list.at(i)];
+        --m_firstPosition;
+    } else {
+        for (int i = row + 1; i < m_list.size(); ++i)
+            ++m_positions[m_list.at(i)];
+    }
+    m_positions.insert(m_list.at(row), m_firstPosition + row);
+}
+
+// Called while the item is still in m_list at the row
+void WebOSSurfaceModel::removePosition(int row)
+{
+    m_positions.remove(m_list.at(row));
+    if (row < m_list.size() / 2) {
+        for (int i = 0; i < row; ++i)
+            ++m_positions[m_list.at(i)];
+        ++m_firstPosition;
+    } else {
+        for (int i = row + 1; i < m_list.size(); ++i)
+            --m_positions[m_list.at(i)];
+    }
+}
+
+void WebOSSurfaceModel::insertOrdered(QList<WebOSSurfaceItem*> &bucket, WebOSSurfaceItem *item)
+{
+    // Relative order of rows never changes once inserted, so a bucket sorted
+    // by position stays sorted across removals and only insertion needs a search.
+    auto pos = std::lower_bound(bucket.begin(), bucket.end(), m_positions.value(item),
+                                [this](WebOSSurfaceItem *i, int position) { return m_positions.value(i) < position; });
+    bucket.insert(pos, item);
+}
+
+void WebOSSurfaceModel::removeFromBucket(QHash<QString, QList<WebOSSurfaceItem*>> &index, const QString &key, WebOSSurfaceItem *item)
+{
+    auto it = index.find(key);
+    if (it == index.end())
+        return;
+    it.value().removeOne(item);
+    if (it.value().isEmpty())
+        index.erase(it);
+}
+
+void WebOSSurfaceModel::indexItem(WebOSSurfaceItem *item)
+{
+    IndexedKeys keys;
+    keys.appId = item->appId();
+    keys.type = item->type();
+    insertOrdered(m_appIdIndex[keys.appId], item);
+    insertOrdered(m_typeIndex[keys.type], item);
+    m_indexedKeys.insert(item, keys);
+
+    connect(item, SIGNAL(appIdChanged()), SLOT(handleItemKeyChange()), Qt::UniqueConnection);
+    connect(item, SIGNAL(typeChanged()), SLOT(handleItemKeyChange()), Qt::UniqueConnection);
+}
+
+void WebOSSurfaceModel::unindexItem(WebOSSurfaceItem *item)
+{
+    auto it = m_indexedKeys.find(item);
+    if (it != m_indexedKeys.end()) {
+        removeFromBucket(m_appIdIndex, it.value().appId, item);
+        removeFromBucket(m_typeIndex, it.value().type, item);
+        m_indexedKeys.erase(it);
+    }
+    m_dirtyItems.remove(item);
+
+    disconnect(item, SIGNAL(appIdChanged()), this, SLOT(handleItemKeyChange()));
+    disconnect(item, SIGNAL(typeChanged()), this, SLOT(handleItemKeyChange()));
+}
+
+void WebOSSurfaceModel::handleItemKeyChange()
+{
+    PMTRACE_FUNCTION;
+    WebOSSurfaceItem* item = static_cast<WebOSSurfaceItem*>(sender());
+    auto it = m_indexedKeys.find(item);
+    if (it == m_indexedKeys.end())
+        return;
+
+    const QString appId = item->appId();
+    const QString type = item->type();
+    if (it.value().appId != appId) {
+        removeFromBucket(m_appIdIndex, it.value().appId, item);
+        insertOrdered(m_appIdIndex[appId], item);
+        it.value().appId = appId;
+    }
+    if (it.value().type != type) {
+        removeFromBucket(m_typeIndex, it.value().type, item);
+        insertOrdered(m_typeIndex[type], item);
+        it.value().type = type;
+    }
 }
 
 void WebOSSurfaceModel::handleItemChange()
 {
     PMTRACE_FUNCTION;
     WebOSSurfaceItem* item = static_cast<WebOSSurfaceItem*>(sender());
+    if (m_coalesceDataChanged) {
+        if (!m_positions.contains(item))
+            return;
+        if (m_dirtyItems.isEmpty())
+            emit deferDataChanged();
+        m_dirtyItems.insert(item);
+        return;
+    }
+
     QModelIndex index = indexFromItem(item);
     if (index.isValid()) {
         if (m_dataDirty) {
@@ -204,6 +349,45 @@ void WebOSSurfaceModel::handleDeferDataChanged()
     m_firstDirtyIndex = m_lastDirtyIndex = 0;
 }
 
+void WebOSSurfaceModel::notifyItemChanged(const WebOSSurfaceItem *item)
+{
+    const int row = rowOf(item);
+    if (row >= 0)
+        emit dataChanged(index(row), index(row), QVector<int>() << 0);
+}
+
+void WebOSSurfaceModel::flushDataChanged()
+{
+    PMTRACE_FUNCTION;
+    if (m_dirtyItems.isEmpty())
+        return;
+
+    // Items removed in the meantime are already dropped from m_dirtyItems
+    QVector<int> rows;
+    rows.reserve(m_dirtyItems.size());
+    foreach (const WebOSSurfaceItem *item, m_dirtyItems)
+        rows.append(rowOf(item));
+    m_dirtyItems.clear();
+    std::sort(rows.begin(), rows.end());
+
+    // Emit one signal per contiguous range of dirty rows rather than the
+    // whole span, so proxies only re-filter the rows that actually changed.
+    // Items whose filter depends on other items (e.g. transients) are fine
+    // as long as every item involved notifies its own change.
+    const QVector<int> changedRoles = QVector<int>() << 0;
+    int first = rows.first();
+    int last = first;
+    for (int i = 1; i <= rows.size(); ++i) {
+        if (i < rows.size() && rows.at(i) == last + 1) {
+            last = rows.at(i);
+            continue;
+        }
+        emit dataChanged(index(first), index(last), changedRoles);
+        if (i < rows.size())
+            first = last = rows.at(i);
+    }
+}
+
 void WebOSSurfaceModel::surfaceUnmapped(WebOSSurfaceItem *item)
 {
     PMTRACE_FUNCTION;
@@ -221,7 +405,7 @@ void WebOSSurfaceModel::surfaceMapped(WebOSSurfaceItem *item)
     if (!index.isValid())
         appendRow(item);
     else
-        qWarning() << "Item already exists in the model" << item;
+        qCWarning(lsmModel) << "Item already exists in the model" << item;
 }
 
 void WebOSSurfaceModel::surfaceDestroyed(WebOSSurfaceItem *item)
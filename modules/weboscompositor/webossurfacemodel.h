@@ -20,8 +20,8 @@
 #include <WebOSCoreCompositor/weboscompositorexport.h>
 
 #include <QAbstractListModel>
+#include <QSet>
 
-class WebOSSurfaceItem;
 class WebOSSurfaceItem;
 
 class WEBOS_COMPOSITOR_EXPORT WebOSSurfaceModel: public QAbstractListModel
@@ -52,6 +52,10 @@ public:
     WebOSSurfaceItem* surfaceItemForIndex(int index);
     WebOSSurfaceItem* getLastRecentItem();
 
+    // Emits dataChanged for the row of the item only, so that proxies
+    // re-filter and re-sort just that row
+    void notifyItemChanged(const WebOSSurfaceItem *item);
+
 public slots:
     void surfaceMapped(WebOSSurfaceItem* surface);
     void surfaceUnmapped(WebOSSurfaceItem* surface);
@@ -63,13 +67,44 @@ signals:
 private slots:
     void handleItemChange();
     void handleDeferDataChanged();
+    void handleItemKeyChange();
+    void flushDataChanged();
 
 private:
+    struct IndexedKeys {
+        QString appId;
+        QString type;
+    };
+
+    void indexItem(WebOSSurfaceItem *item);
+    void unindexItem(WebOSSurfaceItem *item);
+    int rowOf(const WebOSSurfaceItem *item) const;
+    void insertPosition(int row);
+    void removePosition(int row);
+    void insertOrdered(QList<WebOSSurfaceItem*> &bucket, WebOSSurfaceItem *item);
+    void removeFromBucket(QHash<QString, QList<WebOSSurfaceItem*>> &index, const QString &key, WebOSSurfaceItem *item);
+    WebOSSurfaceItem* firstOfType(const QString &type) const;
+
     bool m_dataDirty;
     int m_firstDirtyIndex;
     int m_lastDirtyIndex;
+    // Coalesced mode: dirty items are kept by pointer as rows may shift
+    // before the changes get flushed in the next event loop iteration.
+    bool m_coalesceDataChanged;
+    QSet<const WebOSSurfaceItem*> m_dirtyItems;
     QList<WebOSSurfaceItem*> m_list;
     QHash<int, QByteArray> roles;
+
+    // Lookup indexes over m_list. Buckets are kept in row order so that
+    // the first entry is the one a linear scan would have found.
+    // The row of an item is its position minus m_firstPosition. Inserting
+    // or removing a row renumbers only the shorter side, so it is O(1) at
+    // either end, where recent items come and go.
+    QHash<const WebOSSurfaceItem*, int> m_positions;
+    int m_firstPosition = 0;
+    QHash<QString, QList<WebOSSurfaceItem*>> m_appIdIndex;
+    QHash<QString, QList<WebOSSurfaceItem*>> m_typeIndex;
+    QHash<const WebOSSurfaceItem*, IndexedKeys> m_indexedKeys;
 };
 
 #endif // WEBOSSURFACEMODEL_H
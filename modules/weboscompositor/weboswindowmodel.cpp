@@ -1,4 +1,4 @@
-// Copyright (c) 2013-2018 LG Electronics, Inc.
+// Copyright (c) 2013-2024 LG Electronics, Inc.
 //
 // Licensed under the Apache License, Version 2.0 (the "License");
 // you may not use this file except in compliance with the License.
@@ -94,10 +94,134 @@ void WebOSWindowModel::setAcceptFunction(QString func) {
     }
 }
 
+void WebOSWindowModel::setAppIds(const QStringList &appIds)
+{
+    PMTRACE_FUNCTION;
+    if (appIds != m_appIds) {
+        m_appIds = appIds;
+        m_appIdSet.clear();
+        foreach (const QString &appId, m_appIds)
+            m_appIdSet.insert(appId);
+        deferInvalidate();
+        emit appIdsChanged();
+    }
+}
+
+void WebOSWindowModel::setDisplayId(int displayId)
+{
+    PMTRACE_FUNCTION;
+    if (displayId != m_displayId) {
+        m_displayId = displayId;
+        deferInvalidate();
+        emit displayIdChanged();
+    }
+}
+
+void WebOSWindowModel::setFullscreenOnly(bool fullscreenOnly)
+{
+    PMTRACE_FUNCTION;
+    if (fullscreenOnly != m_fullscreenOnly) {
+        m_fullscreenOnly = fullscreenOnly;
+        deferInvalidate();
+        emit fullscreenOnlyChanged();
+    }
+}
+
+void WebOSWindowModel::setItemStates(const QList<int> &states)
+{
+    PMTRACE_FUNCTION;
+    if (states != m_itemStates) {
+        m_itemStates = states;
+        deferInvalidate();
+        emit itemStatesChanged();
+    }
+}
+
+void WebOSWindowModel::setSortKeys(const QList<int> &keys)
+{
+    PMTRACE_FUNCTION;
+    if (keys != m_sortKeys) {
+        m_sortKeys = keys;
+        deferInvalidate();
+        emit sortKeysChanged();
+    }
+}
+
+void WebOSWindowModel::setSortDescending(bool descending)
+{
+    PMTRACE_FUNCTION;
+    if (descending != m_sortDescending) {
+        m_sortDescending = descending;
+        deferInvalidate();
+        emit sortDescendingChanged();
+    }
+}
+
+bool WebOSWindowModel::acceptsNatively(WebOSSurfaceItem *item) const
+{
+    if (!item)
+        return false;
+    if (m_displayId >= 0 && item->displayAffinity() != m_displayId)
+        return false;
+    if (m_fullscreenOnly && !item->fullscreen())
+        return false;
+    if (!m_appIdSet.isEmpty() && !m_appIdSet.contains(item->appId()))
+        return false;
+    if (!m_itemStates.isEmpty() && !m_itemStates.contains(item->itemState()))
+        return false;
+    return true;
+}
+
+template<typename T>
+static inline int compareValues(const T &a, const T &b)
+{
+    return a < b ? -1 : (b < a ? 1 : 0);
+}
+
+int WebOSWindowModel::compareNatively(WebOSSurfaceItem *left, WebOSSurfaceItem *right) const
+{
+    foreach (int key, m_sortKeys) {
+        int result = 0;
+        switch (key) {
+        case SortByFullscreenTick:
+            result = compareValues(left->lastFullscreenTick(), right->lastFullscreenTick());
+            break;
+        case SortByZ:
+            result = compareValues(left->z(), right->z());
+            break;
+        case SortByItemState:
+            result = compareValues((int)left->itemState(), (int)right->itemState());
+            break;
+        case SortByDisplayId:
+            result = compareValues(left->displayAffinity(), right->displayAffinity());
+            break;
+        default:
+            break;
+        }
+        if (result != 0)
+            return m_sortDescending ? -result : result;
+    }
+    return 0;
+}
+
 bool WebOSWindowModel::lessThan(const QModelIndex &left,
                                 const QModelIndex &right) const
 {
     PMTRACE_FUNCTION;
+    if (!m_sortKeys.isEmpty()) {
+        WebOSSurfaceItem* leftItem = sourceModel()->data(left).value<WebOSSurfaceItem*>();
+        WebOSSurfaceItem* rightItem = sourceModel()->data(right).value<WebOSSurfaceItem*>();
+        if (leftItem && rightItem) {
+            int result = compareNatively(leftItem, rightItem);
+            // Keep the source order for equal keys
+            return result != 0 ? result < 0 : left.row() < right.row();
+        }
+    }
+
+    // No sorting requested, keep the source order
+    if (m_sortFunc.isEmpty())
+        return left.row() < right.row();
+
     QVariant leftData = sourceModel()->data(left);
     QVariant rightData = sourceModel()->data(right);
     QVariant returnedValue;
@@ -120,13 +244,19 @@ bool WebOSWindowModel::filterAcceptsRow(int sourceRow,
          const QModelIndex &sourceParent) const
 {
     PMTRACE_FUNCTION;
+    bool hasNativeFilter = m_displayId >= 0 || m_fullscreenOnly ||
+                           !m_appIdSet.isEmpty() || !m_itemStates.isEmpty();
+
     // no filters defined, accept all window types
-    if(windowType().isEmpty() && m_acceptFunc.isEmpty()) {
+    if(windowType().isEmpty() && m_acceptFunc.isEmpty() && !hasNativeFilter) {
         return true;
     }
 
     QModelIndex index0 = sourceModel()->index(sourceRow, 0, sourceParent);
     WebOSSurfaceItem* item = sourceModel()->data(index0).value<WebOSSurfaceItem*>();
+    if (hasNativeFilter && !acceptsNatively(item))
+        return false;
+
     bool accepts = false;
     if (!m_acceptFunc.isEmpty()) {
         QVariant returnedValue;
@@ -134,8 +264,10 @@ bool WebOSWindowModel::filterAcceptsRow(int sourceRow,
                 Q_RETURN_ARG(QVariant, returnedValue),
                 Q_ARG(QVariant, QVariant::fromValue(item)));
         accepts = returnedValue.toBool();
-    } else {
+    } else if (!windowType().isEmpty()) {
         accepts = item->type() == windowType();
+    } else {
+        accepts = true;
     }
     return accepts;
 }
@@ -211,9 +343,10 @@ void WebOSWindowModel::setLocked(bool locked)
 
     m_locked = locked;
     setDynamicSortFilter(!m_locked);
-    // After set the dynamicSortFilter, the model should be filtered again.
+    // After set the dynamicSortFilter, the model should be filtered and
+    // sorted again, as changes while locked were not applied.
     if (!m_locked)
-        invalidateFilter();
+        invalidate();
 
     emit lockedChanged();
 }
@@ -23,6 +23,8 @@
 #include <QSortFilterProxyModel>
 #include <QList>
 #include <QHash>
+#include <QSet>
+#include <QStringList>
 
 class WebOSSurfaceModel;
 class WebOSSurfaceItem;
@@ -41,7 +43,26 @@ class WEBOS_COMPOSITOR_EXPORT WebOSWindowModel : public QSortFilterProxyModel {
     Q_PROPERTY(int count READ count NOTIFY countChanged);
     Q_PROPERTY(bool locked READ locked WRITE setLocked NOTIFY lockedChanged);
 
+    // Native predicates, evaluated without calling back into QML.
+    // All of the set ones must match, on top of acceptFunction if any.
+    Q_PROPERTY(QStringList appIds READ appIds WRITE setAppIds NOTIFY appIdsChanged);
+    Q_PROPERTY(int displayId READ displayId WRITE setDisplayId NOTIFY displayIdChanged);
+    Q_PROPERTY(bool fullscreenOnly READ fullscreenOnly WRITE setFullscreenOnly NOTIFY fullscreenOnlyChanged);
+    Q_PROPERTY(QList<int> itemStates READ itemStates WRITE setItemStates NOTIFY itemStatesChanged);
+
+    // Native sort keys, compared in order. Takes precedence over sortFunction.
+    Q_PROPERTY(QList<int> sortKeys READ sortKeys WRITE setSortKeys NOTIFY sortKeysChanged);
+    Q_PROPERTY(bool sortDescending READ sortDescending WRITE setSortDescending NOTIFY sortDescendingChanged);
+
 public:
+    enum SortKey {
+        SortByFullscreenTick = 1,
+        SortByZ,
+        SortByItemState,
+        SortByDisplayId
+    };
+    Q_ENUM(SortKey)
+
     WebOSWindowModel();
     ~WebOSWindowModel();
 
@@ -68,6 +89,24 @@ public:
     bool locked();
     void setLocked(bool);
 
+    QStringList appIds() const { return m_appIds; }
+    void setAppIds(const QStringList &appIds);
+
+    int displayId() const { return m_displayId; }
+    void setDisplayId(int displayId);
+
+    bool fullscreenOnly() const { return m_fullscreenOnly; }
+    void setFullscreenOnly(bool fullscreenOnly);
+
+    QList<int> itemStates() const { return m_itemStates; }
+    void setItemStates(const QList<int> &states);
+
+    QList<int> sortKeys() const { return m_sortKeys; }
+    void setSortKeys(const QList<int> &keys);
+
+    bool sortDescending() const { return m_sortDescending; }
+    void setSortDescending(bool descending);
+
 signals:
     void windowTypeChanged();
     void surfaceSourceChanged();
@@ -78,6 +117,12 @@ signals:
     void surfaceRemovalFinished();
     void countChanged();
     void lockedChanged();
+    void appIdsChanged();
+    void displayIdChanged();
+    void fullscreenOnlyChanged();
+    void itemStatesChanged();
+    void sortKeysChanged();
+    void sortDescendingChanged();
     void deferredInvalidate();
     void invalidated();
 
@@ -85,6 +130,8 @@ protected:
     virtual bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
     bool lessThan(const QModelIndex &left, const QModelIndex &right) const override;
     void deferInvalidate();
+    bool acceptsNatively(WebOSSurfaceItem *item) const;
+    int compareNatively(WebOSSurfaceItem *left, WebOSSurfaceItem *right) const;
 
 protected slots:
     void emitSurfacesRemoved(const QModelIndex & parent, int start, int end);
@@ -100,6 +147,14 @@ private:
     QString m_sortFunc;
     QString m_acceptFunc;
     bool m_locked;
+
+    QStringList m_appIds;
+    QSet<QString> m_appIdSet;
+    int m_displayId = -1;
+    bool m_fullscreenOnly = false;
+    QList<int> m_itemStates;
+    QList<int> m_sortKeys;
+    bool m_sortDescending = false;
 };
 
 #endif